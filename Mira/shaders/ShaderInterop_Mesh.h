@@ -7,4 +7,24 @@ struct ShaderInterop_SubmeshMD
 	uint vert_count;
 	uint index_start;
 	uint index_count;
+
+	float3 bounds_min;
+	float3 bounds_extent;
+
+	uint meshlet_start;
+	uint meshlet_count;
+};
+
+struct ShaderInterop_Meshlet
+{
+	uint vert_offset;
+	uint vert_count;
+	uint prim_offset;
+	uint prim_count;
+	uint index_offset;
+
+	float3 center;
+	float radius;
+	float3 cone_axis;
+	float cone_cutoff;
 };
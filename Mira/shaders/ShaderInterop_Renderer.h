@@ -8,6 +8,10 @@ struct ShaderInterop_MeshTable
 	uint vert_nor_array;
 	uint vert_tangent_array;
 	uint submesh_md_array;
+
+	uint meshlet_array;
+	uint meshlet_vertex_array;
+	uint meshlet_triangle_array;
 };
 
 struct ShaderInterop_PerDraw
@@ -20,6 +20,32 @@ struct PushConstants
 
 ConstantBuffer<PushConstants> g_push_constants : register(b0, space0);
 
+#ifdef QUANTIZED_VERTICES
+// Decoders of VertexFormat::Quantized (VertexQuantization.cpp)
+float3 decode_position(uint2 packed, ShaderInterop_SubmeshMD submesh)
+{
+    const float3 unorm = float3(packed.x & 0xffff, packed.x >> 16, packed.y & 0xffff) / 65535.f;
+    return submesh.bounds_min + unorm * submesh.bounds_extent;
+}
+
+float3 decode_octahedral(uint packed)
+{
+    const int2 snorm = int2(packed << 16, packed) >> 16;
+    const float2 e = max(snorm / 32767.f, -1.f);
+
+    // Unfold the lower half
+    float3 n = float3(e, 1.f - abs(e.x) - abs(e.y));
+    const float t = saturate(-n.z);
+    n.xy -= t * (2.f * step(0.f, n.xy) - 1.f);
+    return normalize(n);
+}
+
+float2 decode_half2(uint packed)
+{
+    return f16tof32(uint2(packed, packed >> 16));
+}
+#endif
+
 
 VS_OUT main(uint vertex_id : SV_VertexID, uint instance_id : SV_InstanceID)
 {
@@ -41,13 +67,26 @@ VS_OUT main(uint vertex_id : SV_VertexID, uint instance_id : SV_InstanceID)
     vertex_id += submesh.vert_start;    // Add vertex offset to submesh within mesh
     
     // Grab vertex tables and vertex data
+#ifdef QUANTIZED_VERTICES
+    StructuredBuffer<uint2> positions = ResourceDescriptorHeap[mesh_table.vert_pos_array];
+    StructuredBuffer<uint> uvs = ResourceDescriptorHeap[mesh_table.vert_uv_array];
+    StructuredBuffer<uint> normals = ResourceDescriptorHeap[mesh_table.vert_nor_array];
+    StructuredBuffer<uint> tangents = ResourceDescriptorHeap[mesh_table.vert_tangent_array];
+    const float3 position = decode_position(positions[vertex_id], submesh);
+    const float2 uv = decode_half2(uvs[vertex_id]);
+    const float3 normal = decode_octahedral(normals[vertex_id]);
+#else
     StructuredBuffer<float3> positions = ResourceDescriptorHeap[mesh_table.vert_pos_array];
     StructuredBuffer<float2> uvs = ResourceDescriptorHeap[mesh_table.vert_uv_array];
     StructuredBuffer<float3> normals = ResourceDescriptorHeap[mesh_table.vert_nor_array];
     StructuredBuffer<float3> tangents = ResourceDescriptorHeap[mesh_table.vert_tangent_array];
-    output.position = mul(per_frame_data.projection_matrix, mul(per_frame_data.view_matrix, mul(per_draw_data.world_matrix, float4(positions[vertex_id], 1.f))));
-    output.uv = uvs[vertex_id];
-    output.normal = mul(per_draw_data.world_matrix, float4(normals[vertex_id], 1.f));
+    const float3 position = positions[vertex_id];
+    const float2 uv = uvs[vertex_id];
+    const float3 normal = normals[vertex_id];
+#endif
+    output.position = mul(per_frame_data.projection_matrix, mul(per_frame_data.view_matrix, mul(per_draw_data.world_matrix, float4(position, 1.f))));
+    output.uv = uv;
+    output.normal = mul(per_draw_data.world_matrix, float4(normal, 1.f));
         
     return output;
 }
\ No newline at end of file
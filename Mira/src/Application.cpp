@@ -4,21 +4,30 @@
 #include "RHI/DX12/RenderDevice_DX12.h"
 #include "RHI/DX12/RenderBackend_DX12.h"
 #include "RHI/PipelineBuilder.h"
+#include "RHI/Capture/RenderDevice_Capture.h"
 #include "Window/Window.h"
 
 #include "Rendering/GPUGarbageBin.h"
 #include "Rendering/GPUConstantManager.h"
 #include "Rendering/MeshManager.h"
 #include "Rendering/TextureManager.h"
+#include "Rendering/RenderGraph.h"
+#include "Rendering/QueueScheduler.h"
+#include "Rendering/ClusterCuller.h"
+#include "Profiling/Profiler.h"
+#include "Profiling/CPUProfiler.h"
+#include "Threading/ThreadPool.h"
 
 #include "Resource/AssimpImporter.h"
 #include "Resource/TextureImporter.h"
 
+#include <iostream>
+
 
 #include "../shaders/ShaderInterop_Renderer.h"
 
 
-Application::Application()
+Application::Application(std::optional<CaptureSettings> capture, std::optional<std::filesystem::path> profile_path)
 {
 	const UINT c_width = 1600;
 	const UINT c_height = 900;
@@ -26,61 +35,56 @@ Application::Application()
 	auto win_proc_callback = [this](HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) -> LRESULT { return this->window_proc(hwnd, uMsg, wParam, lParam); };
 	m_window = std::make_unique<Window>(GetModuleHandle(NULL), win_proc_callback, c_width, c_height);
 
-	auto sclr = std::make_unique<mira::ShaderCompiler_DXC>();
+	// Shared by everything that runs work on other threads, outlives all of them
+	mira::ThreadPool workers;
+
+	auto sclr = std::make_unique<mira::ShaderCompiler_DXC>(workers);
 #ifdef _DEBUG
-	auto be_dx = std::make_unique<mira::RenderBackend_DX12>(true);
+	auto be_dx = std::make_unique<mira::RenderBackend_DX12>(workers, true);
 #else
-	auto be_dx = std::make_unique<mira::RenderBackend_DX12>(false);
+	auto be_dx = std::make_unique<mira::RenderBackend_DX12>(workers, false);
 #endif
-	auto rd = be_dx->create_device();
-
-
-	std::array<mira::Texture, 2> bb_textures;
-	std::array<mira::TextureView, 2> bb_rts;
-	std::array<mira::RenderPass, 2> bb_rps;
-
-	// Create swapchain (requires at least 2 buffers)
-	mira::SwapChain* sc = rd->create_swapchain(m_window->get_hwnd(), 2);
+	mira::RenderDevice* rd = be_dx->create_device();
 
-	// Create depth texture (single)
-	mira::Texture depth_tex;
-	mira::TextureView depth_view;
+	// Record from device creation onwards so that everything the captured frames depend on is part of the capture
+	std::unique_ptr<mira::RenderDevice_Capture> capture_rd;
+	if (capture.has_value())
 	{
-		mira::TextureDesc desc{};
-		desc.width = c_width;
-		desc.height = c_height;
-		desc.usage = mira::UsageIntent::DepthStencil;
-		desc.format = mira::ResourceFormat::D32_FLOAT;
-		depth_tex = rd->create_texture(desc);
-
-		depth_view = rd->create_view(depth_tex,
-			mira::TextureViewDesc(
-				mira::ViewType::DepthStencil, 
-				mira::TextureViewRange(mira::TextureViewDimension::Texture2D, mira::ResourceFormat::D32_FLOAT).set_mips(0, 1)));
+		capture_rd = std::make_unique<mira::RenderDevice_Capture>(rd, capture->path);
+		rd = capture_rd.get();
 	}
 
-	// Create backbuffer renderpasses
-	for (u32 i = 0; i < bb_rps.size(); ++i)
-	{
-		bb_textures[i] = sc->get_buffer(i);
+	// CPU records a frame while the GPU works on up to this many frames minus one
+	constexpr u8 MAX_FRAMES_IN_FLIGHT = 2;
 
-		bb_rts[i] = rd->create_view(bb_textures[i],
-			mira::TextureViewDesc(
-				mira::ViewType::RenderTarget,
-				mira::TextureViewRange(mira::TextureViewDimension::Texture2D, mira::ResourceFormat::RGBA_8_UNORM)));
+	// One more buffer than frames in flight so that presenting does not wait on the display
+	std::array<mira::Texture, MAX_FRAMES_IN_FLIGHT + 1> bb_textures;
 
-		bb_rps[i] = rd->create_renderpass(mira::RenderPassBuilder()
-			.append_rt(bb_rts[i], mira::RenderPassBeginAccessType::Clear, mira::RenderPassEndingAccessType::Preserve)
-			.add_depth_stencil(depth_view, 
-				mira::RenderPassBeginAccessType::Clear, mira::RenderPassEndingAccessType::Discard,		// depth
-				mira::RenderPassBeginAccessType::Discard, mira::RenderPassEndingAccessType::Discard)	// stencil
-			.build());
-	}
+	// Create swapchain (requires at least 2 buffers)
+	mira::SwapChain* sc = rd->create_swapchain(m_window->get_hwnd(), (u8)bb_textures.size());
+	for (u32 i = 0; i < bb_textures.size(); ++i)
+		bb_textures[i] = sc->get_buffer(i);
+
+	// Depth is only needed within the frame, it is owned by the render graph
+	mira::TextureDesc depth_desc{};
+	depth_desc.width = c_width;
+	depth_desc.height = c_height;
+	depth_desc.usage = mira::UsageIntent::DepthStencil;
+	depth_desc.format = mira::ResourceFormat::D32_FLOAT;
 	
+	// Vertex attributes are stored quantized, the vertex shader decodes them
+	constexpr mira::VertexFormat VERTEX_FORMAT = mira::VertexFormat::Quantized;
+
 	// Create mesh pipeline
 	mira::Pipeline mesh_pipe;
 	{
-		auto vs = sclr->compile_from_file("mesh_vs.hlsl", mira::ShaderType::Vertex);
+		mira::ShaderCompileRequest vs_request{};
+		vs_request.rel_path = "mesh_vs.hlsl";
+		vs_request.type = mira::ShaderType::Vertex;
+		if (VERTEX_FORMAT == mira::VertexFormat::Quantized)
+			vs_request.defines.push_back({ "QUANTIZED_VERTICES", "1" });
+
+		auto vs = sclr->compile(vs_request);
 		auto ps = sclr->compile_from_file("mesh_ps.hlsl", mira::ShaderType::Pixel);
 
 		mesh_pipe = rd->create_graphics_pipeline(mira::GraphicsPipelineBuilder()
@@ -95,19 +99,23 @@ Application::Application()
 			.build());
 	}
 
-	mira::GPUGarbageBin bin(1);
+	// Deletions are deferred until the frames which may still use the resources have completed
+	mira::GPUGarbageBin bin(rd);
 
 	// Create constant data helper
 	mira::GPUConstantManager constant_mgr(rd, &bin, 3);
 
 	// Initialize mesh manager
+	constexpr u32 MAX_VERTICES = 1'000'000;
 	mira::MeshManager::SizeSpecification spec{};
 	spec.index_buffer_size = sizeof(u32) * 10'000'000;
 	spec.staging_size = 15'000'000;
-	spec.buffer_sizes[mira::VertexAttribute::Position] = 10'000'000;
-	spec.buffer_sizes[mira::VertexAttribute::UV] = 10'000'000;
-	spec.buffer_sizes[mira::VertexAttribute::Normal] = 10'000'000;
-	spec.buffer_sizes[mira::VertexAttribute::Tangent] = 10'000'000;
+	spec.vertex_format = VERTEX_FORMAT;
+	for (auto attr : { mira::VertexAttribute::Position, mira::VertexAttribute::UV, mira::VertexAttribute::Normal, mira::VertexAttribute::Tangent })
+		spec.buffer_sizes[attr] = MAX_VERTICES * mira::MeshManager::get_stride(attr, VERTEX_FORMAT);
+	spec.meshlet_buffer_size = sizeof(mira::Meshlet) * 50'000;
+	spec.meshlet_vertex_buffer_size = sizeof(u32) * 2 * MAX_VERTICES;
+	spec.meshlet_triangle_buffer_size = sizeof(u32) * 10'000'000 / 3;
 	mira::MeshManager static_mesh_mgr(rd, &bin, spec);
 
 	// Load sponza
@@ -119,9 +127,12 @@ Application::Application()
 		mira::MeshManager::MeshSpecification load_spec{};
 		load_spec.indices = res->mesh.indices;
 		load_spec.submeshes = res->submeshes;
+		load_spec.meshlets = res->mesh.meshlets;
+		load_spec.meshlet_vertices = res->mesh.meshlet_vertices;
+		load_spec.meshlet_triangles = res->mesh.meshlet_triangles;
 		for (auto& [attr, mem] : res->mesh.vertex_data)
 			load_spec.data[attr] = mem;
-		sponza_mesh = static_mesh_mgr.load_mesh(load_spec);	
+		sponza_mesh = static_mesh_mgr.load_mesh_async(load_spec);
 	}
 
 	// Test texture importer
@@ -133,31 +144,58 @@ Application::Application()
 	// Test texture manager
 	mira::TextureManager tex_man(rd, &bin);
 	auto [tex_handle, tex_view] = tex_man.allocate("ultra", tex_res->data_per_mip);
+
+	// Views, render passes and barriers for the attachments are handled by the graph
+	mira::RenderGraph graph(rd, &bin);
+
+	// Places the waits between work on different queues
+	mira::QueueScheduler scheduler(rd);
+
+	mira::Profiler profiler;
+
+	// Draws only the meshlets in view and facing the camera
+	mira::ClusterCuller culler(workers);
+	std::vector<mira::ClusterDraw> cluster_draws;
 	
 
-	u32 count{ 0 };
-	std::array<mira::CommandList, 1> list_hdls;
+	// Uploads made while loading have to complete before the first frame runs the deletions they deferred
+	rd->flush();
+
+	u32 captured_frames{ 0 };
 
 	while (m_window->is_alive())
 	{
+		MIRA_PROFILE_FRAME(rd->get_current_frame());
+		MIRA_PROFILE_ZONE("Frame");
+
 		m_window->pump_messages();
 
-		// Wait for GPU
-		rd->flush();
+		// First boundary ends the prologue (resource creation and loading)
+		if (capture_rd && capture_rd->is_capturing())
+		{
+			if (captured_frames++ == capture->frames)
+				capture_rd->end_capture();
+			else
+				capture_rd->mark_frame_boundary();
+		}
 
-		if (count != 0)
-			rd->recycle_command_list(list_hdls[0]);
+		// Wait only if the GPU is MAX_FRAMES_IN_FLIGHT frames behind
+		rd->begin_frame(MAX_FRAMES_IN_FLIGHT);
 		bin.begin_frame();
+		static_mesh_mgr.begin_frame();
 
-		auto curr_bb = bb_textures[sc->get_next_draw_surface_idx()];
-		auto curr_bb_rp = bb_rps[sc->get_next_draw_surface_idx()];
+		// GPU timings trail a few frames behind
+		profiler.collect_cpu_events();
+		profiler.collect_gpu_timings(rd->get_gpu_timings());
 
-		mira::RenderCommandList list;
+		graph.begin_frame();
+		scheduler.begin_frame();
 
-		list.submit(mira::RenderCommandBarrier()
-			.append(mira::ResourceBarrier::transition(curr_bb, mira::ResourceState::Present, mira::ResourceState::RenderTarget, 0))
-			.append(mira::ResourceBarrier::transition(depth_tex, count++ == 0 ? mira::ResourceState::Common : mira::ResourceState::DepthRead, mira::ResourceState::DepthWrite, 0))
-		);
+		// Meshes are only drawn once is_ready, the frame does not depend on the uploads
+		static_mesh_mgr.schedule_uploads(scheduler);
+
+		auto bb = graph.import_texture(bb_textures[sc->get_next_draw_surface_idx()], mira::ResourceState::Present, mira::ResourceState::Present);
+		auto depth = graph.create_texture(depth_desc);
 	
 		auto [mem, mesh_table_view] = constant_mgr.allocate_transient(sizeof(ShaderInterop_MeshTable));
 		((ShaderInterop_MeshTable*)mem)->submesh_md_array = static_mesh_mgr.get_submesh_metadata_buffer();
@@ -165,57 +203,96 @@ Application::Application()
 		((ShaderInterop_MeshTable*)mem)->vert_uv_array = static_mesh_mgr.get_attribute_buffer(mira::VertexAttribute::UV);
 		((ShaderInterop_MeshTable*)mem)->vert_nor_array = static_mesh_mgr.get_attribute_buffer(mira::VertexAttribute::Normal);
 		((ShaderInterop_MeshTable*)mem)->vert_tangent_array = static_mesh_mgr.get_attribute_buffer(mira::VertexAttribute::Tangent);
+		((ShaderInterop_MeshTable*)mem)->meshlet_array = static_mesh_mgr.get_meshlet_buffer();
+		((ShaderInterop_MeshTable*)mem)->meshlet_vertex_array = static_mesh_mgr.get_meshlet_vertex_buffer();
+		((ShaderInterop_MeshTable*)mem)->meshlet_triangle_array = static_mesh_mgr.get_meshlet_triangle_buffer();
 		
-		auto [frame_mem, frame_view] = constant_mgr.allocate_transient(sizeof(ShaderInterop_PerFrame));
-		((ShaderInterop_PerFrame*)frame_mem)->view_matrix = DirectX::XMMatrixLookAtLH({ 3.f, 4.f, 0.f }, { -2.f, 3.f, 2.f }, { 0.f, 1.f, 0.f });
+		const DirectX::XMFLOAT3 camera_position(3.f, 4.f, 0.f);
+		const DirectX::XMMATRIX world_matrix = DirectX::XMMatrixScaling(0.07f, 0.07f, 0.07f);
 
+		const DirectX::XMMATRIX view_matrix = DirectX::XMMatrixLookAtLH(DirectX::XMLoadFloat3(&camera_position), { -2.f, 3.f, 2.f }, { 0.f, 1.f, 0.f });
 #ifdef USE_REVERSE_Z
-		((ShaderInterop_PerFrame*)frame_mem)->projection_matrix = DirectX::XMMatrixPerspectiveFovLH(80.f * 3.1415 / 180.f, (float)c_width / c_height, 500.f, 1.f);
+		const DirectX::XMMATRIX projection_matrix = DirectX::XMMatrixPerspectiveFovLH(80.f * 3.1415 / 180.f, (float)c_width / c_height, 500.f, 1.f);
 #else
-		((ShaderInterop_PerFrame*)frame_mem)->projection_matrix = DirectX::XMMatrixPerspectiveFovLH(80.f * 3.1415 / 180.f, (float)c_width / c_height, 0.1f, 500.f);
+		const DirectX::XMMATRIX projection_matrix = DirectX::XMMatrixPerspectiveFovLH(80.f * 3.1415 / 180.f, (float)c_width / c_height, 0.1f, 500.f);
 #endif
-	
-		// Draw
-		list.submit(mira::RenderCommandBeginRenderPass(curr_bb_rp));
-		{
-			// Testing: Using same PerDraw data for all submeshes
-			auto [draw_mem, draw_view] = constant_mgr.allocate_transient(sizeof(ShaderInterop_PerDraw));
-			((ShaderInterop_PerDraw*)draw_mem)->world_matrix = DirectX::XMMatrixScaling(0.07f, 0.07f, 0.07f);
 
-			list.submit(mira::RenderCommandSetPipeline(mesh_pipe));
-			for (u32 sm = 0; sm < sponza_mesh.num_submeshes; ++sm)
-			{
-				list.submit(mira::RenderCommandUpdateShaderArgs()
-					.append_constant(mesh_table_view)
-					.append_constant(static_mesh_mgr.get_submesh_metadata_index(sponza_mesh.mesh, sm))
-					.append_constant(frame_view)
-					.append_constant(draw_view)
-					.append_constant(tex_view)
-				);
-
-				const auto& submesh_md = static_mesh_mgr.get_submesh_metadata(sponza_mesh.mesh, sm);
-				
-				list.submit(mira::RenderCommandDrawIndexed(static_mesh_mgr.get_index_buffer(), submesh_md.index_count, 1, submesh_md.index_start, 0, 0));
-			}
-		}
-		list.submit(mira::RenderCommandEndRenderPass());
+		auto [frame_mem, frame_view] = constant_mgr.allocate_transient(sizeof(ShaderInterop_PerFrame));
+		((ShaderInterop_PerFrame*)frame_mem)->view_matrix = view_matrix;
+		((ShaderInterop_PerFrame*)frame_mem)->projection_matrix = projection_matrix;
 
-		list.submit(mira::RenderCommandBarrier()
-			.append(mira::ResourceBarrier::transition(curr_bb, mira::ResourceState::RenderTarget, mira::ResourceState::Present, 0))
-			.append(mira::ResourceBarrier::transition(depth_tex, mira::ResourceState::DepthWrite, mira::ResourceState::DepthRead, 0))
-		);
+		// Cull on the CPU, before recording
+		cluster_draws.clear();
+		if (static_mesh_mgr.is_ready(sponza_mesh.mesh))
+		{
+			mira::ClusterCuller::View cull_view{};
+			DirectX::XMStoreFloat4x4((DirectX::XMFLOAT4X4*)cull_view.view_projection.data(), view_matrix * projection_matrix);
+			cull_view.camera_position = { camera_position.x, camera_position.y, camera_position.z };
+
+			std::array<f32, 16> world{};
+			DirectX::XMStoreFloat4x4((DirectX::XMFLOAT4X4*)world.data(), world_matrix);
 
-		list_hdls[0] = rd->allocate_command_list(mira::QueueType::Graphics);
-		rd->compile_command_list(list_hdls[0], list);
-		rd->submit_command_lists(list_hdls);
+			culler.cull(cull_view, static_mesh_mgr, sponza_mesh, world, cluster_draws);
+		}
+	
+		// Draw
+		graph.add_pass("Geometry", [&](mira::RenderCommandList& list, const mira::RGExecuteContext&)
+			{
+				// Streamed in, drawn once its upload has completed
+				if (!static_mesh_mgr.is_ready(sponza_mesh.mesh))
+					return;
+
+				// Testing: Using same PerDraw data for all submeshes
+				auto [draw_mem, draw_view] = constant_mgr.allocate_transient(sizeof(ShaderInterop_PerDraw));
+				((ShaderInterop_PerDraw*)draw_mem)->world_matrix = world_matrix;
+
+				list.submit(mira::RenderCommandSetPipeline(mesh_pipe));
+				for (const auto& draw : cluster_draws)
+				{
+					list.submit(mira::RenderCommandUpdateShaderArgs()
+						.append_constant(mesh_table_view)
+						.append_constant(static_mesh_mgr.get_submesh_metadata_index(sponza_mesh.mesh, draw.submesh))
+						.append_constant(frame_view)
+						.append_constant(draw_view)
+						.append_constant(tex_view)
+					);
+
+					list.submit(mira::RenderCommandDrawIndexed(static_mesh_mgr.get_index_buffer(), draw.index_count, 1, draw.index_start, 0, 0));
+				}
+			})
+			.add_render_target(bb, mira::TextureViewRange(mira::TextureViewDimension::Texture2D, mira::ResourceFormat::RGBA_8_UNORM),
+				mira::RenderPassBeginAccessType::Clear, mira::RenderPassEndingAccessType::Preserve)
+			.set_depth_stencil(depth, mira::TextureViewRange(mira::TextureViewDimension::Texture2D, mira::ResourceFormat::D32_FLOAT).set_mips(0, 1),
+				mira::RenderPassBeginAccessType::Clear, mira::RenderPassEndingAccessType::Discard);
+
+		auto list = graph.execute();
+		MIRA_PROFILE_COUNTER("Frame commands", list.get_commands().size());
+
+		auto list_hdl = rd->allocate_command_list(mira::QueueType::Graphics);
+		rd->compile_command_list(list_hdl, list);
+		scheduler.add_batch("Frame", mira::QueueType::Graphics, { list_hdl });
+		scheduler.submit();
+		profiler.add_events(rd->get_current_frame(), scheduler.get_profile_events());
+
+		// Recorded memory is reused once the GPU is done with the frame
+		bin.push_deferred_deletion(list_hdl);
+
+		constant_mgr.end_frame();
 
 		// present to swapchain
 		sc->present(false);
-
-		bin.end_frame();
+		rd->end_frame();
 	}
 
 	rd->flush();
+
+	if (profile_path.has_value())
+	{
+		profiler.collect_cpu_events();
+		std::cout << profiler.format_summary();
+		if (!profiler.write_trace(*profile_path))
+			std::cout << "Failed to write profile to " << profile_path->string() << "\n";
+	}
 }
 
 void Application::run()
@@ -5,7 +5,15 @@
 class Application
 {
 public:
-	Application();
+	struct CaptureSettings
+	{
+		std::filesystem::path path;
+		u32 frames{ 1 };
+	};
+
+public:
+	// Profiled scopes of the last frames are written to 'profile_path' on exit
+	Application(std::optional<CaptureSettings> capture = std::nullopt, std::optional<std::filesystem::path> profile_path = std::nullopt);
 
 	void run();
 
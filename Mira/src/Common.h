@@ -10,6 +10,8 @@
 #include <variant>
 #include <span>
 #include <functional>
+#include <limits>
+#include <cstring>
 
 using f32 = float;
 using f64 = double;
@@ -50,6 +52,26 @@ static void try_insert_move(std::vector<std::optional<T>>& vec, T&& element, u32
 	vec[index] = std::move(element);
 }
 
+// FNV-1a, for hashing plain data (e.g caching keys). Hash padding-free fields individually rather than whole structs.
+static u64 hash_bytes(const void* data, size_t size, u64 seed = 14695981039346656037ull)
+{
+	u64 hash = seed;
+	const u8* bytes = (const u8*)data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+template <typename T>
+static u64 hash_combine(u64 seed, const T& value)
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+	return hash_bytes(&value, sizeof(T), seed);
+}
+
 template <typename T>
 static const T& try_get(const std::vector<std::optional<T>>& vec, u32 index)
 {
@@ -67,3 +89,19 @@ static T& try_get(std::vector<std::optional<T>>& vec, u32 index)
 }
 
 
+
+// Removes the entry of 'handle' from a lookup which may hold several handles with the same hash
+template <typename H>
+static void erase_lookup(std::unordered_multimap<u64, H>& lookup, u64 hash, H handle)
+{
+	auto [first, last] = lookup.equal_range(hash);
+	for (auto it = first; it != last; ++it)
+	{
+		if (it->second.handle == handle.handle)
+		{
+			lookup.erase(it);
+			return;
+		}
+	}
+	assert(false);
+}
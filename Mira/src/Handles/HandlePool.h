@@ -2,6 +2,7 @@
 #include <stdint.h>
 #include <vector>
 #include <stack>
+#include <limits>
 #include <assert.h>
 
 namespace mira
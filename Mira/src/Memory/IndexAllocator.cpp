@@ -0,0 +1,53 @@
+#include "IndexAllocator.h"
+
+namespace mira
+{
+	IndexAllocator::IndexAllocator(u32 capacity) :
+		m_capacity(capacity),
+		m_next(std::make_unique<std::atomic<u32>[]>(capacity))
+	{
+		assert(capacity < EMPTY);
+	}
+
+	std::optional<u32> IndexAllocator::allocate()
+	{
+		// Reuse a freed index
+		u64 head = m_head.load(std::memory_order_acquire);
+		while (get_index(head) != EMPTY)
+		{
+			const u32 index = get_index(head);
+			const u32 next = m_next[index].load(std::memory_order_relaxed);
+			if (m_head.compare_exchange_weak(head, pack(get_tag(head) + 1, next), std::memory_order_acquire, std::memory_order_acquire))
+			{
+				m_num_allocated.fetch_add(1, std::memory_order_relaxed);
+				return index;
+			}
+		}
+
+		// Take one which has never been used
+		u32 index = m_bump.load(std::memory_order_relaxed);
+		while (index < m_capacity)
+		{
+			if (m_bump.compare_exchange_weak(index, index + 1, std::memory_order_relaxed))
+			{
+				m_num_allocated.fetch_add(1, std::memory_order_relaxed);
+				return index;
+			}
+		}
+
+		return {};
+	}
+
+	void IndexAllocator::free(u32 index)
+	{
+		assert(index < m_bump.load(std::memory_order_relaxed));
+
+		u64 head = m_head.load(std::memory_order_relaxed);
+		do
+		{
+			m_next[index].store(get_index(head), std::memory_order_relaxed);
+		} while (!m_head.compare_exchange_weak(head, pack(get_tag(head) + 1, index), std::memory_order_release, std::memory_order_relaxed));
+
+		m_num_allocated.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
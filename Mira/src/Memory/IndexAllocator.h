@@ -0,0 +1,47 @@
+#pragma once
+#include "../Common.h"
+#include <atomic>
+
+namespace mira
+{
+	/*
+		Hands out single indices in [0, capacity) in O(1), safe to use from multiple threads without locking.
+
+		Freed indices are kept on a lock-free stack and reused first (most recently freed first), indices which were never
+		handed out are taken from a bump counter. The head of the stack is tagged with a counter which changes on every push and pop,
+		so that a head which was popped and pushed back in between is not mistaken for an unchanged one (ABA).
+	*/
+	class IndexAllocator
+	{
+	public:
+		IndexAllocator() = default;
+		IndexAllocator(u32 capacity);
+
+		IndexAllocator(const IndexAllocator&) = delete;
+		IndexAllocator& operator=(const IndexAllocator&) = delete;
+
+		// Empty once all indices are in use
+		[[nodiscard]] std::optional<u32> allocate();
+		void free(u32 index);
+
+		u32 get_capacity() const { return m_capacity; }
+		u32 get_num_allocated() const { return m_num_allocated.load(std::memory_order_relaxed); }
+
+	private:
+		static constexpr u32 EMPTY = std::numeric_limits<u32>::max();
+
+		static u64 pack(u32 tag, u32 index) { return ((u64)tag << 32) | index; }
+		static u32 get_tag(u64 head) { return (u32)(head >> 32); }
+		static u32 get_index(u64 head) { return (u32)head; }
+
+	private:
+		u32 m_capacity{ 0 };
+
+		// Free stack, each free index links to the one below it
+		std::unique_ptr<std::atomic<u32>[]> m_next;
+		std::atomic<u64> m_head{ pack(0, EMPTY) };
+
+		std::atomic<u32> m_bump{ 0 };
+		std::atomic<u32> m_num_allocated{ 0 };
+	};
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include "../Common.h"
+#include <new>
+
+namespace mira
+{
+	template <typename Signature, size_t Capacity = 64>
+	class InplaceFunction;
+
+	/*
+		Move-only std::function replacement which stores the callable inside the object, never on the heap.
+		Callables larger than the capacity fail to compile rather than falling back to an allocation.
+	*/
+	template <typename R, typename... Args, size_t Capacity>
+	class InplaceFunction<R(Args...), Capacity>
+	{
+	public:
+		InplaceFunction() = default;
+
+		template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InplaceFunction> && std::is_invocable_r_v<R, std::decay_t<F>&, Args...>>>
+		InplaceFunction(F&& func)
+		{
+			using Callable = std::decay_t<F>;
+			static_assert(sizeof(Callable) <= Capacity, "Callable does not fit, capture less or raise the capacity");
+			static_assert(alignof(Callable) <= alignof(std::max_align_t));
+			static_assert(std::is_nothrow_move_constructible_v<Callable>);
+
+			new (m_storage) Callable(std::forward<F>(func));
+			m_ops = &OPS<Callable>;
+		}
+
+		InplaceFunction(InplaceFunction&& other) noexcept
+		{
+			move_from(other);
+		}
+
+		InplaceFunction& operator=(InplaceFunction&& other) noexcept
+		{
+			if (this != &other)
+			{
+				reset();
+				move_from(other);
+			}
+			return *this;
+		}
+
+		InplaceFunction(const InplaceFunction&) = delete;
+		InplaceFunction& operator=(const InplaceFunction&) = delete;
+
+		~InplaceFunction() { reset(); }
+
+		R operator()(Args... args)
+		{
+			assert(m_ops != nullptr);
+			return m_ops->invoke(m_storage, std::forward<Args>(args)...);
+		}
+
+		explicit operator bool() const { return m_ops != nullptr; }
+
+		void reset()
+		{
+			if (m_ops)
+				m_ops->destroy(m_storage);
+			m_ops = nullptr;
+		}
+
+	private:
+		struct Ops
+		{
+			R(*invoke)(void*, Args&&...);
+			void(*move)(void* dst, void* src);		// Move constructs into dst and destroys src
+			void(*destroy)(void*);
+		};
+
+		template <typename Callable>
+		static constexpr Ops OPS
+		{
+			[](void* callable, Args&&... args) -> R { return (*(Callable*)callable)(std::forward<Args>(args)...); },
+			[](void* dst, void* src) { new (dst) Callable(std::move(*(Callable*)src)); ((Callable*)src)->~Callable(); },
+			[](void* callable) { ((Callable*)callable)->~Callable(); }
+		};
+
+		void move_from(InplaceFunction& other)
+		{
+			if (!other.m_ops)
+				return;
+
+			other.m_ops->move(m_storage, other.m_storage);
+			m_ops = other.m_ops;
+			other.m_ops = nullptr;
+		}
+
+	private:
+		alignas(std::max_align_t) u8 m_storage[Capacity];
+		const Ops* m_ops{ nullptr };
+	};
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "../Common.h"
+
+namespace mira
+{
+	/*
+		Ring over [0, size) which is allocated linearly and freed in bulk, from the oldest allocation onwards.
+
+		Positions only ever grow, offsets into the ring are taken modulo the size.
+		Allocations are contiguous: one which does not fit before the end of the ring starts over at the beginning.
+	*/
+	class VirtualLinearRing
+	{
+	public:
+		VirtualLinearRing() = default;
+		VirtualLinearRing(u64 size) : m_size(size) {}
+
+		// Offset into the ring, -1 if there is no room left
+		[[nodiscard]] u64 allocate(u64 size)
+		{
+			assert(size <= m_size);
+
+			// Skip the remainder at the end of the ring
+			u64 start = m_head;
+			if (start % m_size + size > m_size)
+				start += m_size - start % m_size;
+
+			// Nothing in use, the skipped remainder is free as well
+			if (m_tail == m_head)
+				m_tail = start;
+
+			if (start + size - m_tail > m_size)
+				return (u64)-1;
+
+			m_head = start + size;
+			return start % m_size;
+		}
+
+		// Frees everything allocated before 'position' (a previous head)
+		void free_until(u64 position)
+		{
+			assert(position <= m_head);
+			if (position > m_tail)
+				m_tail = position;
+		}
+
+		u64 get_head() const { return m_head; }
+		u64 get_size() const { return m_size; }
+		u64 get_num_used() const { return m_head - m_tail; }
+
+	private:
+		u64 m_size{ 0 };
+
+		u64 m_head{ 0 };
+		u64 m_tail{ 0 };
+	};
+}
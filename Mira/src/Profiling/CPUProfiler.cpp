@@ -0,0 +1,158 @@
+#include "CPUProfiler.h"
+#include <atomic>
+#include <mutex>
+
+namespace mira
+{
+	namespace
+	{
+		// Single producer (the owning thread), single consumer (the drain)
+		struct ThreadBuffer
+		{
+			std::array<CPUProfiler::Event, CPUProfiler::BUFFER_CAPACITY> events;
+			std::atomic<u64> write{ 0 };
+			std::atomic<u64> read{ 0 };
+
+			u32 thread{ 0 };
+			std::string name;		// Guarded by the registry mutex
+			u8 depth{ 0 };			// Owning thread only
+		};
+
+		// Buffers outlive their threads so that events recorded just before a thread exits are still drained
+		struct Registry
+		{
+			std::mutex mutex;
+			std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+			std::atomic<u64> num_dropped{ 0 };
+
+			// Reference point of the tick to steady_clock conversion, the rate is measured against it on every drain
+			const u64 reference_ticks{ CPUProfiler::get_ticks() };
+			const u64 reference_ns{ CPUProfiler::get_time_ns() };
+		};
+
+		Registry& get_registry()
+		{
+			static Registry registry;
+			return registry;
+		}
+
+		thread_local ThreadBuffer* t_buffer = nullptr;
+
+		ThreadBuffer& get_thread_buffer()
+		{
+			if (!t_buffer)
+			{
+				auto& registry = get_registry();
+				std::lock_guard lock(registry.mutex);
+				auto buffer = std::make_unique<ThreadBuffer>();
+				buffer->thread = (u32)registry.buffers.size();
+				t_buffer = buffer.get();
+				registry.buffers.push_back(std::move(buffer));
+			}
+			return *t_buffer;
+		}
+
+		void append(const CPUProfiler::Event& event)
+		{
+			auto& buffer = get_thread_buffer();
+			const u64 write = buffer.write.load(std::memory_order_relaxed);
+			if (write - buffer.read.load(std::memory_order_acquire) >= CPUProfiler::BUFFER_CAPACITY)
+			{
+				get_registry().num_dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			buffer.events[write % CPUProfiler::BUFFER_CAPACITY] = event;
+			buffer.write.store(write + 1, std::memory_order_release);
+		}
+	}
+
+	void CPUProfiler::set_thread_name(const char* name)
+	{
+		auto& buffer = get_thread_buffer();
+		std::lock_guard lock(get_registry().mutex);
+		buffer.name = name;
+	}
+
+	void CPUProfiler::record_counter(const char* name, f64 value)
+	{
+		Event event{};
+		event.name = name;
+		event.start_ns = event.end_ns = get_ticks();
+		event.value = value;
+		event.type = EventType::Counter;
+		append(event);
+	}
+
+	void CPUProfiler::mark_frame(u64 frame)
+	{
+		Event event{};
+		event.name = "Frame";
+		event.start_ns = event.end_ns = get_ticks();
+		event.value = (f64)frame;
+		event.type = EventType::Frame;
+		append(event);
+	}
+
+	void CPUProfiler::drain(std::vector<ThreadEvents>& threads)
+	{
+		auto& registry = get_registry();
+		std::lock_guard lock(registry.mutex);
+
+#ifdef MIRA_PROFILE_USE_TSC
+		// The longer the program runs, the more precise the rate
+		const u64 elapsed_ticks = get_ticks() - registry.reference_ticks;
+		const u64 elapsed_ns = get_time_ns() - registry.reference_ns;
+		const f64 ns_per_tick = elapsed_ticks > 0 ? (f64)elapsed_ns / elapsed_ticks : 1.0;
+		auto to_ns = [&](u64 ticks) { return registry.reference_ns + (u64)((f64)(i64)(ticks - registry.reference_ticks) * ns_per_tick); };
+#else
+		auto to_ns = [](u64 ticks) { return ticks; };
+#endif
+
+		for (const auto& buffer : registry.buffers)
+		{
+			const u64 read = buffer->read.load(std::memory_order_relaxed);
+			const u64 write = buffer->write.load(std::memory_order_acquire);
+			if (read == write)
+				continue;
+
+			ThreadEvents thread_events{};
+			thread_events.thread = buffer->thread;
+			thread_events.thread_name = buffer->name;
+			thread_events.events.reserve(write - read);
+			for (u64 i = read; i < write; ++i)
+			{
+				auto event = buffer->events[i % BUFFER_CAPACITY];
+				event.start_ns = to_ns(event.start_ns);
+				event.end_ns = to_ns(event.end_ns);
+				thread_events.events.push_back(event);
+			}
+			threads.push_back(std::move(thread_events));
+
+			buffer->read.store(write, std::memory_order_release);
+		}
+	}
+
+	u64 CPUProfiler::get_num_dropped_events()
+	{
+		return get_registry().num_dropped.load(std::memory_order_relaxed);
+	}
+
+	u8 CPUProfiler::push_zone()
+	{
+		return get_thread_buffer().depth++;
+	}
+
+	void CPUProfiler::pop_zone(const char* name, u8 depth, u64 start_ticks)
+	{
+		Event event{};
+		event.name = name;
+		event.start_ns = start_ticks;
+		event.end_ns = get_ticks();
+		event.type = EventType::Zone;
+		event.depth = depth;
+
+		--get_thread_buffer().depth;
+		append(event);
+	}
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include "../Common.h"
+#include "ProfilingDefines.h"
+#include <chrono>
+#include <string>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define MIRA_PROFILE_USE_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace mira
+{
+	/*
+		Records CPU zones, counters and frame markers from any thread.
+
+		- Each thread appends to its own fixed-size buffer without locking, a single consumer drains them all (Profiler::collect_cpu_events).
+		- Only the name pointers are stored, names have to be string literals.
+		- A thread recording more than BUFFER_CAPACITY events between two drains drops the excess rather than blocking.
+		- Times are on the std::chrono::steady_clock timeline, same as the GPU timings.
+		  On x64 events are stamped with the (invariant) TSC, which is much cheaper to read, and converted when drained.
+
+		Record through the MIRA_PROFILE_* macros, which compile to nothing without MIRA_ENABLE_PROFILING.
+	*/
+	class CPUProfiler
+	{
+	public:
+		static constexpr u32 BUFFER_CAPACITY = 16384;
+
+		enum class EventType : u8
+		{
+			Zone,
+			Counter,
+			Frame
+		};
+
+		struct Event
+		{
+			const char* name{ nullptr };
+			u64 start_ns{ 0 };				// Ticks until drained
+			u64 end_ns{ 0 };
+			f64 value{ 0.0 };				// Counter value or frame number
+			EventType type{ EventType::Zone };
+			u8 depth{ 0 };					// Zone nesting on its thread
+		};
+
+		struct ThreadEvents
+		{
+			u32 thread{ 0 };				// Registration order, the first thread to record is 0
+			std::string thread_name;
+			std::vector<Event> events;		// In order of completion
+		};
+
+		class ScopedZone
+		{
+		public:
+			ScopedZone(const char* name) :
+				m_name(name),
+				m_depth(CPUProfiler::push_zone()),
+				m_start_ticks(CPUProfiler::get_ticks())
+			{
+			}
+
+			~ScopedZone() { CPUProfiler::pop_zone(m_name, m_depth, m_start_ticks); }
+
+			ScopedZone(const ScopedZone&) = delete;
+			ScopedZone& operator=(const ScopedZone&) = delete;
+
+		private:
+			const char* m_name{ nullptr };
+			u8 m_depth{ 0 };
+			u64 m_start_ticks{ 0 };
+		};
+
+	public:
+		static u64 get_time_ns()
+		{
+			return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		static u64 get_ticks()
+		{
+#ifdef MIRA_PROFILE_USE_TSC
+			return __rdtsc();
+#else
+			return get_time_ns();
+#endif
+		}
+
+		static void set_thread_name(const char* name);
+		static void record_counter(const char* name, f64 value);
+
+		// Everything recorded after the marker (on any thread) belongs to 'frame'
+		static void mark_frame(u64 frame);
+
+		// Appends the events recorded since the previous drain, one entry per thread with events
+		static void drain(std::vector<ThreadEvents>& threads);
+
+		static u64 get_num_dropped_events();
+
+	private:
+		static u8 push_zone();
+		static void pop_zone(const char* name, u8 depth, u64 start_ticks);
+	};
+}
+
+#define MIRA_PROFILE_CONCAT_INNER(a, b) a##b
+#define MIRA_PROFILE_CONCAT(a, b) MIRA_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef MIRA_ENABLE_PROFILING
+#define MIRA_PROFILE_ZONE(name) const mira::CPUProfiler::ScopedZone MIRA_PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define MIRA_PROFILE_FUNCTION() MIRA_PROFILE_ZONE(__FUNCTION__)
+#define MIRA_PROFILE_COUNTER(name, value) mira::CPUProfiler::record_counter(name, (f64)(value))
+#define MIRA_PROFILE_FRAME(frame) mira::CPUProfiler::mark_frame(frame)
+#define MIRA_PROFILE_THREAD(name) mira::CPUProfiler::set_thread_name(name)
+#else
+#define MIRA_PROFILE_ZONE(name)
+#define MIRA_PROFILE_FUNCTION()
+#define MIRA_PROFILE_COUNTER(name, value)
+#define MIRA_PROFILE_FRAME(frame)
+#define MIRA_PROFILE_THREAD(name)
+#endif
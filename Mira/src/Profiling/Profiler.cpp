@@ -0,0 +1,316 @@
+#include "Profiler.h"
+#include "CPUProfiler.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+namespace mira
+{
+	namespace
+	{
+		const char* get_gpu_track_name(QueueType queue)
+		{
+			switch (queue)
+			{
+			case QueueType::Graphics:
+				return "GPU Graphics";
+			case QueueType::Compute:
+				return "GPU Compute";
+			case QueueType::Copy:
+				return "GPU Copy";
+			default:
+				return "GPU";
+			}
+		}
+
+		std::string escape_json(const std::string& str)
+		{
+			std::string escaped;
+			escaped.reserve(str.size());
+			for (char c : str)
+			{
+				if (c == '"' || c == '\\')
+					escaped.push_back('\\');
+				if ((u8)c >= 0x20)
+					escaped.push_back(c);
+			}
+			return escaped;
+		}
+	}
+
+	Profiler::Profiler(u32 max_frames) :
+		m_max_frames(max_frames)
+	{
+		assert(max_frames > 0);
+	}
+
+	void Profiler::collect_cpu_events()
+	{
+		std::vector<CPUProfiler::ThreadEvents> threads;
+		CPUProfiler::drain(threads);
+		if (threads.empty())
+			return;
+
+		auto to_ms = [](u64 ns) { return (f64)ns / 1'000'000.0; };
+
+		// Frame markers of this batch in time order (time, frame), every other event belongs to the latest marker preceding it
+		std::vector<std::pair<u64, u64>> markers;
+		for (const auto& thread : threads)
+		{
+			for (const auto& event : thread.events)
+			{
+				if (event.type == CPUProfiler::EventType::Frame)
+					markers.push_back({ event.start_ns, (u64)event.value });
+			}
+		}
+		std::sort(markers.begin(), markers.end());
+
+		auto get_frame_of = [&](u64 time_ns)
+		{
+			auto it = std::upper_bound(markers.cbegin(), markers.cend(), std::make_pair(time_ns, std::numeric_limits<u64>::max()));
+			return it == markers.cbegin() ? m_cpu_frame : std::prev(it)->second;
+		};
+
+		for (const auto& [time_ns, frame] : markers)
+			m_frames[frame].start_ms = to_ms(time_ns);
+
+		for (auto& thread : threads)
+		{
+			const std::string track = "CPU " + std::to_string(thread.thread) + (thread.thread_name.empty() ? "" : " (" + thread.thread_name + ")");
+
+			// Zones complete innermost first, parents go before their children
+			std::stable_sort(thread.events.begin(), thread.events.end(), [](const CPUProfiler::Event& a, const CPUProfiler::Event& b)
+				{
+					return a.start_ns != b.start_ns ? a.start_ns < b.start_ns : a.depth < b.depth;
+				});
+
+			for (const auto& event : thread.events)
+			{
+				if (event.type == CPUProfiler::EventType::Zone)
+				{
+					Event zone{};
+					zone.name = event.name;
+					zone.track = track;
+					zone.depth = event.depth;
+					zone.start_ms = to_ms(event.start_ns);
+					zone.duration_ms = to_ms(event.end_ns - event.start_ns);
+					m_frames[get_frame_of(event.start_ns)].events.push_back(std::move(zone));
+				}
+				else if (event.type == CPUProfiler::EventType::Counter)
+				{
+					m_frames[get_frame_of(event.start_ns)].counters.push_back({ event.name, to_ms(event.start_ns), event.value });
+				}
+			}
+		}
+
+		if (!markers.empty())
+			m_cpu_frame = markers.back().second;
+		trim_frames();
+	}
+
+	void Profiler::collect_gpu_timings(const GPUFrameTimings& timings)
+	{
+		if (timings.scopes.empty() || (m_last_gpu_frame.has_value() && *m_last_gpu_frame >= timings.frame))
+			return;
+		m_last_gpu_frame = timings.frame;
+
+		std::vector<Event> events;
+		events.reserve(timings.scopes.size());
+		for (const auto& scope : timings.scopes)
+		{
+			Event event{};
+			event.name = scope.name;
+			event.track = get_gpu_track_name(scope.queue);
+			event.depth = scope.depth;
+			event.start_ms = scope.start_ms;
+			event.duration_ms = scope.duration_ms;
+			event.statistics = scope.statistics;
+			events.push_back(std::move(event));
+		}
+
+		auto& frame_events = m_frames[timings.frame].events;
+		frame_events.insert(frame_events.end(), std::make_move_iterator(events.begin()), std::make_move_iterator(events.end()));
+		trim_frames();
+	}
+
+	void Profiler::add_events(u64 frame, std::span<const Event> events)
+	{
+		if (events.empty())
+			return;
+
+		auto& frame_events = m_frames[frame].events;
+		frame_events.insert(frame_events.end(), events.begin(), events.end());
+		trim_frames();
+	}
+
+	std::vector<u64> Profiler::get_frames() const
+	{
+		std::vector<u64> frames;
+		frames.reserve(m_frames.size());
+		for (const auto& [frame, data] : m_frames)
+			frames.push_back(frame);
+		return frames;
+	}
+
+	std::span<const Profiler::Event> Profiler::get_events(u64 frame) const
+	{
+		auto it = m_frames.find(frame);
+		if (it == m_frames.end())
+			return {};
+		return it->second.events;
+	}
+
+	std::span<const Profiler::Counter> Profiler::get_counters(u64 frame) const
+	{
+		auto it = m_frames.find(frame);
+		if (it == m_frames.end())
+			return {};
+		return it->second.counters;
+	}
+
+	std::string Profiler::format_frame(u64 frame) const
+	{
+		// Group by track, keeping the order of events within each
+		std::map<std::string, std::vector<const Event*>> tracks;
+		for (const auto& event : get_events(frame))
+			tracks[event.track].push_back(&event);
+
+		// Zones of a frame may be collected in several batches, parents go before their children
+		for (auto& [track, events] : tracks)
+		{
+			std::stable_sort(events.begin(), events.end(), [](const Event* a, const Event* b)
+				{
+					return a->start_ms != b->start_ms ? a->start_ms < b->start_ms : a->depth < b->depth;
+				});
+		}
+
+		std::ostringstream out;
+		out << std::fixed << std::setprecision(3);
+		out << "Frame " << frame << "\n";
+		for (const auto& [track, events] : tracks)
+		{
+			out << "  " << track << "\n";
+			for (const Event* event : events)
+			{
+				out << std::string(4 + event->depth * 2, ' ') << event->name << ": " << event->duration_ms << " ms";
+				if (event->statistics.has_value())
+				{
+					out << " (" << event->statistics->ia_primitives << " primitives, " << event->statistics->vs_invocations << " VS, "
+						<< event->statistics->ps_invocations << " PS, " << event->statistics->cs_invocations << " CS invocations)";
+				}
+				out << "\n";
+			}
+		}
+
+		for (const auto& counter : get_counters(frame))
+			out << "  " << counter.name << " = " << counter.value << "\n";
+		return out.str();
+	}
+
+	std::string Profiler::format_summary() const
+	{
+		struct Stats
+		{
+			u32 frames{ 0 };
+			u32 calls{ 0 };
+			f64 total_ms{ 0.0 };
+			f64 min_ms{ std::numeric_limits<f64>::max() };
+			f64 max_ms{ 0.0 };
+		};
+
+		// Keyed by (track, name), time per frame is the sum over all calls within the frame
+		std::map<std::pair<std::string, std::string>, Stats> stats;
+		for (const auto& [frame, data] : m_frames)
+		{
+			std::map<std::pair<std::string, std::string>, std::pair<u32, f64>> frame_totals;
+			for (const auto& event : data.events)
+			{
+				auto& [calls, ms] = frame_totals[{ event.track, event.name }];
+				++calls;
+				ms += event.duration_ms;
+			}
+
+			for (const auto& [key, totals] : frame_totals)
+			{
+				auto& s = stats[key];
+				++s.frames;
+				s.calls += totals.first;
+				s.total_ms += totals.second;
+				s.min_ms = std::min(s.min_ms, totals.second);
+				s.max_ms = std::max(s.max_ms, totals.second);
+			}
+		}
+
+		std::ostringstream out;
+		out << std::fixed << std::setprecision(3);
+		out << "Profile summary over " << m_frames.size() << " frames (per frame: average/min/max ms, calls)\n";
+		for (const auto& [key, s] : stats)
+		{
+			out << "  " << key.first << " / " << key.second << ": " << s.total_ms / s.frames << " / " << s.min_ms << " / " << s.max_ms
+				<< " ms, " << (f64)s.calls / s.frames << " calls\n";
+		}
+
+		const u64 dropped = CPUProfiler::get_num_dropped_events();
+		if (dropped > 0)
+			out << "  " << dropped << " CPU events dropped, drain more often\n";
+		return out.str();
+	}
+
+	bool Profiler::write_trace(const std::filesystem::path& path) const
+	{
+		std::ofstream file(path);
+		if (!file)
+			return false;
+
+		// Tracks become threads of a single process, named through metadata events
+		std::unordered_map<std::string, u32> track_ids;
+		auto get_track_id = [&](const std::string& track)
+		{
+			auto [it, inserted] = track_ids.try_emplace(track, (u32)track_ids.size());
+			if (inserted)
+				file << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":" << it->second << ",\"args\":{\"name\":\"" << escape_json(track) << "\"}},\n";
+			return it->second;
+		};
+
+		file << std::fixed << std::setprecision(3);
+		file << "{\"traceEvents\":[\n";
+		for (const auto& [frame, data] : m_frames)
+		{
+			if (data.start_ms.has_value())
+				file << "{\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"name\":\"Frame " << frame << "\",\"ts\":" << *data.start_ms * 1000.0 << "},\n";
+
+			for (const auto& counter : data.counters)
+			{
+				file << "{\"ph\":\"C\",\"pid\":0,\"name\":\"" << escape_json(counter.name) << "\",\"ts\":" << counter.time_ms * 1000.0
+					<< ",\"args\":{\"value\":" << counter.value << "}},\n";
+			}
+
+			for (const auto& event : data.events)
+			{
+				const u32 tid = get_track_id(event.track);
+
+				// Microseconds
+				file << "{\"ph\":\"X\",\"pid\":0,\"tid\":" << tid << ",\"name\":\"" << escape_json(event.name) << "\",\"ts\":" << event.start_ms * 1000.0
+					<< ",\"dur\":" << event.duration_ms * 1000.0 << ",\"args\":{\"frame\":" << frame;
+				if (event.statistics.has_value())
+				{
+					const auto& stats = *event.statistics;
+					file << ",\"ia_vertices\":" << stats.ia_vertices << ",\"ia_primitives\":" << stats.ia_primitives << ",\"vs_invocations\":" << stats.vs_invocations
+						<< ",\"ps_invocations\":" << stats.ps_invocations << ",\"cs_invocations\":" << stats.cs_invocations;
+				}
+				file << "}},\n";
+			}
+		}
+
+		// Trailing event so that the array has no dangling comma
+		file << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":0,\"args\":{\"name\":\"Mira\"}}\n]}\n";
+		return (bool)file;
+	}
+
+	void Profiler::trim_frames()
+	{
+		while (m_frames.size() > m_max_frames)
+			m_frames.erase(m_frames.begin());
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "../Common.h"
+#include "../RHI/RHITypes.h"
+#include <map>
+#include <string>
+
+namespace mira
+{
+	/*
+		Collects profiling scopes of recent frames into a single timeline, which is written out as a whole.
+
+		CPU zones are drained from CPUProfiler and filed under the frame of the latest preceding frame marker.
+		GPU timings arrive a few frames late (RenderDevice::get_gpu_timings) and are filed under the frame they were recorded in.
+		Times are on the std::chrono::steady_clock timeline, so scopes of different sources line up.
+	*/
+	class Profiler
+	{
+	public:
+		struct Event
+		{
+			std::string name;
+			std::string track;				// Timeline the event is drawn on, e.g "GPU Graphics"
+			u8 depth{ 0 };					// Nesting within the track, children follow their parent
+			f64 start_ms{ 0.0 };
+			f64 duration_ms{ 0.0 };
+			std::optional<PipelineStatistics> statistics;
+		};
+
+		struct Counter
+		{
+			std::string name;
+			f64 time_ms{ 0.0 };
+			f64 value{ 0.0 };
+		};
+
+	public:
+		Profiler(u32 max_frames = 64);
+
+		// Takes everything recorded through the MIRA_PROFILE_* macros since the last call
+		void collect_cpu_events();
+
+		// Takes the device's latest timings, if they have not been seen yet
+		void collect_gpu_timings(const GPUFrameTimings& timings);
+
+		// Events of other sources (e.g QueueScheduler::get_profile_events), filed under 'frame'
+		void add_events(u64 frame, std::span<const Event> events);
+
+		// Frames with events, oldest first
+		std::vector<u64> get_frames() const;
+		std::span<const Event> get_events(u64 frame) const;
+		std::span<const Counter> get_counters(u64 frame) const;
+
+		// Indented scope tree of a frame per track, with durations
+		std::string format_frame(u64 frame) const;
+
+		// Per scope name and track over the kept frames: calls per frame and the average, minimum and maximum time per frame
+		std::string format_summary() const;
+
+		// Chrome trace event format (chrome://tracing, Perfetto) of all kept frames
+		bool write_trace(const std::filesystem::path& path) const;
+
+	private:
+		struct Frame
+		{
+			std::optional<f64> start_ms;		// CPU frame marker
+			std::vector<Event> events;
+			std::vector<Counter> counters;
+		};
+
+		void trim_frames();
+
+	private:
+		u32 m_max_frames{ 0 };
+		std::map<u64, Frame> m_frames;
+		std::optional<u64> m_last_gpu_frame;
+
+		// Frame of the latest CPU frame marker, events before the first marker count towards frame 0
+		u64 m_cpu_frame{ 0 };
+	};
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+/*
+	MIRA_ENABLE_PROFILING is set by the build, not here: the Debug configurations of Mira.vcxproj and CMake Debug builds define it,
+	Release leaves it out so that every profiling zone, counter and frame marker is compiled away.
+	Add it to the preprocessor definitions of a configuration (or set the MIRA_ENABLE_PROFILING CMake option) to profile it.
+*/
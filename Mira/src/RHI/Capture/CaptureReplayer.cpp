@@ -0,0 +1,418 @@
+#include "CaptureReplayer.h"
+#include "CaptureSerialization.h"
+#include <chrono>
+#include <iostream>
+
+namespace mira
+{
+	namespace
+	{
+		using Clock = std::chrono::high_resolution_clock;
+
+		f64 elapsed_ms(Clock::time_point start)
+		{
+			return std::chrono::duration<f64, std::milli>(Clock::now() - start).count();
+		}
+	}
+
+	CaptureReplayer::CaptureReplayer(RenderDevice* device, const std::filesystem::path& path) :
+		m_device(device),
+		m_reader(path)
+	{
+		const auto header = m_reader.read<CaptureHeader>();
+		if (header.magic != CaptureHeader::MAGIC)
+			throw std::runtime_error("Not a capture: " + path.string());
+		if (header.version != CaptureHeader::VERSION)
+			throw std::runtime_error("Capture version " + std::to_string(header.version) + " is not supported (expected " + std::to_string(CaptureHeader::VERSION) + ")");
+
+		// Prologue
+		Stats prologue_stats{};
+		while (!m_reader.at_end() && execute_chunk(prologue_stats, false));
+		m_device->flush();
+
+		m_frames_start = m_reader.get_offset();
+	}
+
+	CaptureReplayer::~CaptureReplayer()
+	{
+		m_device->flush();
+		release_frame_allocations();
+		release_deferred_frees();
+	}
+
+	CaptureReplayer::Stats CaptureReplayer::replay(u32 loops)
+	{
+		Stats stats{};
+
+		for (u32 loop = 0; loop < loops; ++loop)
+		{
+			// Only the frees of the last loop are carried out
+			for (auto& handles : m_handles)
+				for (auto& [captured, replayed] : handles)
+					replayed.deferred_frees = 0;
+
+			m_reader.seek(m_frames_start);
+			while (!m_reader.at_end())
+			{
+				const auto frame_start = Clock::now();
+				while (!m_reader.at_end() && execute_chunk(stats, true));
+				stats.frame_ms += elapsed_ms(frame_start);
+				++stats.frames;
+			}
+
+			// Anything the captured frames did not get to release
+			m_device->flush();
+			release_frame_allocations();
+		}
+
+		return stats;
+	}
+
+	bool CaptureReplayer::execute_chunk(Stats& stats, bool in_frame)
+	{
+		const auto chunk = m_reader.read<CaptureChunk>();
+		const auto remapper = [this](CaptureHandleKind kind, u64 handle) { return remap(kind, handle); };
+
+		switch (chunk)
+		{
+		case CaptureChunk::CreateBuffer:
+		{
+			const auto captured = m_reader.read<Buffer>();
+			const auto desc = m_reader.read<BufferDesc>();
+			const auto buffer = m_device->create_buffer(desc);
+
+			// Captured upload data is relative to zeroed memory
+			if (desc.memory_type == MemoryType::Upload)
+			{
+				u8* mapped = m_device->map(buffer);
+				std::memset(mapped, 0, desc.size);
+				m_mapped_uploads[buffer.handle] = mapped;
+			}
+
+			insert(CaptureHandleKind::Buffer, captured.handle, buffer.handle, in_frame);
+			break;
+		}
+		case CaptureChunk::CreateTexture:
+		case CaptureChunk::RegisterSwapchainTexture:
+		{
+			const auto captured = m_reader.read<Texture>();
+			const auto desc = m_reader.read<TextureDesc>();
+			insert(CaptureHandleKind::Texture, captured.handle, m_device->create_texture(desc).handle, in_frame);
+			break;
+		}
+		case CaptureChunk::CreateHeap:
+		{
+			const auto captured = m_reader.read<Heap>();
+			const auto desc = m_reader.read<HeapDesc>();
+			insert(CaptureHandleKind::Heap, captured.handle, m_device->create_heap(desc).handle, in_frame);
+			break;
+		}
+		case CaptureChunk::CreatePlacedBuffer:
+		{
+			const auto captured = m_reader.read<Buffer>();
+			const auto desc = m_reader.read<BufferDesc>();
+			const auto heap = Heap{ remap(CaptureHandleKind::Heap, m_reader.read<Heap>().handle) };
+			const auto offset = m_reader.read<u64>();
+			insert(CaptureHandleKind::Buffer, captured.handle, m_device->create_placed_buffer(desc, heap, offset).handle, in_frame);
+			break;
+		}
+		case CaptureChunk::CreatePlacedTexture:
+		{
+			const auto captured = m_reader.read<Texture>();
+			const auto desc = m_reader.read<TextureDesc>();
+			const auto heap = Heap{ remap(CaptureHandleKind::Heap, m_reader.read<Heap>().handle) };
+			const auto offset = m_reader.read<u64>();
+			insert(CaptureHandleKind::Texture, captured.handle, m_device->create_placed_texture(desc, heap, offset).handle, in_frame);
+			break;
+		}
+		case CaptureChunk::CreatePipeline:
+		{
+			const auto captured = m_reader.read<Pipeline>();
+			const auto desc = read_pipeline_desc(m_reader, m_shaders);
+			insert(CaptureHandleKind::Pipeline, captured.handle, m_device->create_graphics_pipeline(desc).handle, in_frame);
+			break;
+		}
+		case CaptureChunk::CreateRenderPass:
+		{
+			const auto captured = m_reader.read<RenderPass>();
+			const auto desc = read_renderpass_desc(m_reader, remapper);
+			insert(CaptureHandleKind::RenderPass, captured.handle, m_device->create_renderpass(desc).handle, in_frame);
+			break;
+		}
+		case CaptureChunk::CreateBufferView:
+		{
+			const auto captured = m_reader.read<BufferView>();
+			const auto buffer = m_reader.read<Buffer>();
+			const auto desc = m_reader.read<BufferViewDesc>();
+			const auto descriptor = m_reader.read<u32>();
+
+			const auto view = m_device->create_view(Buffer{ remap(CaptureHandleKind::Buffer, buffer.handle) }, desc);
+			validate_descriptor(descriptor, m_device->get_global_descriptor(view));
+			insert(CaptureHandleKind::BufferView, captured.handle, view.handle, in_frame);
+			break;
+		}
+		case CaptureChunk::CreateTransientView:
+		{
+			const auto buffer = m_reader.read<Buffer>();
+			const auto desc = m_reader.read<BufferViewDesc>();
+			const auto descriptor = m_reader.read<u32>();
+
+			validate_descriptor(descriptor, m_device->create_transient_view(Buffer{ remap(CaptureHandleKind::Buffer, buffer.handle) }, desc));
+			break;
+		}
+		case CaptureChunk::CreateTextureView:
+		{
+			const auto captured = m_reader.read<TextureView>();
+			const auto texture = m_reader.read<Texture>();
+			const auto desc = m_reader.read<TextureViewDesc>();
+			const auto descriptor = m_reader.read<u32>();
+
+			const auto view = m_device->create_view(Texture{ remap(CaptureHandleKind::Texture, texture.handle) }, desc);
+			validate_descriptor(descriptor, m_device->get_global_descriptor(view));
+			insert(CaptureHandleKind::TextureView, captured.handle, view.handle, in_frame);
+			break;
+		}
+
+		// Releases of resources which were created outside of the replayed frames are deferred to destruction
+		case CaptureChunk::FreeBuffer:
+		{
+			if (auto handle = erase(CaptureHandleKind::Buffer, m_reader.read<Buffer>().handle, in_frame); handle.has_value())
+			{
+				m_mapped_uploads.erase(*handle);
+				m_device->free_buffer(Buffer{ *handle });
+			}
+			break;
+		}
+		case CaptureChunk::FreeTexture:
+		{
+			if (auto handle = erase(CaptureHandleKind::Texture, m_reader.read<Texture>().handle, in_frame); handle.has_value())
+				m_device->free_texture(Texture{ *handle });
+			break;
+		}
+		case CaptureChunk::FreePipeline:
+		{
+			if (auto handle = erase(CaptureHandleKind::Pipeline, m_reader.read<Pipeline>().handle, in_frame); handle.has_value())
+				m_device->free_pipeline(Pipeline{ *handle });
+			break;
+		}
+		case CaptureChunk::FreeRenderPass:
+		{
+			if (auto handle = erase(CaptureHandleKind::RenderPass, m_reader.read<RenderPass>().handle, in_frame); handle.has_value())
+				m_device->free_renderpass(RenderPass{ *handle });
+			break;
+		}
+		case CaptureChunk::FreeBufferView:
+		{
+			if (auto handle = erase(CaptureHandleKind::BufferView, m_reader.read<BufferView>().handle, in_frame); handle.has_value())
+				m_device->free_view(BufferView{ *handle });
+			break;
+		}
+		case CaptureChunk::FreeTextureView:
+		{
+			if (auto handle = erase(CaptureHandleKind::TextureView, m_reader.read<TextureView>().handle, in_frame); handle.has_value())
+				m_device->free_view(TextureView{ *handle });
+			break;
+		}
+		case CaptureChunk::FreeHeap:
+		{
+			if (auto handle = erase(CaptureHandleKind::Heap, m_reader.read<Heap>().handle, in_frame); handle.has_value())
+				m_device->free_heap(Heap{ *handle });
+			break;
+		}
+
+		case CaptureChunk::BufferData:
+		{
+			const auto buffer = remap(CaptureHandleKind::Buffer, m_reader.read<Buffer>().handle);
+			const auto offset = m_reader.read<u64>();
+			const auto data = m_reader.read_bytes();
+
+			auto it = m_mapped_uploads.find(buffer);
+			if (it == m_mapped_uploads.end())
+				throw std::runtime_error("Corrupt capture: buffer data for a buffer which is not mapped");
+			const u64 size = m_device->get_desc(Buffer{ buffer }).size;
+			if (offset > size || data.size() > size - offset)
+				throw std::runtime_error("Corrupt capture: buffer data outside of a mapped upload buffer");
+			std::memcpy(it->second + offset, data.data(), data.size());
+			break;
+		}
+
+		case CaptureChunk::AllocateCommandList:
+		{
+			const auto captured = m_reader.read<CommandList>();
+			const auto queue = m_reader.read<QueueType>();
+			insert(CaptureHandleKind::CommandList, captured.handle, m_device->allocate_command_list(queue).handle, in_frame);
+			break;
+		}
+		case CaptureChunk::CompileCommandList:
+		{
+			const auto handle = CommandList{ remap(CaptureHandleKind::CommandList, m_reader.read<CommandList>().handle) };
+			auto list = read_command_list(m_reader, remapper);
+
+			++stats.command_lists;
+			stats.commands += list.get_commands().size();
+
+			const auto start = Clock::now();
+			m_device->compile_command_list(handle, std::move(list));
+			stats.compile_ms += elapsed_ms(start);
+			break;
+		}
+		case CaptureChunk::SubmitCommandLists:
+		{
+			auto lists = m_reader.read_array<CommandList>();
+			const auto queue = m_reader.read<QueueType>();
+			auto incoming_sync = m_reader.read<std::optional<SyncReceipt>>();
+			const auto captured_receipt = m_reader.read<std::optional<SyncReceipt>>();
+
+			for (auto& list : lists)
+				list.handle = remap(CaptureHandleKind::CommandList, list.handle);
+			if (incoming_sync.has_value())
+				incoming_sync = remap(*incoming_sync);
+
+			const auto start = Clock::now();
+			const auto receipt = m_device->submit_command_lists(lists, queue, incoming_sync, captured_receipt.has_value());
+			stats.submit_ms += elapsed_ms(start);
+
+			if (captured_receipt.has_value())
+				insert(CaptureHandleKind::SyncReceipt, receipt_key(*captured_receipt), receipt->value, in_frame);
+			break;
+		}
+		case CaptureChunk::BeginFrame:
+		{
+			m_device->begin_frame(m_reader.read<u8>());
+			break;
+		}
+		case CaptureChunk::EndFrame:
+		{
+			m_device->end_frame();
+			break;
+		}
+		case CaptureChunk::InsertWait:
+		{
+			const auto queue = m_reader.read<QueueType>();
+			m_device->insert_wait(queue, remap(m_reader.read<SyncReceipt>()));
+			break;
+		}
+		case CaptureChunk::RecycleCommandList:
+		{
+			if (auto handle = erase(CaptureHandleKind::CommandList, m_reader.read<CommandList>().handle, in_frame); handle.has_value())
+				m_device->recycle_command_list(CommandList{ *handle });
+			break;
+		}
+		case CaptureChunk::WaitForGPU:
+		{
+			m_device->wait_for_gpu(remap(m_reader.read<SyncReceipt>()));
+			break;
+		}
+		case CaptureChunk::Flush:
+		{
+			m_device->flush();
+			break;
+		}
+		case CaptureChunk::FrameBoundary:
+		{
+			return false;
+		}
+		default:
+			throw std::runtime_error("Corrupt capture: unknown chunk");
+		}
+
+		return true;
+	}
+
+	u64 CaptureReplayer::remap(CaptureHandleKind kind, u64 handle) const
+	{
+		// Null handles stay null
+		if (handle == 0)
+			return 0;
+
+		const auto& handles = m_handles[(size_t)kind];
+		auto it = handles.find(handle);
+		if (it == handles.end())
+			throw std::runtime_error("Corrupt capture: use of a handle which was never created");
+		return it->second.handle;
+	}
+
+	void CaptureReplayer::insert(CaptureHandleKind kind, u64 captured, u64 replayed, bool in_frame)
+	{
+		auto [it, inserted] = m_handles[(size_t)kind].try_emplace(captured, ReplayedHandle{ replayed, in_frame });
+		if (!inserted)
+		{
+			assert(it->second.handle == replayed);
+			++it->second.references;
+		}
+	}
+
+	std::optional<u64> CaptureReplayer::erase(CaptureHandleKind kind, u64 captured, bool in_frame)
+	{
+		auto& handles = m_handles[(size_t)kind];
+		auto it = handles.find(captured);
+		if (it == handles.end())
+			return std::nullopt;
+
+		// The next loop uses the handle again
+		if (in_frame && !it->second.created_in_frame)
+		{
+			assert(it->second.deferred_frees < it->second.references);
+			++it->second.deferred_frees;
+			return std::nullopt;
+		}
+
+		const auto replayed = it->second.handle;
+		if (--it->second.references == 0)
+			handles.erase(it);
+		return replayed;
+	}
+
+	void CaptureReplayer::validate_descriptor(u32 captured, u32 replayed) const
+	{
+		// Descriptor indices may be baked into captured upload data, in which case the replayed frame will read the wrong resources
+		if (captured != replayed)
+			std::cout << "CaptureReplayer: descriptor mismatch (captured " << captured << ", replayed " << replayed << ")\n";
+	}
+
+	void CaptureReplayer::release_frame_allocations()
+	{
+		release([](ReplayedHandle& handle) { return handle.created_in_frame ? handle.references : 0; });
+	}
+
+	void CaptureReplayer::release_deferred_frees()
+	{
+		release([](ReplayedHandle& handle)
+			{
+				const u32 frees = handle.deferred_frees;
+				handle.deferred_frees = 0;
+				return frees;
+			});
+	}
+
+	void CaptureReplayer::release(const std::function<u32(ReplayedHandle&)>& count)
+	{
+		auto release_kind = [&](CaptureHandleKind kind, auto&& free_func)
+		{
+			auto& handles = m_handles[(size_t)kind];
+			for (auto it = handles.begin(); it != handles.end();)
+			{
+				const u32 frees = count(it->second);
+				for (u32 i = 0; i < frees; ++i)
+					free_func(it->second.handle);
+
+				it->second.references -= frees;
+				if (it->second.references == 0)
+					it = handles.erase(it);
+				else
+					++it;
+			}
+		};
+
+		// Dependents first
+		release_kind(CaptureHandleKind::SyncReceipt, [](u64) {});		// Nothing to free, only the mapping goes
+		release_kind(CaptureHandleKind::CommandList, [this](u64 handle) { m_device->recycle_command_list(CommandList{ handle }); });
+		release_kind(CaptureHandleKind::RenderPass, [this](u64 handle) { m_device->free_renderpass(RenderPass{ handle }); });
+		release_kind(CaptureHandleKind::BufferView, [this](u64 handle) { m_device->free_view(BufferView{ handle }); });
+		release_kind(CaptureHandleKind::TextureView, [this](u64 handle) { m_device->free_view(TextureView{ handle }); });
+		release_kind(CaptureHandleKind::Pipeline, [this](u64 handle) { m_device->free_pipeline(Pipeline{ handle }); });
+		release_kind(CaptureHandleKind::Texture, [this](u64 handle) { m_device->free_texture(Texture{ handle }); });
+		release_kind(CaptureHandleKind::Buffer, [this](u64 handle) { m_mapped_uploads.erase(handle); m_device->free_buffer(Buffer{ handle }); });
+		release_kind(CaptureHandleKind::Heap, [this](u64 handle) { m_device->free_heap(Heap{ handle }); });
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "../RenderDevice.h"
+#include "CaptureTypes.h"
+
+namespace mira
+{
+	/*
+		Replays a capture recorded by RenderDevice_Capture against any RenderDevice.
+
+		The prologue is executed once on construction, after which the captured frames can be replayed repeatedly.
+		Anything a loop of frames leaves alive (e.g resources freed by a frame past the end of the capture) is released at the end of every loop,
+		so that looping does not leak.
+		Prologue resources freed by the frames are kept until destruction instead, every loop needs them again.
+
+		Captures are validated while reading: a file which cannot be opened, has the wrong magic or version, or is corrupt
+		throws std::runtime_error from the constructor or replay().
+	*/
+	class CaptureReplayer
+	{
+	public:
+		struct Stats
+		{
+			u32 frames{ 0 };
+			u32 command_lists{ 0 };
+			u64 commands{ 0 };
+
+			// CPU time spent inside the device
+			f64 compile_ms{ 0.0 };
+			f64 submit_ms{ 0.0 };
+			f64 frame_ms{ 0.0 };
+		};
+
+	public:
+		CaptureReplayer(RenderDevice* device, const std::filesystem::path& path);
+		~CaptureReplayer();
+
+		// Replay all captured frames 'loops' times
+		Stats replay(u32 loops = 1);
+
+	private:
+		struct ReplayedHandle
+		{
+			u64 handle{ 0 };
+			bool created_in_frame{ false };
+
+			// Creations which returned this handle (pipelines and views are shared by identical descriptions)
+			u32 references{ 1 };
+
+			// Frees of a prologue handle by the last loop of frames, carried out on destruction
+			u32 deferred_frees{ 0 };
+		};
+
+		using HandleMap = std::unordered_map<u64, ReplayedHandle>;
+
+		// Executes the chunk at the reader position, returns false on a frame boundary
+		bool execute_chunk(Stats& stats, bool in_frame);
+
+		u64 remap(CaptureHandleKind kind, u64 handle) const;
+		void insert(CaptureHandleKind kind, u64 captured, u64 replayed, bool in_frame);
+		std::optional<u64> erase(CaptureHandleKind kind, u64 captured, bool in_frame);
+
+		// Receipts are timeline values rather than handles, the replaying device reaches different values on the same queue
+		static u64 receipt_key(SyncReceipt receipt) { return ((u64)receipt.queue << 56) | receipt.value; }
+		SyncReceipt remap(SyncReceipt receipt) const { return SyncReceipt{ receipt.queue, remap(CaptureHandleKind::SyncReceipt, receipt_key(receipt)) }; }
+
+		void validate_descriptor(u32 captured, u32 replayed) const;
+		void release_frame_allocations();
+		void release_deferred_frees();
+
+		// Frees 'count(handle)' references of every handle, dependents first
+		void release(const std::function<u32(ReplayedHandle&)>& count);
+
+	private:
+		RenderDevice* m_device{ nullptr };
+		CaptureReader m_reader;
+
+		u64 m_frames_start{ 0 };
+
+		std::array<HandleMap, (size_t)CaptureHandleKind::Count> m_handles;
+		std::unordered_map<u64, u8*> m_mapped_uploads;
+		std::vector<std::unique_ptr<CompiledShader>> m_shaders;
+	};
+}
@@ -0,0 +1,272 @@
+#include "CaptureSerialization.h"
+
+namespace mira
+{
+	namespace
+	{
+		template <typename Handle>
+		Handle remap_handle(const CaptureHandleRemap& remap, CaptureHandleKind kind, Handle handle)
+		{
+			handle.handle = remap(kind, handle.handle);
+			return handle;
+		}
+
+		template <typename Command>
+		void write_trivial(CaptureWriter& writer, const RenderCommand* cmd)
+		{
+			writer.write(*static_cast<const Command*>(cmd));
+		}
+
+		void write_shader(CaptureWriter& writer, const CompiledShader* shader)
+		{
+			writer.write(shader != nullptr);
+			if (!shader)
+				return;
+
+			writer.write(shader->shader_type);
+			writer.write_array(std::span<const u8>(shader->blob));
+		}
+
+		const CompiledShader* read_shader(CaptureReader& reader, std::vector<std::unique_ptr<CompiledShader>>& shader_storage)
+		{
+			if (!reader.read<bool>())
+				return nullptr;
+
+			auto shader = std::make_unique<CompiledShader>();
+			shader->shader_type = reader.read<ShaderType>();
+			shader->blob = reader.read_array<u8>();
+
+			shader_storage.push_back(std::move(shader));
+			return shader_storage.back().get();
+		}
+	}
+
+	void write_command_list(CaptureWriter& writer, const RenderCommandList& list)
+	{
+		const auto& cmds = list.get_commands();
+		writer.write((u64)cmds.size());
+
+		for (const auto& cmd : cmds)
+		{
+			writer.write(cmd->type);
+
+			switch (cmd->type)
+			{
+			case RenderCommandDraw::TYPE:
+				write_trivial<RenderCommandDraw>(writer, cmd.get());
+				break;
+			case RenderCommandDrawIndexed::TYPE:
+				write_trivial<RenderCommandDrawIndexed>(writer, cmd.get());
+				break;
+			case RenderCommandDrawIndexedIndirect::TYPE:
+				write_trivial<RenderCommandDrawIndexedIndirect>(writer, cmd.get());
+				break;
+			case RenderCommandSetPipeline::TYPE:
+				write_trivial<RenderCommandSetPipeline>(writer, cmd.get());
+				break;
+			case RenderCommandBeginRenderPass::TYPE:
+				write_trivial<RenderCommandBeginRenderPass>(writer, cmd.get());
+				break;
+			case RenderCommandEndRenderPass::TYPE:
+				break;
+			case RenderCommandCopyBuffer::TYPE:
+				write_trivial<RenderCommandCopyBuffer>(writer, cmd.get());
+				break;
+			case RenderCommandUpdateShaderArgs::TYPE:
+				write_trivial<RenderCommandUpdateShaderArgs>(writer, cmd.get());
+				break;
+			case RenderCommandBeginProfileScope::TYPE:
+				write_trivial<RenderCommandBeginProfileScope>(writer, cmd.get());
+				break;
+			case RenderCommandEndProfileScope::TYPE:
+				break;
+			case RenderCommandBarrier::TYPE:
+			{
+				const auto& barr = *static_cast<const RenderCommandBarrier*>(cmd.get());
+				writer.write_array(std::span<const ResourceBarrier>(barr.barriers));
+				break;
+			}
+			case RenderCommandCopyBufferToImage::TYPE:
+			{
+				// Tuple is not trivially copyable
+				const auto& copy = *static_cast<const RenderCommandCopyBufferToImage*>(cmd.get());
+				writer.write(copy.src);
+				writer.write(copy.dst);
+				writer.write(copy.dst_subresource);
+				writer.write(std::get<0>(copy.dst_topleft));
+				writer.write(std::get<1>(copy.dst_topleft));
+				writer.write(std::get<2>(copy.dst_topleft));
+				writer.write(copy.src_offset);
+				writer.write(copy.src_format);
+				writer.write(copy.src_width);
+				writer.write(copy.src_height);
+				writer.write(copy.src_depth);
+				writer.write(copy.src_rowpitch);
+				break;
+			}
+			default:
+				assert(false);
+			}
+		}
+	}
+
+	RenderCommandList read_command_list(CaptureReader& reader, const CaptureHandleRemap& remap)
+	{
+		RenderCommandList list;
+
+		const u64 num_cmds = reader.read<u64>();
+		for (u64 i = 0; i < num_cmds; ++i)
+		{
+			const auto type = reader.read<RenderCommandType>();
+
+			switch (type)
+			{
+			case RenderCommandDraw::TYPE:
+			{
+				list.submit(reader.read<RenderCommandDraw>());
+				break;
+			}
+			case RenderCommandDrawIndexed::TYPE:
+			{
+				auto cmd = reader.read<RenderCommandDrawIndexed>();
+				cmd.index_buffer = remap_handle(remap, CaptureHandleKind::Buffer, cmd.index_buffer);
+				list.submit(cmd);
+				break;
+			}
+			case RenderCommandDrawIndexedIndirect::TYPE:
+			{
+				auto cmd = reader.read<RenderCommandDrawIndexedIndirect>();
+				cmd.index_buffer = remap_handle(remap, CaptureHandleKind::Buffer, cmd.index_buffer);
+				cmd.argument_buffer = remap_handle(remap, CaptureHandleKind::Buffer, cmd.argument_buffer);
+				if (cmd.count_buffer.has_value())
+					cmd.count_buffer = remap_handle(remap, CaptureHandleKind::Buffer, *cmd.count_buffer);
+				list.submit(cmd);
+				break;
+			}
+			case RenderCommandSetPipeline::TYPE:
+			{
+				auto cmd = reader.read<RenderCommandSetPipeline>();
+				cmd.pipeline = remap_handle(remap, CaptureHandleKind::Pipeline, cmd.pipeline);
+				list.submit(cmd);
+				break;
+			}
+			case RenderCommandBeginRenderPass::TYPE:
+			{
+				auto cmd = reader.read<RenderCommandBeginRenderPass>();
+				cmd.rp = remap_handle(remap, CaptureHandleKind::RenderPass, cmd.rp);
+				list.submit(cmd);
+				break;
+			}
+			case RenderCommandEndRenderPass::TYPE:
+			{
+				list.submit(RenderCommandEndRenderPass());
+				break;
+			}
+			case RenderCommandCopyBuffer::TYPE:
+			{
+				auto cmd = reader.read<RenderCommandCopyBuffer>();
+				cmd.src = remap_handle(remap, CaptureHandleKind::Buffer, cmd.src);
+				cmd.dst = remap_handle(remap, CaptureHandleKind::Buffer, cmd.dst);
+				list.submit(cmd);
+				break;
+			}
+			case RenderCommandUpdateShaderArgs::TYPE:
+			{
+				list.submit(reader.read<RenderCommandUpdateShaderArgs>());
+				break;
+			}
+			case RenderCommandBeginProfileScope::TYPE:
+			{
+				list.submit(reader.read<RenderCommandBeginProfileScope>());
+				break;
+			}
+			case RenderCommandEndProfileScope::TYPE:
+			{
+				list.submit(RenderCommandEndProfileScope());
+				break;
+			}
+			case RenderCommandBarrier::TYPE:
+			{
+				RenderCommandBarrier cmd;
+				cmd.barriers = reader.read_array<ResourceBarrier>();
+				for (auto& barr : cmd.barriers)
+				{
+					const auto kind = barr.info.res_type == ResourceBarrier::ResourceType::Buffer ? CaptureHandleKind::Buffer : CaptureHandleKind::Texture;
+					barr.info.resource_or_before = remap(kind, barr.info.resource_or_before);
+					if (barr.info.type == ResourceBarrier::Type::Aliasing)
+						barr.info.after = remap(kind, barr.info.after);
+				}
+				list.submit(cmd);
+				break;
+			}
+			case RenderCommandCopyBufferToImage::TYPE:
+			{
+				RenderCommandCopyBufferToImage cmd;
+				cmd.src = remap_handle(remap, CaptureHandleKind::Buffer, reader.read<Buffer>());
+				cmd.dst = remap_handle(remap, CaptureHandleKind::Texture, reader.read<Texture>());
+				cmd.dst_subresource = reader.read<u32>();
+				const u32 x = reader.read<u32>();
+				const u32 y = reader.read<u32>();
+				const u32 z = reader.read<u32>();
+				cmd.dst_topleft = { x, y, z };
+				cmd.src_offset = reader.read<u64>();
+				cmd.src_format = reader.read<ResourceFormat>();
+				cmd.src_width = reader.read<u32>();
+				cmd.src_height = reader.read<u32>();
+				cmd.src_depth = reader.read<u32>();
+				cmd.src_rowpitch = reader.read<u32>();
+				list.submit(cmd);
+				break;
+			}
+			default:
+				throw std::runtime_error("Corrupt capture: unknown command type");
+			}
+		}
+
+		return list;
+	}
+
+	void write_renderpass_desc(CaptureWriter& writer, const RenderPassDesc& desc)
+	{
+		writer.write_array(std::span<const RenderPassTargetDesc>(desc.render_target_descs));
+		writer.write(desc.depth_stencil_desc);
+		writer.write(desc.flags);
+	}
+
+	RenderPassDesc read_renderpass_desc(CaptureReader& reader, const CaptureHandleRemap& remap)
+	{
+		RenderPassDesc desc{};
+		desc.render_target_descs = reader.read_array<RenderPassTargetDesc>();
+		desc.depth_stencil_desc = reader.read<std::optional<RenderPassDepthStencilTargetDesc>>();
+		desc.flags = reader.read<RenderPassFlag>();
+
+		for (auto& rt : desc.render_target_descs)
+			rt.view = remap_handle(remap, CaptureHandleKind::TextureView, rt.view);
+		if (desc.depth_stencil_desc.has_value())
+			desc.depth_stencil_desc->view = remap_handle(remap, CaptureHandleKind::TextureView, desc.depth_stencil_desc->view);
+
+		return desc;
+	}
+
+	void write_pipeline_desc(CaptureWriter& writer, const GraphicsPipelineDesc& desc)
+	{
+		// Shader pointers are meaningless in the file, they are patched on read
+		writer.write(desc);
+		write_shader(writer, desc.vs);
+		write_shader(writer, desc.gs);
+		write_shader(writer, desc.ds);
+		write_shader(writer, desc.hs);
+		write_shader(writer, desc.ps);
+	}
+
+	GraphicsPipelineDesc read_pipeline_desc(CaptureReader& reader, std::vector<std::unique_ptr<CompiledShader>>& shader_storage)
+	{
+		auto desc = reader.read<GraphicsPipelineDesc>();
+		desc.vs = read_shader(reader, shader_storage);
+		desc.gs = read_shader(reader, shader_storage);
+		desc.ds = read_shader(reader, shader_storage);
+		desc.hs = read_shader(reader, shader_storage);
+		desc.ps = read_shader(reader, shader_storage);
+		return desc;
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "CaptureTypes.h"
+#include "../RenderCommandList.h"
+
+namespace mira
+{
+	/*
+		Serialization of the structures which cannot be written as plain bytes.
+		Handles are written as-is and remapped on read.
+	*/
+	void write_command_list(CaptureWriter& writer, const RenderCommandList& list);
+	RenderCommandList read_command_list(CaptureReader& reader, const CaptureHandleRemap& remap);
+
+	void write_renderpass_desc(CaptureWriter& writer, const RenderPassDesc& desc);
+	RenderPassDesc read_renderpass_desc(CaptureReader& reader, const CaptureHandleRemap& remap);
+
+	// Shaders are embedded in the capture, the read shaders are placed in 'shader_storage' which has to outlive the returned description
+	void write_pipeline_desc(CaptureWriter& writer, const GraphicsPipelineDesc& desc);
+	GraphicsPipelineDesc read_pipeline_desc(CaptureReader& reader, std::vector<std::unique_ptr<CompiledShader>>& shader_storage);
+}
@@ -0,0 +1,190 @@
+#pragma once
+#include "../RHITypes.h"
+#include <fstream>
+#include <cstring>
+#include <bit>
+#include <stdexcept>
+
+namespace mira
+{
+	/*
+		Binary capture layout:
+			CaptureHeader
+			{ CaptureChunk, chunk payload }*
+
+		Every device call which affects the command stream is recorded as a chunk, in call order.
+		Handles are stored as they were seen during capture and are remapped to freshly created ones on replay.
+
+		FrameBoundary chunks split the stream into a prologue (everything before the first boundary, e.g resource creation and loading)
+		and a sequence of frames which can be replayed repeatedly.
+	*/
+	struct CaptureHeader
+	{
+		static constexpr u32 MAGIC = 0x5043524D;		// "MRCP"
+		static constexpr u32 VERSION = 8;
+
+		u32 magic{ MAGIC };
+		u32 version{ VERSION };
+	};
+
+	enum class CaptureChunk : u32
+	{
+		CreateBuffer,
+		CreateTexture,
+		CreatePipeline,
+		CreateRenderPass,
+		CreateBufferView,
+		CreateTextureView,
+		RegisterSwapchainTexture,
+
+		FreeBuffer,
+		FreeTexture,
+		FreePipeline,
+		FreeRenderPass,
+		FreeBufferView,
+		FreeTextureView,
+
+		BufferData,
+
+		AllocateCommandList,
+		CompileCommandList,
+		SubmitCommandLists,
+		RecycleCommandList,
+		WaitForGPU,
+		Flush,
+
+		FrameBoundary,
+
+		CreateHeap,
+		CreatePlacedBuffer,
+		CreatePlacedTexture,
+		FreeHeap,
+
+		InsertWait,
+
+		CreateTransientView,
+		EndFrame,
+
+		BeginFrame
+	};
+
+	enum class CaptureHandleKind : u8
+	{
+		Buffer,
+		Texture,
+		Pipeline,
+		RenderPass,
+		BufferView,
+		TextureView,
+		CommandList,
+		SyncReceipt,
+		Heap,
+
+		Count
+	};
+
+	// Maps a captured handle to the handle it was recreated as
+	using CaptureHandleRemap = std::function<u64(CaptureHandleKind, u64)>;
+
+	class CaptureWriter
+	{
+	public:
+		CaptureWriter(const std::filesystem::path& path) : m_file(path, std::ios::binary) {}
+
+		template <typename T>
+		void write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			m_file.write((const char*)&value, sizeof(T));
+		}
+
+		// Size prefixed
+		void write_bytes(const void* data, u64 size)
+		{
+			write(size);
+			m_file.write((const char*)data, size);
+		}
+
+		template <typename T>
+		void write_array(std::span<const T> elements)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			write_bytes(elements.data(), elements.size_bytes());
+		}
+
+		bool is_open() const { return m_file.is_open(); }
+		void close() { m_file.close(); }
+
+	private:
+		std::ofstream m_file;
+	};
+
+	// Captures are untrusted input: failing to open the file and reading past its end throw std::runtime_error
+	class CaptureReader
+	{
+	public:
+		CaptureReader(const std::filesystem::path& path)
+		{
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			if (!file.is_open())
+				throw std::runtime_error("Failed to open capture " + path.string());
+
+			m_data.resize((size_t)file.tellg());
+			file.seekg(0);
+			file.read((char*)m_data.data(), m_data.size());
+			if (!file)
+				throw std::runtime_error("Failed to read capture " + path.string());
+		}
+
+		template <typename T>
+		T read()
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			check_remaining(sizeof(T));
+
+			// Some descriptions are not default constructible
+			std::array<u8, sizeof(T)> bytes;
+			std::memcpy(bytes.data(), m_data.data() + m_offset, sizeof(T));
+			m_offset += sizeof(T);
+			return std::bit_cast<T>(bytes);
+		}
+
+		std::span<const u8> read_bytes()
+		{
+			const u64 size = read<u64>();
+			check_remaining(size);
+
+			std::span<const u8> bytes(m_data.data() + m_offset, (size_t)size);
+			m_offset += size;
+			return bytes;
+		}
+
+		template <typename T>
+		std::vector<T> read_array()
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			auto bytes = read_bytes();
+			if (bytes.size() % sizeof(T) != 0)
+				throw std::runtime_error("Corrupt capture: array size is not a multiple of its element size");
+
+			std::vector<T> elements(bytes.size() / sizeof(T));
+			std::memcpy(elements.data(), bytes.data(), bytes.size());
+			return elements;
+		}
+
+		bool at_end() const { return m_offset >= m_data.size(); }
+		u64 get_offset() const { return m_offset; }
+		void seek(u64 offset) { m_offset = offset; }
+
+	private:
+		void check_remaining(u64 size) const
+		{
+			if (size > m_data.size() - m_offset)
+				throw std::runtime_error("Corrupt capture: read past the end of the file");
+		}
+
+	private:
+		std::vector<u8> m_data;
+		u64 m_offset{ 0 };
+	};
+}
@@ -0,0 +1,493 @@
+#include "RenderDevice_Capture.h"
+#include "CaptureSerialization.h"
+
+namespace mira
+{
+	RenderDevice_Capture::RenderDevice_Capture(RenderDevice* device, const std::filesystem::path& path) :
+		m_device(device)
+	{
+		m_writer.emplace(path);
+		assert(m_writer->is_open());
+		m_writer->write(CaptureHeader{});
+	}
+
+	RenderDevice_Capture::~RenderDevice_Capture()
+	{
+		end_capture();
+	}
+
+	void RenderDevice_Capture::mark_frame_boundary()
+	{
+		write_chunk(CaptureChunk::FrameBoundary);
+	}
+
+	void RenderDevice_Capture::end_capture()
+	{
+		if (!m_writer.has_value())
+			return;
+
+		m_writer->close();
+		m_writer = std::nullopt;
+		m_mapped_uploads.clear();
+	}
+
+	SwapChain* RenderDevice_Capture::create_swapchain(void* hwnd, u8 num_buffers)
+	{
+		auto sc = m_device->create_swapchain(hwnd, num_buffers);
+
+		// Swapchain buffers are substituted by regular textures on replay
+		if (m_writer.has_value())
+		{
+			for (u8 i = 0; i < num_buffers; ++i)
+			{
+				const auto buffer = sc->get_buffer(i);
+				write_chunk(CaptureChunk::RegisterSwapchainTexture);
+				m_writer->write(buffer);
+				m_writer->write(m_device->get_desc(buffer));
+			}
+		}
+
+		return sc;
+	}
+
+	Buffer RenderDevice_Capture::create_buffer(const BufferDesc& desc)
+	{
+		auto handle = m_device->create_buffer(desc);
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::CreateBuffer);
+			m_writer->write(handle);
+			m_writer->write(desc);
+		}
+		return handle;
+	}
+
+	Texture RenderDevice_Capture::create_texture(const TextureDesc& desc)
+	{
+		auto handle = m_device->create_texture(desc);
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::CreateTexture);
+			m_writer->write(handle);
+			m_writer->write(desc);
+		}
+		return handle;
+	}
+
+	Pipeline RenderDevice_Capture::create_graphics_pipeline(const GraphicsPipelineDesc& desc)
+	{
+		auto handle = m_device->create_graphics_pipeline(desc);
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::CreatePipeline);
+			m_writer->write(handle);
+			write_pipeline_desc(*m_writer, desc);
+		}
+		return handle;
+	}
+
+	Pipeline RenderDevice_Capture::create_graphics_pipeline_async(const GraphicsPipelineDesc& desc, Pipeline fallback)
+	{
+		auto handle = m_device->create_graphics_pipeline_async(desc, fallback);
+		if (m_writer.has_value())
+		{
+			// Replayed as a regular creation, so that replays bind the same pipeline regardless of compilation timing
+			write_chunk(CaptureChunk::CreatePipeline);
+			m_writer->write(handle);
+			write_pipeline_desc(*m_writer, desc);
+		}
+		return handle;
+	}
+
+	bool RenderDevice_Capture::is_pipeline_ready(Pipeline handle) const
+	{
+		return m_device->is_pipeline_ready(handle);
+	}
+
+	RenderPass RenderDevice_Capture::create_renderpass(const RenderPassDesc& desc)
+	{
+		auto handle = m_device->create_renderpass(desc);
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::CreateRenderPass);
+			m_writer->write(handle);
+			write_renderpass_desc(*m_writer, desc);
+		}
+		return handle;
+	}
+
+	BufferView RenderDevice_Capture::create_view(Buffer buffer, const BufferViewDesc& desc)
+	{
+		auto handle = m_device->create_view(buffer, desc);
+		if (m_writer.has_value())
+		{
+			// Descriptor is stored to validate that replay hands out the same indices (they may be baked into captured data)
+			write_chunk(CaptureChunk::CreateBufferView);
+			m_writer->write(handle);
+			m_writer->write(buffer);
+			m_writer->write(desc);
+			m_writer->write(m_device->get_global_descriptor(handle));
+		}
+		return handle;
+	}
+
+	TextureView RenderDevice_Capture::create_view(Texture texture, const TextureViewDesc& desc)
+	{
+		auto handle = m_device->create_view(texture, desc);
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::CreateTextureView);
+			m_writer->write(handle);
+			m_writer->write(texture);
+			m_writer->write(desc);
+			m_writer->write(m_device->get_global_descriptor(handle));
+		}
+		return handle;
+	}
+
+	u32 RenderDevice_Capture::create_transient_view(Buffer buffer, const BufferViewDesc& desc)
+	{
+		auto descriptor = m_device->create_transient_view(buffer, desc);
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::CreateTransientView);
+			m_writer->write(buffer);
+			m_writer->write(desc);
+			m_writer->write(descriptor);
+		}
+		return descriptor;
+	}
+
+	Heap RenderDevice_Capture::create_heap(const HeapDesc& desc)
+	{
+		auto handle = m_device->create_heap(desc);
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::CreateHeap);
+			m_writer->write(handle);
+			m_writer->write(desc);
+		}
+		return handle;
+	}
+
+	Buffer RenderDevice_Capture::create_placed_buffer(const BufferDesc& desc, Heap heap, u64 offset)
+	{
+		auto handle = m_device->create_placed_buffer(desc, heap, offset);
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::CreatePlacedBuffer);
+			m_writer->write(handle);
+			m_writer->write(desc);
+			m_writer->write(heap);
+			m_writer->write(offset);
+		}
+		return handle;
+	}
+
+	Texture RenderDevice_Capture::create_placed_texture(const TextureDesc& desc, Heap heap, u64 offset)
+	{
+		auto handle = m_device->create_placed_texture(desc, heap, offset);
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::CreatePlacedTexture);
+			m_writer->write(handle);
+			m_writer->write(desc);
+			m_writer->write(heap);
+			m_writer->write(offset);
+		}
+		return handle;
+	}
+
+	MemoryRequirements RenderDevice_Capture::get_memory_requirements(const BufferDesc& desc) const
+	{
+		return m_device->get_memory_requirements(desc);
+	}
+
+	MemoryRequirements RenderDevice_Capture::get_memory_requirements(const TextureDesc& desc) const
+	{
+		return m_device->get_memory_requirements(desc);
+	}
+
+	void RenderDevice_Capture::free_buffer(Buffer handle)
+	{
+		m_mapped_uploads.erase(handle.handle);
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::FreeBuffer);
+			m_writer->write(handle);
+		}
+		m_device->free_buffer(handle);
+	}
+
+	void RenderDevice_Capture::free_texture(Texture handle)
+	{
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::FreeTexture);
+			m_writer->write(handle);
+		}
+		m_device->free_texture(handle);
+	}
+
+	void RenderDevice_Capture::free_pipeline(Pipeline handle)
+	{
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::FreePipeline);
+			m_writer->write(handle);
+		}
+		m_device->free_pipeline(handle);
+	}
+
+	void RenderDevice_Capture::free_renderpass(RenderPass handle)
+	{
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::FreeRenderPass);
+			m_writer->write(handle);
+		}
+		m_device->free_renderpass(handle);
+	}
+
+	void RenderDevice_Capture::free_view(BufferView handle)
+	{
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::FreeBufferView);
+			m_writer->write(handle);
+		}
+		m_device->free_view(handle);
+	}
+
+	void RenderDevice_Capture::free_view(TextureView handle)
+	{
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::FreeTextureView);
+			m_writer->write(handle);
+		}
+		m_device->free_view(handle);
+	}
+
+	void RenderDevice_Capture::free_heap(Heap handle)
+	{
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::FreeHeap);
+			m_writer->write(handle);
+		}
+		m_device->free_heap(handle);
+	}
+
+	void RenderDevice_Capture::recycle_command_list(CommandList handle)
+	{
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::RecycleCommandList);
+			m_writer->write(handle);
+		}
+		m_device->recycle_command_list(handle);
+	}
+
+	CommandList RenderDevice_Capture::allocate_command_list(QueueType queue)
+	{
+		auto handle = m_device->allocate_command_list(queue);
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::AllocateCommandList);
+			m_writer->write(handle);
+			m_writer->write(queue);
+		}
+		return handle;
+	}
+
+	void RenderDevice_Capture::compile_command_list(CommandList handle, RenderCommandList list)
+	{
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::CompileCommandList);
+			m_writer->write(handle);
+			write_command_list(*m_writer, list);
+		}
+		m_device->compile_command_list(handle, std::move(list));
+	}
+
+	std::optional<SyncReceipt> RenderDevice_Capture::submit_command_lists(std::span<CommandList> lists, QueueType queue, std::optional<SyncReceipt> incoming_sync, bool generate_sync)
+	{
+		auto receipt = m_device->submit_command_lists(lists, queue, incoming_sync, generate_sync);
+		if (m_writer.has_value())
+		{
+			// Data has to be in place before the submission that consumes it on replay
+			for (auto& [buffer, upload] : m_mapped_uploads)
+				capture_upload_data(Buffer{ buffer }, upload);
+
+			write_chunk(CaptureChunk::SubmitCommandLists);
+			m_writer->write_array(std::span<const CommandList>(lists));
+			m_writer->write(queue);
+			m_writer->write(incoming_sync);
+			m_writer->write(receipt);
+		}
+		return receipt;
+	}
+
+	void RenderDevice_Capture::insert_wait(QueueType queue, SyncReceipt receipt)
+	{
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::InsertWait);
+			m_writer->write(queue);
+			m_writer->write(receipt);
+		}
+		m_device->insert_wait(queue, receipt);
+	}
+
+	u32 RenderDevice_Capture::get_global_descriptor(BufferView view) const
+	{
+		return m_device->get_global_descriptor(view);
+	}
+
+	u32 RenderDevice_Capture::get_global_descriptor(TextureView view) const
+	{
+		return m_device->get_global_descriptor(view);
+	}
+
+	const BufferDesc& RenderDevice_Capture::get_desc(Buffer buffer) const
+	{
+		return m_device->get_desc(buffer);
+	}
+
+	const TextureDesc& RenderDevice_Capture::get_desc(Texture texture) const
+	{
+		return m_device->get_desc(texture);
+	}
+
+	void RenderDevice_Capture::wait_for_gpu(SyncReceipt receipt)
+	{
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::WaitForGPU);
+			m_writer->write(receipt);
+		}
+		m_device->wait_for_gpu(receipt);
+	}
+
+	bool RenderDevice_Capture::is_complete(SyncReceipt receipt) const
+	{
+		return m_device->is_complete(receipt);
+	}
+
+	void RenderDevice_Capture::flush()
+	{
+		if (m_writer.has_value())
+			write_chunk(CaptureChunk::Flush);
+		m_device->flush();
+	}
+
+	void RenderDevice_Capture::begin_frame(u8 max_frames_in_flight)
+	{
+		if (m_writer.has_value())
+		{
+			write_chunk(CaptureChunk::BeginFrame);
+			m_writer->write(max_frames_in_flight);
+		}
+		m_device->begin_frame(max_frames_in_flight);
+	}
+
+	void RenderDevice_Capture::end_frame()
+	{
+		if (m_writer.has_value())
+			write_chunk(CaptureChunk::EndFrame);
+		m_device->end_frame();
+	}
+
+	u64 RenderDevice_Capture::get_current_frame() const
+	{
+		return m_device->get_current_frame();
+	}
+
+	u64 RenderDevice_Capture::get_num_completed_frames() const
+	{
+		return m_device->get_num_completed_frames();
+	}
+
+	u8* RenderDevice_Capture::map(Buffer handle, u32 subresource, std::pair<u32, u32> read_range)
+	{
+		auto mapped = m_device->map(handle, subresource, read_range);
+
+		// Only CPU-written memory is of interest
+		const auto& desc = m_device->get_desc(handle);
+		if (m_writer.has_value() && desc.memory_type == MemoryType::Upload && !m_mapped_uploads.contains(handle.handle))
+		{
+			// Replay starts off with zeroed memory, which the shadow copy reflects
+			MappedUpload upload{};
+			upload.memory = mapped;
+			upload.shadow.resize(desc.size, 0);
+			m_mapped_uploads.insert({ handle.handle, std::move(upload) });
+		}
+
+		return mapped;
+	}
+
+	void RenderDevice_Capture::unmap(Buffer handle, u32 subresource, std::pair<u32, u32> written_range)
+	{
+		// Grab any last writes while the memory is still accessible
+		if (auto it = m_mapped_uploads.find(handle.handle); it != m_mapped_uploads.end())
+		{
+			capture_upload_data(handle, it->second);
+			m_mapped_uploads.erase(it);
+		}
+
+		m_device->unmap(handle, subresource, written_range);
+	}
+
+	const GPUFrameTimings& RenderDevice_Capture::get_gpu_timings() const
+	{
+		return m_device->get_gpu_timings();
+	}
+
+	void RenderDevice_Capture::write_chunk(CaptureChunk chunk)
+	{
+		if (m_writer.has_value())
+			m_writer->write(chunk);
+	}
+
+	void RenderDevice_Capture::capture_upload_data(Buffer buffer, MappedUpload& upload)
+	{
+		const u64 size = upload.shadow.size();
+
+		// Write contiguous runs of dirty pages
+		u64 offset = 0;
+		while (offset < size)
+		{
+			u64 run_start = offset;
+			while (run_start < size)
+			{
+				const u64 page_size = (std::min)(DIFF_PAGE_SIZE, size - run_start);
+				if (std::memcmp(upload.memory + run_start, upload.shadow.data() + run_start, page_size) != 0)
+					break;
+				run_start += page_size;
+			}
+
+			u64 run_end = run_start;
+			while (run_end < size)
+			{
+				const u64 page_size = (std::min)(DIFF_PAGE_SIZE, size - run_end);
+				if (std::memcmp(upload.memory + run_end, upload.shadow.data() + run_end, page_size) == 0)
+					break;
+				run_end += page_size;
+			}
+
+			if (run_end > run_start)
+			{
+				std::memcpy(upload.shadow.data() + run_start, upload.memory + run_start, run_end - run_start);
+
+				write_chunk(CaptureChunk::BufferData);
+				m_writer->write(buffer);
+				m_writer->write(run_start);
+				m_writer->write_bytes(upload.shadow.data() + run_start, run_end - run_start);
+			}
+
+			offset = run_end;
+		}
+	}
+}
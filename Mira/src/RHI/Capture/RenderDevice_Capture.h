@@ -0,0 +1,103 @@
+#pragma once
+#include "../RenderDevice.h"
+#include "CaptureTypes.h"
+
+namespace mira
+{
+	/*
+		Pass-through device which records every call affecting the command stream into a binary capture (see CaptureTypes.h).
+		The capture is replayed against any backend through CaptureReplayer.
+
+		Recording starts on construction, so the device should be wrapped right after creation to have every resource the frames depend on recorded.
+
+		Upload data is captured by diffing mapped upload buffers against a shadow copy on each submission,
+		only the pages which have changed since the previous submission are written.
+	*/
+	class RenderDevice_Capture final : public RenderDevice
+	{
+	public:
+		RenderDevice_Capture(RenderDevice* device, const std::filesystem::path& path);
+		~RenderDevice_Capture();
+
+		// Separates captured frames, the first call marks the end of the prologue
+		void mark_frame_boundary();
+
+		// Stop recording, the device keeps forwarding calls
+		void end_capture();
+		bool is_capturing() const { return m_writer.has_value(); }
+
+		SwapChain* create_swapchain(void* hwnd, u8 num_buffers);
+
+		Buffer create_buffer(const BufferDesc& desc);
+		Texture create_texture(const TextureDesc& desc);
+		Pipeline create_graphics_pipeline(const GraphicsPipelineDesc& desc);
+		Pipeline create_graphics_pipeline_async(const GraphicsPipelineDesc& desc, Pipeline fallback = Pipeline{});
+		bool is_pipeline_ready(Pipeline handle) const;
+		RenderPass create_renderpass(const RenderPassDesc& desc);
+		BufferView create_view(Buffer buffer, const BufferViewDesc& desc);
+		TextureView create_view(Texture texture, const TextureViewDesc& desc);
+		u32 create_transient_view(Buffer buffer, const BufferViewDesc& desc);
+
+		Heap create_heap(const HeapDesc& desc);
+		Buffer create_placed_buffer(const BufferDesc& desc, Heap heap, u64 offset);
+		Texture create_placed_texture(const TextureDesc& desc, Heap heap, u64 offset);
+		MemoryRequirements get_memory_requirements(const BufferDesc& desc) const;
+		MemoryRequirements get_memory_requirements(const TextureDesc& desc) const;
+
+		void free_buffer(Buffer handle);
+		void free_texture(Texture handle);
+		void free_pipeline(Pipeline handle);
+		void free_renderpass(RenderPass handle);
+		void free_view(BufferView handle);
+		void free_view(TextureView handle);
+		void free_heap(Heap handle);
+		void recycle_command_list(CommandList handle);
+
+		CommandList allocate_command_list(QueueType queue = QueueType::Graphics);
+		void compile_command_list(CommandList handle, RenderCommandList list);
+		std::optional<SyncReceipt> submit_command_lists(
+			std::span<CommandList> lists,
+			QueueType queue = QueueType::Graphics,
+			std::optional<SyncReceipt> incoming_sync = std::nullopt,
+			bool generate_sync = false);
+		void insert_wait(QueueType queue, SyncReceipt receipt);
+
+		u32 get_global_descriptor(BufferView view) const;
+		u32 get_global_descriptor(TextureView view) const;
+
+		const BufferDesc& get_desc(Buffer buffer) const;
+		const TextureDesc& get_desc(Texture texture) const;
+
+		void wait_for_gpu(SyncReceipt receipt);
+		bool is_complete(SyncReceipt receipt) const;
+		void flush();
+		void begin_frame(u8 max_frames_in_flight);
+		void end_frame();
+		u64 get_current_frame() const;
+		u64 get_num_completed_frames() const;
+
+		u8* map(Buffer handle, u32 subresource = 0, std::pair<u32, u32> read_range = { 0, 0 });
+		void unmap(Buffer handle, u32 subresource = 0, std::pair<u32, u32> written_range = { 0, 0 });
+
+		const GPUFrameTimings& get_gpu_timings() const;
+
+	private:
+		// Granularity of upload data diffing
+		static constexpr u64 DIFF_PAGE_SIZE = 4096;
+
+		struct MappedUpload
+		{
+			u8* memory{ nullptr };
+			std::vector<u8> shadow;
+		};
+
+		void write_chunk(CaptureChunk chunk);
+		void capture_upload_data(Buffer buffer, MappedUpload& upload);
+
+	private:
+		RenderDevice* m_device{ nullptr };
+		std::optional<CaptureWriter> m_writer;
+
+		std::unordered_map<u64, MappedUpload> m_mapped_uploads;
+	};
+}
@@ -3,11 +3,13 @@
 
 namespace mira
 {
-	CommandCompiler_DX12::CommandCompiler_DX12(const RenderDevice_DX12* dev, ComPtr<ID3D12CommandAllocator> ator, ComPtr<ID3D12GraphicsCommandList4> cmdl, QueueType queue) :
+	CommandCompiler_DX12::CommandCompiler_DX12(const RenderDevice_DX12* dev, ComPtr<ID3D12CommandAllocator> ator, ComPtr<ID3D12GraphicsCommandList4> cmdl, DX12UploadArena&& arena, QueueType queue) :
 		m_dev(dev),
 		m_ator(ator),
 		m_list(cmdl),
-		m_queue_type(queue)
+		m_queue_type(queue),
+		m_state_tracker(queue == QueueType::Copy),
+		m_upload_arena(std::move(arena))
 	{
 		/*
 			Ordering constraint between SetDescriptorHeap and SetRootSig
@@ -30,37 +32,148 @@ namespace mira
 	}
 
 
+	u32 CommandCompiler_DX12::try_merge_draws(std::span<const std::shared_ptr<RenderCommand>> cmds)
+	{
+		if (m_queue_type != QueueType::Graphics)
+			return 0;
+
+		/*
+			A run consists of elements of an optional UpdateShaderArgs directly followed by a DrawIndexed.
+			All draws must share the index buffer and the shader arguments may only differ from the first element in a single slot.
+			That slot is then fed per draw through the draw ID of the command signature, which covers the common case of
+			a per-draw index (e.g submesh) being the only thing changing between draws.
+		*/
+		m_merge_scratch.clear();
+		const RenderCommandUpdateShaderArgs* prev_args = &m_current_args;
+		std::optional<u8> varying_slot;
+		u32 consumed = 0;
+
+		while (consumed < cmds.size())
+		{
+			MergeCandidate candidate{ prev_args, nullptr };
+			u32 num_cmds = 1;
+
+			if (cmds[consumed]->type == RenderCommandUpdateShaderArgs::TYPE)
+			{
+				if (consumed + 1 >= cmds.size())
+					break;
+				candidate.args = static_cast<const RenderCommandUpdateShaderArgs*>(cmds[consumed].get());
+				++num_cmds;
+			}
+
+			const auto& draw_cmd = cmds[consumed + num_cmds - 1];
+			if (draw_cmd->type != RenderCommandDrawIndexed::TYPE)
+				break;
+			candidate.draw = static_cast<const RenderCommandDrawIndexed*>(draw_cmd.get());
+
+			if (!m_merge_scratch.empty())
+			{
+				const auto& first = m_merge_scratch.front();
+				if (candidate.draw->index_buffer.handle != first.draw->index_buffer.handle ||
+					candidate.args->num_constants != first.args->num_constants)
+					break;
+
+				bool compatible = true;
+				for (u8 slot = 0; slot < candidate.args->num_constants && compatible; ++slot)
+				{
+					if (candidate.args->constants[slot] == first.args->constants[slot])
+						continue;
+
+					if (!varying_slot.has_value())
+						varying_slot = slot;
+					compatible = *varying_slot == slot;
+				}
+
+				if (!compatible)
+					break;
+			}
+
+			m_merge_scratch.push_back(candidate);
+			prev_args = candidate.args;
+			consumed += num_cmds;
+		}
+
+		if (m_merge_scratch.size() < MIN_DRAWS_TO_MERGE)
+			return 0;
+
+		// Write arguments
+		const u32 num_draws = (u32)m_merge_scratch.size();
+		auto args_mem = m_upload_arena.allocate(num_draws * sizeof(DrawIndexedIndirectArguments));
+		auto args = (DrawIndexedIndirectArguments*)args_mem.memory;
+		for (u32 i = 0; i < num_draws; ++i)
+		{
+			const auto& candidate = m_merge_scratch[i];
+			args[i].draw_id = varying_slot.has_value() ? candidate.args->constants[*varying_slot] : 0;
+			args[i].indices_per_instance = candidate.draw->indices_per_instance;
+			args[i].instance_count = candidate.draw->instance_count;
+			args[i].index_start = candidate.draw->index_start;
+			args[i].vertex_start = (i32)candidate.draw->vertex_start;
+			args[i].instance_start = candidate.draw->instance_start;
+		}
+
+		// Arguments which do not vary are shared by the whole run
+		if (m_merge_scratch.front().args->num_constants > 0)
+			set_shader_args(*m_merge_scratch.front().args);
+		bind_index_buffer(m_merge_scratch.front().draw->index_buffer);
+		flush_barriers();
+
+		// Skip the draw ID if the signature does not consume it
+		const u64 args_offset = args_mem.offset + (varying_slot.has_value() ? 0 : sizeof(u32));
+		m_list->ExecuteIndirect(m_dev->get_api_draw_indexed_signature(varying_slot), num_draws, args_mem.resource, args_offset, nullptr, 0);
+
+		// Root arguments touched by the command signature are undefined after ExecuteIndirect, restore to what sequential draws would leave behind
+		if (varying_slot.has_value())
+			set_shader_args(*m_merge_scratch.back().args);
+		else
+			m_current_args = *m_merge_scratch.back().args;
+
+		return consumed;
+	}
+
 	void CommandCompiler_DX12::compile(const RenderCommandDraw& cmd)
 	{
+		flush_barriers();
 		m_list->DrawInstanced(cmd.verts_per_instance, cmd.instance_count, cmd.vert_start, cmd.instance_start);
 	}
 
 	void CommandCompiler_DX12::compile(const RenderCommandDrawIndexed& cmd)
 	{
-		if (cmd.index_buffer.handle != m_current_ib.handle)
-		{
-			auto ib = m_dev->get_api_buffer(cmd.index_buffer);
-			D3D12_INDEX_BUFFER_VIEW ibv{};
-			ibv.BufferLocation = ib->GetGPUVirtualAddress();
-			ibv.Format = DXGI_FORMAT_R32_UINT;
-			ibv.SizeInBytes = m_dev->get_api_buffer_size(cmd.index_buffer);
-			m_list->IASetIndexBuffer(&ibv);
-
-			m_current_ib = cmd.index_buffer;
-		}
-
+		flush_barriers();
+		bind_index_buffer(cmd.index_buffer);
 		m_list->DrawIndexedInstanced(cmd.indices_per_instance, cmd.instance_count, cmd.index_start, cmd.vertex_start, cmd.instance_start);
 	}
 
+	void CommandCompiler_DX12::compile(const RenderCommandDrawIndexedIndirect& cmd)
+	{
+		flush_barriers();
+		bind_index_buffer(cmd.index_buffer);
+
+		ID3D12Resource* count_buffer = cmd.count_buffer.has_value() ? m_dev->get_api_buffer(*cmd.count_buffer) : nullptr;
+		const u64 count_offset = cmd.count_buffer.has_value() ? m_dev->get_api_buffer_offset(*cmd.count_buffer) + cmd.count_offset : 0;
+
+		// Argument layout always carries the draw ID, skip it if the signature does not consume it
+		const u64 args_offset = m_dev->get_api_buffer_offset(cmd.argument_buffer) + cmd.argument_offset + (cmd.draw_id_slot.has_value() ? 0 : sizeof(u32));
+		m_list->ExecuteIndirect(m_dev->get_api_draw_indexed_signature(cmd.draw_id_slot), cmd.max_draws,
+			m_dev->get_api_buffer(cmd.argument_buffer), args_offset,
+			count_buffer, count_offset);
+
+		// Root arguments touched by the command signature are undefined after ExecuteIndirect
+		if (cmd.draw_id_slot.has_value())
+			set_shader_args(m_current_args);
+	}
+
 	void CommandCompiler_DX12::compile(const RenderCommandSetPipeline& cmd)
 	{
-		m_list->SetPipelineState(m_dev->get_api_pipeline(cmd.pipeline));
-		m_list->IASetPrimitiveTopology(m_dev->get_api_topology(cmd.pipeline));
+		const Pipeline pipeline = m_dev->resolve_pipeline(cmd.pipeline);
+		m_list->SetPipelineState(m_dev->get_api_pipeline(pipeline));
+		m_list->IASetPrimitiveTopology(m_dev->get_api_topology(pipeline));
 
 	}
 
 	void CommandCompiler_DX12::compile(const RenderCommandBeginRenderPass& cmd)
 	{
+		flush_barriers();
+
 		// Bind render pass
 		auto rts = m_dev->get_rp_rts(cmd.rp);
 		auto ds = m_dev->get_rp_depth_stencil(cmd.rp);
@@ -84,66 +197,111 @@ namespace mira
 
 	void CommandCompiler_DX12::compile(const RenderCommandEndRenderPass& cmd)
 	{
+		flush_barriers();
 		m_list->EndRenderPass();
 	}
 
 	void CommandCompiler_DX12::compile(const RenderCommandBarrier& cmd)
 	{
-		std::vector<D3D12_RESOURCE_BARRIER> barrs{};
-		barrs.reserve(cmd.barriers.size());
-
 		for (const auto& barr : cmd.barriers)
 		{
 			switch (barr.info.type)
 			{
 			case ResourceBarrier::Type::Aliasing:
 			{
-				assert(false);
+				const bool is_buffer = barr.info.res_type == ResourceBarrier::ResourceType::Buffer;
+				auto get_resource = [&](u64 handle) -> ID3D12Resource*
+				{
+					// Null resource is allowed for 'before'
+					if (handle == 0)
+						return nullptr;
+					return is_buffer ? m_dev->get_api_buffer(Buffer{ handle }) : m_dev->get_api_texture(Texture{ handle });
+				};
+
+				m_pending_barriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(get_resource(barr.info.resource_or_before), get_resource(barr.info.after)));
 				break;
 			}
 			case ResourceBarrier::Type::Transition:
 			{
-				if (barr.info.res_type == ResourceBarrier::ResourceType::Buffer)
+				const bool is_buffer = barr.info.res_type == ResourceBarrier::ResourceType::Buffer;
+				const u64 handle = barr.info.resource_or_before;
+				ID3D12Resource* resource = is_buffer ? m_dev->get_api_buffer(Buffer{ handle }) : m_dev->get_api_texture(Texture{ handle });
+				const u32 num_subresources = is_buffer ? 1 : m_dev->get_api_subresource_count(Texture{ handle });
+				const auto after = m_dev->get_resource_state(barr.info.state_after);
+
+				// The state was already tracked on the begin half, which also knows the exact transitions to end
+				if (barr.info.split == ResourceBarrier::Split::EndOnly)
 				{
-					barrs.push_back(CD3DX12_RESOURCE_BARRIER::Transition(
-						m_dev->get_api_buffer(Buffer{ barr.info.resource_or_before }),
-						m_dev->get_resource_state(barr.info.state_before), m_dev->get_resource_state(barr.info.state_after),
-						barr.info.subresource));
+					[[maybe_unused]] const u32 closed = end_split(resource, barr.info.subresource);
+					// Tracked begins may have been dropped as redundant
+					assert(closed > 0 || barr.info.tracked_before);
+					break;
+				}
+
+				m_transition_scratch.clear();
+				if (barr.info.tracked_before)
+				{
+					m_state_tracker.transition(resource, !is_buffer, handle, num_subresources, barr.info.subresource, after, m_transition_scratch);
 				}
 				else
 				{
-					barrs.push_back(CD3DX12_RESOURCE_BARRIER::Transition(
-						m_dev->get_api_texture(Texture{ barr.info.resource_or_before }),
-						m_dev->get_resource_state(barr.info.state_before), m_dev->get_resource_state(barr.info.state_after),
-						barr.info.subresource));
+					const auto before = m_dev->get_resource_state(barr.info.state_before);
+					m_state_tracker.track(resource, !is_buffer, handle, num_subresources, barr.info.subresource, before, after);
+					m_transition_scratch.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, before, after, barr.info.subresource));
 				}
 
+				for (auto& transition : m_transition_scratch)
+				{
+					if (barr.info.split == ResourceBarrier::Split::BeginOnly)
+					{
+						m_open_splits.push_back(transition);
+						transition.Flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+						m_pending_barriers.push_back(transition);
+					}
+					else
+					{
+						push_transition(transition);
+					}
+				}
 				break;
 			}
 			case ResourceBarrier::Type::UnorderedAccess:
 			{
-				assert(false);
+				ID3D12Resource* resource = barr.info.res_type == ResourceBarrier::ResourceType::Buffer ?
+					m_dev->get_api_buffer(Buffer{ barr.info.resource_or_before }) :
+					m_dev->get_api_texture(Texture{ barr.info.resource_or_before });
+
+				m_pending_barriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(resource));
 				break;
 			}
 			default:
 				assert(false);
 			}
 		}
+	}
 
-		m_barriers_per_submission.push_back(std::move(barrs));
-		m_list->ResourceBarrier((u32)m_barriers_per_submission.back().size(), m_barriers_per_submission.back().data());
+	void CommandCompiler_DX12::flush_barriers()
+	{
+		if (m_pending_barriers.empty())
+			return;
+
+		m_list->ResourceBarrier((u32)m_pending_barriers.size(), m_pending_barriers.data());
+		m_pending_barriers.clear();
 	}
 
 	void CommandCompiler_DX12::compile(const RenderCommandCopyBuffer& cmd)
 	{
+		flush_barriers();
 		auto src = m_dev->get_api_buffer(cmd.src);
 		auto dst = m_dev->get_api_buffer(cmd.dst);
 
-		m_list->CopyBufferRegion(dst, cmd.dst_offset, src, cmd.src_offset, cmd.size);
+		m_list->CopyBufferRegion(dst, m_dev->get_api_buffer_offset(cmd.dst) + cmd.dst_offset, src, m_dev->get_api_buffer_offset(cmd.src) + cmd.src_offset, cmd.size);
 	}
 
 	void CommandCompiler_DX12::compile(const RenderCommandCopyBufferToImage& cmd)
 	{
+		flush_barriers();
+
 		D3D12_TEXTURE_COPY_LOCATION dst_loc{}, src_loc{};
 
 		dst_loc.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
@@ -152,10 +310,10 @@ namespace mira
 
 		src_loc.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
 		src_loc.pResource = m_dev->get_api_buffer(cmd.src);
-		src_loc.PlacedFootprint.Offset = cmd.src_offset;				// ======= @todo: is this correct?
+		src_loc.PlacedFootprint.Offset = m_dev->get_api_buffer_offset(cmd.src) + cmd.src_offset;				// ======= @todo: is this correct?
 
 		// Assert that the user has placed the data correctly according to alignment rules
-		assert(cmd.src_offset % D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT == 0);
+		assert(src_loc.PlacedFootprint.Offset % D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT == 0);
 
 		src_loc.PlacedFootprint.Footprint.RowPitch = cmd.src_rowpitch;
 		src_loc.PlacedFootprint.Footprint.Depth = cmd.src_depth;
@@ -167,11 +325,178 @@ namespace mira
 	}
 
 	void CommandCompiler_DX12::compile(const RenderCommandUpdateShaderArgs& cmd)
+	{
+		set_shader_args(cmd);
+	}
+
+	void CommandCompiler_DX12::reserve_profile_queries(std::span<const std::shared_ptr<RenderCommand>> cmds)
+	{
+		// Copy queues need a dedicated timestamp heap type, their scopes are ignored
+		if (m_queue_type == QueueType::Copy)
+			return;
+
+		u32 num_scopes = 0, num_statistics = 0;
+		for (const auto& cmd : cmds)
+		{
+			if (cmd->type != RenderCommandBeginProfileScope::TYPE)
+				continue;
+
+			++num_scopes;
+			if (static_cast<const RenderCommandBeginProfileScope*>(cmd.get())->pipeline_statistics && m_queue_type == QueueType::Graphics)
+				++num_statistics;
+		}
+
+		if (num_scopes > 0)
+			m_profile_queries = m_dev->get_profiler()->reserve(m_dev->get_current_frame(), num_scopes, num_statistics);
+	}
+
+	void CommandCompiler_DX12::resolve_profile_queries()
+	{
+		assert(m_open_scopes.empty());
+		if (m_profile_queries.has_value())
+			m_dev->get_profiler()->resolve(m_list.Get(), *m_profile_queries);
+	}
+
+	void CommandCompiler_DX12::compile(const RenderCommandBeginProfileScope& cmd)
+	{
+		if (!m_profile_queries.has_value())
+		{
+			m_open_scopes.push_back(std::nullopt);
+			return;
+		}
+
+		// Barriers requested before the scope are not part of it
+		flush_barriers();
+
+		DX12GPUProfiler::Scope scope{};
+		scope.name = cmd.name.data();
+		scope.queue = m_queue_type;
+		scope.depth = (u8)m_open_scopes.size();
+		scope.timestamp = m_profile_queries->first_timestamp + (u32)m_profile_scopes.size() * 2;
+		m_list->EndQuery(m_dev->get_profiler()->get_timestamp_heap(), D3D12_QUERY_TYPE_TIMESTAMP, scope.timestamp);
+
+		// Pipeline statistics are only gathered on the graphics queue
+		if (cmd.pipeline_statistics && m_queue_type == QueueType::Graphics)
+		{
+			scope.statistics = m_profile_queries->first_statistics + m_num_statistics++;
+			m_list->BeginQuery(m_dev->get_profiler()->get_statistics_heap(), D3D12_QUERY_TYPE_PIPELINE_STATISTICS, *scope.statistics);
+		}
+
+		m_open_scopes.push_back((u32)m_profile_scopes.size());
+		m_profile_scopes.push_back(std::move(scope));
+	}
+
+	void CommandCompiler_DX12::compile(const RenderCommandEndProfileScope& cmd)
+	{
+		assert(!m_open_scopes.empty());
+		const auto open = m_open_scopes.back();
+		m_open_scopes.pop_back();
+		if (!open.has_value())
+			return;
+
+		// Barriers requested within the scope are part of it
+		flush_barriers();
+
+		const auto& scope = m_profile_scopes[*open];
+		if (scope.statistics.has_value())
+			m_list->EndQuery(m_dev->get_profiler()->get_statistics_heap(), D3D12_QUERY_TYPE_PIPELINE_STATISTICS, *scope.statistics);
+		m_list->EndQuery(m_dev->get_profiler()->get_timestamp_heap(), D3D12_QUERY_TYPE_TIMESTAMP, scope.timestamp + 1);
+	}
+
+	void CommandCompiler_DX12::push_transition(const D3D12_RESOURCE_BARRIER& barr)
+	{
+		/*
+			Nothing can use a resource while its barriers are pending, so the latest pending barrier on the same subresource,
+			if it is a transition ending in the state this one starts from, can be folded: A->B followed by B->A cancels out,
+			A->B followed by B->C becomes A->C.
+			Only adjacent ones, an aliasing or UAV barrier (or a split half) on the resource in between has to see the state
+			the earlier transition leaves it in.
+		*/
+		const auto& incoming = barr.Transition;
+		auto overlaps = [&incoming](const D3D12_RESOURCE_BARRIER& pending)
+		{
+			switch (pending.Type)
+			{
+			case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION:
+				return pending.Transition.pResource == incoming.pResource &&
+					(pending.Transition.Subresource == incoming.Subresource ||
+					 pending.Transition.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES ||
+					 incoming.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+			case D3D12_RESOURCE_BARRIER_TYPE_ALIASING:
+				// Null stands for any placed resource
+				return pending.Aliasing.pResourceBefore == nullptr || pending.Aliasing.pResourceAfter == nullptr ||
+					pending.Aliasing.pResourceBefore == incoming.pResource || pending.Aliasing.pResourceAfter == incoming.pResource;
+			case D3D12_RESOURCE_BARRIER_TYPE_UAV:
+				// Null stands for any resource
+				return pending.UAV.pResource == nullptr || pending.UAV.pResource == incoming.pResource;
+			default:
+				return true;
+			}
+		};
+
+		auto it = std::find_if(m_pending_barriers.rbegin(), m_pending_barriers.rend(), overlaps);
+		if (it != m_pending_barriers.rend())
+		{
+			// Split halves have to match each other as recorded
+			auto& pending = it->Transition;
+			const bool foldable = it->Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION && it->Flags == D3D12_RESOURCE_BARRIER_FLAG_NONE &&
+				pending.Subresource == incoming.Subresource && pending.StateAfter == incoming.StateBefore;
+			if (foldable)
+			{
+				if (pending.StateBefore == incoming.StateAfter)
+					m_pending_barriers.erase(std::next(it).base());
+				else
+					pending.StateAfter = incoming.StateAfter;
+				return;
+			}
+		}
+
+		m_pending_barriers.push_back(barr);
+	}
+
+	u32 CommandCompiler_DX12::end_split(ID3D12Resource* resource, u32 subresource)
+	{
+		u32 closed = 0;
+		for (auto it = m_open_splits.begin(); it != m_open_splits.end();)
+		{
+			const auto& open = it->Transition;
+			if (open.pResource != resource || (subresource != D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES && open.Subresource != subresource))
+			{
+				++it;
+				continue;
+			}
+
+			D3D12_RESOURCE_BARRIER end = *it;
+			end.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+			m_pending_barriers.push_back(end);
+			it = m_open_splits.erase(it);
+			++closed;
+		}
+		return closed;
+	}
+
+	void CommandCompiler_DX12::bind_index_buffer(Buffer buffer)
+	{
+		if (buffer.handle == m_current_ib.handle)
+			return;
+
+		auto ib = m_dev->get_api_buffer(buffer);
+		D3D12_INDEX_BUFFER_VIEW ibv{};
+		ibv.BufferLocation = ib->GetGPUVirtualAddress() + m_dev->get_api_buffer_offset(buffer);
+		ibv.Format = DXGI_FORMAT_R32_UINT;
+		ibv.SizeInBytes = m_dev->get_api_buffer_size(buffer);
+		m_list->IASetIndexBuffer(&ibv);
+
+		m_current_ib = buffer;
+	}
+
+	void CommandCompiler_DX12::set_shader_args(const RenderCommandUpdateShaderArgs& args)
 	{
 		if (m_queue_type == QueueType::Graphics)
-			m_list->SetGraphicsRoot32BitConstants(0, cmd.num_constants, cmd.constants.data(), 0);
+			m_list->SetGraphicsRoot32BitConstants(0, args.num_constants, args.constants.data(), 0);
 		else if (m_queue_type == QueueType::Compute)
-			m_list->SetComputeRoot32BitConstants(0, cmd.num_constants, cmd.constants.data(), 0);
+			m_list->SetComputeRoot32BitConstants(0, args.num_constants, args.constants.data(), 0);
 
+		m_current_args = args;
 	}
 }
@@ -1,6 +1,9 @@
 #pragma once
 #include "../RenderCommandList.h"
 #include "DX12CommonIncludes.h"
+#include "Utilities/DX12UploadArena.h"
+#include "Utilities/DX12ResourceStateTracker.h"
+#include "Utilities/DX12GPUProfiler.h"
 
 namespace mira
 {
@@ -9,14 +12,35 @@ namespace mira
 	class CommandCompiler_DX12
 	{
 	public:
-		CommandCompiler_DX12(const RenderDevice_DX12* dev, ComPtr<ID3D12CommandAllocator> ator, ComPtr<ID3D12GraphicsCommandList4> cmdl, QueueType queue);
+		CommandCompiler_DX12(const RenderDevice_DX12* dev, ComPtr<ID3D12CommandAllocator> ator, ComPtr<ID3D12GraphicsCommandList4> cmdl, DX12UploadArena&& arena, QueueType queue);
 
 		ID3D12GraphicsCommandList4* get_list() { return m_list.Get(); }
 		ID3D12CommandAllocator* get_allocator() { return m_ator.Get(); }
+		DX12UploadArena& get_upload_arena() { return m_upload_arena; }
 		QueueType get_queue_type() const { return m_queue_type; }
+		const DX12ResourceStateTracker& get_state_tracker() const { return m_state_tracker; }
+
+		// Split transitions which have begun but not ended, must be none once the list is done
+		bool has_open_splits() const { return !m_open_splits.empty(); }
+
+		/*
+			Folds a run of consecutive indexed draws at the start of 'cmds' into a single indirect draw.
+			Returns the number of commands consumed, or 0 if no merge took place (caller compiles them as usual).
+		*/
+		u32 try_merge_draws(std::span<const std::shared_ptr<RenderCommand>> cmds);
+
+		// Barriers are batched until they are required, which the owner has to account for once recording is done
+		void flush_barriers();
+
+		// Queries of the profiling scopes are reserved up front, so that the list resolves a single block once recording is done
+		void reserve_profile_queries(std::span<const std::shared_ptr<RenderCommand>> cmds);
+		void resolve_profile_queries();
+		const std::optional<DX12GPUProfiler::Reservation>& get_profile_queries() const { return m_profile_queries; }
+		std::span<const DX12GPUProfiler::Scope> get_profile_scopes() const { return m_profile_scopes; }
 		
 		void compile(const RenderCommandDraw& cmd);
 		void compile(const RenderCommandDrawIndexed& cmd);
+		void compile(const RenderCommandDrawIndexedIndirect& cmd);
 		void compile(const RenderCommandSetPipeline& cmd);
 		void compile(const RenderCommandBeginRenderPass& cmd);
 		void compile(const RenderCommandEndRenderPass& cmd);
@@ -24,6 +48,26 @@ namespace mira
 		void compile(const RenderCommandCopyBuffer& cmd);
 		void compile(const RenderCommandCopyBufferToImage& cmd);
 		void compile(const RenderCommandUpdateShaderArgs& cmd);
+		void compile(const RenderCommandBeginProfileScope& cmd);
+		void compile(const RenderCommandEndProfileScope& cmd);
+
+	private:
+		void bind_index_buffer(Buffer buffer);
+		void set_shader_args(const RenderCommandUpdateShaderArgs& args);
+		void push_transition(const D3D12_RESOURCE_BARRIER& barr);
+
+		// Ends the open split transitions on the (sub)resource, returns the number ended
+		u32 end_split(ID3D12Resource* resource, u32 subresource);
+
+	private:
+		// Anything shorter is cheaper to issue as direct draws
+		static constexpr u32 MIN_DRAWS_TO_MERGE = 4;
+
+		struct MergeCandidate
+		{
+			const RenderCommandUpdateShaderArgs* args{ nullptr };
+			const RenderCommandDrawIndexed* draw{ nullptr };
+		};
 
 	private:
 		const RenderDevice_DX12* m_dev;
@@ -31,11 +75,28 @@ namespace mira
 		ComPtr<ID3D12GraphicsCommandList4> m_list;
 		QueueType m_queue_type{ QueueType::None };
 
-		// Store barriers persistently
-		std::vector<std::vector<D3D12_RESOURCE_BARRIER>> m_barriers_per_submission;
+		// Pending barriers, flushed as a single batch right before they are required
+		std::vector<D3D12_RESOURCE_BARRIER> m_pending_barriers;
+
+		// Local resource states, resolved against the global states on submission
+		DX12ResourceStateTracker m_state_tracker;
+		std::vector<D3D12_RESOURCE_BARRIER> m_transition_scratch;
+
+		// Begin halves of split transitions waiting for their end
+		std::vector<D3D12_RESOURCE_BARRIER> m_open_splits;
 
 		Buffer m_current_ib;
+		RenderCommandUpdateShaderArgs m_current_args;
+
+		// Holds the indirect arguments of merged draws, lives as long as the command allocator does
+		DX12UploadArena m_upload_arena;
+		std::vector<MergeCandidate> m_merge_scratch;
 
+		// Scopes are skipped (nullopt) when no queries could be reserved
+		std::optional<DX12GPUProfiler::Reservation> m_profile_queries;
+		std::vector<DX12GPUProfiler::Scope> m_profile_scopes;
+		std::vector<std::optional<u32>> m_open_scopes;
+		u32 m_num_statistics{ 0 };
 
 	};
 }
@@ -8,7 +8,8 @@ extern "C" { __declspec(dllexport) extern const char* D3D12SDKPath = ".\\D3D12\\
 
 namespace mira
 {
-	RenderBackend_DX12::RenderBackend_DX12(bool debug) :
+	RenderBackend_DX12::RenderBackend_DX12(ThreadPool& workers, bool debug) :
+		m_workers(workers),
 		m_debug_on(debug)
 	{
 		create_adapter_factory();
@@ -33,7 +34,7 @@ namespace mira
 		hr = D3D12CreateDevice(m_adapter.Get(), D3D_FEATURE_LEVEL_12_2, IID_PPV_ARGS(dev.GetAddressOf()));
 		HR_VFY(hr);
 
-		auto render_device = std::make_unique<RenderDevice_DX12>(dev, m_adapter.Get(), m_debug_on);
+		auto render_device = std::make_unique<RenderDevice_DX12>(dev, m_adapter.Get(), m_workers, m_debug_on);
 		auto ret = render_device.get();
 
 		m_devices.insert({ render_device.get(), dev });
@@ -4,10 +4,13 @@
 
 namespace mira
 {
+	class ThreadPool;
+
 	class RenderBackend_DX12 : public RenderBackend
 	{
 	public:
-		RenderBackend_DX12(bool debug = false);
+		// Devices compile pipelines in the background on 'workers'
+		RenderBackend_DX12(ThreadPool& workers, bool debug = false);
 
 		RenderDevice* create_device() override;
 
@@ -22,6 +25,7 @@ namespace mira
 		};
 
 	private:
+		ThreadPool& m_workers;
 		bool m_debug_on{ false };
 
 		std::unordered_map<RenderDevice*, ComPtr<ID3D12Device>> m_devices;
@@ -1,12 +1,15 @@
 #include "RenderDevice_DX12.h"
 #include <D3D12MemAlloc.h>
 #include <iostream>
+#include <numeric>
 
 #include "Utilities/DX12DescriptorManager.h"
 #include "Utilities/DX12Queue.h"
 #include "Utilities/DX12Fence.h"
+#include "Utilities/DX12PipelineLibrary.h"
 #include "Utilities/StructTranslator_DX12.h"
 #include "CommandCompiler_DX12.h"
+#include "../../Profiling/CPUProfiler.h"
 
 #include "SwapChain_DX12.h"
 
@@ -14,17 +17,18 @@
 namespace mira
 {
 
-	RenderDevice_DX12::RenderDevice_DX12(ComPtr<ID3D12Device5> device, IDXGIAdapter* adapter, bool debug) :
+	RenderDevice_DX12::RenderDevice_DX12(ComPtr<ID3D12Device5> device, IDXGIAdapter* adapter, ThreadPool& workers, bool debug) :
 		m_device(device),
-		m_debug_on(debug)
+		m_debug_on(debug),
+		m_workers(workers)
 	{
 		// 0 marked as un-used
 		//m_resources.resize(1);
 		m_buffers.resize(1);
 		m_textures.resize(1);
+		m_heaps.resize(1);
 		m_pipelines.resize(1);
 		m_renderpasses.resize(1);
-		m_syncs.resize(1);
 		m_command_lists.resize(1);
 
 		m_buffer_views.resize(1);
@@ -35,11 +39,22 @@ namespace mira
 
 		m_descriptor_mgr = std::make_unique<DX12DescriptorManager>(m_device.Get());
 
+		m_transient_descriptors = m_descriptor_mgr->allocate(NUM_TRANSIENT_DESCRIPTORS, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		m_transient_ring = VirtualLinearRing(NUM_TRANSIENT_DESCRIPTORS);
+		m_profiler = std::make_unique<DX12GPUProfiler>(m_device.Get(), m_dma.Get());
+
 		init_rootsig();
+		init_command_signatures();
+
+		m_pipeline_library = std::make_unique<DX12PipelineLibrary>(m_device.Get(), PIPELINE_LIBRARY_PATH);
 	}
 
 	RenderDevice_DX12::~RenderDevice_DX12()
 	{
+		m_workers.wait(m_pipeline_jobs);
+
+		m_descriptor_mgr->free(&m_transient_descriptors);
+
 		// Destroy any leftover views automatically
 		for (auto view : m_buffer_views)
 		{
@@ -56,6 +71,10 @@ namespace mira
 				m_descriptor_mgr->free(&(*view).view);
 			}
 		}
+
+		// Leftover sub-allocated buffers go with their blocks
+		for (auto& block : m_small_buffer_blocks)
+			block.block->Clear();
 	}
 
 	SwapChain* RenderDevice_DX12::create_swapchain(void* hwnd, u8 num_buffers)
@@ -68,92 +87,310 @@ namespace mira
 	{
 		HRESULT hr{ S_OK };
 
+		Buffer_Storage storage{};
+		storage.desc = desc;
+
+		if (!sub_allocate_buffer(desc, storage))
+		{
+			D3D12MA::ALLOCATION_DESC ad{};
+			ad.HeapType = to_internal(desc.memory_type);
+
+			const D3D12_RESOURCE_DESC rd = get_resource_desc(desc);
+
+			hr = m_dma->CreateResource(&ad, &rd, get_initial_state(desc.memory_type), nullptr, storage.alloc.GetAddressOf(), IID_PPV_ARGS(storage.resource.GetAddressOf()));
+			HR_VFY(hr);
+		}
+		storage.states = DX12SubresourceStates(1, get_initial_state(desc.memory_type));
+		
+		auto handle = m_rhp.allocate<Buffer>();
+		try_insert(m_buffers, storage, get_slot(handle.handle));
+		return handle;
+	}
+
+	bool RenderDevice_DX12::sub_allocate_buffer(const BufferDesc& desc, Buffer_Storage& storage)
+	{
+		if (desc.memory_type == MemoryType::Default || desc.size == 0 || desc.size > SMALL_BUFFER_MAX_SIZE)
+			return false;
+		if (desc.alignment > SMALL_BUFFER_ALIGNMENT)
+			return false;
+
+		/*
+			Structured views address the resource in whole elements from its start, so the offset of the sub-allocation has to be a multiple of their stride.
+			Readback buffers and buffers without shader resource access can not have shader views, and constant or raw views are fine at any sub-allocation.
+			Other buffers have to state their stride, or they get a resource of their own.
+		*/
+		u64 alignment = SMALL_BUFFER_ALIGNMENT;
+		const bool viewable = desc.memory_type == MemoryType::Upload && !(desc.usage & UsageIntent::DenyShaderResource);
+		if (viewable)
+		{
+			if (desc.stride == 0)
+				return false;
+			alignment = std::lcm(alignment, (u64)desc.stride);
+			if (alignment > SMALL_BUFFER_MAX_SIZE)
+				return false;
+		}
+
+		D3D12MA::VIRTUAL_ALLOCATION_DESC alloc_desc{};
+		alloc_desc.Size = desc.size;
+		alloc_desc.Alignment = alignment;
+
+		auto try_allocate = [&](u32 block_idx)
+		{
+			auto& block = m_small_buffer_blocks[block_idx];
+			if (block.memory_type != desc.memory_type)
+				return false;
+
+			UINT64 offset{ 0 };
+			if (FAILED(block.block->Allocate(&alloc_desc, &storage.sub_allocation, &offset)))
+				return false;
+
+			storage.resource = block.resource;
+			storage.block = block_idx;
+			storage.offset = offset;
+			return true;
+		};
+
+		for (u32 i = 0; i < (u32)m_small_buffer_blocks.size(); ++i)
+		{
+			if (try_allocate(i))
+				return true;
+		}
+
+		// Every block of the memory type is full
+		HRESULT hr{ S_OK };
+
 		D3D12MA::ALLOCATION_DESC ad{};
 		ad.HeapType = to_internal(desc.memory_type);
 
-		D3D12_RESOURCE_DESC rd{};
-		rd.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		rd.Alignment = desc.alignment;
-		rd.Width = desc.size;
-		rd.Height = rd.DepthOrArraySize = rd.MipLevels = 1;
-		rd.Format = DXGI_FORMAT_UNKNOWN;
-		rd.SampleDesc.Count = 1;
-		rd.SampleDesc.Quality = 0;
-		rd.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		rd.Flags = to_internal(desc.usage);
+		const D3D12_RESOURCE_DESC rd = get_resource_desc(BufferDesc((u32)SMALL_BUFFER_BLOCK_SIZE, desc.memory_type));
+
+		SmallBufferBlock block{};
+		block.memory_type = desc.memory_type;
+		hr = m_dma->CreateResource(&ad, &rd, get_initial_state(desc.memory_type), nullptr, block.alloc.GetAddressOf(), IID_PPV_ARGS(block.resource.GetAddressOf()));
+		HR_VFY(hr);
+		hr = block.resource->Map(0, nullptr, (void**)&block.mapped);
+		HR_VFY(hr);
 
-		D3D12_RESOURCE_STATES init_state{ D3D12_RESOURCE_STATE_COMMON };
-		if (ad.HeapType == D3D12_HEAP_TYPE_UPLOAD)
-			init_state = D3D12_RESOURCE_STATE_GENERIC_READ;
-		else if (ad.HeapType == D3D12_HEAP_TYPE_READBACK)
-			init_state = D3D12_RESOURCE_STATE_COPY_DEST;
+		D3D12MA::VIRTUAL_BLOCK_DESC block_desc{};
+		block_desc.Size = SMALL_BUFFER_BLOCK_SIZE;
+		hr = D3D12MA::CreateVirtualBlock(&block_desc, block.block.GetAddressOf());
+		HR_VFY(hr);
 
-		Buffer_Storage storage{};
+		m_small_buffer_blocks.push_back(std::move(block));
+
+		[[maybe_unused]] const bool allocated = try_allocate((u32)m_small_buffer_blocks.size() - 1);
+		assert(allocated);
+		return true;
+	}
+
+	Texture RenderDevice_DX12::create_texture(const TextureDesc& desc)
+	{
+		HRESULT hr{ S_OK };
+
+		D3D12MA::ALLOCATION_DESC ad{};
+		ad.HeapType = to_internal(desc.memory_type);
+
+		const D3D12_RESOURCE_DESC rd = get_resource_desc(desc);
+
+		Texture_Storage storage{};
 		storage.desc = desc;
 
-		hr = m_dma->CreateResource(&ad, &rd, init_state, nullptr, storage.alloc.GetAddressOf(), IID_PPV_ARGS(storage.resource.GetAddressOf()));
+		hr = m_dma->CreateResource(&ad, &rd, get_initial_state(desc.memory_type), nullptr, storage.alloc.GetAddressOf(), IID_PPV_ARGS(storage.resource.GetAddressOf()));
 		HR_VFY(hr);
-		
-		auto handle = m_rhp.allocate<Buffer>();
-		try_insert(m_buffers, storage, get_slot(handle.handle));
+		storage.states = DX12SubresourceStates(get_subresource_count(storage.resource.Get()), get_initial_state(desc.memory_type));
+
+		auto handle = m_rhp.allocate<Texture>();
+		try_insert(m_textures, storage, get_slot(handle.handle));
 		return handle;
 	}
 
-	Texture RenderDevice_DX12::create_texture(const TextureDesc& desc)
+	Heap RenderDevice_DX12::create_heap(const HeapDesc& desc)
 	{
 		HRESULT hr{ S_OK };
 
 		D3D12MA::ALLOCATION_DESC ad{};
 		ad.HeapType = to_internal(desc.memory_type);
+		switch (desc.category)
+		{
+		case HeapCategory::Buffers:
+			ad.ExtraHeapFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+			break;
+		case HeapCategory::Textures:
+			ad.ExtraHeapFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+			break;
+		case HeapCategory::RenderTargets:
+			ad.ExtraHeapFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+			break;
+		default:
+			assert(false);
+		}
 
-		D3D12_RESOURCE_DESC rd{};
-		rd.Dimension = to_internal(desc.type);
-		rd.Alignment = desc.alignment;
-		rd.Width = desc.width;
-		rd.Height = desc.height;
-		rd.DepthOrArraySize = desc.depth;
-		rd.MipLevels = desc.mip_levels;
-		rd.Format = to_internal(desc.format);
-		rd.SampleDesc.Count = desc.sample_count;
-		rd.SampleDesc.Quality = desc.sample_quality;
-		rd.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-		rd.Flags = to_internal(desc.usage);
+		D3D12_RESOURCE_ALLOCATION_INFO info{};
+		info.SizeInBytes = desc.size;
+		info.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+		Heap_Storage storage{};
+		storage.desc = desc;
+
+		hr = m_dma->AllocateMemory(&ad, &info, storage.alloc.GetAddressOf());
+		HR_VFY(hr);
+
+		auto handle = m_rhp.allocate<Heap>();
+		try_insert(m_heaps, storage, get_slot(handle.handle));
+		return handle;
+	}
+
+	Buffer RenderDevice_DX12::create_placed_buffer(const BufferDesc& desc, Heap heap, u64 offset)
+	{
+		HRESULT hr{ S_OK };
 
-		D3D12_RESOURCE_STATES init_state{ D3D12_RESOURCE_STATE_COMMON };
-		if (ad.HeapType == D3D12_HEAP_TYPE_UPLOAD)
-			init_state = D3D12_RESOURCE_STATE_GENERIC_READ;
-		else if (ad.HeapType == D3D12_HEAP_TYPE_READBACK)
-			init_state = D3D12_RESOURCE_STATE_COPY_DEST;
+		const auto& heap_res = try_get(m_heaps, get_slot(heap.handle));
+		assert(heap_res.desc.category == HeapCategory::Buffers);
+		assert(heap_res.desc.memory_type == desc.memory_type);
+
+		const D3D12_RESOURCE_DESC rd = get_resource_desc(desc);
+
+		Buffer_Storage storage{};
+		storage.desc = desc;
+
+		hr = m_dma->CreateAliasingResource(heap_res.alloc.Get(), offset, &rd, get_initial_state(desc.memory_type), nullptr, IID_PPV_ARGS(storage.resource.GetAddressOf()));
+		HR_VFY(hr);
+		storage.states = DX12SubresourceStates(1, get_initial_state(desc.memory_type));
+
+		auto handle = m_rhp.allocate<Buffer>();
+		try_insert(m_buffers, storage, get_slot(handle.handle));
+		return handle;
+	}
+
+	Texture RenderDevice_DX12::create_placed_texture(const TextureDesc& desc, Heap heap, u64 offset)
+	{
+		HRESULT hr{ S_OK };
+
+		const auto& heap_res = try_get(m_heaps, get_slot(heap.handle));
+		assert(heap_res.desc.category != HeapCategory::Buffers);
+		assert(heap_res.desc.memory_type == desc.memory_type);
+
+		const D3D12_RESOURCE_DESC rd = get_resource_desc(desc);
 
 		Texture_Storage storage{};
 		storage.desc = desc;
 
-		hr = m_dma->CreateResource(&ad, &rd, init_state, nullptr, storage.alloc.GetAddressOf(), IID_PPV_ARGS(storage.resource.GetAddressOf()));
+		hr = m_dma->CreateAliasingResource(heap_res.alloc.Get(), offset, &rd, get_initial_state(desc.memory_type), nullptr, IID_PPV_ARGS(storage.resource.GetAddressOf()));
 		HR_VFY(hr);
+		storage.states = DX12SubresourceStates(get_subresource_count(storage.resource.Get()), get_initial_state(desc.memory_type));
 
 		auto handle = m_rhp.allocate<Texture>();
 		try_insert(m_textures, storage, get_slot(handle.handle));
 		return handle;
 	}
 
+	MemoryRequirements RenderDevice_DX12::get_memory_requirements(const BufferDesc& desc) const
+	{
+		const D3D12_RESOURCE_DESC rd = get_resource_desc(desc);
+		const auto info = m_device->GetResourceAllocationInfo(0, 1, &rd);
+		return MemoryRequirements{ info.SizeInBytes, info.Alignment };
+	}
+
+	MemoryRequirements RenderDevice_DX12::get_memory_requirements(const TextureDesc& desc) const
+	{
+		const D3D12_RESOURCE_DESC rd = get_resource_desc(desc);
+		const auto info = m_device->GetResourceAllocationInfo(0, 1, &rd);
+		return MemoryRequirements{ info.SizeInBytes, info.Alignment };
+	}
+
 	Pipeline RenderDevice_DX12::create_graphics_pipeline(const GraphicsPipelineDesc& desc)
 	{
 		assert(!desc.vs->blob.empty() && !desc.ps->blob.empty());
-		HRESULT hr{ S_OK };
-			
-		D3D12_GRAPHICS_PIPELINE_STATE_DESC api_desc = to_internal(desc, m_common_rsig.Get());
 
-		ComPtr<ID3D12PipelineState> pso;
-		hr = m_device->CreateGraphicsPipelineState(&api_desc, IID_PPV_ARGS(pso.GetAddressOf()));
-		HR_VFY(hr);
+		const u64 hash = hash_combine(hash_desc(desc), m_common_rsig_hash);
+		if (auto it = m_pipeline_lookup.find(hash); it != m_pipeline_lookup.end())
+		{
+			++try_get(m_pipelines, get_slot(it->second.handle)).ref_count;
+			return it->second;
+		}
+
+		Pipeline_Storage storage{};
+		storage.pipeline = load_or_compile_pipeline(hash, desc);
+		return insert_pipeline(desc, hash, std::move(storage));
+	}
+
+	Pipeline RenderDevice_DX12::create_graphics_pipeline_async(const GraphicsPipelineDesc& desc, Pipeline fallback)
+	{
+		assert(!desc.vs->blob.empty() && !desc.ps->blob.empty());
+		assert(fallback.handle == 0 || is_pipeline_ready(fallback));
+
+		const u64 hash = hash_combine(hash_desc(desc), m_common_rsig_hash);
+		if (auto it = m_pipeline_lookup.find(hash); it != m_pipeline_lookup.end())
+		{
+			++try_get(m_pipelines, get_slot(it->second.handle)).ref_count;
+			return it->second;
+		}
+
+		// The shaders are only guaranteed to live for the duration of the call
+		struct Job
+		{
+			GraphicsPipelineDesc desc;
+			std::array<std::optional<CompiledShader>, 5> shaders;
+			std::promise<ComPtr<ID3D12PipelineState>> result;
+		};
+
+		auto job = std::make_shared<Job>();
+		job->desc = desc;
+		const CompiledShader** stages[] = { &job->desc.vs, &job->desc.gs, &job->desc.ds, &job->desc.hs, &job->desc.ps };
+		for (u32 i = 0; i < job->shaders.size(); ++i)
+		{
+			if (*stages[i] == nullptr)
+				continue;
+			job->shaders[i] = **stages[i];
+			*stages[i] = &(*job->shaders[i]);
+		}
 
 		Pipeline_Storage storage{};
+		storage.pending = job->result.get_future().share();
+		storage.fallback = fallback;
+
+		m_workers.submit(m_pipeline_jobs, [this, hash, job]()
+			{
+				job->result.set_value(load_or_compile_pipeline(hash, job->desc));
+			});
+
+		return insert_pipeline(desc, hash, std::move(storage));
+	}
+
+	bool RenderDevice_DX12::is_pipeline_ready(Pipeline handle) const
+	{
+		const auto& storage = try_get(m_pipelines, get_slot(handle.handle));
+		if (storage.pipeline)
+			return true;
+
+		auto pending = storage.pending;
+		return pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+
+	ComPtr<ID3D12PipelineState> RenderDevice_DX12::load_or_compile_pipeline(u64 hash, const GraphicsPipelineDesc& desc)
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC api_desc = to_internal(desc, m_common_rsig.Get());
+
+		// Skips driver compilation if compiled in an earlier run
+		ComPtr<ID3D12PipelineState> pso = m_pipeline_library->load_graphics_pipeline(hash, api_desc);
+		if (!pso)
+		{
+			HRESULT hr = m_device->CreateGraphicsPipelineState(&api_desc, IID_PPV_ARGS(pso.GetAddressOf()));
+			HR_VFY(hr);
+			m_pipeline_library->store(hash, pso.Get());
+		}
+		return pso;
+	}
+
+	Pipeline RenderDevice_DX12::insert_pipeline(const GraphicsPipelineDesc& desc, u64 hash, Pipeline_Storage storage)
+	{
 		storage.desc = desc;
 		storage.topology = to_internal_topology(desc.topology, desc.num_control_patches);
-		storage.pipeline = pso;
+		storage.hash = hash;
 
 		auto handle = m_rhp.allocate<Pipeline>();
-		try_insert(m_pipelines, storage, get_slot(handle.handle));
+		try_insert_move(m_pipelines, std::move(storage), get_slot(handle.handle));
+		m_pipeline_lookup.insert({ hash, handle });
 		return handle;
 	}
 
@@ -173,7 +410,7 @@ namespace mira
 			auto& res = try_get(m_texture_views, get_slot(rtd.view.handle));		// grab view md
 
 			auto api = to_internal(rtd);
-			assert(res.type == ViewType::RenderTarget);
+			assert(res.desc.view == ViewType::RenderTarget);
 			api.cpuDescriptor = res.view.cpu_handle(0);
 
 			auto& tex = try_get(m_textures, get_slot(res.tex.handle));				// grab underlying texture md
@@ -192,7 +429,7 @@ namespace mira
 		{
 			auto& res = try_get(m_texture_views, get_slot(desc.depth_stencil_desc->view.handle));
 			auto depth_api = to_internal(*desc.depth_stencil_desc);
-			assert(res.type == ViewType::DepthStencil);
+			assert(res.desc.view == ViewType::DepthStencil);
 			depth_api.cpuDescriptor = res.view.cpu_handle(0);
 
 			auto& tex_res = try_get(m_textures, get_slot(res.tex.handle));				// grab underlying texture md
@@ -212,6 +449,8 @@ namespace mira
 	void RenderDevice_DX12::free_buffer(Buffer handle)
 	{
 		auto& res = try_get(m_buffers, get_slot(handle.handle));
+		if (res.block.has_value())
+			m_small_buffer_blocks[*res.block].block->FreeAllocation(res.sub_allocation);
 		
 		m_buffers[get_slot(handle.handle)] = std::nullopt;
 		m_rhp.free(handle);
@@ -226,8 +465,19 @@ namespace mira
 
 	}
 
+	void RenderDevice_DX12::free_heap(Heap handle)
+	{
+		m_heaps[get_slot(handle.handle)] = std::nullopt;
+		m_rhp.free(handle);
+	}
+
 	void RenderDevice_DX12::free_pipeline(Pipeline handle)
 	{
+		auto& storage = try_get(m_pipelines, get_slot(handle.handle));
+		if (--storage.ref_count > 0)
+			return;
+
+		m_pipeline_lookup.erase(storage.hash);
 		m_pipelines[get_slot(handle.handle)] = std::nullopt;
 		m_rhp.free(handle);
 
@@ -243,6 +493,10 @@ namespace mira
 	void RenderDevice_DX12::free_view(BufferView handle)
 	{
 		auto& res = try_get(m_buffer_views, get_slot(handle.handle));
+		if (--res.ref_count > 0)
+			return;
+
+		erase_lookup(m_buffer_view_lookup, res.hash, handle);
 		m_descriptor_mgr->free(&res.view);
 
 		m_buffer_views[get_slot(handle.handle)] = std::nullopt;
@@ -253,6 +507,10 @@ namespace mira
 	void RenderDevice_DX12::free_view(TextureView handle)
 	{
 		auto& res = try_get(m_texture_views, get_slot(handle.handle));
+		if (--res.ref_count > 0)
+			return;
+
+		erase_lookup(m_texture_view_lookup, res.hash, handle);
 		m_descriptor_mgr->free(&res.view);
 
 		m_texture_views[get_slot(handle.handle)] = std::nullopt;
@@ -266,44 +524,87 @@ namespace mira
 		assert(desc.view != ViewType::DepthStencil);
 		assert(desc.view != ViewType::RenderTarget);
 
+		const u64 hash = hash_combine(hash_desc(desc), buffer.handle);
+		auto [first, last] = m_buffer_view_lookup.equal_range(hash);
+		for (auto it = first; it != last; ++it)
+		{
+			auto& existing = try_get(m_buffer_views, get_slot(it->second.handle));
+			if (existing.buf.handle == buffer.handle && existing.desc == desc)
+			{
+				++existing.ref_count;
+				return it->second;
+			}
+		}
+
 		auto& buffer_storage = try_get(m_buffers, get_slot(buffer.handle));
 		auto view_desc = m_descriptor_mgr->allocate(1, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
 		assert(desc.offset + desc.stride * desc.count <= buffer_storage.desc.size);
+		write_view(desc, buffer_storage.resource.Get(), buffer_storage.offset, view_desc.cpu_handle(0));
+
+		auto handle = m_rhp.allocate<BufferView>();
+		try_insert(m_buffer_views, BufferView_Storage(buffer, desc, view_desc, hash), get_slot(handle.handle));
+		m_buffer_view_lookup.insert({ hash, handle });
+		return handle;
+	}
+
+	u32 RenderDevice_DX12::create_transient_view(Buffer buffer, const BufferViewDesc& desc)
+	{
+		assert(desc.view == ViewType::Constant || desc.view == ViewType::ShaderResource || desc.view == ViewType::UnorderedAccess);
+
+		auto& buffer_storage = try_get(m_buffers, get_slot(buffer.handle));
+		assert(desc.offset + desc.stride * desc.count <= buffer_storage.desc.size);
+
+		u64 offset = m_transient_ring.allocate(1);
+		while (offset == (u64)-1)
+		{
+			// Ring is full, a single frame using up the whole ring is not recoverable
+			assert(!m_frames_in_flight.empty());
+			retire_frames((u32)m_frames_in_flight.size() - 1);
+			offset = m_transient_ring.allocate(1);
+		}
+
+		write_view(desc, buffer_storage.resource.Get(), buffer_storage.offset, m_transient_descriptors.cpu_handle(offset));
+		return (u32)m_transient_descriptors.index_offset_from_base((u32)offset);
+	}
+
+	void RenderDevice_DX12::write_view(const BufferViewDesc& desc, ID3D12Resource* resource, u64 resource_offset, D3D12_CPU_DESCRIPTOR_HANDLE dst)
+	{
+		const u64 offset = resource_offset + desc.offset;
 
 		if (desc.view == ViewType::Constant)
 		{
 			assert(desc.stride % 256 == 0);
 
 			D3D12_CONSTANT_BUFFER_VIEW_DESC cbvd{};
-			cbvd.BufferLocation = buffer_storage.resource.Get()->GetGPUVirtualAddress() + desc.offset;
+			cbvd.BufferLocation = resource->GetGPUVirtualAddress() + offset;
 			cbvd.SizeInBytes = desc.stride * desc.count;
-			m_device->CreateConstantBufferView(&cbvd, view_desc.cpu_handle(0));
+			m_device->CreateConstantBufferView(&cbvd, dst);
 		}
 		else if (desc.view == ViewType::ShaderResource)
 		{
-			assert(desc.offset % desc.stride == 0);
+			assert(offset % desc.stride == 0);
 
 			D3D12_SHADER_RESOURCE_VIEW_DESC srvd{};
 			srvd.Format = DXGI_FORMAT_UNKNOWN;
 			srvd.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
 			srvd.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-			srvd.Buffer.FirstElement = desc.offset / desc.stride;
+			srvd.Buffer.FirstElement = offset / desc.stride;
 			srvd.Buffer.NumElements = desc.count;
 			srvd.Buffer.StructureByteStride = desc.stride;
 			srvd.Buffer.Flags = desc.raw ? D3D12_BUFFER_SRV_FLAG_RAW : D3D12_BUFFER_SRV_FLAG_NONE;
 
-			m_device->CreateShaderResourceView(buffer_storage.resource.Get(), &srvd, view_desc.cpu_handle(0));
+			m_device->CreateShaderResourceView(resource, &srvd, dst);
 
 		}
 		else if (desc.view == ViewType::UnorderedAccess)
 		{
-			assert(desc.offset % desc.stride == 0);
+			assert(offset % desc.stride == 0);
 
 			D3D12_UNORDERED_ACCESS_VIEW_DESC uavd{};
 			uavd.Format = DXGI_FORMAT_UNKNOWN;
 			uavd.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
-			uavd.Buffer.FirstElement = desc.offset / desc.stride;
+			uavd.Buffer.FirstElement = offset / desc.stride;
 			uavd.Buffer.NumElements = desc.count;
 			uavd.Buffer.StructureByteStride = desc.stride;
 			uavd.Buffer.CounterOffsetInBytes = 0;
@@ -311,7 +612,7 @@ namespace mira
 
 			// We never use counter buffers, user has to create their own RW buffer with counters and do InterlockedAdd
 			// This makes counting explicit on the user side and simplifies API (always no counter)
-			m_device->CreateUnorderedAccessView(buffer_storage.resource.Get(), nullptr, &uavd, view_desc.cpu_handle(2));
+			m_device->CreateUnorderedAccessView(resource, nullptr, &uavd, dst);
 		}
 		else if (desc.view == ViewType::RaytracingAS)
 		{
@@ -321,16 +622,12 @@ namespace mira
 			srvd.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 			srvd.RaytracingAccelerationStructure.Location = desc.offset;
 
-			m_device->CreateShaderResourceView(buffer_storage.resource.Get(), &srvd, view_desc.cpu_handle(0));
+			m_device->CreateShaderResourceView(resource, &srvd, dst);
 		}
 		else
 		{
 			assert(false);
 		}
-
-		auto handle = m_rhp.allocate<BufferView>();
-		try_insert(m_buffer_views, BufferView_Storage(buffer, desc.view, view_desc), get_slot(handle.handle));
-		return handle;
 	}
 
 	TextureView RenderDevice_DX12::create_view(Texture texture, const TextureViewDesc& desc)
@@ -339,6 +636,18 @@ namespace mira
 		assert(desc.view != ViewType::Constant);
 		assert(desc.view != ViewType::RaytracingAS);
 
+		const u64 hash = hash_combine(hash_desc(desc), texture.handle);
+		auto [first, last] = m_texture_view_lookup.equal_range(hash);
+		for (auto it = first; it != last; ++it)
+		{
+			auto& existing = try_get(m_texture_views, get_slot(it->second.handle));
+			if (existing.tex.handle == texture.handle && existing.desc == desc)
+			{
+				++existing.ref_count;
+				return it->second;
+			}
+		}
+
 		auto& tex_storage = try_get(m_textures, get_slot(texture.handle));
 
 		DX12DescriptorChunk view_desc;
@@ -375,26 +684,20 @@ namespace mira
 		}
 
 		auto handle = m_rhp.allocate<TextureView>();
-		try_insert(m_texture_views, TextureView_Storage(texture, desc.view, view_desc), get_slot(handle.handle));
+		try_insert(m_texture_views, TextureView_Storage(texture, desc, view_desc, hash), get_slot(handle.handle));
+		m_texture_view_lookup.insert({ hash, handle });
 		return handle;
 	}
 	
 
-	void RenderDevice_DX12::recycle_sync(SyncReceipt receipt)
-	{
-		auto sync = std::move(try_get(m_syncs, get_slot(receipt.handle)));
-		m_recycled_syncs.push(sync);
-		
-		// mark as empty
-		m_syncs[get_slot(receipt.handle)] = std::nullopt;
-		m_rhp.free(receipt);
-
-	}
-
 	u8* RenderDevice_DX12::map(Buffer handle, u32 subresource, std::pair<u32, u32> read_range)
 	{
 		auto& res = try_get(m_buffers, get_slot(handle.handle));
 
+		// Blocks stay mapped
+		if (res.block.has_value())
+			return m_small_buffer_blocks[*res.block].mapped + res.offset;
+
 		u8* mapped{ nullptr };
 
 		D3D12_RANGE range{};
@@ -409,6 +712,8 @@ namespace mira
 	void RenderDevice_DX12::unmap(Buffer handle, u32 subresource, std::pair<u32, u32> written_range)
 	{
 		auto& res = try_get(m_buffers, get_slot(handle.handle));
+		if (res.block.has_value())
+			return;
 
 		D3D12_RANGE range{};
 		range.Begin = written_range.first;
@@ -416,20 +721,102 @@ namespace mira
 		res.resource->Unmap(subresource, &range);
 	}
 
+	const GPUFrameTimings& RenderDevice_DX12::get_gpu_timings() const
+	{
+		return m_gpu_timings;
+	}
+
 
 	void RenderDevice_DX12::flush()
 	{
 		m_direct_queue->flush();
 		m_compute_queue->flush();
-		m_direct_queue->flush();
+		m_copy_queue->flush();
+	}
+
+	void RenderDevice_DX12::begin_frame(u8 max_frames_in_flight)
+	{
+		assert(max_frames_in_flight > 0);
+		retire_frames(max_frames_in_flight - 1);
+	}
+
+	void RenderDevice_DX12::end_frame()
+	{
+		FrameInFlight frame{};
+		frame.frame = m_num_frames;
+		frame.ring_end = m_transient_ring.get_head();
+
+		// Frames share the queue timelines with sync receipts
+		const QueueType queues[] = { QueueType::Graphics, QueueType::Compute, QueueType::Copy };
+		for (u32 i = 0; i < NUM_QUEUES; ++i)
+			frame.timeline_values[i] = get_queue(queues[i])->insert_signal();
+
+		m_profiler->end_frame(m_num_frames, *m_direct_queue, *m_compute_queue);
+
+		m_frames_in_flight.push_back(frame);
+		++m_num_frames;
+
+		// Query ranges of the profiler are reused every MAX_FRAMES frames
+		retire_frames(DX12GPUProfiler::MAX_FRAMES - 1);
+		m_profiler->begin_frame(m_num_frames);
+	}
+
+	u64 RenderDevice_DX12::get_current_frame() const
+	{
+		return m_num_frames;
+	}
+
+	u64 RenderDevice_DX12::get_num_completed_frames() const
+	{
+		// Frames still tracked complete in order, count the leading ones which have finished since the last retire
+		const QueueType queues[] = { QueueType::Graphics, QueueType::Compute, QueueType::Copy };
+		u64 completed = m_num_frames - m_frames_in_flight.size();
+		for (const auto& frame : m_frames_in_flight)
+		{
+			for (u32 i = 0; i < NUM_QUEUES; ++i)
+			{
+				if (!get_queue(queues[i])->is_completed(frame.timeline_values[i]))
+					return completed;
+			}
+			++completed;
+		}
+		return completed;
+	}
+
+	void RenderDevice_DX12::retire_frames(u32 max_frames_in_flight)
+	{
+		const QueueType queues[] = { QueueType::Graphics, QueueType::Compute, QueueType::Copy };
+		while (!m_frames_in_flight.empty())
+		{
+			const auto& frame = m_frames_in_flight.front();
+
+			bool completed = true;
+			for (u32 i = 0; i < NUM_QUEUES; ++i)
+				completed &= get_queue(queues[i])->is_completed(frame.timeline_values[i]);
+
+			if (!completed)
+			{
+				if (m_frames_in_flight.size() <= max_frames_in_flight)
+					break;
+
+				for (u32 i = 0; i < NUM_QUEUES; ++i)
+					get_queue(queues[i])->cpu_wait(frame.timeline_values[i]);
+			}
+
+			m_transient_ring.free_until(frame.ring_end);
+			m_profiler->read_back(frame.frame, m_gpu_timings);
+			m_frames_in_flight.pop_front();
+		}
 	}
 
 	void RenderDevice_DX12::wait_for_gpu(SyncReceipt receipt)
 	{
-		const auto& sync = try_get(m_syncs, get_slot(receipt.handle));
-		sync.fence.cpu_wait();
+		get_queue(receipt.queue)->cpu_wait(receipt.value);
+	}
 
-		recycle_sync(receipt);
+	bool RenderDevice_DX12::is_complete(SyncReceipt receipt) const
+	{
+		return get_queue(receipt.queue)->is_completed(receipt.value);
 	}
 
 	u32 RenderDevice_DX12::get_global_descriptor(BufferView view) const
@@ -444,37 +831,22 @@ namespace mira
 		return (u32)res.view.index_offset_from_base();
 	}
 
-	CommandList RenderDevice_DX12::allocate_command_list(QueueType queue)
+	const BufferDesc& RenderDevice_DX12::get_desc(Buffer buffer) const
 	{
-		CommandList_Storage storage{};
-
-		// Re-use if any
-		auto& recycled_pool = m_recycled_ator_and_list[queue];
-		if (!recycled_pool.empty())
-		{
-			auto ator_list = recycled_pool.front();
-			ator_list.reset();		// Reset ator and list for re-use
-			recycled_pool.pop();
+		return try_get(m_buffers, get_slot(buffer.handle)).desc;
+	}
 
-			storage.compiler = std::make_unique<CommandCompiler_DX12>(this, ator_list.ator, ator_list.list, queue);
-		}
-		else
-		{
-			// Allocate new ator + list
-			HRESULT hr{ S_OK };
-			ComPtr<ID3D12CommandAllocator> ator;
-			ComPtr<ID3D12GraphicsCommandList4> cmdl;
-			hr = m_device->CreateCommandAllocator(get_command_list_type(queue), IID_PPV_ARGS(ator.GetAddressOf()));
-			HR_VFY(hr);
-			hr = m_device->CreateCommandList1(0, get_command_list_type(queue), D3D12_COMMAND_LIST_FLAG_NONE, IID_PPV_ARGS(cmdl.GetAddressOf()));
-			HR_VFY(hr);
+	const TextureDesc& RenderDevice_DX12::get_desc(Texture texture) const
+	{
+		return try_get(m_textures, get_slot(texture.handle)).desc;
+	}
 
-			// Reset 
-			ator->Reset();
-			cmdl->Reset(ator.Get(), nullptr);
+	CommandList RenderDevice_DX12::allocate_command_list(QueueType queue)
+	{
+		CommandList_Storage storage{};
 
-			storage.compiler = std::make_unique<CommandCompiler_DX12>(this, ator, cmdl, queue);
-		}
+		auto ator_list = get_ator_and_list(queue);
+		storage.compiler = std::make_unique<CommandCompiler_DX12>(this, ator_list.ator, ator_list.list, std::move(ator_list.upload_arena), queue);
 
 		auto handle = m_rhp.allocate<CommandList>();
 		try_insert_move(m_command_lists, std::move(storage), get_slot(handle.handle));
@@ -488,8 +860,11 @@ namespace mira
 		CommandAtorAndList storage{};
 		storage.ator = res.compiler->get_allocator();
 		storage.list = res.compiler->get_list();
+		storage.upload_arena = std::move(res.compiler->get_upload_arena());
 
-		m_recycled_ator_and_list[res.compiler->get_queue_type()].push(storage);
+		m_recycled_ator_and_list[res.compiler->get_queue_type()].push(std::move(storage));
+		if (res.fixup.has_value())
+			m_recycled_ator_and_list[res.compiler->get_queue_type()].push(std::move(*res.fixup));
 	
 		m_command_lists[get_slot(handle.handle)] = std::nullopt;
 		m_rhp.free(handle);
@@ -497,11 +872,23 @@ namespace mira
 
 	void RenderDevice_DX12::compile_command_list(CommandList handle, RenderCommandList list)
 	{	
+		MIRA_PROFILE_FUNCTION();
+
 		auto& res = try_get(m_command_lists, get_slot(handle.handle));
 
 		// Compile
-		for (const auto& cmd : list.get_commands())
+		const auto& cmds = list.get_commands();
+		res.compiler->reserve_profile_queries(cmds);
+		for (u32 i = 0; i < cmds.size(); ++i)
 		{
+			// Consecutive indexed draws may be folded into a single indirect draw
+			if (const u32 merged = res.compiler->try_merge_draws(std::span(cmds).subspan(i)); merged > 0)
+			{
+				i += merged - 1;
+				continue;
+			}
+
+			const auto& cmd = cmds[i];
 			switch (cmd->type)
 			{
 			case RenderCommandDraw::TYPE:
@@ -549,66 +936,112 @@ namespace mira
 				res.compiler->compile(*static_cast<RenderCommandCopyBufferToImage*>(cmd.get()));
 				break;
 			}
+			case RenderCommandDrawIndexedIndirect::TYPE:
+			{
+				res.compiler->compile(*static_cast<RenderCommandDrawIndexedIndirect*>(cmd.get()));
+				break;
+			}
+			case RenderCommandBeginProfileScope::TYPE:
+			{
+				res.compiler->compile(*static_cast<RenderCommandBeginProfileScope*>(cmd.get()));
+				break;
+			}
+			case RenderCommandEndProfileScope::TYPE:
+			{
+				res.compiler->compile(*static_cast<RenderCommandEndProfileScope*>(cmd.get()));
+				break;
+			}
 			default:
 				assert(false);
 			}
 		}
 
+		// Trailing barriers
+		res.compiler->flush_barriers();
+		assert(!res.compiler->has_open_splits());
+
+		res.compiler->resolve_profile_queries();
+
 		res.is_compiled = true;
 	}
 
 	std::optional<SyncReceipt> RenderDevice_DX12::submit_command_lists(std::span<CommandList> lists, QueueType queue, std::optional<SyncReceipt> incoming_sync, bool generate_sync)
 	{
+		MIRA_PROFILE_FUNCTION();
+
 		// verify that the submitted lists are compiled
-		ID3D12CommandList* cmdls[16];
+		std::vector<ID3D12CommandList*> cmdls;
+
+		// Decayed once the whole batch has been resolved, D3D12 decays at the end of the ExecuteCommandLists call
+		std::vector<std::pair<DX12SubresourceStates*, const DX12SubresourceStates*>> decaying;
 		for (u32 i = 0; i < lists.size(); ++i)
 		{
-			const auto& storage = try_get(m_command_lists, get_slot(lists[i].handle));
+			auto& storage = try_get(m_command_lists, get_slot(lists[i].handle));
 			assert(storage.is_compiled);
+
+			/*
+				Resolve the states the list expects on entry against the global states, in submission order.
+				Mismatches are transitioned in a separate list executed right before it.
+				Resources which decay to common after the batch are promoted out of common instead, see DX12ResourceStateTracker.
+			*/
+			std::vector<D3D12_RESOURCE_BARRIER> fixups;
+			for (const auto& [resource, tracked] : storage.compiler->get_state_tracker().get_resources())
+			{
+				auto& global = get_global_states(tracked.is_texture, tracked.handle);
+				const bool decays = DX12ResourceStateTracker::decays(tracked.is_texture, queue == QueueType::Copy);
+				DX12ResourceStateTracker::append_transitions(resource, global, tracked.required, decays, fixups);
+				DX12ResourceStateTracker::merge(global, tracked.current);
+				if (decays)
+					decaying.push_back({ &global, &tracked.current });
+			}
+
+			// Copy queues can not transition out of states they do not support, those have to be left by the other queues first
+			if (queue == QueueType::Copy)
+			{
+				for ([[maybe_unused]] const auto& fixup : fixups)
+					assert(((fixup.Transition.StateBefore | fixup.Transition.StateAfter) & ~(D3D12_RESOURCE_STATE_COPY_DEST | D3D12_RESOURCE_STATE_COPY_SOURCE)) == 0);
+			}
+
+			if (!fixups.empty())
+			{
+				assert(!storage.fixup.has_value());
+				storage.fixup = get_ator_and_list(queue);
+				storage.fixup->list->ResourceBarrier((u32)fixups.size(), fixups.data());
+				storage.fixup->close();
+				cmdls.push_back(storage.fixup->list.Get());
+			}
 	
 			auto cmdl = storage.compiler->get_list();
 			cmdl->Close();
-			cmdls[i] = cmdl;
+			cmdls.push_back(cmdl);
+
+			if (const auto& queries = storage.compiler->get_profile_queries(); queries.has_value())
+				m_profiler->add_scopes(*queries, storage.compiler->get_profile_scopes());
 		}
 
 		DX12Queue* curr_queue = get_queue(queue);
 
-		// Wait for incoming sync
+		// Wait for incoming sync on the GPU
 		if (incoming_sync.has_value())
-		{
-			// Lookup sync, and perform GPU wait
-			const auto& sync = try_get(m_syncs, get_slot(incoming_sync->handle));
-			sync.fence.gpu_wait(*curr_queue);
-		}
+			curr_queue->insert_wait(*get_queue(incoming_sync->queue), incoming_sync->value);
+
+		curr_queue->execute_command_lists((u32)cmdls.size(), cmdls.data());
 
-		curr_queue->execute_command_lists((u32)lists.size(), cmdls);
+		for (auto [global, changes] : decaying)
+			DX12ResourceStateTracker::decay(*global, *changes);
 
 		// Generate outgoing sync
 		std::optional<SyncReceipt> sync_receipt{ std::nullopt };
 		if (generate_sync)
-		{
-			SyncPrimitive sync{};
-
-			// Use recycled syncs
-			if (!m_recycled_syncs.empty())
-			{
-				sync = std::move(m_recycled_syncs.front());
-				m_recycled_syncs.pop();
-			}
-			// Create new sync
-			else
-			{
-				sync.fence = DX12Fence(m_device.Get(), 0);
-			}
-
-			curr_queue->insert_signal(sync.fence);
-
-			sync_receipt = m_rhp.allocate<SyncReceipt>();
-			try_insert(m_syncs, std::move(sync), get_slot(sync_receipt->handle));
-		}
+			sync_receipt = SyncReceipt{ queue, curr_queue->insert_signal() };
 		return sync_receipt;
 	}
 
+	void RenderDevice_DX12::insert_wait(QueueType queue, SyncReceipt receipt)
+	{
+		get_queue(queue)->insert_wait(*get_queue(receipt.queue), receipt.value);
+	}
+
 
 
 
@@ -624,11 +1057,21 @@ namespace mira
 		return try_get(m_textures, get_slot(texture.handle)).resource.Get();
 	}
 
+	u32 RenderDevice_DX12::get_api_subresource_count(Texture texture) const
+	{
+		return try_get(m_textures, get_slot(texture.handle)).states.get_num_subresources();
+	}
+
 	u32 RenderDevice_DX12::get_api_buffer_size(Buffer buffer) const
 	{
 		return try_get(m_buffers, get_slot(buffer.handle)).desc.size;
 	}
 
+	u64 RenderDevice_DX12::get_api_buffer_offset(Buffer buffer) const
+	{
+		return try_get(m_buffers, get_slot(buffer.handle)).offset;
+	}
+
 	D3D12_RESOURCE_STATES RenderDevice_DX12::get_resource_state(ResourceState state) const
 	{
 		return to_internal(state);
@@ -639,6 +1082,14 @@ namespace mira
 		return to_internal(format);
 	}
 
+	Pipeline RenderDevice_DX12::resolve_pipeline(Pipeline pipeline) const
+	{
+		const auto& storage = try_get(m_pipelines, get_slot(pipeline.handle));
+		if (storage.fallback.handle == 0 || is_pipeline_ready(pipeline))
+			return pipeline;
+		return storage.fallback;
+	}
+
 	D3D_PRIMITIVE_TOPOLOGY RenderDevice_DX12::get_api_topology(Pipeline pipeline) const
 	{
 		return try_get(m_pipelines, get_slot(pipeline.handle)).topology;
@@ -646,7 +1097,13 @@ namespace mira
 
 	ID3D12PipelineState* RenderDevice_DX12::get_api_pipeline(Pipeline pipeline) const
 	{
-		return try_get(m_pipelines, get_slot(pipeline.handle)).pipeline.Get();
+		const auto& storage = try_get(m_pipelines, get_slot(pipeline.handle));
+		if (storage.pipeline)
+			return storage.pipeline.Get();
+
+		// Copy, as command lists may be compiled in parallel. The shared state owns the pipeline.
+		auto pending = storage.pending;
+		return pending.get().Get();
 	}
 
 	ID3D12RootSignature* RenderDevice_DX12::get_api_global_rsig() const
@@ -654,6 +1111,15 @@ namespace mira
 		return m_common_rsig.Get();
 	}
 
+	ID3D12CommandSignature* RenderDevice_DX12::get_api_draw_indexed_signature(std::optional<u8> draw_id_slot) const
+	{
+		if (!draw_id_slot.has_value())
+			return m_draw_indexed_sig.Get();
+
+		assert(*draw_id_slot < NUM_ROOT_CONSTANTS);
+		return m_draw_indexed_with_id_sigs[*draw_id_slot].Get();
+	}
+
 	ID3D12DescriptorHeap* RenderDevice_DX12::get_api_global_resource_dheap() const
 	{
 		return m_descriptor_mgr->get_gpu_dh_resource();
@@ -700,6 +1166,14 @@ namespace mira
 		storage.resource = texture;
 		auto desc = texture->GetDesc();
 
+		// Swapchain buffers are always created as RGBA8 render targets
+		storage.desc.width = (u32)desc.Width;
+		storage.desc.height = desc.Height;
+		storage.desc.mip_levels = desc.MipLevels;
+		storage.desc.format = ResourceFormat::RGBA_8_UNORM;
+		storage.desc.usage = UsageIntent::RenderTarget;
+		storage.states = DX12SubresourceStates(get_subresource_count(texture.Get()), D3D12_RESOURCE_STATE_PRESENT);
+
 		auto handle = m_rhp.allocate<Texture>();
 		try_insert(m_textures, storage, get_slot(handle.handle));
 		return handle;
@@ -733,8 +1207,6 @@ namespace mira
 	{
 		HRESULT hr{ S_OK };
 
-		const u8 num_constants = 9;
-
 		std::vector<D3D12_ROOT_PARAMETER> params;
 		//for (u32 reg = 0; reg < num_constants; ++reg)
 		//{
@@ -755,7 +1227,7 @@ namespace mira
 		param.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
 		param.Constants.RegisterSpace = 0;
 		param.Constants.ShaderRegister = 0;
-		param.Constants.Num32BitValues = num_constants + 1;		// Indirect Set Constant requires 2 for some reason to start working with Debug Validation Layer is on
+		param.Constants.Num32BitValues = NUM_ROOT_CONSTANTS;		// Indirect Set Constant requires 2 for some reason to start working with Debug Validation Layer is on
 		params.push_back(param);
 
 		D3D12_ROOT_SIGNATURE_DESC rsd{};
@@ -780,7 +1252,44 @@ namespace mira
 		}
 
 		hr = m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(m_common_rsig.GetAddressOf()));
+		m_common_rsig_hash = hash_bytes(signature->GetBufferPointer(), signature->GetBufferSize());
+		HR_VFY(hr);
+	}
+
+	void RenderDevice_DX12::init_command_signatures()
+	{
+		HRESULT hr{ S_OK };
+
+		// Argument buffer layout is always DrawIndexedIndirectArguments, signatures without the draw ID are offset past it by the compiler
+		static_assert(sizeof(DrawIndexedIndirectArguments) == sizeof(u32) + sizeof(D3D12_DRAW_INDEXED_ARGUMENTS));
+
+		D3D12_INDIRECT_ARGUMENT_DESC draw_arg{};
+		draw_arg.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+		D3D12_COMMAND_SIGNATURE_DESC csd{};
+		csd.ByteStride = sizeof(DrawIndexedIndirectArguments);
+		csd.NumArgumentDescs = 1;
+		csd.pArgumentDescs = &draw_arg;
+
+		// Root signature is only required if the signature modifies root arguments
+		hr = m_device->CreateCommandSignature(&csd, nullptr, IID_PPV_ARGS(m_draw_indexed_sig.GetAddressOf()));
 		HR_VFY(hr);
+
+		for (u8 slot = 0; slot < NUM_ROOT_CONSTANTS; ++slot)
+		{
+			D3D12_INDIRECT_ARGUMENT_DESC args[2]{};
+			args[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+			args[0].Constant.RootParameterIndex = 0;
+			args[0].Constant.DestOffsetIn32BitValues = slot;
+			args[0].Constant.Num32BitValuesToSet = 1;
+			args[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+			csd.NumArgumentDescs = _countof(args);
+			csd.pArgumentDescs = args;
+
+			hr = m_device->CreateCommandSignature(&csd, m_common_rsig.Get(), IID_PPV_ARGS(m_draw_indexed_with_id_sigs[slot].GetAddressOf()));
+			HR_VFY(hr);
+		}
 	}
 
 	std::vector<D3D12_STATIC_SAMPLER_DESC> RenderDevice_DX12::grab_static_samplers()
@@ -823,7 +1332,7 @@ namespace mira
 		return samplers;
 	}
 
-	DX12Queue* RenderDevice_DX12::get_queue(QueueType type)
+	DX12Queue* RenderDevice_DX12::get_queue(QueueType type) const
 	{
 		DX12Queue* curr_queue{ nullptr };
 		switch (type)
@@ -859,6 +1368,92 @@ namespace mira
 		}
 	}
 
+	D3D12_RESOURCE_DESC RenderDevice_DX12::get_resource_desc(const BufferDesc& desc) const
+	{
+		D3D12_RESOURCE_DESC rd{};
+		rd.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		rd.Alignment = desc.alignment;
+		rd.Width = desc.size;
+		rd.Height = rd.DepthOrArraySize = rd.MipLevels = 1;
+		rd.Format = DXGI_FORMAT_UNKNOWN;
+		rd.SampleDesc.Count = 1;
+		rd.SampleDesc.Quality = 0;
+		rd.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		rd.Flags = to_internal(desc.usage);
+		return rd;
+	}
+
+	D3D12_RESOURCE_DESC RenderDevice_DX12::get_resource_desc(const TextureDesc& desc) const
+	{
+		D3D12_RESOURCE_DESC rd{};
+		rd.Dimension = to_internal(desc.type);
+		rd.Alignment = desc.alignment;
+		rd.Width = desc.width;
+		rd.Height = desc.height;
+		rd.DepthOrArraySize = desc.depth;
+		rd.MipLevels = desc.mip_levels;
+		rd.Format = to_internal(desc.format);
+		rd.SampleDesc.Count = desc.sample_count;
+		rd.SampleDesc.Quality = desc.sample_quality;
+		rd.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		rd.Flags = to_internal(desc.usage);
+		return rd;
+	}
+
+	u32 RenderDevice_DX12::get_subresource_count(ID3D12Resource* resource) const
+	{
+		const auto desc = resource->GetDesc();
+		const u32 array_size = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1 : desc.DepthOrArraySize;
+		return desc.MipLevels * array_size * D3D12GetFormatPlaneCount(m_device.Get(), desc.Format);
+	}
+
+	DX12SubresourceStates& RenderDevice_DX12::get_global_states(bool is_texture, u64 handle)
+	{
+		if (is_texture)
+			return try_get(m_textures, get_slot(handle)).states;
+		return try_get(m_buffers, get_slot(handle)).states;
+	}
+
+	RenderDevice_DX12::CommandAtorAndList RenderDevice_DX12::get_ator_and_list(QueueType queue)
+	{
+		// Re-use if any
+		auto& recycled_pool = m_recycled_ator_and_list[queue];
+		if (!recycled_pool.empty())
+		{
+			auto ator_list = std::move(recycled_pool.front());
+			ator_list.reset();		// Reset ator and list for re-use
+			recycled_pool.pop();
+			return ator_list;
+		}
+
+		// Allocate new ator + list
+		HRESULT hr{ S_OK };
+		CommandAtorAndList ator_list{};
+		hr = m_device->CreateCommandAllocator(get_command_list_type(queue), IID_PPV_ARGS(ator_list.ator.GetAddressOf()));
+		HR_VFY(hr);
+		hr = m_device->CreateCommandList1(0, get_command_list_type(queue), D3D12_COMMAND_LIST_FLAG_NONE, IID_PPV_ARGS(ator_list.list.GetAddressOf()));
+		HR_VFY(hr);
+
+		// Reset 
+		ator_list.ator->Reset();
+		ator_list.list->Reset(ator_list.ator.Get(), nullptr);
+		ator_list.upload_arena = DX12UploadArena(m_dma.Get());
+		return ator_list;
+	}
+
+	D3D12_RESOURCE_STATES RenderDevice_DX12::get_initial_state(MemoryType memory_type) const
+	{
+		switch (memory_type)
+		{
+		case MemoryType::Upload:
+			return D3D12_RESOURCE_STATE_GENERIC_READ;
+		case MemoryType::Readback:
+			return D3D12_RESOURCE_STATE_COPY_DEST;
+		default:
+			return D3D12_RESOURCE_STATE_COMMON;
+		}
+	}
+
 
 }
 
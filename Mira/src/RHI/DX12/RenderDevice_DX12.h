@@ -2,18 +2,25 @@
 #include "../RenderDevice.h"
 #include "DX12CommonIncludes.h"
 #include "Utilities/DX12DescriptorChunk.h"
-#include "Utilities/DX12Fence.h"
+#include "Utilities/DX12UploadArena.h"
+#include "Utilities/DX12ResourceStateTracker.h"
+#include "Utilities/DX12GPUProfiler.h"
+#include "../../Threading/ThreadPool.h"
 
 #include <unordered_map>
 #include <queue>
+#include <deque>
 #include <functional>
 #include <optional>
+#include <future>
 
 #include "../../Handles/HandleAllocator.h"
+#include "../../Memory/VirtualLinearRing.h"
 
 namespace D3D12MA { class Allocator; class Allocation; }
 class DX12DescriptorManager;
 class DX12Queue;
+class DX12PipelineLibrary;
 
 namespace mira
 {
@@ -26,7 +33,8 @@ namespace mira
 		friend CommandCompiler_DX12;		// Compiler context requires read-access to API resources
 
 	public:
-		RenderDevice_DX12(ComPtr<ID3D12Device5> device, IDXGIAdapter* adapter, bool debug);
+		// Pipelines are compiled in the background on 'workers', shared with the rest of the application
+		RenderDevice_DX12(ComPtr<ID3D12Device5> device, IDXGIAdapter* adapter, ThreadPool& workers, bool debug);
 		~RenderDevice_DX12();
 
 		SwapChain* create_swapchain(void* hwnd, u8 num_buffers);
@@ -34,9 +42,18 @@ namespace mira
 		Buffer create_buffer(const BufferDesc& desc);
 		Texture create_texture(const TextureDesc& desc);
 		Pipeline create_graphics_pipeline(const GraphicsPipelineDesc& desc);
+		Pipeline create_graphics_pipeline_async(const GraphicsPipelineDesc& desc, Pipeline fallback = Pipeline{});
+		bool is_pipeline_ready(Pipeline handle) const;
 		RenderPass create_renderpass(const RenderPassDesc& desc);
 		BufferView create_view(Buffer buffer, const BufferViewDesc& desc);
 		TextureView create_view(Texture texture, const TextureViewDesc& desc);
+		u32 create_transient_view(Buffer buffer, const BufferViewDesc& desc);
+
+		Heap create_heap(const HeapDesc& desc);
+		Buffer create_placed_buffer(const BufferDesc& desc, Heap heap, u64 offset);
+		Texture create_placed_texture(const TextureDesc& desc, Heap heap, u64 offset);
+		MemoryRequirements get_memory_requirements(const BufferDesc& desc) const;
+		MemoryRequirements get_memory_requirements(const TextureDesc& desc) const;
 
 		void free_buffer(Buffer handle);
 		void free_texture(Texture handle);
@@ -44,7 +61,7 @@ namespace mira
 		void free_renderpass(RenderPass handle);
 		void free_view(BufferView handle);
 		void free_view(TextureView handle);
-		void recycle_sync(SyncReceipt receipt);
+		void free_heap(Heap handle);
 		void recycle_command_list(CommandList handle);
 
 		// Reserve metadata for command recording
@@ -60,15 +77,27 @@ namespace mira
 			std::optional<SyncReceipt> incoming_sync = std::nullopt,				// Synchronize with prior to command list execution
 			bool generate_sync = false);				// Generate sync after command list execution
 
+		void insert_wait(QueueType queue, SyncReceipt receipt);
+
 		u32 get_global_descriptor(BufferView view) const;
 		u32 get_global_descriptor(TextureView view) const;
 
+		const BufferDesc& get_desc(Buffer buffer) const;
+		const TextureDesc& get_desc(Texture texture) const;
+
 		void flush();
+		void begin_frame(u8 max_frames_in_flight);
+		void end_frame();
+		u64 get_current_frame() const;
+		u64 get_num_completed_frames() const;
 		void wait_for_gpu(SyncReceipt receipt);
+		bool is_complete(SyncReceipt receipt) const;
 
 
 		u8* map(Buffer handle, u32 subresource = 0, std::pair<u32, u32> read_range = { 0, 0 });
 		void unmap(Buffer handle, u32 subresource = 0, std::pair<u32, u32> written_range = { 0, 0 });
+
+		const GPUFrameTimings& get_gpu_timings() const;
 	
 		
 
@@ -88,14 +117,19 @@ namespace mira
 		// Implementation interfaces
 		ID3D12Resource* get_api_buffer(Buffer buffer) const;
 		ID3D12Resource* get_api_texture(Texture texture) const;
+		u32 get_api_subresource_count(Texture texture) const;
 		u32 get_api_buffer_size(Buffer buffer) const;
+		u64 get_api_buffer_offset(Buffer buffer) const;		// Offset into the resource, non-zero for sub-allocated buffers
 
 		D3D12_RESOURCE_STATES get_resource_state(ResourceState state) const;
 		DXGI_FORMAT get_format(ResourceFormat format) const;
 
+		// Pipeline to bind in place of 'pipeline', its fallback while it is still compiling
+		Pipeline resolve_pipeline(Pipeline pipeline) const;
 		D3D_PRIMITIVE_TOPOLOGY get_api_topology(Pipeline pipeline) const;
-		ID3D12PipelineState* get_api_pipeline(Pipeline pipeline) const;
+		ID3D12PipelineState* get_api_pipeline(Pipeline pipeline) const;			// Waits for pipelines still compiling
 		ID3D12RootSignature* get_api_global_rsig() const;
+		ID3D12CommandSignature* get_api_draw_indexed_signature(std::optional<u8> draw_id_slot) const;
 		ID3D12DescriptorHeap* get_api_global_resource_dheap() const;
 		ID3D12DescriptorHeap* get_api_global_sampler_dheap() const;
 
@@ -103,6 +137,8 @@ namespace mira
 		std::optional<D3D12_RENDER_PASS_DEPTH_STENCIL_DESC> get_rp_depth_stencil(RenderPass rp) const;
 		D3D12_RENDER_PASS_FLAGS get_rp_flags(RenderPass rp) const;
 
+		DX12GPUProfiler* get_profiler() const { return m_profiler.get(); }
+
 		ID3D12CommandQueue* get_queue(D3D12_COMMAND_LIST_TYPE type);
 
 		Texture register_swapchain_texture(ComPtr<ID3D12Resource> texture);
@@ -113,10 +149,25 @@ namespace mira
 		void create_queues();
 		void init_dma(IDXGIAdapter* adapter);
 		void init_rootsig();
+		void init_command_signatures();
 		std::vector<D3D12_STATIC_SAMPLER_DESC> grab_static_samplers();
-		DX12Queue* get_queue(QueueType type);
+		DX12Queue* get_queue(QueueType type) const;
 		D3D12_COMMAND_LIST_TYPE get_command_list_type(QueueType queue);
 
+		// Loads from the pipeline library or compiles, safe to call from any thread
+		ComPtr<ID3D12PipelineState> load_or_compile_pipeline(u64 hash, const GraphicsPipelineDesc& desc);
+
+		void write_view(const BufferViewDesc& desc, ID3D12Resource* resource, u64 resource_offset, D3D12_CPU_DESCRIPTOR_HANDLE dst);
+
+		// Retires completed frames (reclaiming their transient views), waits for the oldest ones until at most 'max_frames_in_flight' remain
+		void retire_frames(u32 max_frames_in_flight);
+
+		D3D12_RESOURCE_DESC get_resource_desc(const BufferDesc& desc) const;
+		D3D12_RESOURCE_DESC get_resource_desc(const TextureDesc& desc) const;
+		D3D12_RESOURCE_STATES get_initial_state(MemoryType memory_type) const;
+		u32 get_subresource_count(ID3D12Resource* resource) const;
+		DX12SubresourceStates& get_global_states(bool is_texture, u64 handle);
+
 
 
 
@@ -124,31 +175,47 @@ namespace mira
 		struct TextureView_Storage
 		{
 			Texture tex;
-			ViewType type{ ViewType::None };
+			TextureViewDesc desc;
 			DX12DescriptorChunk view;
 
-			TextureView_Storage(Texture tex_in, ViewType type_in, const DX12DescriptorChunk& descriptor) : tex(tex_in), type(type_in), view(descriptor) {}
+			// Identical views of a resource share a handle, which is freed with its last user
+			u64 hash{ 0 };
+			u32 ref_count{ 1 };
+
+			TextureView_Storage(Texture tex_in, const TextureViewDesc& desc_in, const DX12DescriptorChunk& descriptor, u64 hash_in) : tex(tex_in), desc(desc_in), view(descriptor), hash(hash_in) {}
 		};
 
 		struct BufferView_Storage
 		{
 			Buffer buf;
-			ViewType type{ ViewType::None };
+			BufferViewDesc desc;
 			DX12DescriptorChunk view;
 
-			BufferView_Storage(Buffer buf_in, ViewType type_in, const DX12DescriptorChunk& descriptor) : buf(buf_in), type(type_in), view(descriptor) {}
+			// Identical views of a resource share a handle, which is freed with its last user
+			u64 hash{ 0 };
+			u32 ref_count{ 1 };
+
+			BufferView_Storage(Buffer buf_in, const BufferViewDesc& desc_in, const DX12DescriptorChunk& descriptor, u64 hash_in) : buf(buf_in), desc(desc_in), view(descriptor), hash(hash_in) {}
 		};
 
 		struct GPUResource_Storage
 		{
 			ComPtr<D3D12MA::Allocation> alloc;
 			ComPtr<ID3D12Resource> resource;
+
+			// State as of the last submission
+			DX12SubresourceStates states;
 		};
 
 		struct Buffer_Storage : public GPUResource_Storage
 		{
 			BufferDesc desc;
 			u8* mapped_resource{ nullptr };
+
+			// Range of a small buffer block, for sub-allocated buffers (the resource is the block's)
+			std::optional<u32> block;
+			D3D12MA::VirtualAllocation sub_allocation{};
+			u64 offset{ 0 };
 		};
 
 		struct Texture_Storage : public GPUResource_Storage
@@ -156,11 +223,25 @@ namespace mira
 			TextureDesc desc;
 		};
 
+		struct Heap_Storage
+		{
+			HeapDesc desc;
+			ComPtr<D3D12MA::Allocation> alloc;		// Memory-only allocation which placed resources are created in
+		};
+
 		struct Pipeline_Storage
 		{
 			GraphicsPipelineDesc desc;
 			D3D_PRIMITIVE_TOPOLOGY topology{};
 			ComPtr<ID3D12PipelineState> pipeline;
+
+			// Background compilation, for pipelines created asynchronously
+			std::shared_future<ComPtr<ID3D12PipelineState>> pending;
+			Pipeline fallback;
+
+			// Identical descriptions share a handle, which is freed with its last user
+			u64 hash{ 0 };
+			u32 ref_count{ 1 };
 		};
 
 		struct RenderPass_Storage
@@ -171,21 +252,17 @@ namespace mira
 			D3D12_RENDER_PASS_FLAGS flags{};
 		};
 
-		struct CommandList_Storage
-		{
-			std::unique_ptr<CommandCompiler_DX12> compiler;
-			bool is_compiled{ false };
-		};
-
 		struct CommandAtorAndList
 		{
 			ComPtr<ID3D12CommandAllocator> ator;
 			ComPtr<ID3D12GraphicsCommandList4> list;
+			DX12UploadArena upload_arena;
 
 			void reset()
 			{
 				ator->Reset();
 				list->Reset(ator.Get(), nullptr);
+				upload_arena.reset();
 			}
 
 			void close()
@@ -194,11 +271,55 @@ namespace mira
 			}
 		};
 
-		struct SyncPrimitive
+		struct CommandList_Storage
+		{
+			std::unique_ptr<CommandCompiler_DX12> compiler;
+			bool is_compiled{ false };
+
+			// Transitions into the states the list expects, executed right before it
+			std::optional<CommandAtorAndList> fixup;
+		};
+
+	private:
+		CommandAtorAndList get_ator_and_list(QueueType queue);
+		Pipeline insert_pipeline(const GraphicsPipelineDesc& desc, u64 hash, Pipeline_Storage storage);
+
+		// Places small upload/readback buffers in a shared block, false if the buffer needs a resource of its own
+		bool sub_allocate_buffer(const BufferDesc& desc, Buffer_Storage& storage);
+
+
+	private:
+		// Size of the single root constant parameter that shader arguments are passed through
+		static constexpr u8 NUM_ROOT_CONSTANTS = 10;
+
+		static constexpr const char* PIPELINE_LIBRARY_PATH = "pipelines.dx12lib";
+
+		static constexpr u32 NUM_QUEUES = 3;
+		static constexpr u32 NUM_TRANSIENT_DESCRIPTORS = 16'384;
+
+		// Frame submitted to the GPU, complete once every queue's timeline has reached the value signaled at its end.
+		// Holds the end of the frame's transient views in the ring, which are reclaimed with it.
+		struct FrameInFlight
 		{
-			DX12Fence fence;
+			u64 frame{ 0 };
+			u64 ring_end{ 0 };
+			std::array<u64, NUM_QUEUES> timeline_values{};		// Graphics, compute, copy
 		};
 
+		// Upload and readback buffers are never transitioned, so small ones can share a resource without disagreeing on its state.
+		// Sub-allocations are aligned for texture uploads, which also covers constant buffer placement, and to the stride of structured views.
+		static constexpr u32 SMALL_BUFFER_MAX_SIZE = 16 * 1024;
+		static constexpr u64 SMALL_BUFFER_BLOCK_SIZE = 4 * 1024 * 1024;
+		static constexpr u64 SMALL_BUFFER_ALIGNMENT = D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT;
+
+		struct SmallBufferBlock
+		{
+			MemoryType memory_type{ MemoryType::Upload };
+			ComPtr<D3D12MA::Allocation> alloc;
+			ComPtr<ID3D12Resource> resource;
+			ComPtr<D3D12MA::VirtualBlock> block;
+			u8* mapped{ nullptr };		// Persistently mapped
+		};
 
 	private:
 		ComPtr<ID3D12Device5> m_device;
@@ -207,22 +328,53 @@ namespace mira
 		ComPtr<D3D12MA::Allocator> m_dma;
 
 		ComPtr<ID3D12RootSignature> m_common_rsig;
+		u64 m_common_rsig_hash{ 0 };
+
+		// Pipelines by content hash (description, shaders and root signature)
+		std::unordered_map<u64, Pipeline> m_pipeline_lookup;
+		std::unique_ptr<DX12PipelineLibrary> m_pipeline_library;
+
+		// Background pipeline compilation, waited for on destruction so that no compilation outlives the library or device
+		ThreadPool& m_workers;
+		ThreadPool::JobGroup m_pipeline_jobs;
+
+		// Indexed indirect draws, with and without a per-draw root constant (one signature per root constant slot)
+		ComPtr<ID3D12CommandSignature> m_draw_indexed_sig;
+		std::array<ComPtr<ID3D12CommandSignature>, NUM_ROOT_CONSTANTS> m_draw_indexed_with_id_sigs;
 		std::unique_ptr<DX12DescriptorManager> m_descriptor_mgr;
 
+		// Views by resource and description
+		// Keyed on the hash of resource and description, colliding views are told apart by their storage
+		std::unordered_multimap<u64, BufferView> m_buffer_view_lookup;
+		std::unordered_multimap<u64, TextureView> m_texture_view_lookup;
+
+		// Transient views, linearly allocated from a range of the shader visible heap
+		DX12DescriptorChunk m_transient_descriptors;
+		VirtualLinearRing m_transient_ring;
+
+		// Frames in submission order
+		std::deque<FrameInFlight> m_frames_in_flight;
+		u64 m_num_frames{ 0 };
+
+		// Profiling scopes, read back as frames retire
+		std::unique_ptr<DX12GPUProfiler> m_profiler;
+		GPUFrameTimings m_gpu_timings;
+
 		HandleAllocator m_rhp;
 
 		std::vector<std::optional<Buffer_Storage>> m_buffers;
 		std::vector<std::optional<Texture_Storage>> m_textures;
+		std::vector<std::optional<Heap_Storage>> m_heaps;
 		std::vector<std::optional<BufferView_Storage>> m_buffer_views;
 		std::vector<std::optional<TextureView_Storage>> m_texture_views;
 		std::vector<std::optional<Pipeline_Storage>> m_pipelines;
 		std::vector<std::optional<RenderPass_Storage>> m_renderpasses;
 		std::vector<std::optional<CommandList_Storage>> m_command_lists;		
-		std::vector<std::optional<SyncPrimitive>> m_syncs;		
+
+		std::vector<SmallBufferBlock> m_small_buffer_blocks;
 
 		//std::queue<CommandAtorAndList> m_recycled_ator_and_list;
 		std::unordered_map<QueueType, std::queue<CommandAtorAndList>> m_recycled_ator_and_list;
-		std::queue<SyncPrimitive> m_recycled_syncs;
 
 		// Important that this is destructed before resources and descriptor managers (need to free underlying texture)
 		std::unique_ptr<SwapChain_DX12> m_swapchain;
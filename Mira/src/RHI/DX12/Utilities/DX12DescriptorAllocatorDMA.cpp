@@ -1,12 +1,18 @@
 #include "DX12DescriptorAllocatorDMA.h"
 
-DX12DescriptorAllocatorDMA::DX12DescriptorAllocatorDMA(DX12DescriptorChunk&& chunk, bool uses_linear_algorithm) :
-	m_chunk(std::move(chunk))
+DX12DescriptorAllocatorDMA::DX12DescriptorAllocatorDMA(DX12DescriptorChunk&& chunk, uint32_t num_table_descriptors, bool uses_linear_algorithm) :
+	m_chunk(std::move(chunk)),
+	m_singles(m_chunk.num_descriptors() - num_table_descriptors),
+	m_tables_offset(m_chunk.num_descriptors() - num_table_descriptors)
 {
+	assert(num_table_descriptors <= m_chunk.num_descriptors());
+	if (num_table_descriptors == 0)
+		return;
+
 	HRESULT hr = S_OK;
 
 	D3D12MA::VIRTUAL_BLOCK_DESC block_desc = {};
-	block_desc.Size = m_chunk.num_descriptors();		// treat each descriptor as a 'byte'
+	block_desc.Size = num_table_descriptors;		// treat each descriptor as a 'byte'
 	block_desc.Flags = uses_linear_algorithm ? D3D12MA::VIRTUAL_BLOCK_FLAG_ALGORITHM_LINEAR : D3D12MA::VIRTUAL_BLOCK_FLAG_NONE;
 
 	hr = CreateVirtualBlock(&block_desc, &m_dma_block);
@@ -15,11 +21,30 @@ DX12DescriptorAllocatorDMA::DX12DescriptorAllocatorDMA(DX12DescriptorChunk&& chu
 
 DX12DescriptorAllocatorDMA::~DX12DescriptorAllocatorDMA()
 {
-	assert(m_active_allocations.size() == 0);
+	assert(m_singles.get_num_allocated() == 0);
+	assert(m_num_table_allocations == 0);
+
+	if (m_dma_block)
+		m_dma_block->Release();
 }
 
 DX12DescriptorChunk DX12DescriptorAllocatorDMA::allocate(uint32_t num_descriptors)
 {
+	if (num_descriptors == 1)
+	{
+		auto index = m_singles.allocate();
+
+		// Allocation failed - no space for it could be found.
+		assert(index.has_value());
+		if (!index.has_value())
+			return DX12DescriptorChunk();
+
+		return DX12DescriptorChunk(m_chunk.get_subchunk(*index, 1));
+	}
+
+	// Tables require a range reserved for them
+	assert(m_dma_block != nullptr);
+
 	HRESULT hr = S_OK;
 
 	D3D12MA::VIRTUAL_ALLOCATION_DESC alloc_desc{};
@@ -27,12 +52,16 @@ DX12DescriptorChunk DX12DescriptorAllocatorDMA::allocate(uint32_t num_descriptor
 
 	D3D12MA::VirtualAllocation dma_alloc;
 	UINT64 alloc_offset;
-	hr = m_dma_block->Allocate(&alloc_desc, &dma_alloc, &alloc_offset);
-	if (SUCCEEDED(hr))
 	{
-		m_active_allocations.insert({ dma_alloc.AllocHandle, dma_alloc });
+		std::lock_guard lock(m_tables_mutex);
+		hr = m_dma_block->Allocate(&alloc_desc, &dma_alloc, &alloc_offset);
+		if (SUCCEEDED(hr))
+			++m_num_table_allocations;
+	}
 
-		auto chunk = DX12DescriptorChunk(m_chunk.get_subchunk(alloc_offset, num_descriptors));
+	if (SUCCEEDED(hr))
+	{
+		auto chunk = DX12DescriptorChunk(m_chunk.get_subchunk(m_tables_offset + alloc_offset, num_descriptors));
 		chunk.set_allocator_key(dma_alloc.AllocHandle);	// Hold on to the alloc handle
 		return chunk;
 	}
@@ -46,9 +75,16 @@ DX12DescriptorChunk DX12DescriptorAllocatorDMA::allocate(uint32_t num_descriptor
 
 void DX12DescriptorAllocatorDMA::free(DX12DescriptorChunk* chunk)
 {
-	uint64_t handle = chunk->get_allocator_key();
-	auto it = m_active_allocations.find(handle);
-	D3D12MA::VirtualAllocation alloc = it->second;
+	if (chunk->num_descriptors() == 1)
+	{
+		m_singles.free((uint32_t)(chunk->index_offset_from_base() - m_chunk.index_offset_from_base()));
+		return;
+	}
+
+	D3D12MA::VirtualAllocation alloc{};
+	alloc.AllocHandle = chunk->get_allocator_key();
+
+	std::lock_guard lock(m_tables_mutex);
 	m_dma_block->FreeAllocation(alloc);
-	m_active_allocations.erase(it);
+	--m_num_table_allocations;
 }
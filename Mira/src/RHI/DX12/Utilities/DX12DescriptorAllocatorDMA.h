@@ -1,12 +1,18 @@
 #pragma once
 #include "D3D12MemAlloc.h"
-#include <unordered_map>
+#include <mutex>
 #include "DX12DescriptorChunk.h"
+#include "../../../Memory/IndexAllocator.h"
 
+/*
+	Allocates descriptors from a chunk, which is split in two:
+		[0, size - num_table_descriptors)		Single descriptors, O(1) and lock-free through an index allocator (nearly every allocation is a single view)
+		[size - num_table_descriptors, size)	Contiguous tables of multiple descriptors, through a D3D12MA virtual block behind a lock
+*/
 class DX12DescriptorAllocatorDMA
 {
 public:
-	DX12DescriptorAllocatorDMA(DX12DescriptorChunk&& chunk, bool uses_linear_algorithm = false);
+	DX12DescriptorAllocatorDMA(DX12DescriptorChunk&& chunk, uint32_t num_table_descriptors = 0, bool uses_linear_algorithm = false);
 	~DX12DescriptorAllocatorDMA();
 
 	DX12DescriptorChunk allocate(uint32_t num_descriptors);
@@ -14,9 +20,13 @@ public:
 
 private:
 	DX12DescriptorChunk m_chunk;
-	D3D12MA::VirtualBlock* m_dma_block{ nullptr };
 
-	std::unordered_map<uint64_t, D3D12MA::VirtualAllocation> m_active_allocations;
+	mira::IndexAllocator m_singles;
+
+	uint32_t m_tables_offset{ 0 };
+	D3D12MA::VirtualBlock* m_dma_block{ nullptr };
+	uint32_t m_num_table_allocations{ 0 };
+	std::mutex m_tables_mutex;
 };
 
 
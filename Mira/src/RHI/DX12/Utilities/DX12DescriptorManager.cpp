@@ -69,8 +69,9 @@ void DX12DescriptorManager::init_heaps(ID3D12Device* device)
 
 void DX12DescriptorManager::init_allocators()
 {
-	m_gpu_dh_resource_ator = std::make_unique<DX12DescriptorAllocatorDMA>(m_gpu_dh_resource->as_chunk());
-	m_gpu_dh_sampler_ator = std::make_unique<DX12DescriptorAllocatorDMA>(m_gpu_dh_sampler->as_chunk());
+	// Some room for descriptor tables in the shader visible heaps (including the device's transient view ring), everything else is single descriptors
+	m_gpu_dh_resource_ator = std::make_unique<DX12DescriptorAllocatorDMA>(m_gpu_dh_resource->as_chunk(), 30'000);
+	m_gpu_dh_sampler_ator = std::make_unique<DX12DescriptorAllocatorDMA>(m_gpu_dh_sampler->as_chunk(), 100);
 	m_cpu_dh_rtv_ator = std::make_unique<DX12DescriptorAllocatorDMA>(m_cpu_dh_rtv->as_chunk());
 	m_cpu_dh_dsv_ator = std::make_unique<DX12DescriptorAllocatorDMA>(m_cpu_dh_dsv->as_chunk());
 }
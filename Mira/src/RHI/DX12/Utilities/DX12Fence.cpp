@@ -1,46 +1,56 @@
 #include "DX12Fence.h"
+#include <chrono>
 
-DX12Fence::DX12Fence(ID3D12Device* dev, u32 init_value, D3D12_FENCE_FLAGS flags)
+DX12Fence::DX12Fence(ID3D12Device* dev, u64 init_value, D3D12_FENCE_FLAGS flags)
 {
 	HRESULT hr = S_OK;
 	hr = dev->CreateFence(
 		init_value, flags, IID_PPV_ARGS(m_fence.GetAddressOf()));
 
 	assert(SUCCEEDED(hr));
-
-	// Create dedicated event to use for this fence
-	m_event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
 }
 
 
-bool DX12Fence::signal(ID3D12CommandQueue* queue, UINT value)
+bool DX12Fence::signal(ID3D12CommandQueue* queue, u64 value)
 {
-	m_wait_for_value = value;
 	HRESULT hr = queue->Signal(m_fence.Get(), value);
 	return SUCCEEDED(hr);
 }
 
 
-bool DX12Fence::gpu_wait(ID3D12CommandQueue* queue) const
+bool DX12Fence::gpu_wait(ID3D12CommandQueue* queue, u64 value) const
 {
-	HRESULT hr = queue->Wait(m_fence.Get(), m_wait_for_value);
+	HRESULT hr = queue->Wait(m_fence.Get(), value);
 	return SUCCEEDED(hr);
 }
 
-bool DX12Fence::cpu_wait() const
+bool DX12Fence::cpu_wait(u64 value) const
 {
-	if (m_fence->GetCompletedValue() < m_wait_for_value)
-	{
-		// Raise an event when fence reaches the value
-		HRESULT hr = m_fence->SetEventOnCompletion(m_wait_for_value, m_event);
-		if (FAILED(hr))
-			return false;
+	if (m_fence->GetCompletedValue() >= value)
+		return true;
 
-		// CPU block until event is done
-		WaitForSingleObject(m_event, INFINITE);
+	// Spin first, a kernel round trip costs more than a short wait
+	const auto spin_end = std::chrono::steady_clock::now() + std::chrono::microseconds(SPIN_MICROSECONDS);
+	while (std::chrono::steady_clock::now() < spin_end)
+	{
+		if (m_fence->GetCompletedValue() >= value)
+			return true;
+		YieldProcessor();
 	}
 
-	return true;
+	// A null event blocks inside the call until the value is reached, which is safe with several threads waiting on the same fence
+	HRESULT hr = m_fence->SetEventOnCompletion(value, nullptr);
+	return SUCCEEDED(hr);
+}
+
+bool DX12Fence::is_completed(u64 value) const
+{
+	return m_fence->GetCompletedValue() >= value;
+}
+
+u64 DX12Fence::get_completed_value() const
+{
+	return m_fence->GetCompletedValue();
 }
 
 DX12Fence::operator ID3D12Fence* () const
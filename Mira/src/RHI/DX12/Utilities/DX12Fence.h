@@ -5,23 +5,26 @@ class DX12Fence
 {
 public:
 	DX12Fence() = default;
-	DX12Fence(ID3D12Device* dev, u32 init_value, D3D12_FENCE_FLAGS flags = D3D12_FENCE_FLAG_NONE);
+	DX12Fence(ID3D12Device* dev, u64 init_value, D3D12_FENCE_FLAGS flags = D3D12_FENCE_FLAG_NONE);
 
 	// Signals this fence with 'value' once this position in the queue has been reached
 	// (All commands prior to this position are guaranteed to have finished their execution)
-	bool signal(ID3D12CommandQueue* queue, u32 value);
+	bool signal(ID3D12CommandQueue* queue, u64 value);
 
-	// Waits for a signaled value on the GPU
-	bool gpu_wait(ID3D12CommandQueue* queue) const;
+	// Waits for 'value' on the GPU
+	bool gpu_wait(ID3D12CommandQueue* queue, u64 value) const;
 
-	// Waits for a signaled value on the CPU
-	bool cpu_wait() const;
+	// Waits for 'value' on the CPU, spinning briefly before blocking since most waits are for work which is about to finish
+	bool cpu_wait(u64 value) const;
+
+	bool is_completed(u64 value) const;
+	u64 get_completed_value() const;
 
 	operator ID3D12Fence* () const;
 
+private:
+	static constexpr u32 SPIN_MICROSECONDS = 50;
+
 private:
 	ComPtr<ID3D12Fence> m_fence;
-	HANDLE m_event{ nullptr };
-	u32 m_wait_for_value = 0;
 };
-
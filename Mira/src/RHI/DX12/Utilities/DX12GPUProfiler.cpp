@@ -0,0 +1,155 @@
+#include "DX12GPUProfiler.h"
+#include <tuple>
+
+DX12GPUProfiler::DX12GPUProfiler(ID3D12Device* dev, D3D12MA::Allocator* dma)
+{
+	HRESULT hr = S_OK;
+
+	// Timestamp heaps serve both the direct and the compute queue
+	D3D12_QUERY_HEAP_DESC qhd{};
+	qhd.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	qhd.Count = MAX_FRAMES * MAX_SCOPES_PER_FRAME * 2;
+	hr = dev->CreateQueryHeap(&qhd, IID_PPV_ARGS(m_timestamp_heap.GetAddressOf()));
+	HR_VFY(hr);
+
+	qhd.Type = D3D12_QUERY_HEAP_TYPE_PIPELINE_STATISTICS;
+	qhd.Count = MAX_FRAMES * MAX_STATISTICS_PER_FRAME;
+	hr = dev->CreateQueryHeap(&qhd, IID_PPV_ARGS(m_statistics_heap.GetAddressOf()));
+	HR_VFY(hr);
+
+	D3D12MA::ALLOCATION_DESC ad{};
+	ad.HeapType = D3D12_HEAP_TYPE_READBACK;
+	D3D12_RESOURCE_DESC rd = CD3DX12_RESOURCE_DESC::Buffer(TIMESTAMP_BYTES + STATISTICS_BYTES);
+	hr = dma->CreateResource(&ad, &rd, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, m_readback_alloc.GetAddressOf(), IID_PPV_ARGS(m_readback.GetAddressOf()));
+	HR_VFY(hr);
+
+	// Frames only read ranges the GPU is done writing to, so the buffer can stay mapped
+	hr = m_readback->Map(0, nullptr, (void**)&m_mapped);
+	HR_VFY(hr);
+
+	LARGE_INTEGER freq{};
+	QueryPerformanceFrequency(&freq);
+	m_cpu_ticks_per_ms = (f64)freq.QuadPart / 1000.0;
+
+	begin_frame(0);
+}
+
+DX12GPUProfiler::~DX12GPUProfiler()
+{
+	D3D12_RANGE no_write{ 0, 0 };
+	m_readback->Unmap(0, &no_write);
+}
+
+std::optional<DX12GPUProfiler::Reservation> DX12GPUProfiler::reserve(u64 frame, u32 num_scopes, u32 num_statistics)
+{
+	auto& curr = m_frames[frame % MAX_FRAMES];
+	assert(curr.frame == frame);
+
+	// Counts may overshoot on failure, which only makes later reservations of the frame fail too
+	const u32 first_scope = curr.num_scopes.fetch_add(num_scopes);
+	const u32 first_statistics = curr.num_statistics.fetch_add(num_statistics);
+	if (first_scope + num_scopes > MAX_SCOPES_PER_FRAME || first_statistics + num_statistics > MAX_STATISTICS_PER_FRAME)
+		return std::nullopt;
+
+	const u32 slot = (u32)(frame % MAX_FRAMES);
+
+	Reservation reservation{};
+	reservation.frame = frame;
+	reservation.first_timestamp = (slot * MAX_SCOPES_PER_FRAME + first_scope) * 2;
+	reservation.first_statistics = slot * MAX_STATISTICS_PER_FRAME + first_statistics;
+	reservation.num_scopes = num_scopes;
+	reservation.num_statistics = num_statistics;
+	return reservation;
+}
+
+void DX12GPUProfiler::resolve(ID3D12GraphicsCommandList* list, const Reservation& reservation) const
+{
+	if (reservation.num_scopes > 0)
+	{
+		list->ResolveQueryData(m_timestamp_heap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, reservation.first_timestamp, reservation.num_scopes * 2,
+			m_readback.Get(), get_timestamp_offset(reservation.first_timestamp));
+	}
+
+	if (reservation.num_statistics > 0)
+	{
+		list->ResolveQueryData(m_statistics_heap.Get(), D3D12_QUERY_TYPE_PIPELINE_STATISTICS, reservation.first_statistics, reservation.num_statistics,
+			m_readback.Get(), get_statistics_offset(reservation.first_statistics));
+	}
+}
+
+void DX12GPUProfiler::add_scopes(const Reservation& reservation, std::span<const Scope> scopes)
+{
+	// Lists with scopes have to be submitted in the frame they were compiled in
+	auto& curr = m_frames[reservation.frame % MAX_FRAMES];
+	assert(curr.frame == reservation.frame);
+	curr.scopes.insert(curr.scopes.end(), scopes.begin(), scopes.end());
+}
+
+void DX12GPUProfiler::end_frame(u64 frame, const DX12Queue& graphics, const DX12Queue& compute)
+{
+	auto& curr = m_frames[frame % MAX_FRAMES];
+	assert(curr.frame == frame);
+
+	if (!curr.scopes.empty())
+	{
+		curr.clocks[0] = calibrate(graphics);
+		curr.clocks[1] = calibrate(compute);
+	}
+}
+
+void DX12GPUProfiler::begin_frame(u64 frame)
+{
+	auto& next = m_frames[frame % MAX_FRAMES];
+	next.frame = frame;
+	next.num_scopes = 0;
+	next.num_statistics = 0;
+	next.scopes.clear();
+}
+
+void DX12GPUProfiler::read_back(u64 frame, mira::GPUFrameTimings& timings) const
+{
+	const auto& curr = m_frames[frame % MAX_FRAMES];
+	assert(curr.frame == frame);
+
+	timings.frame = frame;
+	timings.scopes.clear();
+	timings.scopes.reserve(curr.scopes.size());
+
+	for (const auto& scope : curr.scopes)
+	{
+		const auto& clock = curr.clocks[scope.queue == mira::QueueType::Compute ? 1 : 0];
+		const u64 begin = *(const u64*)(m_mapped + get_timestamp_offset(scope.timestamp));
+		const u64 end = *(const u64*)(m_mapped + get_timestamp_offset(scope.timestamp + 1));
+		const f64 ms_per_tick = 1000.0 / (f64)clock.frequency;
+
+		mira::GPUScopeTiming timing{};
+		timing.name = scope.name;
+		timing.queue = scope.queue;
+		timing.depth = scope.depth;
+		timing.start_ms = clock.cpu_ms + ((f64)begin - (f64)clock.gpu_timestamp) * ms_per_tick;
+		timing.duration_ms = end >= begin ? (f64)(end - begin) * ms_per_tick : 0.0;
+
+		if (scope.statistics.has_value())
+		{
+			// Same layout
+			static_assert(sizeof(mira::PipelineStatistics) == sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS));
+			timing.statistics = mira::PipelineStatistics{};
+			std::memcpy(&*timing.statistics, m_mapped + get_statistics_offset(*scope.statistics), sizeof(mira::PipelineStatistics));
+		}
+
+		timings.scopes.push_back(std::move(timing));
+	}
+}
+
+DX12GPUProfiler::QueueClock DX12GPUProfiler::calibrate(const DX12Queue& queue) const
+{
+	QueueClock clock{};
+	clock.frequency = queue.get_timestamp_freq();
+
+	u64 cpu_ticks{ 0 };
+	std::tie(clock.gpu_timestamp, cpu_ticks) = queue.get_clock_calibration();
+
+	// The CPU timestamp is a QueryPerformanceCounter value, which steady_clock is based on
+	clock.cpu_ms = (f64)cpu_ticks / m_cpu_ticks_per_ms;
+	return clock;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include "../DX12CommonIncludes.h"
+#include "../../RHITypes.h"
+#include "D3D12MemAlloc.h"
+#include "DX12Queue.h"
+#include <atomic>
+
+/*
+	Timestamp and pipeline statistics queries backing profiling scopes.
+
+	Each frame owns a fixed range of the query heaps and of a persistently mapped readback buffer, chosen by the frame number modulo MAX_FRAMES.
+	Command lists reserve a contiguous block of queries while compiling and resolve it into the readback buffer at their end,
+	so the results of a frame can be read once it has completed on the GPU.
+	The owner has to read a frame back before its range is reused, which allows at most MAX_FRAMES - 1 frames in flight.
+
+	Timestamps are converted to the CPU clock through a calibration of each queue taken at the end of the frame.
+*/
+class DX12GPUProfiler
+{
+public:
+	static constexpr u32 MAX_FRAMES = 4;
+	static constexpr u32 MAX_SCOPES_PER_FRAME = 2048;
+	static constexpr u32 MAX_STATISTICS_PER_FRAME = 256;
+
+	// Queries of a command list, within the range of the frame it was compiled in
+	struct Reservation
+	{
+		u64 frame{ 0 };
+		u32 first_timestamp{ 0 };			// Heap indices
+		u32 first_statistics{ 0 };
+		u32 num_scopes{ 0 };				// Two timestamps each
+		u32 num_statistics{ 0 };
+	};
+
+	struct Scope
+	{
+		std::string name;
+		mira::QueueType queue{ mira::QueueType::Graphics };
+		u8 depth{ 0 };
+		u32 timestamp{ 0 };					// Begin, the end timestamp follows it
+		std::optional<u32> statistics;
+	};
+
+public:
+	DX12GPUProfiler(ID3D12Device* dev, D3D12MA::Allocator* dma);
+	~DX12GPUProfiler();
+
+	// Safe to call from any thread, nullopt if the frame is out of queries
+	std::optional<Reservation> reserve(u64 frame, u32 num_scopes, u32 num_statistics);
+
+	ID3D12QueryHeap* get_timestamp_heap() const { return m_timestamp_heap.Get(); }
+	ID3D12QueryHeap* get_statistics_heap() const { return m_statistics_heap.Get(); }
+
+	// Records the copy of the reserved queries into the readback buffer, at the end of the list
+	void resolve(ID3D12GraphicsCommandList* list, const Reservation& reservation) const;
+
+	// Scopes of a submitted list, in submission order
+	void add_scopes(const Reservation& reservation, std::span<const Scope> scopes);
+
+	// Called once all work of the frame has been submitted
+	void end_frame(u64 frame, const DX12Queue& graphics, const DX12Queue& compute);
+
+	// Takes over the range of the frame MAX_FRAMES back, which has to be read back by now
+	void begin_frame(u64 frame);
+
+	// The frame must have completed on the GPU
+	void read_back(u64 frame, mira::GPUFrameTimings& timings) const;
+
+private:
+	// Relates the timestamps of a queue to the CPU clock
+	struct QueueClock
+	{
+		u64 frequency{ 1 };
+		u64 gpu_timestamp{ 0 };
+		f64 cpu_ms{ 0.0 };
+	};
+
+	struct Frame
+	{
+		u64 frame{ 0 };
+		std::atomic<u32> num_scopes{ 0 };
+		std::atomic<u32> num_statistics{ 0 };
+
+		std::vector<Scope> scopes;
+		std::array<QueueClock, 2> clocks;		// Graphics, compute
+	};
+
+	QueueClock calibrate(const DX12Queue& queue) const;
+
+	u64 get_timestamp_offset(u32 query) const { return (u64)query * sizeof(u64); }
+	u64 get_statistics_offset(u32 query) const { return TIMESTAMP_BYTES + (u64)query * sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS); }
+
+private:
+	static constexpr u64 TIMESTAMP_BYTES = (u64)MAX_FRAMES * MAX_SCOPES_PER_FRAME * 2 * sizeof(u64);
+	static constexpr u64 STATISTICS_BYTES = (u64)MAX_FRAMES * MAX_STATISTICS_PER_FRAME * sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS);
+
+	ComPtr<ID3D12QueryHeap> m_timestamp_heap;
+	ComPtr<ID3D12QueryHeap> m_statistics_heap;
+
+	ComPtr<D3D12MA::Allocation> m_readback_alloc;
+	ComPtr<ID3D12Resource> m_readback;
+	const u8* m_mapped{ nullptr };
+
+	std::array<Frame, MAX_FRAMES> m_frames;
+	f64 m_cpu_ticks_per_ms{ 1.0 };
+};
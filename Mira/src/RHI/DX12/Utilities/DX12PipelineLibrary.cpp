@@ -0,0 +1,76 @@
+#include "DX12PipelineLibrary.h"
+#include <fstream>
+#include <iostream>
+
+DX12PipelineLibrary::DX12PipelineLibrary(ID3D12Device1* dev, const std::filesystem::path& path) :
+	m_path(path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (file)
+		m_serialized.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	HRESULT hr = S_OK;
+	if (!m_serialized.empty())
+	{
+		hr = dev->CreatePipelineLibrary(m_serialized.data(), m_serialized.size(), IID_PPV_ARGS(m_library.GetAddressOf()));
+
+		// Written by a different driver or adapter, or corrupted
+		if (FAILED(hr))
+		{
+			std::cout << "DX12PipelineLibrary: discarding " << path << " (0x" << std::hex << (u32)hr << std::dec << ")\n";
+			m_serialized.clear();
+			m_library.Reset();
+		}
+	}
+
+	if (!m_library)
+	{
+		hr = dev->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(m_library.GetAddressOf()));
+		HR_VFY(hr);
+	}
+}
+
+DX12PipelineLibrary::~DX12PipelineLibrary()
+{
+	if (!m_library || !m_dirty)
+		return;
+
+	std::vector<u8> data(m_library->GetSerializedSize());
+	HRESULT hr = m_library->Serialize(data.data(), data.size());
+	HR_VFY(hr);
+
+	std::ofstream file(m_path, std::ios::binary | std::ios::trunc);
+	file.write((const char*)data.data(), data.size());
+}
+
+ComPtr<ID3D12PipelineState> DX12PipelineLibrary::load_graphics_pipeline(u64 hash, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+	std::lock_guard lock(m_mutex);
+
+	ComPtr<ID3D12PipelineState> pso;
+	HRESULT hr = m_library->LoadGraphicsPipeline(get_name(hash).c_str(), &desc, IID_PPV_ARGS(pso.GetAddressOf()));
+	if (FAILED(hr))
+	{
+		++m_misses;
+		return nullptr;
+	}
+
+	++m_hits;
+	return pso;
+}
+
+void DX12PipelineLibrary::store(u64 hash, ID3D12PipelineState* pipeline)
+{
+	std::lock_guard lock(m_mutex);
+
+	// Fails if a pipeline with this name exists, which happens if the stored one no longer matches its description (e.g root signature change)
+	HRESULT hr = m_library->StorePipeline(get_name(hash).c_str(), pipeline);
+	m_dirty |= SUCCEEDED(hr);
+}
+
+std::wstring DX12PipelineLibrary::get_name(u64 hash)
+{
+	wchar_t name[17]{};
+	swprintf(name, 17, L"%016llx", (unsigned long long)hash);
+	return name;
+}
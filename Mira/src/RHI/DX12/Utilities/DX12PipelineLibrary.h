@@ -0,0 +1,43 @@
+#pragma once
+#include "../DX12CommonIncludes.h"
+#include <mutex>
+
+/*
+	Compiled pipelines persisted across runs through ID3D12PipelineLibrary, keyed by a content hash of the pipeline description.
+
+	The library file is loaded on construction and written back on destruction if anything was added.
+	A library which the driver rejects (e.g after a driver update) is discarded and rebuilt.
+	The serialized data has to outlive the library, so it is kept in memory for its lifetime.
+*/
+class DX12PipelineLibrary
+{
+public:
+	DX12PipelineLibrary() = default;
+	DX12PipelineLibrary(ID3D12Device1* dev, const std::filesystem::path& path);
+	~DX12PipelineLibrary();
+
+	DX12PipelineLibrary(const DX12PipelineLibrary&) = delete;
+	DX12PipelineLibrary& operator=(const DX12PipelineLibrary&) = delete;
+
+	// Null if the library has no pipeline for 'hash' or the stored one does not match 'desc'
+	ComPtr<ID3D12PipelineState> load_graphics_pipeline(u64 hash, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+	void store(u64 hash, ID3D12PipelineState* pipeline);
+
+	u32 get_num_hits() const { return m_hits; }
+	u32 get_num_misses() const { return m_misses; }
+
+private:
+	static std::wstring get_name(u64 hash);
+
+private:
+	std::filesystem::path m_path;
+	std::vector<u8> m_serialized;
+	ComPtr<ID3D12PipelineLibrary> m_library;
+	bool m_dirty{ false };
+
+	u32 m_hits{ 0 };
+	u32 m_misses{ 0 };
+
+	std::mutex m_mutex;
+};
@@ -1,7 +1,7 @@
 #include "DX12Queue.h"
 
 DX12Queue::DX12Queue(ID3D12Device* dev, D3D12_COMMAND_LIST_TYPE queueType) :
-	m_flush_fence(dev, 0)
+	m_timeline(dev, 0)
 {
 	HRESULT hr = S_OK;
 	D3D12_COMMAND_QUEUE_DESC cqd{};
@@ -17,20 +17,33 @@ void DX12Queue::execute_command_lists(UINT num_lists, ID3D12CommandList* const*
 	m_queue->ExecuteCommandLists(num_lists, lists);
 }
 
-void DX12Queue::insert_signal(DX12Fence& fence)
+u64 DX12Queue::insert_signal()
 {
-	fence.signal(m_queue.Get(), m_next_fence_value++);
+	m_timeline.signal(m_queue.Get(), ++m_signaled_value);
+	return m_signaled_value;
 }
 
-void DX12Queue::insert_wait(DX12Fence& fence)
+void DX12Queue::insert_wait(const DX12Queue& other, u64 value)
 {
-	fence.gpu_wait(m_queue.Get());
+	// Same queue waits are already ordered
+	if (&other == this)
+		return;
+	other.m_timeline.gpu_wait(m_queue.Get(), value);
+}
+
+void DX12Queue::cpu_wait(u64 value) const
+{
+	m_timeline.cpu_wait(value);
+}
+
+bool DX12Queue::is_completed(u64 value) const
+{
+	return m_timeline.is_completed(value);
 }
 
 void DX12Queue::flush()
 {
-	DX12Queue::insert_signal(m_flush_fence);
-	m_flush_fence.cpu_wait();
+	m_timeline.cpu_wait(insert_signal());
 }
 
 UINT64 DX12Queue::get_timestamp_freq() const
@@ -42,6 +55,15 @@ UINT64 DX12Queue::get_timestamp_freq() const
 	return freq;
 }
 
+std::pair<u64, u64> DX12Queue::get_clock_calibration() const
+{
+	HRESULT hr = S_OK;
+	UINT64 gpu_timestamp{ 0 }, cpu_timestamp{ 0 };
+	hr = m_queue->GetClockCalibration(&gpu_timestamp, &cpu_timestamp);
+	assert(SUCCEEDED(hr));
+	return { gpu_timestamp, cpu_timestamp };
+}
+
 DX12Queue::operator ID3D12CommandQueue* () const
 {
 	return m_queue.Get();
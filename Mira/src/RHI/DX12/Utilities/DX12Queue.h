@@ -2,6 +2,11 @@
 #include "../DX12CommonIncludes.h"
 #include "DX12Fence.h"
 
+/*
+	Command queue with its own timeline fence.
+	Every signal advances the timeline by one, so a position on the queue is fully described by a value and
+	completion checks are plain comparisons.
+*/
 class DX12Queue
 {
 public:
@@ -9,20 +14,32 @@ public:
 	DX12Queue(ID3D12Device* dev, D3D12_COMMAND_LIST_TYPE queue_type);
 
 	void execute_command_lists(UINT num_lists, ID3D12CommandList* const* lists);
-	void insert_signal(DX12Fence& fence);
-	void insert_wait(DX12Fence& fence);
+
+	// Signals the next timeline value after all prior work, and returns it
+	u64 insert_signal();
+
+	// GPU-waits for a value on another queue's timeline before executing further work
+	void insert_wait(const DX12Queue& other, u64 value);
+
+	void cpu_wait(u64 value) const;
+	bool is_completed(u64 value) const;
+
+	// Latest value passed to insert_signal
+	u64 get_signaled_value() const { return m_signaled_value; }
 
 	// Inserts immediate CPU-wait
 	void flush();
 
 	UINT64 get_timestamp_freq() const;
 
+	// GPU timestamp and QueryPerformanceCounter value sampled at the same moment
+	std::pair<u64, u64> get_clock_calibration() const;
+
 	operator ID3D12CommandQueue* () const;
 
 private:
 	ComPtr<ID3D12CommandQueue> m_queue;
 
-	DX12Fence m_flush_fence;
-	UINT m_next_fence_value{ 1 };
+	DX12Fence m_timeline;
+	u64 m_signaled_value{ 0 };
 };
-
@@ -0,0 +1,196 @@
+#include "DX12ResourceStateTracker.h"
+
+namespace
+{
+	constexpr D3D12_RESOURCE_STATES READ_ONLY_STATES = D3D12_RESOURCE_STATE_GENERIC_READ | D3D12_RESOURCE_STATE_DEPTH_READ;
+}
+
+DX12SubresourceStates::DX12SubresourceStates(u32 num_subresources, D3D12_RESOURCE_STATES state) :
+	m_num_subresources(num_subresources),
+	m_uniform(state)
+{
+}
+
+D3D12_RESOURCE_STATES DX12SubresourceStates::get(u32 subresource) const
+{
+	if (is_uniform())
+		return m_uniform;
+
+	assert(subresource < m_num_subresources);
+	return m_per_subresource[subresource];
+}
+
+void DX12SubresourceStates::set(u32 subresource, D3D12_RESOURCE_STATES state)
+{
+	if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES || m_num_subresources == 1)
+	{
+		m_uniform = state;
+		m_per_subresource.clear();
+		return;
+	}
+
+	assert(subresource < m_num_subresources);
+	if (is_uniform())
+	{
+		if (state == m_uniform)
+			return;
+		m_per_subresource.assign(m_num_subresources, m_uniform);
+	}
+	m_per_subresource[subresource] = state;
+}
+
+DX12ResourceStateTracker::DX12ResourceStateTracker(bool copy_queue) :
+	m_copy_queue(copy_queue)
+{
+}
+
+void DX12ResourceStateTracker::transition(ID3D12Resource* resource, bool is_texture, u64 handle, u32 num_subresources, u32 subresource,
+	D3D12_RESOURCE_STATES after, std::vector<D3D12_RESOURCE_BARRIER>& barriers)
+{
+	auto& tracked = get_tracked(resource, is_texture, handle, num_subresources);
+
+	auto transition_subresource = [&](u32 sub, u32 api_sub)
+	{
+		const D3D12_RESOURCE_STATES current = tracked.current.get(sub);
+
+		// First use, the device transitions into it on submission
+		if (current == DX12SubresourceStates::UNKNOWN)
+		{
+			tracked.required.set(api_sub, after);
+			tracked.current.set(api_sub, after);
+			return;
+		}
+
+		D3D12_RESOURCE_STATES target = after;
+		if (!m_copy_queue && is_read_only(current) && is_read_only(after))
+			target = current | after;
+
+		if (target == current)
+			return;
+
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, current, target, api_sub));
+		tracked.current.set(api_sub, target);
+	};
+
+	// Whole resource in a single transition when possible
+	if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES && tracked.current.is_uniform())
+	{
+		transition_subresource(0, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+		return;
+	}
+
+	if (subresource != D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+	{
+		transition_subresource(subresource, subresource);
+		return;
+	}
+
+	for (u32 i = 0; i < num_subresources; ++i)
+		transition_subresource(i, i);
+}
+
+void DX12ResourceStateTracker::track(ID3D12Resource* resource, bool is_texture, u64 handle, u32 num_subresources, u32 subresource,
+	D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+{
+	auto& tracked = get_tracked(resource, is_texture, handle, num_subresources);
+
+	// The explicit 'before' is what the list expects on entry
+	if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES && tracked.current.is_uniform())
+	{
+		if (tracked.current.get(0) == DX12SubresourceStates::UNKNOWN)
+			tracked.required.set(subresource, before);
+	}
+	else if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+	{
+		for (u32 i = 0; i < num_subresources; ++i)
+		{
+			if (tracked.current.get(i) == DX12SubresourceStates::UNKNOWN)
+				tracked.required.set(i, before);
+		}
+	}
+	else if (tracked.current.get(subresource) == DX12SubresourceStates::UNKNOWN)
+	{
+		tracked.required.set(subresource, before);
+	}
+
+	tracked.current.set(subresource, after);
+}
+
+bool DX12ResourceStateTracker::is_read_only(D3D12_RESOURCE_STATES state)
+{
+	return state != D3D12_RESOURCE_STATE_COMMON && (state & ~READ_ONLY_STATES) == 0;
+}
+
+void DX12ResourceStateTracker::merge(DX12SubresourceStates& states, const DX12SubresourceStates& changes)
+{
+	if (changes.is_uniform())
+	{
+		if (changes.get(0) != DX12SubresourceStates::UNKNOWN)
+			states.set(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, changes.get(0));
+		return;
+	}
+
+	for (u32 i = 0; i < changes.get_num_subresources(); ++i)
+	{
+		if (changes.get(i) != DX12SubresourceStates::UNKNOWN)
+			states.set(i, changes.get(i));
+	}
+}
+
+void DX12ResourceStateTracker::decay(DX12SubresourceStates& states, const DX12SubresourceStates& changes)
+{
+	if (changes.is_uniform())
+	{
+		if (changes.get(0) != DX12SubresourceStates::UNKNOWN)
+			states.set(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, D3D12_RESOURCE_STATE_COMMON);
+		return;
+	}
+
+	for (u32 i = 0; i < changes.get_num_subresources(); ++i)
+	{
+		if (changes.get(i) != DX12SubresourceStates::UNKNOWN)
+			states.set(i, D3D12_RESOURCE_STATE_COMMON);
+	}
+}
+
+void DX12ResourceStateTracker::append_transitions(ID3D12Resource* resource, const DX12SubresourceStates& from, const DX12SubresourceStates& to, bool promoted, std::vector<D3D12_RESOURCE_BARRIER>& barriers)
+{
+	auto needs_transition = [promoted](D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+	{
+		if (after == DX12SubresourceStates::UNKNOWN || before == after)
+			return false;
+		return !(promoted && before == D3D12_RESOURCE_STATE_COMMON);
+	};
+
+	if (from.is_uniform() && to.is_uniform())
+	{
+		const auto before = from.get(0);
+		const auto after = to.get(0);
+		if (needs_transition(before, after))
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, before, after, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES));
+		return;
+	}
+
+	for (u32 i = 0; i < to.get_num_subresources(); ++i)
+	{
+		const auto before = from.get(i);
+		const auto after = to.get(i);
+		if (needs_transition(before, after))
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, before, after, i));
+	}
+}
+
+DX12ResourceStateTracker::TrackedResource& DX12ResourceStateTracker::get_tracked(ID3D12Resource* resource, bool is_texture, u64 handle, u32 num_subresources)
+{
+	auto it = m_resources.find(resource);
+	if (it == m_resources.end())
+	{
+		TrackedResource tracked{};
+		tracked.is_texture = is_texture;
+		tracked.handle = handle;
+		tracked.required = DX12SubresourceStates(num_subresources, DX12SubresourceStates::UNKNOWN);
+		tracked.current = DX12SubresourceStates(num_subresources, DX12SubresourceStates::UNKNOWN);
+		it = m_resources.insert({ resource, std::move(tracked) }).first;
+	}
+	return it->second;
+}
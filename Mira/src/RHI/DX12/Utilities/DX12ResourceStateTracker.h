@@ -0,0 +1,96 @@
+#pragma once
+#include "../DX12CommonIncludes.h"
+
+/*
+	States of every subresource of a single resource.
+	Stored as a single state while all subresources agree, expanded on the first diverging subresource.
+*/
+class DX12SubresourceStates
+{
+public:
+	// Subresource has not been seen yet
+	static constexpr D3D12_RESOURCE_STATES UNKNOWN = (D3D12_RESOURCE_STATES)-1;
+
+public:
+	DX12SubresourceStates() = default;
+	DX12SubresourceStates(u32 num_subresources, D3D12_RESOURCE_STATES state);
+
+	D3D12_RESOURCE_STATES get(u32 subresource) const;
+
+	// D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES sets all
+	void set(u32 subresource, D3D12_RESOURCE_STATES state);
+
+	bool is_uniform() const { return m_per_subresource.empty(); }
+	u32 get_num_subresources() const { return m_num_subresources; }
+
+private:
+	u32 m_num_subresources{ 1 };
+	D3D12_RESOURCE_STATES m_uniform{ UNKNOWN };
+	std::vector<D3D12_RESOURCE_STATES> m_per_subresource;
+};
+
+/*
+	Command list local state tracking.
+
+	Transitions only need to state the target state, the previous state is known from earlier transitions in the same list.
+	The state a resource is first used in is not known while recording (lists are recorded out of submission order),
+	so it is recorded as a requirement instead, which the device resolves against the global state on submission.
+
+	- Transitions to the current state are dropped
+	- Read-only states are combined (e.g pixel + non-pixel shader resource), so that alternating reads do not cause transitions.
+	  Not on copy queues, which only support the copy states.
+
+	On submission, resources which decay to common (buffers, anything used on a copy queue) are left to implicit promotion when
+	they are in the common state. Decay happens once the whole ExecuteCommandLists call completes, not between its lists,
+	so later lists of the same call see the promoted state.
+	Textures on other queues are always transitioned explicitly, so they are never promoted and keep their final state.
+*/
+class DX12ResourceStateTracker
+{
+public:
+	struct TrackedResource
+	{
+		// Owner lookup on resolve
+		bool is_texture{ false };
+		u64 handle{ 0 };
+
+		// State expected when the list starts executing, UNKNOWN for untouched subresources
+		DX12SubresourceStates required;
+		DX12SubresourceStates current;
+	};
+
+public:
+	DX12ResourceStateTracker(bool copy_queue = false);
+
+	// Appends the transitions (if any) required to get the (sub)resource into 'after'
+	void transition(ID3D12Resource* resource, bool is_texture, u64 handle, u32 num_subresources, u32 subresource,
+		D3D12_RESOURCE_STATES after, std::vector<D3D12_RESOURCE_BARRIER>& barriers);
+
+	// Explicit transition, only tracked
+	void track(ID3D12Resource* resource, bool is_texture, u64 handle, u32 num_subresources, u32 subresource,
+		D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after);
+
+	const std::unordered_map<ID3D12Resource*, TrackedResource>& get_resources() const { return m_resources; }
+
+	static bool is_read_only(D3D12_RESOURCE_STATES state);
+
+	// Whether the states of a resource used on the queue decay to common once the ExecuteCommandLists call completes
+	static bool decays(bool is_texture, bool copy_queue) { return !is_texture || copy_queue; }
+
+	// Applies the known states of 'changes' onto 'states'
+	static void merge(DX12SubresourceStates& states, const DX12SubresourceStates& changes);
+
+	// Resets the subresources known in 'changes' to common
+	static void decay(DX12SubresourceStates& states, const DX12SubresourceStates& changes);
+
+	// Appends the transitions required to go from 'from' to 'to', UNKNOWN subresources in 'to' are skipped.
+	// Transitions out of common are skipped if 'promoted', implicit promotion takes care of them.
+	static void append_transitions(ID3D12Resource* resource, const DX12SubresourceStates& from, const DX12SubresourceStates& to, bool promoted, std::vector<D3D12_RESOURCE_BARRIER>& barriers);
+
+private:
+	TrackedResource& get_tracked(ID3D12Resource* resource, bool is_texture, u64 handle, u32 num_subresources);
+
+private:
+	std::unordered_map<ID3D12Resource*, TrackedResource> m_resources;
+	bool m_copy_queue{ false };
+};
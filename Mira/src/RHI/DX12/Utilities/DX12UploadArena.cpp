@@ -0,0 +1,63 @@
+#include "DX12UploadArena.h"
+
+DX12UploadArena::DX12UploadArena(D3D12MA::Allocator* dma, u64 page_size) :
+	m_dma(dma),
+	m_page_size(page_size)
+{
+}
+
+DX12UploadArena::Allocation DX12UploadArena::allocate(u64 size, u64 alignment)
+{
+	assert(m_dma != nullptr);
+
+	// Find the first page (from the current one) which can fit the allocation
+	while (m_curr_page < m_pages.size())
+	{
+		const u64 start = (m_head + alignment - 1) & ~(alignment - 1);
+		if (start + size <= m_pages[m_curr_page].size)
+		{
+			m_head = start + size;
+
+			Allocation alloc{};
+			alloc.memory = m_pages[m_curr_page].mapped + start;
+			alloc.resource = m_pages[m_curr_page].resource.Get();
+			alloc.offset = start;
+			return alloc;
+		}
+
+		++m_curr_page;
+		m_head = 0;
+	}
+
+	// Out of pages, grab a new one which is guaranteed to fit
+	create_page((std::max)(m_page_size, size));
+	return allocate(size, alignment);
+}
+
+void DX12UploadArena::reset()
+{
+	m_curr_page = 0;
+	m_head = 0;
+}
+
+void DX12UploadArena::create_page(u64 size)
+{
+	HRESULT hr = S_OK;
+
+	D3D12MA::ALLOCATION_DESC ad{};
+	ad.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+	D3D12_RESOURCE_DESC rd = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+	Page page{};
+	page.size = size;
+	hr = m_dma->CreateResource(&ad, &rd, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, page.alloc.GetAddressOf(), IID_PPV_ARGS(page.resource.GetAddressOf()));
+	HR_VFY(hr);
+
+	// Upload heaps can stay persistently mapped
+	D3D12_RANGE no_read{ 0, 0 };
+	hr = page.resource->Map(0, &no_read, (void**)&page.mapped);
+	HR_VFY(hr);
+
+	m_pages.push_back(std::move(page));
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "../DX12CommonIncludes.h"
+#include "D3D12MemAlloc.h"
+
+/*
+	Linear sub-allocator over CPU-writable upload heap pages.
+	Individual allocations are never freed, the whole arena is reclaimed at once through reset()
+	which the owner calls when the GPU is guaranteed to be done reading from it.
+
+	Pages are kept around on reset so that a recycled arena does not have to go through the allocator again.
+*/
+class DX12UploadArena
+{
+public:
+	struct Allocation
+	{
+		u8* memory{ nullptr };
+		ID3D12Resource* resource{ nullptr };
+		u64 offset{ 0 };
+	};
+
+public:
+	DX12UploadArena() = default;
+	DX12UploadArena(D3D12MA::Allocator* dma, u64 page_size = 64 * 1024);
+
+	Allocation allocate(u64 size, u64 alignment = sizeof(u32));
+	void reset();
+
+private:
+	struct Page
+	{
+		ComPtr<D3D12MA::Allocation> alloc;
+		ComPtr<ID3D12Resource> resource;
+		u8* mapped{ nullptr };
+		u64 size{ 0 };
+	};
+
+	void create_page(u64 size);
+
+private:
+	D3D12MA::Allocator* m_dma{ nullptr };
+	u64 m_page_size{ 0 };
+
+	std::vector<Page> m_pages;
+	u32 m_curr_page{ 0 };
+	u64 m_head{ 0 };
+};
@@ -0,0 +1,18 @@
+#include "RenderBackend_Null.h"
+#include "RenderDevice_Null.h"
+
+namespace mira
+{
+	RenderBackend_Null::~RenderBackend_Null()
+	{
+	}
+
+	RenderDevice* RenderBackend_Null::create_device()
+	{
+		auto render_device = std::make_unique<RenderDevice_Null>();
+		auto ret = render_device.get();
+
+		m_render_devices.insert({ ret, std::move(render_device) });
+		return ret;
+	}
+}
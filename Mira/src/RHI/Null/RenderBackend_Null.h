@@ -0,0 +1,21 @@
+#pragma once
+#include "../RenderBackend.h"
+#include "../../Common.h"
+
+namespace mira
+{
+	class RenderDevice_Null;
+
+	// Creates devices without a GPU, see RenderDevice_Null
+	class RenderBackend_Null : public RenderBackend
+	{
+	public:
+		RenderBackend_Null() = default;
+		~RenderBackend_Null();
+
+		RenderDevice* create_device() override;
+
+	private:
+		std::unordered_map<RenderDevice*, std::unique_ptr<RenderDevice_Null>> m_render_devices;
+	};
+}
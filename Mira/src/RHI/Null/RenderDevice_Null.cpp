@@ -0,0 +1,699 @@
+#include "RenderDevice_Null.h"
+#include "SwapChain_Null.h"
+
+#include <chrono>
+#include <iostream>
+#include <cstring>
+
+namespace mira
+{
+	namespace
+	{
+		using Clock = std::chrono::high_resolution_clock;
+
+		f64 elapsed_ms(Clock::time_point start)
+		{
+			return std::chrono::duration<f64, std::milli>(Clock::now() - start).count();
+		}
+
+		u64 align_up(u64 value, u64 alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		u32 get_texel_size(ResourceFormat format)
+		{
+			switch (format)
+			{
+			case ResourceFormat::RGBA_32_FLOAT:
+				return 16;
+			case ResourceFormat::D32_FLOAT_S8X24_UINT:
+				return 8;
+			case ResourceFormat::RGBA_8_UNORM:
+			case ResourceFormat::D32_FLOAT:
+			case ResourceFormat::D24_UNORM_S8_UINT:
+				return 4;
+			case ResourceFormat::D16_UNORM:
+				return 2;
+			default:
+				assert(false);
+				return 0;
+			}
+		}
+
+		u32 get_mip_count(const TextureDesc& desc)
+		{
+			// Zero requests the full chain
+			if (desc.mip_levels != 0)
+				return desc.mip_levels;
+
+			u32 largest = std::max(desc.width, desc.height);
+			if (desc.type == TextureType::Texture3D)
+				largest = std::max(largest, desc.depth);
+
+			u32 mips = 1;
+			while (largest > 1)
+			{
+				largest >>= 1;
+				++mips;
+			}
+			return mips;
+		}
+
+		// Synthetic GPU cost model for profiling scopes
+		constexpr f64 SYNTHETIC_COMMAND_MS = 0.001;
+		constexpr f64 SYNTHETIC_VERTEX_MS = 0.000001;
+		constexpr f64 SYNTHETIC_BYTE_MS = 0.0000001;		// 10 GB/s
+
+		f64 get_steady_ms()
+		{
+			return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		u64 get_vertex_count(const RenderCommand& cmd)
+		{
+			if (cmd.type == RenderCommandDraw::TYPE)
+			{
+				const auto& draw = static_cast<const RenderCommandDraw&>(cmd);
+				return (u64)draw.verts_per_instance * draw.instance_count;
+			}
+			if (cmd.type == RenderCommandDrawIndexed::TYPE)
+			{
+				const auto& draw = static_cast<const RenderCommandDrawIndexed&>(cmd);
+				return (u64)draw.indices_per_instance * draw.instance_count;
+			}
+			return 0;
+		}
+
+		u64 get_copied_bytes(const RenderCommand& cmd)
+		{
+			if (cmd.type == RenderCommandCopyBuffer::TYPE)
+				return static_cast<const RenderCommandCopyBuffer&>(cmd).size;
+			if (cmd.type == RenderCommandCopyBufferToImage::TYPE)
+			{
+				const auto& copy = static_cast<const RenderCommandCopyBufferToImage&>(cmd);
+				return (u64)copy.src_rowpitch * copy.src_height * copy.src_depth;
+			}
+			return 0;
+		}
+
+		const char* get_command_name(RenderCommandType type)
+		{
+			switch (type)
+			{
+			case RenderCommandType::Draw:
+				return "Draw";
+			case RenderCommandType::DrawIndexed:
+				return "DrawIndexed";
+			case RenderCommandType::DrawIndexedIndirect:
+				return "DrawIndexedIndirect";
+			case RenderCommandType::SetPipeline:
+				return "SetPipeline";
+			case RenderCommandType::BeginRenderPass:
+				return "BeginRenderPass";
+			case RenderCommandType::EndRenderPass:
+				return "EndRenderPass";
+			case RenderCommandType::Barrier:
+				return "Barrier";
+			case RenderCommandType::UpdateShaderArgs:
+				return "UpdateShaderArgs";
+			case RenderCommandType::CopyBuffer:
+				return "CopyBuffer";
+			case RenderCommandType::CopyBufferToImage:
+				return "CopyBufferToImage";
+			case RenderCommandType::BeginProfileScope:
+				return "BeginProfileScope";
+			case RenderCommandType::EndProfileScope:
+				return "EndProfileScope";
+			default:
+				return "None";
+			}
+		}
+	}
+
+	RenderDevice_Null::RenderDevice_Null(u32 swapchain_width, u32 swapchain_height) :
+		m_swapchain_width(swapchain_width),
+		m_swapchain_height(swapchain_height)
+	{
+		// 0 marked as un-used
+		m_buffers.resize(1);
+		m_textures.resize(1);
+		m_heaps.resize(1);
+		m_pipelines.resize(1);
+		m_renderpasses.resize(1);
+		m_command_lists.resize(1);
+
+		m_buffer_views.resize(1);
+		m_texture_views.resize(1);
+	}
+
+	RenderDevice_Null::~RenderDevice_Null()
+	{
+	}
+
+	void RenderDevice_Null::print_stats() const
+	{
+		std::cout << "RenderDevice_Null: " << m_stats.submissions << " submissions, " << m_stats.command_lists << " command lists, "
+			<< m_stats.bytes_copied << " bytes copied, " << m_stats.heaps << " heaps, " << m_stats.placed_resources << " placed resources\n";
+		std::cout << "\tcompile: " << m_stats.compile_ms << " ms, submit: " << m_stats.submit_ms << " ms\n";
+
+		for (u32 i = 0; i < NUM_COMMAND_TYPES; ++i)
+		{
+			if (m_stats.command_counts[i] == 0)
+				continue;
+			std::cout << "\t" << get_command_name((RenderCommandType)i) << ": " << m_stats.command_counts[i] << " (" << m_stats.command_ms[i] << " ms)\n";
+		}
+	}
+
+	SwapChain* RenderDevice_Null::create_swapchain([[maybe_unused]] void* hwnd, u8 num_buffers)
+	{
+		assert(m_swapchain == nullptr);
+		m_swapchain = std::make_unique<SwapChain_Null>(this, num_buffers, m_swapchain_width, m_swapchain_height);
+		return m_swapchain.get();
+	}
+
+	Buffer RenderDevice_Null::create_buffer(const BufferDesc& desc)
+	{
+		Buffer_Storage storage{};
+		storage.desc = desc;
+		storage.owned.resize(desc.size);
+
+		auto handle = m_rhp.allocate<Buffer>();
+		try_insert_move(m_buffers, std::move(storage), get_slot(handle.handle));
+		return handle;
+	}
+
+	Texture RenderDevice_Null::create_texture(const TextureDesc& desc)
+	{
+		return insert_texture(desc, Heap{}, 0);
+	}
+
+	Pipeline RenderDevice_Null::create_graphics_pipeline(const GraphicsPipelineDesc& desc)
+	{
+		const u64 hash = hash_desc(desc);
+		if (auto it = m_pipeline_lookup.find(hash); it != m_pipeline_lookup.end())
+		{
+			++try_get(m_pipelines, get_slot(it->second.handle)).ref_count;
+			return it->second;
+		}
+
+		auto handle = m_rhp.allocate<Pipeline>();
+		try_insert(m_pipelines, Pipeline_Storage{ desc, hash }, get_slot(handle.handle));
+		m_pipeline_lookup.insert({ hash, handle });
+		return handle;
+	}
+
+	Pipeline RenderDevice_Null::create_graphics_pipeline_async(const GraphicsPipelineDesc& desc, [[maybe_unused]] Pipeline fallback)
+	{
+		// Nothing to compile, the pipeline is ready right away
+		return create_graphics_pipeline(desc);
+	}
+
+	bool RenderDevice_Null::is_pipeline_ready(Pipeline handle) const
+	{
+		assert(m_pipelines[get_slot(handle.handle)].has_value());
+		return true;
+	}
+
+	RenderPass RenderDevice_Null::create_renderpass(const RenderPassDesc& desc)
+	{
+		auto handle = m_rhp.allocate<RenderPass>();
+		try_insert(m_renderpasses, desc, get_slot(handle.handle));
+		return handle;
+	}
+
+	BufferView RenderDevice_Null::create_view(Buffer buffer, const BufferViewDesc& desc)
+	{
+		const u64 hash = hash_combine(hash_desc(desc), buffer.handle);
+		auto [first, last] = m_buffer_view_lookup.equal_range(hash);
+		for (auto it = first; it != last; ++it)
+		{
+			auto& existing = try_get(m_buffer_views, get_slot(it->second.handle));
+			if (existing.buffer.handle == buffer.handle && existing.desc == desc)
+			{
+				++existing.ref_count;
+				return it->second;
+			}
+		}
+
+		auto handle = m_rhp.allocate<BufferView>();
+		try_insert(m_buffer_views, BufferView_Storage{ buffer, desc, allocate_descriptor(), hash }, get_slot(handle.handle));
+		m_buffer_view_lookup.insert({ hash, handle });
+		return handle;
+	}
+
+	u32 RenderDevice_Null::create_transient_view(Buffer buffer, [[maybe_unused]] const BufferViewDesc& desc)
+	{
+		assert(m_buffers[get_slot(buffer.handle)].has_value());
+
+		// Work is complete once submitted, so the ring only fills up within a frame
+		const u64 offset = m_transient_ring.allocate(1);
+		assert(offset != (u64)-1);
+		return MAX_DESCRIPTORS + 1 + (u32)offset;
+	}
+
+	TextureView RenderDevice_Null::create_view(Texture texture, const TextureViewDesc& desc)
+	{
+		const u64 hash = hash_combine(hash_desc(desc), texture.handle);
+		auto [first, last] = m_texture_view_lookup.equal_range(hash);
+		for (auto it = first; it != last; ++it)
+		{
+			auto& existing = try_get(m_texture_views, get_slot(it->second.handle));
+			if (existing.texture.handle == texture.handle && existing.desc == desc)
+			{
+				++existing.ref_count;
+				return it->second;
+			}
+		}
+
+		auto handle = m_rhp.allocate<TextureView>();
+		try_insert(m_texture_views, TextureView_Storage{ texture, desc, allocate_descriptor(), hash }, get_slot(handle.handle));
+		m_texture_view_lookup.insert({ hash, handle });
+		return handle;
+	}
+
+	Heap RenderDevice_Null::create_heap(const HeapDesc& desc)
+	{
+		Heap_Storage storage{};
+		storage.desc = desc;
+		storage.memory.resize(desc.size);
+
+		auto handle = m_rhp.allocate<Heap>();
+		try_insert_move(m_heaps, std::move(storage), get_slot(handle.handle));
+		++m_stats.heaps;
+		return handle;
+	}
+
+	Buffer RenderDevice_Null::create_placed_buffer(const BufferDesc& desc, Heap heap, u64 offset)
+	{
+		auto& heap_storage = try_get(m_heaps, get_slot(heap.handle));
+		assert(heap_storage.desc.category == HeapCategory::Buffers);
+		assert(offset % RESOURCE_ALIGNMENT == 0 && offset + desc.size <= heap_storage.desc.size);
+
+		Buffer_Storage storage{};
+		storage.desc = desc;
+		storage.placed = heap_storage.memory.data() + offset;
+
+		auto handle = m_rhp.allocate<Buffer>();
+		try_insert_move(m_buffers, std::move(storage), get_slot(handle.handle));
+		++m_stats.placed_resources;
+		return handle;
+	}
+
+	Texture RenderDevice_Null::create_placed_texture(const TextureDesc& desc, Heap heap, u64 offset)
+	{
+		assert(heap.handle != 0);
+		++m_stats.placed_resources;
+		return insert_texture(desc, heap, offset);
+	}
+
+	MemoryRequirements RenderDevice_Null::get_memory_requirements(const BufferDesc& desc) const
+	{
+		return MemoryRequirements{ align_up(desc.size, RESOURCE_ALIGNMENT), RESOURCE_ALIGNMENT };
+	}
+
+	MemoryRequirements RenderDevice_Null::get_memory_requirements(const TextureDesc& desc) const
+	{
+		return MemoryRequirements{ align_up(get_texture_layout(desc, nullptr), RESOURCE_ALIGNMENT), RESOURCE_ALIGNMENT };
+	}
+
+	void RenderDevice_Null::free_buffer(Buffer handle)
+	{
+		m_buffers[get_slot(handle.handle)] = std::nullopt;
+		m_rhp.free(handle);
+	}
+
+	void RenderDevice_Null::free_texture(Texture handle)
+	{
+		m_textures[get_slot(handle.handle)] = std::nullopt;
+		m_rhp.free(handle);
+	}
+
+	void RenderDevice_Null::free_pipeline(Pipeline handle)
+	{
+		auto& storage = try_get(m_pipelines, get_slot(handle.handle));
+		if (--storage.ref_count > 0)
+			return;
+
+		m_pipeline_lookup.erase(storage.hash);
+		m_pipelines[get_slot(handle.handle)] = std::nullopt;
+		m_rhp.free(handle);
+	}
+
+	void RenderDevice_Null::free_renderpass(RenderPass handle)
+	{
+		m_renderpasses[get_slot(handle.handle)] = std::nullopt;
+		m_rhp.free(handle);
+	}
+
+	void RenderDevice_Null::free_view(BufferView handle)
+	{
+		auto& storage = try_get(m_buffer_views, get_slot(handle.handle));
+		if (--storage.ref_count > 0)
+			return;
+
+		erase_lookup(m_buffer_view_lookup, storage.hash, handle);
+		free_descriptor(storage.descriptor);
+		m_buffer_views[get_slot(handle.handle)] = std::nullopt;
+		m_rhp.free(handle);
+	}
+
+	void RenderDevice_Null::free_view(TextureView handle)
+	{
+		auto& storage = try_get(m_texture_views, get_slot(handle.handle));
+		if (--storage.ref_count > 0)
+			return;
+
+		erase_lookup(m_texture_view_lookup, storage.hash, handle);
+		free_descriptor(storage.descriptor);
+		m_texture_views[get_slot(handle.handle)] = std::nullopt;
+		m_rhp.free(handle);
+	}
+
+	void RenderDevice_Null::free_heap(Heap handle)
+	{
+		m_heaps[get_slot(handle.handle)] = std::nullopt;
+		m_rhp.free(handle);
+	}
+
+	void RenderDevice_Null::recycle_command_list(CommandList handle)
+	{
+		m_command_lists[get_slot(handle.handle)] = std::nullopt;
+		m_rhp.free(handle);
+	}
+
+	CommandList RenderDevice_Null::allocate_command_list(QueueType queue)
+	{
+		CommandList_Storage storage{};
+		storage.queue = queue;
+
+		auto handle = m_rhp.allocate<CommandList>();
+		try_insert_move(m_command_lists, std::move(storage), get_slot(handle.handle));
+		return handle;
+	}
+
+	void RenderDevice_Null::compile_command_list(CommandList handle, RenderCommandList list)
+	{
+		const auto start = Clock::now();
+
+		auto& storage = try_get(m_command_lists, get_slot(handle.handle));
+		assert(!storage.is_compiled);
+		storage.list = std::move(list);
+		storage.is_compiled = true;
+
+		m_stats.compile_ms += elapsed_ms(start);
+	}
+
+	std::optional<SyncReceipt> RenderDevice_Null::submit_command_lists(std::span<CommandList> lists, QueueType queue, std::optional<SyncReceipt> incoming_sync, bool generate_sync)
+	{
+		const auto start = Clock::now();
+
+		// Everything submitted earlier has already executed
+		assert(!incoming_sync.has_value() || incoming_sync->value <= m_submissions);
+
+		for (auto list : lists)
+		{
+			const auto& storage = try_get(m_command_lists, get_slot(list.handle));
+			assert(storage.is_compiled);
+			assert(storage.queue == queue);
+
+			execute(storage.list, queue);
+			++m_stats.command_lists;
+		}
+
+		++m_submissions;
+		++m_stats.submissions;
+
+		std::optional<SyncReceipt> sync_receipt{ std::nullopt };
+		if (generate_sync)
+			sync_receipt = SyncReceipt{ queue, m_submissions };
+
+		m_stats.submit_ms += elapsed_ms(start);
+		return sync_receipt;
+	}
+
+	void RenderDevice_Null::insert_wait([[maybe_unused]] QueueType queue, SyncReceipt receipt)
+	{
+		assert(receipt.value <= m_submissions);
+	}
+
+	u32 RenderDevice_Null::get_global_descriptor(BufferView view) const
+	{
+		return try_get(m_buffer_views, get_slot(view.handle)).descriptor;
+	}
+
+	u32 RenderDevice_Null::get_global_descriptor(TextureView view) const
+	{
+		return try_get(m_texture_views, get_slot(view.handle)).descriptor;
+	}
+
+	const BufferDesc& RenderDevice_Null::get_desc(Buffer buffer) const
+	{
+		return try_get(m_buffers, get_slot(buffer.handle)).desc;
+	}
+
+	const TextureDesc& RenderDevice_Null::get_desc(Texture texture) const
+	{
+		return try_get(m_textures, get_slot(texture.handle)).desc;
+	}
+
+	void RenderDevice_Null::wait_for_gpu(SyncReceipt receipt)
+	{
+		assert(receipt.value <= m_submissions);
+	}
+
+	bool RenderDevice_Null::is_complete(SyncReceipt receipt) const
+	{
+		return receipt.value <= m_submissions;
+	}
+
+	void RenderDevice_Null::flush()
+	{
+	}
+
+	void RenderDevice_Null::begin_frame([[maybe_unused]] u8 max_frames_in_flight)
+	{
+		// Frames are complete once submitted, there is never one to wait for
+	}
+
+	void RenderDevice_Null::end_frame()
+	{
+		m_transient_ring.free_until(m_transient_ring.get_head());
+
+		m_gpu_timings.frame = m_frames;
+		m_gpu_timings.scopes = std::move(m_frame_timings);
+		m_frame_timings.clear();
+
+		++m_frames;
+	}
+
+	u64 RenderDevice_Null::get_current_frame() const
+	{
+		return m_frames;
+	}
+
+	u64 RenderDevice_Null::get_num_completed_frames() const
+	{
+		return m_frames;
+	}
+
+	u8* RenderDevice_Null::map(Buffer handle, [[maybe_unused]] u32 subresource, [[maybe_unused]] std::pair<u32, u32> read_range)
+	{
+		return try_get(m_buffers, get_slot(handle.handle)).memory();
+	}
+
+	void RenderDevice_Null::unmap([[maybe_unused]] Buffer handle, [[maybe_unused]] u32 subresource, [[maybe_unused]] std::pair<u32, u32> written_range)
+	{
+	}
+
+	const GPUFrameTimings& RenderDevice_Null::get_gpu_timings() const
+	{
+		return m_gpu_timings;
+	}
+
+	u32 RenderDevice_Null::allocate_descriptor()
+	{
+		// Same capacity as the shader visible resource heap on D3D12
+		auto index = m_descriptors.allocate();
+		assert(index.has_value());
+		return *index + 1;
+	}
+
+	void RenderDevice_Null::free_descriptor(u32 descriptor)
+	{
+		m_descriptors.free(descriptor - 1);
+	}
+
+	u64 RenderDevice_Null::get_texture_layout(const TextureDesc& desc, std::vector<u64>* subresource_offsets) const
+	{
+		const u32 texel_size = get_texel_size(desc.format);
+		const u32 mips = get_mip_count(desc);
+		const bool is_3d = desc.type == TextureType::Texture3D;
+		const u32 array_size = is_3d ? 1 : desc.depth;
+
+		// Subresource index is mip + array slice * mips
+		u64 size = 0;
+		for (u32 slice = 0; slice < array_size; ++slice)
+		{
+			for (u32 mip = 0; mip < mips; ++mip)
+			{
+				if (subresource_offsets)
+					subresource_offsets->push_back(size);
+
+				const u64 width = std::max(desc.width >> mip, 1u);
+				const u64 height = std::max(desc.height >> mip, 1u);
+				const u64 depth = is_3d ? std::max(desc.depth >> mip, 1u) : 1;
+				size += width * height * depth * texel_size * desc.sample_count;
+			}
+		}
+		return size;
+	}
+
+	Texture RenderDevice_Null::insert_texture(const TextureDesc& desc, Heap heap, u64 offset)
+	{
+		Texture_Storage storage{};
+		storage.desc = desc;
+		const u64 size = get_texture_layout(desc, &storage.subresource_offsets);
+
+		if (heap.handle != 0)
+		{
+			auto& heap_storage = try_get(m_heaps, get_slot(heap.handle));
+			assert(heap_storage.desc.category != HeapCategory::Buffers);
+			assert(offset % RESOURCE_ALIGNMENT == 0 && offset + size <= heap_storage.desc.size);
+			storage.placed = heap_storage.memory.data() + offset;
+		}
+		else
+		{
+			storage.owned.resize(size);
+		}
+
+		auto handle = m_rhp.allocate<Texture>();
+		try_insert_move(m_textures, std::move(storage), get_slot(handle.handle));
+		return handle;
+	}
+
+	void RenderDevice_Null::execute(const RenderCommandList& list, QueueType queue)
+	{
+		// Work starts no earlier than its submission
+		f64& clock_ms = m_queue_clocks_ms[(u32)queue];
+		clock_ms = std::max(clock_ms, get_steady_ms());
+
+		// Scopes on the copy queue are ignored (nullopt), as on D3D12
+		std::vector<std::optional<size_t>> open_scopes;
+
+		for (const auto& cmd : list.get_commands())
+		{
+			const auto start = Clock::now();
+
+			const u64 vertices = get_vertex_count(*cmd);
+			clock_ms += SYNTHETIC_COMMAND_MS + vertices * SYNTHETIC_VERTEX_MS + get_copied_bytes(*cmd) * SYNTHETIC_BYTE_MS;
+
+			// Counted into the open scopes which gather statistics, triangle lists assumed
+			for (const auto& open : open_scopes)
+			{
+				if (vertices == 0 || !open.has_value() || !m_frame_timings[*open].statistics.has_value())
+					continue;
+
+				auto& statistics = *m_frame_timings[*open].statistics;
+				statistics.ia_vertices += vertices;
+				statistics.ia_primitives += vertices / 3;
+				statistics.vs_invocations += vertices;
+			}
+
+			switch (cmd->type)
+			{
+			case RenderCommandBeginProfileScope::TYPE:
+			{
+				if (queue == QueueType::Copy)
+				{
+					open_scopes.push_back(std::nullopt);
+					break;
+				}
+
+				const auto& scope = *static_cast<RenderCommandBeginProfileScope*>(cmd.get());
+				GPUScopeTiming timing{};
+				timing.name = scope.name.data();
+				timing.queue = queue;
+				timing.depth = (u8)open_scopes.size();
+				timing.start_ms = clock_ms;
+				if (scope.pipeline_statistics && queue == QueueType::Graphics)
+					timing.statistics = PipelineStatistics{};
+
+				open_scopes.push_back(m_frame_timings.size());
+				m_frame_timings.push_back(std::move(timing));
+				break;
+			}
+			case RenderCommandEndProfileScope::TYPE:
+			{
+				assert(!open_scopes.empty());
+				if (open_scopes.back().has_value())
+				{
+					auto& timing = m_frame_timings[*open_scopes.back()];
+					timing.duration_ms = clock_ms - timing.start_ms;
+				}
+				open_scopes.pop_back();
+				break;
+			}
+			case RenderCommandCopyBuffer::TYPE:
+			{
+				execute(*static_cast<RenderCommandCopyBuffer*>(cmd.get()));
+				break;
+			}
+			case RenderCommandCopyBufferToImage::TYPE:
+			{
+				execute(*static_cast<RenderCommandCopyBufferToImage*>(cmd.get()));
+				break;
+			}
+			default:
+				break;
+			}
+
+			const u32 type = (u32)cmd->type;
+			assert(type < NUM_COMMAND_TYPES);
+			++m_stats.command_counts[type];
+			m_stats.command_ms[type] += elapsed_ms(start);
+		}
+
+		// Scopes have to be balanced within a list
+		assert(open_scopes.empty());
+	}
+
+	void RenderDevice_Null::execute(const RenderCommandCopyBuffer& cmd)
+	{
+		auto& src = try_get(m_buffers, get_slot(cmd.src.handle));
+		auto& dst = try_get(m_buffers, get_slot(cmd.dst.handle));
+		assert(cmd.src_offset + cmd.size <= src.desc.size);
+		assert(cmd.dst_offset + cmd.size <= dst.desc.size);
+
+		std::memmove(dst.memory() + cmd.dst_offset, src.memory() + cmd.src_offset, cmd.size);
+		m_stats.bytes_copied += cmd.size;
+	}
+
+	void RenderDevice_Null::execute(const RenderCommandCopyBufferToImage& cmd)
+	{
+		auto& src = try_get(m_buffers, get_slot(cmd.src.handle));
+		auto& dst = try_get(m_textures, get_slot(cmd.dst.handle));
+		assert(cmd.dst_subresource < dst.subresource_offsets.size());
+		assert(cmd.src_format == dst.desc.format);
+
+		const u32 texel_size = get_texel_size(dst.desc.format);
+		const u32 mip = cmd.dst_subresource % get_mip_count(dst.desc);
+		const u64 dst_rowpitch = (u64)std::max(dst.desc.width >> mip, 1u) * texel_size;
+		const u64 dst_slicepitch = dst_rowpitch * std::max(dst.desc.height >> mip, 1u);
+		const auto [x, y, z] = cmd.dst_topleft;
+
+		const u64 row_size = (u64)cmd.src_width * texel_size;
+		u8* dst_base = dst.memory() + dst.subresource_offsets[cmd.dst_subresource];
+		const u8* src_base = src.memory() + cmd.src_offset;
+		for (u32 slice = 0; slice < cmd.src_depth; ++slice)
+		{
+			for (u32 row = 0; row < cmd.src_height; ++row)
+			{
+				const u8* src_row = src_base + ((u64)slice * cmd.src_height + row) * cmd.src_rowpitch;
+				u8* dst_row = dst_base + (z + slice) * dst_slicepitch + (y + row) * dst_rowpitch + (u64)x * texel_size;
+				std::memcpy(dst_row, src_row, row_size);
+			}
+		}
+		m_stats.bytes_copied += row_size * cmd.src_height * cmd.src_depth;
+	}
+}
@@ -0,0 +1,229 @@
+#pragma once
+#include "../RenderDevice.h"
+#include "../../Handles/HandleAllocator.h"
+#include "../../Memory/IndexAllocator.h"
+#include "../../Memory/VirtualLinearRing.h"
+
+namespace mira
+{
+	class SwapChain_Null;
+
+	/*
+		Device without a GPU, for running and measuring the CPU side of the renderer (managers, recording, allocators, uploads) on any platform.
+
+		- Resources live in host memory: buffers can be mapped, placed resources point into the memory of their heap.
+		- Textures are stored tightly packed, subresource after subresource.
+		- Descriptors are plain indices, recycled on free through the same index allocator as D3D12 single descriptors.
+		- Submitted command lists execute on submission: copies are carried out on the CPU, everything else is only counted.
+		  Work is therefore complete once submitted, waits and flushes return immediately.
+		- Profiling scopes are timed on a synthetic clock per queue (fixed cost per command, vertex and copied byte),
+		  and are available once the frame has ended.
+	*/
+	class RenderDevice_Null final : public RenderDevice
+	{
+	public:
+		static constexpr u32 NUM_COMMAND_TYPES = (u32)RenderCommandType::EndProfileScope + 1;
+
+		struct Stats
+		{
+			// Indexed by RenderCommandType
+			std::array<u64, NUM_COMMAND_TYPES> command_counts{};
+			std::array<f64, NUM_COMMAND_TYPES> command_ms{};
+
+			u64 command_lists{ 0 };
+			u64 submissions{ 0 };
+			u64 bytes_copied{ 0 };
+
+			// Creations, e.g to tell whether transient resources are reused across frames
+			u64 heaps{ 0 };
+			u64 placed_resources{ 0 };
+
+			f64 compile_ms{ 0.0 };
+			f64 submit_ms{ 0.0 };
+		};
+
+	public:
+		// Swapchains have no window to take their size from
+		RenderDevice_Null(u32 swapchain_width = 1600, u32 swapchain_height = 900);
+		~RenderDevice_Null();
+
+		const Stats& get_stats() const { return m_stats; }
+		void reset_stats() { m_stats = Stats{}; }
+		void print_stats() const;
+
+		SwapChain* create_swapchain(void* hwnd, u8 num_buffers);
+
+		Buffer create_buffer(const BufferDesc& desc);
+		Texture create_texture(const TextureDesc& desc);
+		Pipeline create_graphics_pipeline(const GraphicsPipelineDesc& desc);
+		Pipeline create_graphics_pipeline_async(const GraphicsPipelineDesc& desc, Pipeline fallback = Pipeline{});
+		bool is_pipeline_ready(Pipeline handle) const;
+		RenderPass create_renderpass(const RenderPassDesc& desc);
+		BufferView create_view(Buffer buffer, const BufferViewDesc& desc);
+		TextureView create_view(Texture texture, const TextureViewDesc& desc);
+		u32 create_transient_view(Buffer buffer, const BufferViewDesc& desc);
+
+		Heap create_heap(const HeapDesc& desc);
+		Buffer create_placed_buffer(const BufferDesc& desc, Heap heap, u64 offset);
+		Texture create_placed_texture(const TextureDesc& desc, Heap heap, u64 offset);
+		MemoryRequirements get_memory_requirements(const BufferDesc& desc) const;
+		MemoryRequirements get_memory_requirements(const TextureDesc& desc) const;
+
+		void free_buffer(Buffer handle);
+		void free_texture(Texture handle);
+		void free_pipeline(Pipeline handle);
+		void free_renderpass(RenderPass handle);
+		void free_view(BufferView handle);
+		void free_view(TextureView handle);
+		void free_heap(Heap handle);
+		void recycle_command_list(CommandList handle);
+
+		CommandList allocate_command_list(QueueType queue = QueueType::Graphics);
+		void compile_command_list(CommandList handle, RenderCommandList list);
+		std::optional<SyncReceipt> submit_command_lists(
+			std::span<CommandList> lists,
+			QueueType queue = QueueType::Graphics,
+			std::optional<SyncReceipt> incoming_sync = std::nullopt,
+			bool generate_sync = false);
+		void insert_wait(QueueType queue, SyncReceipt receipt);
+
+		u32 get_global_descriptor(BufferView view) const;
+		u32 get_global_descriptor(TextureView view) const;
+
+		const BufferDesc& get_desc(Buffer buffer) const;
+		const TextureDesc& get_desc(Texture texture) const;
+
+		void wait_for_gpu(SyncReceipt receipt);
+		bool is_complete(SyncReceipt receipt) const;
+		void flush();
+		void begin_frame(u8 max_frames_in_flight);
+		void end_frame();
+		u64 get_current_frame() const;
+		u64 get_num_completed_frames() const;
+
+		u8* map(Buffer handle, u32 subresource = 0, std::pair<u32, u32> read_range = { 0, 0 });
+		void unmap(Buffer handle, u32 subresource = 0, std::pair<u32, u32> written_range = { 0, 0 });
+
+		const GPUFrameTimings& get_gpu_timings() const;
+
+	private:
+		// Placement alignment of resources in heaps, as on D3D12
+		static constexpr u64 RESOURCE_ALIGNMENT = 64ull * 1024;
+		static constexpr u32 MAX_DESCRIPTORS = 100'000;
+		static constexpr u32 NUM_TRANSIENT_DESCRIPTORS = 16'384;
+
+		struct Buffer_Storage
+		{
+			BufferDesc desc;
+			std::vector<u8> owned;
+			u8* placed{ nullptr };			// Memory in a heap, for placed buffers
+
+			u8* memory() { return placed ? placed : owned.data(); }
+		};
+
+		struct Texture_Storage
+		{
+			TextureDesc desc;
+			std::vector<u8> owned;
+			u8* placed{ nullptr };			// Memory in a heap, for placed textures
+
+			u8* memory() { return placed ? placed : owned.data(); }
+
+			// Tightly packed subresources
+			std::vector<u64> subresource_offsets;
+		};
+
+		struct Heap_Storage
+		{
+			HeapDesc desc;
+			std::vector<u8> memory;
+		};
+
+		struct Pipeline_Storage
+		{
+			GraphicsPipelineDesc desc;
+
+			// Identical descriptions share a handle, as on other backends
+			u64 hash{ 0 };
+			u32 ref_count{ 1 };
+		};
+
+		struct BufferView_Storage
+		{
+			Buffer buffer;
+			BufferViewDesc desc;
+			u32 descriptor{ 0 };
+
+			// Identical views of a resource share a handle, as on other backends
+			u64 hash{ 0 };
+			u32 ref_count{ 1 };
+		};
+
+		struct TextureView_Storage
+		{
+			Texture texture;
+			TextureViewDesc desc;
+			u32 descriptor{ 0 };
+
+			// Identical views of a resource share a handle, as on other backends
+			u64 hash{ 0 };
+			u32 ref_count{ 1 };
+		};
+
+		struct CommandList_Storage
+		{
+			QueueType queue{ QueueType::Graphics };
+			RenderCommandList list;
+			bool is_compiled{ false };
+		};
+
+	private:
+		u32 allocate_descriptor();
+		void free_descriptor(u32 descriptor);
+
+		// Size of the texture in memory, with the offset of each subresource
+		u64 get_texture_layout(const TextureDesc& desc, std::vector<u64>* subresource_offsets) const;
+		Texture insert_texture(const TextureDesc& desc, Heap heap, u64 offset);
+
+		void execute(const RenderCommandList& list, QueueType queue);
+		void execute(const RenderCommandCopyBuffer& cmd);
+		void execute(const RenderCommandCopyBufferToImage& cmd);
+
+	private:
+		HandleAllocator m_rhp;
+
+		std::vector<std::optional<Buffer_Storage>> m_buffers;
+		std::vector<std::optional<Texture_Storage>> m_textures;
+		std::vector<std::optional<Heap_Storage>> m_heaps;
+		std::vector<std::optional<BufferView_Storage>> m_buffer_views;
+		std::vector<std::optional<TextureView_Storage>> m_texture_views;
+		std::vector<std::optional<Pipeline_Storage>> m_pipelines;
+		std::vector<std::optional<RenderPassDesc>> m_renderpasses;
+		std::vector<std::optional<CommandList_Storage>> m_command_lists;
+
+		std::unordered_map<u64, Pipeline> m_pipeline_lookup;
+		// Keyed on the hash of resource and description, colliding views are told apart by their storage
+		std::unordered_multimap<u64, BufferView> m_buffer_view_lookup;
+		std::unordered_multimap<u64, TextureView> m_texture_view_lookup;
+
+		// Descriptor indices offset by one, 0 is reserved like an unused handle
+		IndexAllocator m_descriptors{ MAX_DESCRIPTORS };
+
+		// Transient view descriptors follow the regular ones
+		VirtualLinearRing m_transient_ring{ NUM_TRANSIENT_DESCRIPTORS };
+
+		u64 m_submissions{ 0 };		// Doubles as the timeline of every queue, receipts are complete once handed out
+		u64 m_frames{ 0 };
+		Stats m_stats;
+
+		// Synthetic GPU time of each queue (graphics, compute, copy), on the steady_clock timeline
+		std::array<f64, 3> m_queue_clocks_ms{};
+		std::vector<GPUScopeTiming> m_frame_timings;
+		GPUFrameTimings m_gpu_timings;
+
+		u32 m_swapchain_width{ 0 };
+		u32 m_swapchain_height{ 0 };
+
+		std::unique_ptr<SwapChain_Null> m_swapchain;
+	};
+}
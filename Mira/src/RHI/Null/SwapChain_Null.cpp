@@ -0,0 +1,51 @@
+#include "SwapChain_Null.h"
+#include "RenderDevice_Null.h"
+
+namespace mira
+{
+	SwapChain_Null::SwapChain_Null(RenderDevice_Null* device, u8 num_buffers, u32 width, u32 height) :
+		m_device(device)
+	{
+		assert(num_buffers >= 2);
+
+		TextureDesc desc{};
+		desc.width = width;
+		desc.height = height;
+		desc.mip_levels = 1;
+		desc.format = ResourceFormat::RGBA_8_UNORM;
+		desc.usage = UsageIntent::RenderTarget;
+
+		for (u32 i = 0; i < num_buffers; ++i)
+			m_buffers.push_back(m_device->create_texture(desc));
+	}
+
+	SwapChain_Null::~SwapChain_Null()
+	{
+		for (auto bb : m_buffers)
+			m_device->free_texture(bb);
+	}
+
+	Texture SwapChain_Null::get_next_draw_surface()
+	{
+		return m_buffers[m_curr_buffer];
+	}
+
+	u8 SwapChain_Null::get_next_draw_surface_idx()
+	{
+		return m_curr_buffer;
+	}
+
+	void SwapChain_Null::set_clear_color([[maybe_unused]] const std::array<float, 4>& clear_color)
+	{
+	}
+
+	Texture SwapChain_Null::get_buffer(u8 idx)
+	{
+		return m_buffers[idx];
+	}
+
+	void SwapChain_Null::present([[maybe_unused]] bool vsync)
+	{
+		m_curr_buffer = (m_curr_buffer + 1) % (u8)m_buffers.size();
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "../SwapChain.h"
+
+namespace mira
+{
+	class RenderDevice_Null;
+
+	// Render targets in host memory, presenting only cycles through them
+	class SwapChain_Null : public SwapChain
+	{
+	public:
+		SwapChain_Null(RenderDevice_Null* device, u8 num_buffers, u32 width, u32 height);
+		~SwapChain_Null();
+
+		// Public interface
+		Texture get_next_draw_surface();
+		u8 get_next_draw_surface_idx();
+		void set_clear_color(const std::array<float, 4>& clear_color);
+
+		Texture get_buffer(u8 idx);
+
+		void present(bool vsync);
+
+	private:
+		RenderDevice_Null* m_device{ nullptr };
+		std::vector<Texture> m_buffers;
+		u8 m_curr_buffer{ 0 };
+	};
+}
@@ -8,6 +8,7 @@
 #include "Types/BarrierTypes.h"
 #include "Types/RenderPassTypes.h"
 #include "Types/ViewTypes.h"
+#include <string>
 
 namespace mira
 {
@@ -19,6 +20,50 @@ namespace mira
 		None
 	};
 
+	// Point on a queue's timeline, complete once the queue has executed everything submitted before it.
+	// Plain value, nothing to free or recycle.
+	struct SyncReceipt
+	{
+		QueueType queue{ QueueType::None };
+		u64 value{ 0 };
+	};
+
+	// Counters gathered over a profiling scope (D3D12_QUERY_DATA_PIPELINE_STATISTICS layout)
+	struct PipelineStatistics
+	{
+		u64 ia_vertices{ 0 };
+		u64 ia_primitives{ 0 };
+		u64 vs_invocations{ 0 };
+		u64 gs_invocations{ 0 };
+		u64 gs_primitives{ 0 };
+		u64 c_invocations{ 0 };
+		u64 c_primitives{ 0 };
+		u64 ps_invocations{ 0 };
+		u64 hs_invocations{ 0 };
+		u64 ds_invocations{ 0 };
+		u64 cs_invocations{ 0 };
+	};
+
+	struct GPUScopeTiming
+	{
+		std::string name;
+		QueueType queue{ QueueType::Graphics };
+		u8 depth{ 0 };						// Nesting within the command list, children follow their parent
+
+		// On the std::chrono::steady_clock timeline, so GPU scopes line up with CPU ones
+		f64 start_ms{ 0.0 };
+		f64 duration_ms{ 0.0 };
+
+		std::optional<PipelineStatistics> statistics;
+	};
+
+	// Resolved profiling scopes of a frame, in submission order
+	struct GPUFrameTimings
+	{
+		u64 frame{ 0 };
+		std::vector<GPUScopeTiming> scopes;
+	};
+
 
 
 }
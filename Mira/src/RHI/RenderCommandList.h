@@ -1,6 +1,8 @@
 #pragma once
 #include "RHITypes.h"
 #include <span>
+#include <string_view>
+#include <algorithm>
 
 #include <iostream>
 
@@ -12,6 +14,7 @@ namespace mira
 
 		Draw,
 		DrawIndexed,
+		DrawIndexedIndirect,
 		SetPipeline,
 		BeginRenderPass,
 		EndRenderPass,
@@ -19,7 +22,10 @@ namespace mira
 		UpdateShaderArgs,
 
 		CopyBuffer,
-		CopyBufferToImage
+		CopyBufferToImage,
+
+		BeginProfileScope,
+		EndProfileScope
 	};
 
 	struct RenderCommand
@@ -91,6 +97,50 @@ namespace mira
 			instance_start(instance_start_in) {}
 	};
 
+	/*
+		Layout of a single element in the argument buffer of RenderCommandDrawIndexedIndirect.
+
+		The draw ID is always part of the layout, but it is only consumed if the command specifies a shader argument slot for it.
+		This keeps a single argument layout regardless of whether the draw ID is used or not.
+	*/
+	struct DrawIndexedIndirectArguments
+	{
+		u32 draw_id{ 0 };
+
+		u32 indices_per_instance{ 0 };
+		u32 instance_count{ 0 };
+		u32 index_start{ 0 };
+		i32 vertex_start{ 0 };
+		u32 instance_start{ 0 };
+	};
+
+	struct RenderCommandDrawIndexedIndirect : public RenderCommandTyped<RenderCommandType::DrawIndexedIndirect>
+	{
+		Buffer index_buffer;
+
+		// Tightly packed DrawIndexedIndirectArguments
+		Buffer argument_buffer;
+		u64 argument_offset{ 0 };
+		u32 max_draws{ 0 };
+
+		// Optional GPU-side draw count (single u32), which is clamped by max_draws
+		std::optional<Buffer> count_buffer;
+		u64 count_offset{ 0 };
+
+		// Shader argument slot which receives DrawIndexedIndirectArguments::draw_id for each draw
+		std::optional<u8> draw_id_slot;
+
+		RenderCommandDrawIndexedIndirect() = default;
+		RenderCommandDrawIndexedIndirect(Buffer index_buffer_in, Buffer argument_buffer_in, u64 argument_offset_in, u32 max_draws_in) :
+			index_buffer(index_buffer_in),
+			argument_buffer(argument_buffer_in),
+			argument_offset(argument_offset_in),
+			max_draws(max_draws_in) {}
+
+		RenderCommandDrawIndexedIndirect& set_count_buffer(Buffer buffer, u64 offset) { count_buffer = buffer; count_offset = offset; return *this; }
+		RenderCommandDrawIndexedIndirect& set_draw_id_slot(u8 slot) { draw_id_slot = slot; return *this; }
+	};
+
 	struct RenderCommandSetPipeline : public RenderCommandTyped<RenderCommandType::SetPipeline>
 	{
 		Pipeline pipeline;
@@ -167,6 +217,34 @@ namespace mira
 		RenderCommandUpdateShaderArgs& append_constant(u32 constant) { constants[num_constants++] = constant; assert(num_constants < 10); return *this; }
 	};
 
+	/*
+		GPU timing of the commands up to the matching EndProfileScope, scopes nest and must be balanced within a command list.
+		Results are read back a few frames later, see RenderDevice::get_gpu_timings. Lists with scopes have to be submitted in the frame they are compiled in.
+		Scopes on the copy queue are ignored.
+	*/
+	struct RenderCommandBeginProfileScope : public RenderCommandTyped<RenderCommandType::BeginProfileScope>
+	{
+		// Fixed size so that the command stays trivially copyable, longer names are truncated
+		static constexpr u32 MAX_NAME_LENGTH = 47;
+		std::array<char, MAX_NAME_LENGTH + 1> name{};
+
+		// Additionally count the work of the pipeline stages over the scope
+		bool pipeline_statistics{ false };
+
+		RenderCommandBeginProfileScope() = default;
+		RenderCommandBeginProfileScope(std::string_view name_in, bool pipeline_statistics_in = false) :
+			pipeline_statistics(pipeline_statistics_in)
+		{
+			const size_t length = std::min<size_t>(name_in.size(), MAX_NAME_LENGTH);
+			std::memcpy(name.data(), name_in.data(), length);
+		}
+	};
+
+	struct RenderCommandEndProfileScope : public RenderCommandTyped<RenderCommandType::EndProfileScope>
+	{
+		u8 nothing;
+	};
+
 
 	struct RenderCommandList
 	{
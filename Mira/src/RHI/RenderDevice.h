@@ -15,9 +15,39 @@ namespace mira
 		virtual Texture create_texture(const TextureDesc& desc) = 0;
 		virtual Pipeline create_graphics_pipeline(const GraphicsPipelineDesc& desc) = 0;
 		virtual RenderPass create_renderpass(const RenderPassDesc& desc) = 0;
+
+		// Identical views of the same resource share a handle (and descriptor), each create_view has to be matched by a free_view
 		virtual BufferView create_view(Buffer buffer, const BufferViewDesc& desc) = 0;
 		virtual TextureView create_view(Texture texture, const TextureViewDesc& desc) = 0;
 
+		// Returns immediately and compiles in the background. Until the pipeline is ready, command lists compiled with it
+		// bind 'fallback' instead, or wait for the compilation to finish if there is none. The fallback has to outlive the pipeline.
+		virtual Pipeline create_graphics_pipeline_async(const GraphicsPipelineDesc& desc, Pipeline fallback = Pipeline{}) = 0;
+		virtual bool is_pipeline_ready(Pipeline handle) const = 0;
+
+		// Warms pipelines in the background (e.g during a loading screen), readiness of the returned handles tracks the progress
+		std::vector<Pipeline> precompile_pipelines(std::span<const GraphicsPipelineDesc> descs)
+		{
+			std::vector<Pipeline> pipelines;
+			pipelines.reserve(descs.size());
+			for (const auto& desc : descs)
+				pipelines.push_back(create_graphics_pipeline_async(desc));
+			return pipelines;
+		}
+
+		// Placed resources share the memory of a heap and may alias each other, in which case an aliasing barrier is required before use.
+		// Placed resources are freed through free_buffer/free_texture and must be freed before their heap.
+		virtual Heap create_heap(const HeapDesc& desc) = 0;
+		virtual Buffer create_placed_buffer(const BufferDesc& desc, Heap heap, u64 offset) = 0;
+		virtual Texture create_placed_texture(const TextureDesc& desc, Heap heap, u64 offset) = 0;
+		virtual MemoryRequirements get_memory_requirements(const BufferDesc& desc) const = 0;
+		virtual MemoryRequirements get_memory_requirements(const TextureDesc& desc) const = 0;
+
+		// View which is only valid until the GPU has finished the current frame, returns its global descriptor.
+		// Transient views are allocated linearly from a ring reserved for them and are never freed individually,
+		// the views of a frame are reclaimed together once the GPU is done with it.
+		virtual u32 create_transient_view(Buffer buffer, const BufferViewDesc& desc) = 0;
+
 		// Users determines when it is appropriate to free the resources (they may be in flight!)
 		virtual void free_buffer(Buffer handle) = 0;
 		virtual void free_texture(Texture handle) = 0;
@@ -25,7 +55,7 @@ namespace mira
 		virtual void free_renderpass(RenderPass handle) = 0;
 		virtual void free_view(BufferView handle) = 0;
 		virtual void free_view(TextureView handle) = 0;
-		virtual void recycle_sync(SyncReceipt receipt) = 0;
+		virtual void free_heap(Heap handle) = 0;
 		virtual void recycle_command_list(CommandList handle) = 0;
 
 		/*
@@ -51,22 +81,44 @@ namespace mira
 			std::optional<SyncReceipt> incoming_sync = std::nullopt,				// Synchronize with prior to command list execution
 			bool generate_sync = false) = 0;										// Generate sync after command list execution
 
+		// GPU side wait, work submitted to 'queue' afterwards only starts once the sync has been signaled
+		virtual void insert_wait(QueueType queue, SyncReceipt receipt) = 0;
+
 
 		// Grab GPU-accessible resource handle
 		virtual u32 get_global_descriptor(BufferView view) const = 0;
 		virtual u32 get_global_descriptor(TextureView view) const = 0;
 
-		// CPU side wait, automatically recycles the receipt (recycles sync)
+		// Grab the description the resource was created with
+		virtual const BufferDesc& get_desc(Buffer buffer) const = 0;
+		virtual const TextureDesc& get_desc(Texture texture) const = 0;
+
+		// CPU side wait, spins briefly before blocking
 		virtual void wait_for_gpu(SyncReceipt receipt) = 0;
 
+		// Non-blocking completion query
+		virtual bool is_complete(SyncReceipt receipt) const = 0;
+
 		virtual void flush() = 0;
 
+		// Frame pacing: blocks until fewer than 'max_frames_in_flight' frames are still executing on the GPU,
+		// so the CPU records the next frame while the GPU works on the previous ones instead of waiting for it to go idle.
+		virtual void begin_frame(u8 max_frames_in_flight) = 0;
+
+		// Marks the end of the work submitted for a frame (on all queues), once it completes the frame's transient views are reclaimed
+		virtual void end_frame() = 0;
+
+		// Frames are numbered by end_frame calls, the frame being recorded is get_current_frame().
+		// Frames complete in order, those below get_num_completed_frames() have finished on every queue.
+		virtual u64 get_current_frame() const = 0;
+		virtual u64 get_num_completed_frames() const = 0;
+
 		virtual u8* map(Buffer handle, u32 subresource = 0, std::pair<u32, u32> read_range = { 0, 0 }) = 0;
 		virtual void unmap(Buffer handle, u32 subresource = 0, std::pair<u32, u32> written_range = { 0, 0 }) = 0;
 
-		/*
-			Get Timestamp Frequency( queuetype )
-		*/
+		// Profiling scopes (RenderCommandBeginProfileScope) of the latest frame which has completed and been read back,
+		// which lags a few frames behind. A new frame number means new timings.
+		virtual const GPUFrameTimings& get_gpu_timings() const = 0;
 
 
 
@@ -10,8 +10,8 @@ namespace mira
 	struct Texture  { friend TypedHandlePool; u64 handle{ 0 }; };
 	struct Pipeline { friend TypedHandlePool; u64 handle{ 0 }; };
 	struct RenderPass { friend TypedHandlePool; u64 handle{ 0 }; };
+	struct Heap { friend TypedHandlePool; u64 handle{ 0 }; };
 
-	struct SyncReceipt { friend TypedHandlePool; u64 handle{ 0 }; };
 	struct BufferView { friend TypedHandlePool; u64 handle{ 0 }; };
 	struct TextureView { friend TypedHandlePool; u64 handle{ 0 }; };
 
@@ -15,6 +15,11 @@ namespace mira
 			ShaderType type,
 			const std::string& entry_point = "main") = 0;
 
+		virtual std::shared_ptr<CompiledShader> compile(const ShaderCompileRequest& request) = 0;
+
+		// Compiles the requests in parallel, results are in request order
+		virtual std::vector<ShaderCompileResult> compile_batch(std::span<const ShaderCompileRequest> requests) = 0;
+
 		virtual ~ShaderCompiler() {}
 	};
 	
@@ -0,0 +1,264 @@
+#include "ShaderCache.h"
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mira
+{
+	namespace
+	{
+		// Bounds-checked reads from the mapping
+		class MappingReader
+		{
+		public:
+			MappingReader(const u8* data, u64 size) : m_data(data), m_size(size) {}
+
+			template <typename T>
+			bool read(T& value)
+			{
+				if (m_offset + sizeof(T) > m_size)
+					return false;
+				std::memcpy(&value, m_data + m_offset, sizeof(T));
+				m_offset += sizeof(T);
+				return true;
+			}
+
+			bool read_span(u64 size, std::span<const u8>& span)
+			{
+				if (m_offset + size > m_size)
+					return false;
+				span = std::span<const u8>(m_data + m_offset, size);
+				m_offset += size;
+				return true;
+			}
+
+			bool at_end() const { return m_offset == m_size; }
+
+		private:
+			const u8* m_data{ nullptr };
+			u64 m_size{ 0 };
+			u64 m_offset{ 0 };
+		};
+
+		template <typename T>
+		void write_value(std::ofstream& file, const T& value)
+		{
+			file.write((const char*)&value, sizeof(T));
+		}
+	}
+
+	ShaderCache::ShaderCache(const std::filesystem::path& path) :
+		m_path(path)
+	{
+		map_file();
+		if (m_mapped && !parse_mapping())
+		{
+			std::cout << "ShaderCache: discarding " << path << "\n";
+			m_entries.clear();
+			unmap_file();
+		}
+	}
+
+	ShaderCache::~ShaderCache()
+	{
+		// Entries may point into the mapping, which has to stay alive until they have been written
+		if (m_dirty)
+		{
+			write_file();
+			m_entries.clear();
+			unmap_file();
+
+			std::error_code ec;
+			std::filesystem::rename(std::filesystem::path(m_path).concat(".tmp"), m_path, ec);
+			if (ec)
+				std::cout << "ShaderCache: failed to write " << m_path << " (" << ec.message() << ")\n";
+		}
+
+		unmap_file();
+	}
+
+	std::optional<std::vector<u8>> ShaderCache::find(u64 key)
+	{
+		std::lock_guard lock(m_mutex);
+
+		auto it = m_entries.find(key);
+		if (it == m_entries.end())
+		{
+			++m_misses;
+			return {};
+		}
+
+		for (const auto& dependency : it->second.dependencies)
+		{
+			// Changed since the shader was compiled
+			if (get_file_hash(dependency.path) != dependency.content_hash)
+			{
+				++m_misses;
+				return {};
+			}
+		}
+
+		++m_hits;
+		const auto& bytecode = it->second.bytecode;
+		return std::vector<u8>(bytecode.begin(), bytecode.end());
+	}
+
+	void ShaderCache::store(u64 key, std::vector<Dependency> dependencies, std::span<const u8> bytecode)
+	{
+		std::lock_guard lock(m_mutex);
+
+		Entry entry{};
+		entry.dependencies = std::move(dependencies);
+		entry.owned.assign(bytecode.begin(), bytecode.end());
+		entry.bytecode = entry.owned;
+
+		// Dependencies were just read by the compiler
+		for (const auto& dependency : entry.dependencies)
+			m_file_hashes[dependency.path] = dependency.content_hash;
+
+		m_entries.insert_or_assign(key, std::move(entry));
+		m_dirty = true;
+	}
+
+	u64 ShaderCache::get_file_hash(const std::string& path)
+	{
+		if (auto it = m_file_hashes.find(path); it != m_file_hashes.end())
+			return it->second;
+
+		u64 hash = 0;
+		std::ifstream file(path, std::ios::binary);
+		if (file)
+		{
+			std::vector<u8> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			hash = hash_bytes(contents.data(), contents.size());
+		}
+
+		m_file_hashes.insert({ path, hash });
+		return hash;
+	}
+
+	void ShaderCache::map_file()
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileW(m_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return;
+
+		LARGE_INTEGER size{};
+		if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+		{
+			// The view keeps the mapping alive once the handles are closed
+			HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping)
+			{
+				m_mapped = (const u8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				m_mapped_size = m_mapped ? (u64)size.QuadPart : 0;
+				CloseHandle(mapping);
+			}
+		}
+		CloseHandle(file);
+#else
+		const int fd = open(m_path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return;
+
+		struct stat st {};
+		if (fstat(fd, &st) == 0 && st.st_size > 0)
+		{
+			void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED)
+			{
+				m_mapped = (const u8*)data;
+				m_mapped_size = (u64)st.st_size;
+			}
+		}
+		close(fd);
+#endif
+	}
+
+	void ShaderCache::unmap_file()
+	{
+		if (!m_mapped)
+			return;
+
+#ifdef _WIN32
+		UnmapViewOfFile(m_mapped);
+#else
+		munmap((void*)m_mapped, m_mapped_size);
+#endif
+		m_mapped = nullptr;
+		m_mapped_size = 0;
+	}
+
+	bool ShaderCache::parse_mapping()
+	{
+		/*
+			Layout:
+				u32 magic, u32 version
+				Entries until the end of the file:
+					u64 key, u32 num_dependencies, u32 bytecode_size
+					Dependencies: u64 content_hash, u32 path_length, path
+					Bytecode
+		*/
+		MappingReader reader(m_mapped, m_mapped_size);
+
+		u32 magic = 0, version = 0;
+		if (!reader.read(magic) || !reader.read(version) || magic != MAGIC || version != VERSION)
+			return false;
+
+		while (!reader.at_end())
+		{
+			u64 key = 0;
+			u32 num_dependencies = 0, bytecode_size = 0;
+			if (!reader.read(key) || !reader.read(num_dependencies) || !reader.read(bytecode_size))
+				return false;
+
+			Entry entry{};
+			entry.dependencies.resize(num_dependencies);
+			for (auto& dependency : entry.dependencies)
+			{
+				u32 path_length = 0;
+				std::span<const u8> path;
+				if (!reader.read(dependency.content_hash) || !reader.read(path_length) || !reader.read_span(path_length, path))
+					return false;
+				dependency.path.assign((const char*)path.data(), path.size());
+			}
+
+			if (!reader.read_span(bytecode_size, entry.bytecode))
+				return false;
+
+			m_entries.insert_or_assign(key, std::move(entry));
+		}
+		return true;
+	}
+
+	void ShaderCache::write_file() const
+	{
+		std::ofstream file(std::filesystem::path(m_path).concat(".tmp"), std::ios::binary | std::ios::trunc);
+		write_value(file, MAGIC);
+		write_value(file, VERSION);
+
+		for (const auto& [key, entry] : m_entries)
+		{
+			write_value(file, key);
+			write_value(file, (u32)entry.dependencies.size());
+			write_value(file, (u32)entry.bytecode.size());
+			for (const auto& dependency : entry.dependencies)
+			{
+				write_value(file, dependency.content_hash);
+				write_value(file, (u32)dependency.path.size());
+				file.write(dependency.path.data(), dependency.path.size());
+			}
+			file.write((const char*)entry.bytecode.data(), entry.bytecode.size());
+		}
+	}
+}
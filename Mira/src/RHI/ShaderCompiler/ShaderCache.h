@@ -0,0 +1,76 @@
+#pragma once
+#include "../../Common.h"
+#include <string>
+#include <mutex>
+
+namespace mira
+{
+	/*
+		On-disk cache of compiled shaders, keyed by a hash of what the shader was compiled with (compiler version, path, entry point, profile, arguments).
+
+		- Each entry records the files it was compiled from (source and every transitively included file) with a hash of their contents.
+		  An entry is only used if all of them are unchanged, otherwise it is recompiled and replaced.
+		- The cache file is memory-mapped on construction, cached shaders are read straight from the mapping.
+		- The file is rewritten on destruction if anything was added. A file which fails to parse is discarded.
+		- Safe to use from multiple threads.
+	*/
+	class ShaderCache
+	{
+	public:
+		struct Dependency
+		{
+			std::string path;
+			u64 content_hash{ 0 };
+		};
+
+	public:
+		ShaderCache(const std::filesystem::path& path);
+		~ShaderCache();
+
+		ShaderCache(const ShaderCache&) = delete;
+		ShaderCache& operator=(const ShaderCache&) = delete;
+
+		// Bytecode for 'key' if all of its dependencies are unchanged on disk
+		std::optional<std::vector<u8>> find(u64 key);
+
+		void store(u64 key, std::vector<Dependency> dependencies, std::span<const u8> bytecode);
+
+		u32 get_num_hits() const { return m_hits; }
+		u32 get_num_misses() const { return m_misses; }
+
+	private:
+		static constexpr u32 MAGIC = 0x4348534D;		// "MSHC"
+		static constexpr u32 VERSION = 1;
+
+		struct Entry
+		{
+			std::vector<Dependency> dependencies;
+			std::span<const u8> bytecode;				// Into the mapping or 'owned'
+			std::vector<u8> owned;
+		};
+
+	private:
+		// Hash of the current contents of a file, zero if it cannot be read. Remembered for the rest of the run.
+		u64 get_file_hash(const std::string& path);
+
+		void map_file();
+		void unmap_file();
+		bool parse_mapping();
+		void write_file() const;
+
+	private:
+		std::filesystem::path m_path;
+
+		const u8* m_mapped{ nullptr };
+		u64 m_mapped_size{ 0 };
+
+		std::unordered_map<u64, Entry> m_entries;
+		std::unordered_map<std::string, u64> m_file_hashes;
+		bool m_dirty{ false };
+
+		u32 m_hits{ 0 };
+		u32 m_misses{ 0 };
+
+		std::mutex m_mutex;
+	};
+}
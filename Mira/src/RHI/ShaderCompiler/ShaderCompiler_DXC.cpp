@@ -1,66 +1,245 @@
 #include "ShaderCompiler_DXC.h"
+#include "ShaderCache.h"
+#include <objbase.h>
 #include <dxcapi.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
 
 template <typename T>
 using ComPtr = Microsoft::WRL::ComPtr<T>;
 
 namespace mira
 {
-	ShaderCompiler_DXC::ShaderCompiler_DXC(ShaderModel model) :
-		m_shader_model(model)
+	namespace
+	{
+		// Forwards to the default handler, recording every file included (transitively) during a compilation
+		class TrackingIncludeHandler final : public IDxcIncludeHandler
+		{
+		public:
+			TrackingIncludeHandler(IDxcIncludeHandler* inner) : m_inner(inner) {}
+
+			HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR filename, IDxcBlob** include_source) override
+			{
+				HRESULT hr = m_inner->LoadSource(filename, include_source);
+				if (SUCCEEDED(hr) && *include_source)
+				{
+					IDxcBlob* blob = *include_source;
+					m_dependencies.push_back({ std::filesystem::path(filename).string(), hash_bytes(blob->GetBufferPointer(), blob->GetBufferSize()) });
+				}
+				return hr;
+			}
+
+			HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+			{
+				if (riid == __uuidof(IDxcIncludeHandler) || riid == __uuidof(IUnknown))
+				{
+					*object = this;
+					return S_OK;
+				}
+				*object = nullptr;
+				return E_NOINTERFACE;
+			}
+
+			// Lives on the stack for the duration of a compilation
+			ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+			ULONG STDMETHODCALLTYPE Release() override { return 1; }
+
+			std::vector<ShaderCache::Dependency>& get_dependencies() { return m_dependencies; }
+
+		private:
+			IDxcIncludeHandler* m_inner{ nullptr };
+			std::vector<ShaderCache::Dependency> m_dependencies;
+		};
+
+		u64 hash_string(const void* data, size_t size, u64 seed)
+		{
+			// Length first, so that adjacent strings cannot shift into each other
+			return hash_bytes(data, size, hash_combine(seed, (u64)size));
+		}
+	}
+
+	ShaderCompiler_DXC::ShaderCompiler_DXC(ThreadPool& workers, ShaderModel model, const std::filesystem::path& cache_path) :
+		m_shader_model(model),
+		m_workers(workers)
+	{
+		m_context = create_context();
+		m_compiler_version = query_compiler_version();
+
+		for (u32 i = 0; i < m_workers.get_num_threads(); ++i)
+		{
+			m_worker_contexts.push_back(create_context());
+			m_free_worker_contexts.push_back(i);
+		}
+
+		if (!cache_path.empty())
+			m_cache = std::make_unique<ShaderCache>(cache_path);
+	}
+
+	ShaderCompiler_DXC::~ShaderCompiler_DXC()
+	{
+	}
+
+	std::shared_ptr<CompiledShader> mira::ShaderCompiler_DXC::compile_from_file(std::filesystem::path rel_path, ShaderType type, const std::string& entry_point)
+	{
+		ShaderCompileRequest request{};
+		request.rel_path = rel_path;
+		request.type = type;
+		request.entry_point = entry_point;
+		return compile(request);
+	}
+
+	std::shared_ptr<CompiledShader> ShaderCompiler_DXC::compile(const ShaderCompileRequest& request)
+	{
+		auto result = compile(m_context, request);
+		if (!result.shader)
+			throw std::runtime_error("Failed to compile " + request.rel_path.string());
+		return result.shader;
+	}
+
+	std::vector<ShaderCompileResult> ShaderCompiler_DXC::compile_batch(std::span<const ShaderCompileRequest> requests)
+	{
+		std::vector<ShaderCompileResult> results(requests.size());
+		const u32 num_workers = std::min(m_workers.get_num_threads(), (u32)requests.size());
+
+		// Per call, so that concurrent batches only wait for their own jobs
+		ThreadPool::JobGroup jobs;
+
+		// Workers pull the next request until there are none left
+		std::atomic<u32> next{ 0 };
+		for (u32 w = 0; w < num_workers; ++w)
+		{
+			m_workers.submit(jobs, [this, &next, &requests, &results]()
+				{
+					const u32 context = acquire_worker_context();
+					for (u32 i = next++; i < requests.size(); i = next++)
+						results[i] = compile(m_worker_contexts[context], requests[i]);
+					release_worker_context(context);
+				});
+		}
+		m_workers.wait(jobs);
+
+		return results;
+	}
+
+	u32 ShaderCompiler_DXC::acquire_worker_context()
+	{
+		std::lock_guard lock(m_worker_contexts_mutex);
+		assert(!m_free_worker_contexts.empty());
+		const u32 index = m_free_worker_contexts.back();
+		m_free_worker_contexts.pop_back();
+		return index;
+	}
+
+	void ShaderCompiler_DXC::release_worker_context(u32 index)
+	{
+		std::lock_guard lock(m_worker_contexts_mutex);
+		m_free_worker_contexts.push_back(index);
+	}
+
+	ShaderCompiler_DXC::Context ShaderCompiler_DXC::create_context() const
 	{
 		// Grab interfaces
+		Context context{};
 		HRESULT hr = S_OK;
 
-		hr = DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&m_library));
-		if (FAILED(hr))
-			throw std::runtime_error("Failed to intiialize IDxcLibrary");
-
-		hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&m_compiler));
+		hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&context.compiler));
 		if (FAILED(hr))
-			throw std::runtime_error("Failed to initialize IDxcCompiler");
+			throw std::runtime_error("Failed to initialize IDxcCompiler3");
 
-		hr = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&m_utils));
+		hr = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&context.utils));
 		if (FAILED(hr))
 			throw std::runtime_error("Failed to initialize IDxcUtils");
 
 		// Grab default include handler
-		m_utils->CreateDefaultIncludeHandler(m_def_inc_hdlr.GetAddressOf());
+		context.utils->CreateDefaultIncludeHandler(context.def_inc_hdlr.GetAddressOf());
+		return context;
 	}
 
-	ShaderCompiler_DXC::~ShaderCompiler_DXC()
+	u64 ShaderCompiler_DXC::query_compiler_version() const
 	{
+		ComPtr<IDxcVersionInfo> info;
+		if (FAILED(m_context.compiler.As(&info)))
+			return 0;
+
+		UINT32 major = 0, minor = 0, flags = 0;
+		info->GetVersion(&major, &minor);
+		info->GetFlags(&flags);
+		u64 version = hash_combine(hash_combine(hash_combine(hash_bytes(nullptr, 0), major), minor), flags);
+
+		// Builds of the same release differ by commit
+		ComPtr<IDxcVersionInfo2> info2;
+		UINT32 commit_count = 0;
+		char* commit_hash = nullptr;
+		if (SUCCEEDED(info.As(&info2)) && SUCCEEDED(info2->GetCommitInfo(&commit_count, &commit_hash)))
+		{
+			version = hash_combine(version, commit_count);
+			version = hash_string(commit_hash, std::strlen(commit_hash), version);
+			CoTaskMemFree(commit_hash);
+		}
+		return version;
 	}
 
-	std::shared_ptr<CompiledShader> mira::ShaderCompiler_DXC::compile_from_file(std::filesystem::path rel_path, ShaderType type, const std::string& entry_point)
+	ShaderCompileResult ShaderCompiler_DXC::compile(Context& context, const ShaderCompileRequest& request)
 	{
-		std::wstring entry_wstr = std::filesystem::path(entry_point).wstring();
+		const auto start = std::chrono::high_resolution_clock::now();
+		auto elapsed_ms = [start]() { return std::chrono::duration<f64, std::milli>(std::chrono::high_resolution_clock::now() - start).count(); };
+
+		ShaderCompileResult compile_result{};
 
 		// Prepend directory
-		rel_path = std::filesystem::path("shaders\\" + rel_path.string());
+		const std::filesystem::path rel_path = std::filesystem::path("shaders\\" + request.rel_path.string());
 
-		std::wstring profile = grab_profile(type);
+		std::wstring profile = grab_profile(request.type);
+
+		const u64 key = get_cache_key(rel_path, request, profile);
+		if (m_cache)
+		{
+			if (auto bytecode = m_cache->find(key); bytecode.has_value())
+			{
+				compile_result.shader = std::make_shared<CompiledShader>(bytecode->data(), bytecode->size(), request.type);
+				compile_result.compile_ms = elapsed_ms();
+				compile_result.from_cache = true;
+				return compile_result;
+			}
+		}
 
 		// Create blob to store compiled data
 		uint32_t code_page = CP_UTF8;
 		ComPtr<IDxcBlobEncoding> source_blob;
 
 		HRESULT hr;
-		hr = m_library->CreateBlobFromFile(rel_path.c_str(), &code_page, &source_blob);
+		hr = context.utils->LoadFile(rel_path.c_str(), &code_page, &source_blob);
 		if (FAILED(hr))
-			throw std::runtime_error("Failed to create blob");
+		{
+			std::cout << "Failed to load " << rel_path << "\n";
+			return compile_result;
+		}
+
+		// Source name first, it is reported in errors and includes are resolved relative to it
+		std::vector<std::wstring> args = { rel_path.wstring(), L"-E", std::filesystem::path(request.entry_point).wstring(), L"-T", profile };
+		for (const auto& define : request.defines)
+		{
+			args.push_back(L"-D");
+			args.push_back(std::filesystem::path(define.value.empty() ? define.name : define.name + "=" + define.value).wstring());
+		}
+		for (const auto& arg : request.arguments)
+			args.push_back(std::filesystem::path(arg).wstring());
+
+		std::vector<LPCWSTR> arg_ptrs;
+		for (const auto& arg : args)
+			arg_ptrs.push_back(arg.c_str());
+
+		DxcBuffer source{};
+		source.Ptr = source_blob->GetBufferPointer();
+		source.Size = source_blob->GetBufferSize();
+		source.Encoding = code_page;
+
+		TrackingIncludeHandler include_handler(context.def_inc_hdlr.Get());
 
 		// Compile
-		ComPtr<IDxcOperationResult> result;
-		hr = m_compiler->Compile(
-			source_blob.Get(), // pSource
-			rel_path.c_str(),// pSourceName
-			entry_wstr.c_str(), // pEntryPoint
-			profile.c_str(), // pTargetProfile
-			NULL, 0, // pArguments, argCount
-			NULL, 0, // pDefines, defineCount
-			m_def_inc_hdlr.Get(),
-			result.GetAddressOf()); // ppResult
+		ComPtr<IDxcResult> result;
+		hr = context.compiler->Compile(&source, arg_ptrs.data(), (UINT32)arg_ptrs.size(), &include_handler, IID_PPV_ARGS(result.GetAddressOf()));
 
 		if (SUCCEEDED(hr))
 			result->GetStatus(&hr);
@@ -69,24 +248,49 @@ namespace mira
 		if (FAILED(hr))
 		{
 			ComPtr<IDxcBlobEncoding> errors;
-			hr = result->GetErrorBuffer(&errors);
-			if (SUCCEEDED(hr) && errors)
+			if (result && SUCCEEDED(result->GetErrorBuffer(&errors)) && errors)
 			{
-				wprintf(L"Compilation failed with errors:\n%hs\n",
+				wprintf(L"Compilation of %ls failed with errors:\n%hs\n",
+					rel_path.wstring().c_str(),
 					(const char*)errors->GetBufferPointer());
-				assert(false);
 			}
+			return compile_result;
 		}
 
 		ComPtr<IDxcBlob> res;
 		hr = result->GetResult(res.GetAddressOf());
 		if (FAILED(hr))
-			assert(false);
+			return compile_result;
 
-		return std::make_shared<CompiledShader>(res->GetBufferPointer(), res->GetBufferSize(), type);
+		if (m_cache)
+		{
+			auto& dependencies = include_handler.get_dependencies();
+			dependencies.push_back({ rel_path.string(), hash_bytes(source_blob->GetBufferPointer(), source_blob->GetBufferSize()) });
+			m_cache->store(key, std::move(dependencies), std::span<const u8>((const u8*)res->GetBufferPointer(), res->GetBufferSize()));
+		}
+
+		compile_result.shader = std::make_shared<CompiledShader>(res->GetBufferPointer(), res->GetBufferSize(), request.type);
+		compile_result.compile_ms = elapsed_ms();
+		return compile_result;
+	}
+
+	u64 ShaderCompiler_DXC::get_cache_key(const std::filesystem::path& path, const ShaderCompileRequest& request, const std::wstring& profile) const
+	{
+		const std::string path_str = path.string();
+		u64 key = hash_bytes(path_str.data(), path_str.size(), hash_combine(hash_bytes(nullptr, 0), m_compiler_version));
+		key = hash_string(request.entry_point.data(), request.entry_point.size(), key);
+		key = hash_string(profile.data(), profile.size() * sizeof(wchar_t), key);
+		for (const auto& define : request.defines)
+		{
+			key = hash_string(define.name.data(), define.name.size(), key);
+			key = hash_string(define.value.data(), define.value.size(), key);
+		}
+		for (const auto& arg : request.arguments)
+			key = hash_string(arg.data(), arg.size(), key);
+		return key;
 	}
 
-	std::wstring ShaderCompiler_DXC::grab_profile(ShaderType shader_type)
+	std::wstring ShaderCompiler_DXC::grab_profile(ShaderType shader_type) const
 	{
 		std::wstring profile;
 		switch (shader_type)
@@ -1,18 +1,28 @@
 #pragma once
 #include "../ShaderCompiler.h"
+#include "../../Threading/ThreadPool.h"
 #include <wrl/client.h>
 
-struct IDxcLibrary;
 struct IDxcUtils;
-struct IDxcCompiler;
+struct IDxcCompiler3;
 struct IDxcIncludeHandler;
 
 namespace mira
 {
+	class ShaderCache;
+
+	/*
+		Compiled shaders are cached on disk (see ShaderCache), a shader is only recompiled if its source or any file it includes has changed.
+		An empty cache path disables caching.
+
+		DXC compiler instances are not shared between threads: calls on the owning thread use their own, each batch job borrows one
+		of the per pool thread instances for its duration. Batches run on a pool shared with the rest of the application and wait
+		only for their own jobs.
+	*/
 	class ShaderCompiler_DXC final : public ShaderCompiler
 	{
 	public:
-		ShaderCompiler_DXC(ShaderModel model = ShaderModel::SM_6_6);
+		ShaderCompiler_DXC(ThreadPool& workers, ShaderModel model = ShaderModel::SM_6_6, const std::filesystem::path& cache_path = "shaders.cache");
 		~ShaderCompiler_DXC();
 
 		std::shared_ptr<CompiledShader> compile_from_file(
@@ -20,16 +30,48 @@ namespace mira
 			ShaderType type,
 			const std::string& entry_point = "main");
 
+		std::shared_ptr<CompiledShader> compile(const ShaderCompileRequest& request);
+
+		// Reentrant, batches may be compiled from several threads at once (unlike compile and compile_from_file, which are owning thread only)
+		std::vector<ShaderCompileResult> compile_batch(std::span<const ShaderCompileRequest> requests);
+
+	private:
+		struct Context
+		{
+			Microsoft::WRL::ComPtr<IDxcUtils> utils;
+			Microsoft::WRL::ComPtr<IDxcCompiler3> compiler;
+			Microsoft::WRL::ComPtr<IDxcIncludeHandler> def_inc_hdlr;
+		};
+
 	private:
-		std::wstring grab_profile(ShaderType shader_type);
+		Context create_context() const;
+
+		// Hash of the version and build of the DXC in use, zero if it cannot be queried
+		u64 query_compiler_version() const;
+		ShaderCompileResult compile(Context& context, const ShaderCompileRequest& request);
+
+		// Index of a worker context no other job is using, returned once the job is done
+		u32 acquire_worker_context();
+		void release_worker_context(u32 index);
+
+		std::wstring grab_profile(ShaderType shader_type) const;
+
+		// Everything the compiled bytecode depends on (including the compiler version), other than the contents of the files
+		u64 get_cache_key(const std::filesystem::path& path, const ShaderCompileRequest& request, const std::wstring& profile) const;
 
 	private:
 		ShaderModel m_shader_model;
 
-		Microsoft::WRL::ComPtr<IDxcLibrary> m_library;
-		Microsoft::WRL::ComPtr<IDxcUtils> m_utils;
-		Microsoft::WRL::ComPtr<IDxcCompiler> m_compiler;
-		Microsoft::WRL::ComPtr<IDxcIncludeHandler> m_def_inc_hdlr;
+		Context m_context;
+		u64 m_compiler_version{ 0 };
+		ThreadPool& m_workers;
+
+		// One per pool thread, created up front: at most one job runs per thread, so a free one is always available
+		std::vector<Context> m_worker_contexts;
+		std::vector<u32> m_free_worker_contexts;
+		std::mutex m_worker_contexts_mutex;
+
+		std::unique_ptr<ShaderCache> m_cache;
 
 	};
 }
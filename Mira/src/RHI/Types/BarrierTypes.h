@@ -19,6 +19,17 @@ namespace mira
 			Texture,
 		};
 
+		/*
+			Split transitions let the GPU start a transition early and only wait for it where the resource is needed.
+			The resource may not be used between the begin and the end, both halves must be in the same command list and state the same transition.
+		*/
+		enum class Split : u8
+		{
+			None,
+			BeginOnly,
+			EndOnly,
+		};
+
 		static ResourceBarrier uav_barrier(Texture resource) 
 		{ 
 			ResourceBarrier barr{};
@@ -37,6 +48,52 @@ namespace mira
 			return barr;
 		}
 
+		// Activates 'after' in memory shared with other placed resources, a null 'before' means any resource in the heap may have been active
+		static ResourceBarrier aliasing(Texture before, Texture after)
+		{
+			ResourceBarrier barr{};
+			barr.info.resource_or_before = before.handle;
+			barr.info.after = after.handle;
+			barr.info.type = Type::Aliasing;
+			barr.info.res_type = ResourceType::Texture;
+			return barr;
+		}
+
+		static ResourceBarrier aliasing(Buffer before, Buffer after)
+		{
+			ResourceBarrier barr{};
+			barr.info.resource_or_before = before.handle;
+			barr.info.after = after.handle;
+			barr.info.type = Type::Aliasing;
+			barr.info.res_type = ResourceType::Buffer;
+			return barr;
+		}
+
+		// Transitions from whatever state the (sub)resource is in, as tracked by the device
+		static ResourceBarrier transition(Buffer resource, ResourceState after)
+		{
+			ResourceBarrier barr{};
+			barr.info.resource_or_before = resource.handle;
+			barr.info.state_after = after;
+			barr.info.type = Type::Transition;
+			barr.info.subresource = 0xffffffff;
+			barr.info.res_type = ResourceType::Buffer;
+			barr.info.tracked_before = true;
+			return barr;
+		}
+
+		static ResourceBarrier transition(Texture resource, ResourceState after, u32 api_subresource = 0xffffffff)
+		{
+			ResourceBarrier barr{};
+			barr.info.resource_or_before = resource.handle;
+			barr.info.state_after = after;
+			barr.info.type = Type::Transition;
+			barr.info.subresource = api_subresource;
+			barr.info.res_type = ResourceType::Texture;
+			barr.info.tracked_before = true;
+			return barr;
+		}
+
 		static ResourceBarrier transition(Buffer resource, ResourceState before, ResourceState after)
 		{ 
 			ResourceBarrier barr{};
@@ -61,6 +118,23 @@ namespace mira
 			return barr;
 		}
 
+		// Only valid on transitions
+		ResourceBarrier begin_only() const
+		{
+			assert(info.type == Type::Transition);
+			ResourceBarrier barr = *this;
+			barr.info.split = Split::BeginOnly;
+			return barr;
+		}
+
+		ResourceBarrier end_only() const
+		{
+			assert(info.type == Type::Transition);
+			ResourceBarrier barr = *this;
+			barr.info.split = Split::EndOnly;
+			return barr;
+		}
+
 		struct BarrierInfo
 		{
 			Type type{ Type::Transition };					
@@ -70,6 +144,8 @@ namespace mira
 			u64 after;
 			ResourceState state_before, state_after;
 			u32 subresource{ 0 };
+			bool tracked_before{ false };		// state_before is taken from the tracked state
+			Split split{ Split::None };
 		} info;
 	};
 
@@ -230,6 +230,77 @@ namespace mira
 	};
 
 
+	// Content hash: shaders are hashed by their bytecode, so identical descriptions built from different shader objects match
+	inline u64 hash_desc(const GraphicsPipelineDesc& desc)
+	{
+		u64 hash = hash_bytes(nullptr, 0);
+
+		for (const CompiledShader* shader : { desc.vs, desc.gs, desc.ds, desc.hs, desc.ps })
+		{
+			hash = hash_combine(hash, shader != nullptr);
+			if (shader)
+			{
+				hash = hash_combine(hash, shader->shader_type);
+				hash = hash_combine(hash, shader->blob.size());
+				hash = hash_bytes(shader->blob.data(), shader->blob.size(), hash);
+			}
+		}
+
+		hash = hash_combine(hash, desc.blend.alpha_to_coverage_enabled);
+		hash = hash_combine(hash, desc.blend.independent_blend_enabled);
+		for (const auto& rt : desc.blend.rt_blends)
+		{
+			hash = hash_combine(hash, rt.blend_enabled);
+			hash = hash_combine(hash, rt.logic_op_enabled);
+			hash = hash_combine(hash, rt.src_blend);
+			hash = hash_combine(hash, rt.dst_blend);
+			hash = hash_combine(hash, rt.blend_op);
+			hash = hash_combine(hash, rt.src_blend_alpha);
+			hash = hash_combine(hash, rt.dst_blend_alpha);
+			hash = hash_combine(hash, rt.blend_op_alpha);
+			hash = hash_combine(hash, rt.logic_op);
+			hash = hash_combine(hash, rt.rt_write_mask);
+		}
+		hash = hash_combine(hash, desc.sample_mask);
+
+		const auto& rs = desc.rasterizer;
+		hash = hash_combine(hash, rs.fill_mode);
+		hash = hash_combine(hash, rs.cull_mode);
+		hash = hash_combine(hash, rs.front_ccw);
+		hash = hash_combine(hash, rs.depth_bias);
+		hash = hash_combine(hash, rs.depth_bias_clamp);
+		hash = hash_combine(hash, rs.slope_scaled_depth_bias);
+		hash = hash_combine(hash, rs.depth_clip_enabled);
+		hash = hash_combine(hash, rs.multisample_enabled);
+		hash = hash_combine(hash, rs.aa_line_enabled);
+		hash = hash_combine(hash, rs.forced_sample_count);
+		hash = hash_combine(hash, rs.conservative_raster_enabled);
+
+		const auto& ds = desc.depth_stencil;
+		hash = hash_combine(hash, ds.depth_enabled);
+		hash = hash_combine(hash, ds.depth_write_mask);
+		hash = hash_combine(hash, ds.depth_func);
+		hash = hash_combine(hash, ds.stencil_enabled);
+		hash = hash_combine(hash, ds.stencil_read_mask);
+		hash = hash_combine(hash, ds.stencil_write_mask);
+		for (const auto& face : { ds.front_face, ds.back_face })
+		{
+			hash = hash_combine(hash, face.stencil_fail_op);
+			hash = hash_combine(hash, face.stencil_depth_fail_op);
+			hash = hash_combine(hash, face.stencil_pass_op);
+			hash = hash_combine(hash, face.stencil_func);
+		}
+
+		hash = hash_combine(hash, desc.topology);
+		hash = hash_combine(hash, desc.num_render_targets);
+		hash = hash_combine(hash, desc.rtv_formats);
+		hash = hash_combine(hash, desc.dsv_format);
+		hash = hash_combine(hash, desc.sample_count);
+		hash = hash_combine(hash, desc.sample_quality);
+		hash = hash_combine(hash, desc.num_control_patches);
+		return hash;
+	}
+
 	inline ColorWriteEnable operator|(ColorWriteEnable a, ColorWriteEnable b)
 	{
 		return static_cast<ColorWriteEnable>(static_cast<u16>(a) | static_cast<u16>(b));
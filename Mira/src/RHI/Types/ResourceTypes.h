@@ -84,13 +84,20 @@ namespace mira
 
 		UsageIntent usage{ UsageIntent::None };
 		u32 alignment{ 0 };
+
+		// Element stride of the structured views which will be created on the buffer, zero if unknown.
+		// Lets small upload buffers share a resource with others, their offset in it is kept a multiple of the stride.
+		u32 stride{ 0 };
 		
 		BufferDesc() = default;
-		BufferDesc(u32 size_in, MemoryType memory_type_in, UsageIntent usage_in = UsageIntent::None, u32 alignment_in = 0) :
+		BufferDesc(u32 size_in, MemoryType memory_type_in, UsageIntent usage_in = UsageIntent::None, u32 alignment_in = 0, u32 stride_in = 0) :
 			size(size_in),
 			memory_type(memory_type_in),
 			usage(usage_in),
-			alignment(alignment_in) {}
+			alignment(alignment_in),
+			stride(stride_in) {}
+
+		bool operator==(const BufferDesc&) const = default;
 	};
 
 	struct TextureDesc
@@ -119,8 +126,70 @@ namespace mira
 		MemoryType memory_type{ MemoryType::Default };
 		ResourceFormat format{ ResourceFormat::Unknown };
 		UsageIntent usage{ UsageIntent::None };
+
+		bool operator==(const TextureDesc&) const = default;
+	};
+
+	// Placed resources can only be created in a heap of a matching category (resource heap tier 1)
+	enum class HeapCategory : u8
+	{
+		Buffers,
+		Textures,				// Non render target/depth stencil textures
+		RenderTargets			// Render target and depth stencil textures
+	};
+
+	struct HeapDesc
+	{
+		u64 size{ 0 };
+		MemoryType memory_type{ MemoryType::Default };
+		HeapCategory category{ HeapCategory::Buffers };
+
+		HeapDesc() = default;
+		HeapDesc(u64 size_in, MemoryType memory_type_in, HeapCategory category_in) :
+			size(size_in),
+			memory_type(memory_type_in),
+			category(category_in) {}
+	};
+
+	// Size and alignment of a resource when placed in a heap
+	struct MemoryRequirements
+	{
+		u64 size{ 0 };
+		u64 alignment{ 0 };
 	};
 
+	// For caching on descriptions
+	inline u64 hash_desc(const BufferDesc& desc)
+	{
+		u64 hash = hash_bytes(nullptr, 0);
+		hash = hash_combine(hash, desc.size);
+		hash = hash_combine(hash, desc.memory_type);
+		hash = hash_combine(hash, desc.usage);
+		hash = hash_combine(hash, desc.alignment);
+		hash = hash_combine(hash, desc.stride);
+		return hash;
+	}
+
+	inline u64 hash_desc(const TextureDesc& desc)
+	{
+		u64 hash = hash_bytes(nullptr, 0);
+		hash = hash_combine(hash, desc.width);
+		hash = hash_combine(hash, desc.height);
+		hash = hash_combine(hash, desc.depth);
+		hash = hash_combine(hash, desc.type);
+		hash = hash_combine(hash, desc.alignment);
+		hash = hash_combine(hash, desc.mip_levels);
+		hash = hash_combine(hash, desc.sample_count);
+		hash = hash_combine(hash, desc.sample_quality);
+		hash = hash_combine(hash, desc.clear_color);
+		hash = hash_combine(hash, desc.stencil_clear);
+		hash = hash_combine(hash, desc.depth_clear);
+		hash = hash_combine(hash, desc.memory_type);
+		hash = hash_combine(hash, desc.format);
+		hash = hash_combine(hash, desc.usage);
+		return hash;
+	}
+
 
 
 
@@ -1,5 +1,6 @@
 #pragma once
 #include "../../Common.h"
+#include <string>
 
 namespace mira
 {
@@ -36,4 +37,27 @@ namespace mira
 		~CompiledShader() = default;
 	};
 
+	struct ShaderDefine
+	{
+		std::string name;
+		std::string value;
+	};
+
+	struct ShaderCompileRequest
+	{
+		std::filesystem::path rel_path;				// Relative to the shader directory
+		ShaderType type{ ShaderType::Vertex };
+		std::string entry_point{ "main" };
+
+		std::vector<ShaderDefine> defines;
+		std::vector<std::string> arguments;			// Passed to the compiler as is, e.g "-O3"
+	};
+
+	struct ShaderCompileResult
+	{
+		std::shared_ptr<CompiledShader> shader;		// Null if compilation failed
+		f64 compile_ms{ 0.0 };
+		bool from_cache{ false };
+	};
+
 }
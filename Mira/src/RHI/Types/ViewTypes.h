@@ -58,6 +58,8 @@ namespace mira
 		TextureViewRange& set_min_lod_clamp(float value) { min_lod_clamp = value; return *this; }
 		TextureViewRange& set_depth_read_only() { depth_read_only = true; return *this; }
 		TextureViewRange& set_stencil_read_only() { stencil_read_only = true; return *this; }
+
+		bool operator==(const TextureViewRange&) const = default;
 	};
 
 	struct BufferViewDesc
@@ -72,6 +74,8 @@ namespace mira
 
 		BufferViewDesc(ViewType view_in, u32 offset_in, u32 stride_in, u32 count_in = 1, bool raw_in = false) :
 			view(view_in), offset(offset_in), stride(stride_in), count(count_in), raw(raw_in) {}
+
+		bool operator==(const BufferViewDesc&) const = default;
 	};
 
 	struct TextureViewDesc
@@ -82,5 +86,35 @@ namespace mira
 
 		TextureViewDesc(ViewType view_in, TextureViewRange range_in) :
 			view(view_in), range(range_in) {}
+
+		bool operator==(const TextureViewDesc&) const = default;
 	};
+
+	// For caching on descriptions, equal hashes still have to be compared on the descriptions
+	inline u64 hash_desc(const BufferViewDesc& desc)
+	{
+		u64 hash = hash_bytes(nullptr, 0);
+		hash = hash_combine(hash, desc.view);
+		hash = hash_combine(hash, desc.offset);
+		hash = hash_combine(hash, desc.stride);
+		hash = hash_combine(hash, desc.count);
+		hash = hash_combine(hash, desc.raw);
+		return hash;
+	}
+
+	inline u64 hash_desc(const TextureViewDesc& desc)
+	{
+		u64 hash = hash_bytes(nullptr, 0);
+		hash = hash_combine(hash, desc.view);
+		hash = hash_combine(hash, desc.range.dimension);
+		hash = hash_combine(hash, desc.range.format);
+		hash = hash_combine(hash, desc.range.base_mip_level);
+		hash = hash_combine(hash, desc.range.mip_levels);
+		hash = hash_combine(hash, desc.range.array_base);
+		hash = hash_combine(hash, desc.range.array_count);
+		hash = hash_combine(hash, desc.range.min_lod_clamp);
+		hash = hash_combine(hash, desc.range.depth_read_only);
+		hash = hash_combine(hash, desc.range.stencil_read_only);
+		return hash;
+	}
 }
@@ -0,0 +1,168 @@
+#include "ClusterCuller.h"
+#include "MeshManager.h"
+#include "../Profiling/CPUProfiler.h"
+#include <cmath>
+
+namespace mira
+{
+	namespace
+	{
+		using float3 = std::array<f32, 3>;
+		using float4 = std::array<f32, 4>;
+		using float4x4 = std::array<f32, 16>;
+
+		float4x4 multiply(const float4x4& a, const float4x4& b)
+		{
+			float4x4 res{};
+			for (u32 row = 0; row < 4; ++row)
+				for (u32 col = 0; col < 4; ++col)
+					for (u32 k = 0; k < 4; ++k)
+						res[row * 4 + col] += a[row * 4 + k] * b[k * 4 + col];
+			return res;
+		}
+
+		// Inside where dot(plane.xyz, p) + plane.w >= 0, normalized so that it gives the distance
+		struct Frustum
+		{
+			std::array<float4, 6> planes;
+		};
+
+		// Planes of clip space (row vectors, depth in [0, w]) in the space the matrix transforms from
+		Frustum extract_frustum(const float4x4& m)
+		{
+			auto column = [&](u32 col) { return float4{ m[col], m[4 + col], m[8 + col], m[12 + col] }; };
+			auto add = [](const float4& a, const float4& b) { return float4{ a[0] + b[0], a[1] + b[1], a[2] + b[2], a[3] + b[3] }; };
+			auto sub = [](const float4& a, const float4& b) { return float4{ a[0] - b[0], a[1] - b[1], a[2] - b[2], a[3] - b[3] }; };
+
+			const float4 x = column(0), y = column(1), z = column(2), w = column(3);
+
+			Frustum frustum{};
+			frustum.planes = { add(w, x), sub(w, x), add(w, y), sub(w, y), z, sub(w, z) };
+			for (auto& plane : frustum.planes)
+			{
+				const f32 len = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+				for (auto& v : plane)
+					v /= len;
+			}
+			return frustum;
+		}
+
+		// World space point to the space of an affine (row vector) world matrix
+		float3 to_object_space(const float4x4& world, const float3& p)
+		{
+			auto at = [&](u32 row, u32 col) { return world[row * 4 + col]; };
+
+			// Inverse of the upper 3x3 through its cofactors
+			const f32 c00 = at(1, 1) * at(2, 2) - at(1, 2) * at(2, 1);
+			const f32 c01 = at(1, 2) * at(2, 0) - at(1, 0) * at(2, 2);
+			const f32 c02 = at(1, 0) * at(2, 1) - at(1, 1) * at(2, 0);
+			const f32 inv_det = 1.f / (at(0, 0) * c00 + at(0, 1) * c01 + at(0, 2) * c02);
+
+			const f32 inv[9] =
+			{
+				c00 * inv_det, (at(0, 2) * at(2, 1) - at(0, 1) * at(2, 2)) * inv_det, (at(0, 1) * at(1, 2) - at(0, 2) * at(1, 1)) * inv_det,
+				c01 * inv_det, (at(0, 0) * at(2, 2) - at(0, 2) * at(2, 0)) * inv_det, (at(0, 2) * at(1, 0) - at(0, 0) * at(1, 2)) * inv_det,
+				c02 * inv_det, (at(0, 1) * at(2, 0) - at(0, 0) * at(2, 1)) * inv_det, (at(0, 0) * at(1, 1) - at(0, 1) * at(1, 0)) * inv_det
+			};
+
+			const float3 d = { p[0] - at(3, 0), p[1] - at(3, 1), p[2] - at(3, 2) };
+			return
+			{
+				d[0] * inv[0] + d[1] * inv[3] + d[2] * inv[6],
+				d[0] * inv[1] + d[1] * inv[4] + d[2] * inv[7],
+				d[0] * inv[2] + d[1] * inv[5] + d[2] * inv[8]
+			};
+		}
+
+		bool is_visible(const Meshlet& meshlet, const Frustum& frustum, const float3& camera)
+		{
+			for (const auto& plane : frustum.planes)
+			{
+				const f32 distance = plane[0] * meshlet.center[0] + plane[1] * meshlet.center[1] + plane[2] * meshlet.center[2] + plane[3];
+				if (distance < -meshlet.radius)
+					return false;
+			}
+
+			const float3 to_center = { meshlet.center[0] - camera[0], meshlet.center[1] - camera[1], meshlet.center[2] - camera[2] };
+			const f32 distance = std::sqrt(to_center[0] * to_center[0] + to_center[1] * to_center[1] + to_center[2] * to_center[2]);
+			const f32 alignment = to_center[0] * meshlet.cone_axis[0] + to_center[1] * meshlet.cone_axis[1] + to_center[2] * meshlet.cone_axis[2];
+			return alignment < meshlet.cone_cutoff * distance + meshlet.radius;
+		}
+	}
+
+	ClusterCuller::ClusterCuller(ThreadPool& workers) :
+		m_workers(workers)
+	{
+	}
+
+	ClusterCuller::~ClusterCuller()
+	{
+	}
+
+	void ClusterCuller::cull(const View& view, const MeshManager& mesh_mgr, const MeshContainer& mesh, const std::array<f32, 16>& world, std::vector<ClusterDraw>& draws)
+	{
+		MIRA_PROFILE_FUNCTION();
+
+		const Frustum frustum = extract_frustum(multiply(world, view.view_projection));
+		const float3 camera = to_object_space(world, view.camera_position);
+
+		// Test every meshlet in chunks
+		u32 num_meshlets = 0;
+		for (u32 sm = 0; sm < mesh.num_submeshes; ++sm)
+			num_meshlets += (u32)mesh_mgr.get_meshlets(mesh.mesh, sm).size();
+		m_visible.resize(num_meshlets);
+
+		u32 offset = 0;
+		for (u32 sm = 0; sm < mesh.num_submeshes; ++sm)
+		{
+			const auto meshlets = mesh_mgr.get_meshlets(mesh.mesh, sm);
+			for (u32 start = 0; start < meshlets.size(); start += CHUNK_SIZE)
+			{
+				const auto chunk = meshlets.subspan(start, std::min<size_t>(CHUNK_SIZE, meshlets.size() - start));
+				u8* visible = m_visible.data() + offset + start;
+				m_workers.submit(m_jobs, [chunk, visible, &frustum, camera]()
+					{
+						for (u32 i = 0; i < chunk.size(); ++i)
+							visible[i] = is_visible(chunk[i], frustum, camera) ? 1 : 0;
+					});
+			}
+			offset += (u32)meshlets.size();
+		}
+		m_workers.wait(m_jobs);
+
+		// Merge visible neighbours into draws
+		u32 num_visible = 0;
+		offset = 0;
+		for (u32 sm = 0; sm < mesh.num_submeshes; ++sm)
+		{
+			const auto& md = mesh_mgr.get_submesh_metadata(mesh.mesh, sm);
+			const auto meshlets = mesh_mgr.get_meshlets(mesh.mesh, sm);
+			if (meshlets.empty())
+			{
+				draws.push_back({ sm, md.index_start, md.index_count });
+				continue;
+			}
+
+			bool merging = false;
+			for (u32 i = 0; i < meshlets.size(); ++i)
+			{
+				if (!m_visible[offset + i])
+				{
+					merging = false;
+					continue;
+				}
+
+				++num_visible;
+				const u32 index_count = meshlets[i].prim_count * 3;
+				if (merging)
+					draws.back().index_count += index_count;
+				else
+					draws.push_back({ sm, md.index_start + meshlets[i].index_offset, index_count });
+				merging = true;
+			}
+			offset += (u32)meshlets.size();
+		}
+
+		MIRA_PROFILE_COUNTER("Visible meshlets", num_visible);
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "Types/MeshTypes.h"
+#include "../Threading/ThreadPool.h"
+
+namespace mira
+{
+	class MeshManager;
+
+	// Range of the index buffer to draw with the metadata of 'submesh'
+	struct ClusterDraw
+	{
+		u32 submesh{ 0 };
+		u32 index_start{ 0 };
+		u32 index_count{ 0 };
+	};
+
+	/*
+		Culls the meshlets of a mesh on the CPU against the view frustum (bounding spheres) and the camera (normal cones).
+
+		The frustum planes and the camera are moved into object space once per mesh, rather than every meshlet into world space.
+		The cone test assumes a uniformly scaled world matrix, the frustum test is exact for any affine one.
+		Meshlets are tested in chunks on the shared worker threads, visible ones which follow each other in the index buffer are merged into one draw.
+		Submeshes without meshlets are drawn whole.
+
+		Matrices are row-major with row vectors (DirectXMath), the projection maps depth to [0, 1] (regular or reversed).
+	*/
+	class ClusterCuller
+	{
+	public:
+		struct View
+		{
+			std::array<f32, 16> view_projection{};
+			std::array<f32, 3> camera_position{};		// World space
+		};
+
+	public:
+		// Culling waits only on its own jobs, the pool may be busy with others
+		ClusterCuller(ThreadPool& workers);
+		~ClusterCuller();
+
+		ClusterCuller(const ClusterCuller&) = delete;
+		ClusterCuller& operator=(const ClusterCuller&) = delete;
+
+		// Appends the draws of the visible meshlets of 'mesh' to 'draws', blocks until culled
+		void cull(const View& view, const MeshManager& mesh_mgr, const MeshContainer& mesh, const std::array<f32, 16>& world, std::vector<ClusterDraw>& draws);
+
+	private:
+		ThreadPool& m_workers;
+		ThreadPool::JobGroup m_jobs;
+
+		// Meshlets per job
+		static constexpr u32 CHUNK_SIZE = 256;
+
+		// One entry per meshlet of the mesh being culled, in submesh order
+		std::vector<u8> m_visible;
+	};
+}
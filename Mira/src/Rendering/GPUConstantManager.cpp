@@ -1,6 +1,7 @@
 #include "GPUConstantManager.h"
 #include "../RHI/RenderDevice.h"
 #include "GPUGarbageBin.h"
+#include "../Profiling/CPUProfiler.h"
 
 namespace mira
 {
@@ -37,6 +38,8 @@ namespace mira
 
 	std::pair<u8*, u32> GPUConstantManager::allocate_transient(u32 size)
 	{
+		MIRA_PROFILE_FUNCTION();
+
 		assert(size <= 1024);
 		
 		u32 elements_required = 1 + ((size - 1) / 256);	
@@ -64,21 +67,27 @@ namespace mira
 		assert(allocation != nullptr);
 		assert(contiguous_satisfied);		// Out of memory, just increase max memory
 
-		// Create transient GPU-indexable view
-		auto view = m_rd->create_view(m_transient_buffer.buffer, BufferViewDesc(ViewType::Constant, (u32)allocation_offset, elements_required * 256));
-		auto global_id = m_rd->get_global_descriptor(view);
+		// Create transient GPU-indexable view, reclaimed by the device with the frame
+		auto global_id = m_rd->create_transient_view(m_transient_buffer.buffer, BufferViewDesc(ViewType::Constant, (u32)allocation_offset, elements_required * 256));
 
-		// Free this view when appropriate
-		m_bin->push_deferred_deletion([this, view, elements_required]()
-			{
-				m_rd->free_view(view);
+		// Memory is released with the rest of the frame (see end_frame)
+		m_transient_elements_in_frame += elements_required;
+
+		return { allocation, global_id };
+	}
+
+	void GPUConstantManager::end_frame()
+	{
+		if (m_transient_elements_in_frame == 0)
+			return;
 
-				// Pop the allocated elements
-				for (u32 i = 0; i < elements_required; ++i)
+		// Pop all of the frame's elements at once
+		m_bin->push_deferred_deletion([this, elements = m_transient_elements_in_frame]()
+			{
+				for (u32 i = 0; i < elements; ++i)
 					m_transient_buffer.ator.pop();
 			});
-
-		return { allocation, global_id };
+		m_transient_elements_in_frame = 0;
 	}
 
 	PersistentConstant GPUConstantManager::allocate_persistent(u32 size, void* init_data, u32 init_data_size, bool immutable)
@@ -104,11 +113,8 @@ namespace mira
 		auto& res = try_get(m_persistent_allocations, get_slot(handle.handle));
 
 		// Safely remove current persistent allocation
-		m_bin->push_deferred_deletion([this, res_copy = res, handle]()		// Grabs copy of res
-			{
-				m_persistent_buffers[res_copy.curr_version].ator.free(res_copy.allocation_md.first, res_copy.allocation_md.second);
-				m_rd->free_view(res_copy.view);
-			});
+		m_bin->push_deferred_deletion(&m_persistent_buffers[res.curr_version].ator, res.allocation_md.first, res.allocation_md.second);
+		m_bin->push_deferred_deletion(res.view);
 		
 		// Deletion lambda has a copy of storage for deallocation, we can disable it immediately.
 		m_persistent_allocations[get_slot(handle.handle)] = std::nullopt;
@@ -139,11 +145,8 @@ namespace mira
 		assert(size <= res.allocated_size);	
 
 		// Safely remove current persistent allocation
-		m_bin->push_deferred_deletion([this, res_copy = res, handle]()		// Grabs copy of res
-			{
-				m_persistent_buffers[res_copy.curr_version].ator.free(res_copy.allocation_md.first, res_copy.allocation_md.second);
-				m_rd->free_view(res_copy.view);
-			});
+		m_bin->push_deferred_deletion(&m_persistent_buffers[res.curr_version].ator, res.allocation_md.first, res.allocation_md.second);
+		m_bin->push_deferred_deletion(res.view);
 
 		upload_persistent_to_device_local(handle, res, data, size);
 	}
@@ -34,8 +34,12 @@ namespace mira
 
 		// Transient constants live in shared host-device memory
 		// User can immediately update on CPU
+		// Valid for the current frame only
 		std::pair<u8*, u32> allocate_transient(u32 size);
 
+		// Releases the transient constants of the frame once it is no longer in flight
+		void end_frame();
+
 		// Persistent (lives in device-local memory)
 		PersistentConstant allocate_persistent(u32 size, void* init_data = nullptr, u32 init_data_size = 0, bool immutable = false);
 		void free_persistent(PersistentConstant handle);
@@ -113,6 +117,7 @@ namespace mira
 			--> 512 byte allocations are 2 elements and 1024 byte allocations are 3 elements
 		*/
 		Transient_Buffer m_transient_buffer;
+		u32 m_transient_elements_in_frame{ 0 };
 
 	};
 }
@@ -1,46 +1,75 @@
 #include "GPUGarbageBin.h"
+#include "../RHI/RenderDevice.h"
+#include "../Memory/VirtualBlockAllocator.h"
+#include "../Profiling/CPUProfiler.h"
 
 namespace mira
 {
-	GPUGarbageBin::GPUGarbageBin(u8 max_frames_in_flight) : 
-		m_max_frames_in_flight(max_frames_in_flight)
+	GPUGarbageBin::GPUGarbageBin(RenderDevice* rd) :
+		m_rd(rd)
 	{
 	}
 
-	void GPUGarbageBin::push_deferred_deletion(const std::function<void()>& deletion_func)
+	void GPUGarbageBin::push_deferred_deletion(Buffer handle)
 	{
-		Deletion_Storage storage{};
-		storage.frame_idx_on_request = m_curr_frame_idx;
-		storage.func = deletion_func;
+		m_buffers.push(m_rd->get_current_frame(), handle);
+	}
 
-		std::lock_guard<std::mutex> guard(m_mutex);
-		m_deletes.push(storage);
+	void GPUGarbageBin::push_deferred_deletion(Texture handle)
+	{
+		m_textures.push(m_rd->get_current_frame(), handle);
+	}
+
+	void GPUGarbageBin::push_deferred_deletion(BufferView handle)
+	{
+		m_buffer_views.push(m_rd->get_current_frame(), handle);
+	}
+
+	void GPUGarbageBin::push_deferred_deletion(TextureView handle)
+	{
+		m_texture_views.push(m_rd->get_current_frame(), handle);
+	}
+
+	void GPUGarbageBin::push_deferred_deletion(RenderPass handle)
+	{
+		m_renderpasses.push(m_rd->get_current_frame(), handle);
+	}
+
+	void GPUGarbageBin::push_deferred_deletion(Heap handle)
+	{
+		m_heaps.push(m_rd->get_current_frame(), handle);
+	}
+
+	void GPUGarbageBin::push_deferred_deletion(CommandList handle)
+	{
+		m_command_lists.push(m_rd->get_current_frame(), handle);
+	}
+
+	void GPUGarbageBin::push_deferred_deletion(VirtualBlockAllocator* ator, u64 offset, u64 size)
+	{
+		m_ranges.push(m_rd->get_current_frame(), AllocatorRange{ ator, offset, size });
+	}
+
+	void GPUGarbageBin::push_deferred_deletion(DeletionFunc&& deletion_func)
+	{
+		m_funcs.push(m_rd->get_current_frame(), std::move(deletion_func));
 	}
 
 	void GPUGarbageBin::begin_frame()
 	{
-		/*
-			Assuming deletes are always grouped contiguously:
-
-			[ 0, 0, 0, 1, 1, 1, 2, 2, 2, 0, 0, 0, ...]
-		*/	
-		while (!m_deletes.empty())
-		{
-			auto& storage = m_deletes.front();
-			if (storage.frame_idx_on_request == m_curr_frame_idx)
-			{
-				storage.func();	// delete
-				m_deletes.pop();
-			}
-			else
-			{
-				break;
-			}
-		}
-	}
-
-	void GPUGarbageBin::end_frame()
-	{
-		m_curr_frame_idx = (m_curr_frame_idx + 1) % m_max_frames_in_flight;
+		MIRA_PROFILE_FUNCTION();
+
+		const u64 completed = m_rd->get_num_completed_frames();
+
+		// Dependents first
+		m_funcs.release(completed, [](std::span<DeletionFunc> funcs) { for (auto& func : funcs) func(); });
+		m_ranges.release(completed, [](std::span<AllocatorRange> ranges) { for (const auto& range : ranges) range.ator->free(range.offset, range.size); });
+		m_command_lists.release(completed, [rd = m_rd](std::span<CommandList> lists) { for (auto list : lists) rd->recycle_command_list(list); });
+		m_renderpasses.release(completed, [rd = m_rd](std::span<RenderPass> rps) { for (auto rp : rps) rd->free_renderpass(rp); });
+		m_buffer_views.release(completed, [rd = m_rd](std::span<BufferView> views) { for (auto view : views) rd->free_view(view); });
+		m_texture_views.release(completed, [rd = m_rd](std::span<TextureView> views) { for (auto view : views) rd->free_view(view); });
+		m_buffers.release(completed, [rd = m_rd](std::span<Buffer> buffers) { for (auto buffer : buffers) rd->free_buffer(buffer); });
+		m_textures.release(completed, [rd = m_rd](std::span<Texture> textures) { for (auto texture : textures) rd->free_texture(texture); });
+		m_heaps.release(completed, [rd = m_rd](std::span<Heap> heaps) { for (auto heap : heaps) rd->free_heap(heap); });
 	}
 }
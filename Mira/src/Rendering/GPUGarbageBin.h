@@ -1,36 +1,97 @@
 #pragma once
 #include "../Common.h"
-#include <queue>
-#include <mutex>
-
+#include "../RHI/RenderResourceHandle.h"
+#include "../Memory/InplaceFunction.h"
+#include <algorithm>
 
 namespace mira
 {
+	class RenderDevice;
+	class VirtualBlockAllocator;
+
+	/*
+		Defers the release of resources until the GPU is done with the frame they were released in.
+
+		Deletions are tagged with the device's current frame and released in bulk at begin_frame once the device reports
+		that frame as completed on every queue, so the bin follows the actual GPU progress rather than assuming a frame count.
+		Each kind of deletion has its own queue, released in dependency order (views before their resources, placed resources before their heaps).
+
+		Not thread-safe, deletions are pushed from the thread which records and submits frames.
+	*/
 	class GPUGarbageBin
 	{
 	public:
-		GPUGarbageBin(u8 max_frames_in_flight);
+		// Deferred callbacks are stored inline, larger captures do not compile
+		static constexpr size_t MAX_CALLBACK_SIZE = 64;
+		using DeletionFunc = InplaceFunction<void(), MAX_CALLBACK_SIZE>;
 
-		void push_deferred_deletion(const std::function<void()>& deletion_func);
+	public:
+		GPUGarbageBin(RenderDevice* rd);
 
+		void push_deferred_deletion(Buffer handle);
+		void push_deferred_deletion(Texture handle);
+		void push_deferred_deletion(BufferView handle);
+		void push_deferred_deletion(TextureView handle);
+		void push_deferred_deletion(RenderPass handle);
+		void push_deferred_deletion(Heap handle);
+		void push_deferred_deletion(CommandList handle);
+
+		// Range returned to the allocator (which has to outlive the bin)
+		void push_deferred_deletion(VirtualBlockAllocator* ator, u64 offset, u64 size);
+
+		// For anything else, run once the frame has completed (must not push deletions itself)
+		void push_deferred_deletion(DeletionFunc&& deletion_func);
+
+		// Releases everything deferred in completed frames
 		void begin_frame();
-		void end_frame();
 
 	private:
-		struct Deletion_Storage
+		struct AllocatorRange
 		{
-			u32 frame_idx_on_request{ 0 };
-			std::function<void()> func;
+			VirtualBlockAllocator* ator{ nullptr };
+			u64 offset{ 0 };
+			u64 size{ 0 };
 		};
 
-	private:
-		u8 m_max_frames_in_flight{ 0 };
-		u8 m_curr_frame_idx{ 0 };
-		std::queue<Deletion_Storage> m_deletes;
+		template <typename T>
+		struct DeletionQueue
+		{
+			std::vector<u64> frames;		// Frame each deletion was pushed in, non-decreasing
+			std::vector<T> items;
 
-		std::mutex m_mutex;
+			void push(u64 frame, T item)
+			{
+				assert(frames.empty() || frames.back() <= frame);
+				frames.push_back(frame);
+				items.push_back(std::move(item));
+			}
 
-	};
-}
+			// Hands the items of frames below 'num_completed_frames' to 'release_func' in one go
+			template <typename Func>
+			void release(u64 num_completed_frames, Func&& release_func)
+			{
+				const auto end = std::lower_bound(frames.begin(), frames.end(), num_completed_frames);
+				const size_t count = end - frames.begin();
+				if (count == 0)
+					return;
+
+				release_func(std::span<T>(items.data(), count));
+				frames.erase(frames.begin(), end);
+				items.erase(items.begin(), items.begin() + count);
+			}
+		};
 
+	private:
+		RenderDevice* m_rd{ nullptr };
 
+		DeletionQueue<DeletionFunc> m_funcs;
+		DeletionQueue<AllocatorRange> m_ranges;
+		DeletionQueue<CommandList> m_command_lists;
+		DeletionQueue<RenderPass> m_renderpasses;
+		DeletionQueue<BufferView> m_buffer_views;
+		DeletionQueue<TextureView> m_texture_views;
+		DeletionQueue<Buffer> m_buffers;
+		DeletionQueue<Texture> m_textures;
+		DeletionQueue<Heap> m_heaps;
+	};
+}
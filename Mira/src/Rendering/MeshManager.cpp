@@ -1,12 +1,16 @@
 #include "MeshManager.h"
 #include "../RHI/RenderDevice.h"
 #include "GPUGarbageBin.h"
+#include "QueueScheduler.h"
+#include "VertexQuantization.h"
+#include "../Profiling/CPUProfiler.h"
 
 namespace mira
 {
     MeshManager::MeshManager(RenderDevice* device, GPUGarbageBin* bin, const SizeSpecification& size_spec) :
         m_rd(device),
-        m_bin(bin)
+        m_bin(bin),
+        m_vertex_format(size_spec.vertex_format)
     {
         assert(m_rd != nullptr);
 
@@ -21,11 +25,11 @@ namespace mira
             auto& buffer = m_device_local_buffers[attr].buffer;
             auto& view = m_device_local_buffers[attr].full_view;
             auto& ator = m_device_local_buffers[attr].ator;
-            const u32 count = size / get_stride(attr);
+            const u32 count = size / get_stride(attr, m_vertex_format);
 
             buffer = m_rd->create_buffer(BufferDesc(size, MemoryType::Default));
-            view = m_rd->create_view(buffer, BufferViewDesc(ViewType::ShaderResource, 0, get_stride(attr), count));
-            ator = VirtualBlockAllocator(get_stride(attr), count);
+            view = m_rd->create_view(buffer, BufferViewDesc(ViewType::ShaderResource, 0, get_stride(attr, m_vertex_format), count));
+            ator = VirtualBlockAllocator(get_stride(attr, m_vertex_format), count);
         }
 
         // Create index buffer
@@ -43,7 +47,10 @@ namespace mira
         // Create staging buffer
         {
             m_staging_buffer.buffer = m_rd->create_buffer(BufferDesc(size_spec.staging_size, MemoryType::Upload));
-            m_staging_buffer.ator = BumpAllocator(size_spec.staging_size, m_rd->map(m_staging_buffer.buffer));
+            m_staging_buffer.memory = m_rd->map(m_staging_buffer.buffer);
+            m_staging_buffer.ator = VirtualLinearRing(size_spec.staging_size);
+
+            m_upload_batch_size = size_spec.upload_batch_size != 0 ? size_spec.upload_batch_size : size_spec.staging_size / 2;
         }
 
         // Create device-local submesh metadata buffer
@@ -54,6 +61,14 @@ namespace mira
             m_submesh_metadata.full_view = m_rd->create_view(m_submesh_metadata.buffer, BufferViewDesc(ViewType::ShaderResource, 0, sizeof(SubmeshMetadata), MAX_UNIQUE_SUBMESHES));
             m_submesh_metadata.ator = VirtualBlockAllocator(sizeof(SubmeshMetadata), MAX_UNIQUE_SUBMESHES);
         }
+
+        // Create device-local meshlet buffers
+        if (size_spec.meshlet_buffer_size > 0)
+        {
+            create_structured_buffer(m_meshlets, sizeof(Meshlet), size_spec.meshlet_buffer_size);
+            create_structured_buffer(m_meshlet_vertices, sizeof(u32), size_spec.meshlet_vertex_buffer_size);
+            create_structured_buffer(m_meshlet_triangles, sizeof(u32), size_spec.meshlet_triangle_buffer_size);
+        }
     }
 
     MeshManager::~MeshManager()
@@ -67,64 +82,91 @@ namespace mira
         m_rd->free_buffer(m_submesh_metadata.buffer);
         m_rd->free_view(m_submesh_metadata.full_view);
 
+        for (auto* storage : { &m_meshlets, &m_meshlet_vertices, &m_meshlet_triangles })
+        {
+            if (storage->buffer.handle == 0)
+                continue;
+            m_rd->free_buffer(storage->buffer);
+            m_rd->free_view(storage->full_view);
+        }
+
         m_rd->free_buffer(m_index_buffer.buffer);
 
         m_rd->free_buffer(m_staging_buffer.buffer);
     }
 
-    MeshContainer MeshManager::load_mesh(const MeshSpecification& spec)
+    MeshContainer MeshManager::load_mesh_async(const MeshSpecification& spec)
     {
+        MIRA_PROFILE_FUNCTION();
+
         Mesh_Storage storage{};
-        RenderCommandList list;
+
+        // Bounds of each submesh, quantized positions are relative to them
+        std::vector<SubmeshMetadata> submeshes(spec.submeshes.begin(), spec.submeshes.end());
+        const f32* positions = (const f32*)spec.data.at(VertexAttribute::Position).data();
+        for (auto& submesh : submeshes)
+            compute_bounds(positions + submesh.vert_start * 3, submesh.vert_count, submesh.bounds_min, submesh.bounds_extent);
 
         // Upload each attribute
         for (const auto& [attr, data] : spec.data)
         {
-            auto total_size = data.size_bytes();
-
-            // Upload to staging
-            auto [mem, staging_offset] = m_staging_buffer.ator.allocate_with_offset(total_size);
-            std::memcpy(mem, data.data(), total_size);
+            const u32 vertex_count = (u32)(data.size_bytes() / get_stride(attr, VertexFormat::Float));
+            const u64 total_size = (u64)vertex_count * get_stride(attr, m_vertex_format);
 
             // Reserve device-local memory
             auto dl_offset = m_device_local_buffers[attr].ator.allocate(total_size);
             assert(dl_offset != (u32)-1);
 
-            // GPU-GPU copy
-            list.submit(RenderCommandCopyBuffer(
-                m_staging_buffer.buffer, staging_offset,
-                m_device_local_buffers[attr].buffer, dl_offset,
-                total_size));
+            if (total_size <= m_staging_buffer.ator.get_size())
+            {
+                // Encode into staging
+                auto [mem, staging_offset] = stage(total_size);
+                encode_attribute(attr, (const f32*)data.data(), vertex_count, submeshes, mem);
+
+                // GPU-GPU copy
+                m_pending_copies.submit(RenderCommandCopyBuffer(
+                    m_staging_buffer.buffer, staging_offset,
+                    m_device_local_buffers[attr].buffer, dl_offset,
+                    total_size));
+            }
+            else
+            {
+                // Does not fit the staging ring at once, encoded up front and staged in chunks
+                std::vector<u8> encoded(total_size);
+                encode_attribute(attr, (const f32*)data.data(), vertex_count, submeshes, encoded.data());
+                stage_copy(m_device_local_buffers[attr].buffer, dl_offset, encoded.data(), total_size);
+            }
 
             // Track device-local allocation
             storage.allocation_md[attr] = { dl_offset, total_size };
         }
 
         // Upload indices
-        {
-            auto total_size = spec.indices.size_bytes();
+        storage.indices_allocation = upload(m_index_buffer, spec.indices.data(), spec.indices.size_bytes());
 
-            // Upload to staging
-            auto [mem, staging_offset] = m_staging_buffer.ator.allocate_with_offset(total_size);
-            std::memcpy(mem, spec.indices.data(), total_size);
+        // Upload meshlets, rebased onto the shared meshlet buffers
+        if (!spec.meshlets.empty())
+        {
+            assert(m_meshlets.buffer.handle != 0);
 
-            // Reserve device-local memory
-            auto dl_offset = m_index_buffer.ator.allocate(total_size);
-            assert(dl_offset != (u32)-1);
+            storage.meshlet_vertices_allocation = upload(m_meshlet_vertices, spec.meshlet_vertices.data(), spec.meshlet_vertices.size_bytes());
+            storage.meshlet_triangles_allocation = upload(m_meshlet_triangles, spec.meshlet_triangles.data(), spec.meshlet_triangles.size_bytes());
 
-            // GPU-GPU copy
-            list.submit(RenderCommandCopyBuffer(
-                m_staging_buffer.buffer, staging_offset,
-                m_index_buffer.buffer, dl_offset,
-                total_size));
+            storage.meshlets.assign(spec.meshlets.begin(), spec.meshlets.end());
+            for (auto& meshlet : storage.meshlets)
+            {
+                meshlet.vert_offset += (u32)(storage.meshlet_vertices_allocation.first / sizeof(u32));
+                meshlet.prim_offset += (u32)(storage.meshlet_triangles_allocation.first / sizeof(u32));
+            }
 
-            // Track device-local allocation
-            storage.indices_allocation = { dl_offset, total_size };
+            storage.meshlets_allocation = upload(m_meshlets, storage.meshlets.data(), spec.meshlets.size_bytes());
+            storage.first_meshlet = (u32)(storage.meshlets_allocation.first / sizeof(Meshlet));
+            for (auto& submesh : submeshes)
+                submesh.meshlet_start += storage.first_meshlet;
         }
 
         // Track submeshes
-        auto md_copy = spec.submeshes;
-        for (const auto& submesh : spec.submeshes)
+        for (const auto& submesh : submeshes)
         {
             // Modify metadata for engine specific layout..
             // ...
@@ -138,45 +180,20 @@ namespace mira
         }
 
         // Upload mesh metadata
-        {
-            const u64 total_size = sizeof(SubmeshMetadata) * spec.submeshes.size();
-
-            // Grab staging memory and copy
-            auto [mem, staging_offset] = m_staging_buffer.ator.allocate_with_offset(total_size);
-            std::memcpy(mem, md_copy.data(), total_size);
+        storage.submeshes_md_allocation = upload(m_submesh_metadata, submeshes.data(), sizeof(SubmeshMetadata) * submeshes.size());
 
-            // Grab device-local memory
-            const u64 dl_offset = m_submesh_metadata.ator.allocate(total_size);
-            assert(dl_offset != (u32)-1);
-
-            // Assign global index based on device-local position
-            auto start = dl_offset;
-            for (auto& sm_storage : storage.submeshes)
-            {
-                sm_storage.global_idx = (u32)(start / sizeof(SubmeshMetadata));
-                start += sizeof(SubmeshMetadata);
-            }
-
-            // GPU-GPU copy
-            list.submit(RenderCommandCopyBuffer(
-                m_staging_buffer.buffer, staging_offset,
-                m_submesh_metadata.buffer, dl_offset,
-                total_size));
-
-            // Track device-local allocation
-            storage.submeshes_md_allocation = { dl_offset, total_size };
+        // Assign global index based on device-local position
+        auto start = storage.submeshes_md_allocation.first;
+        for (auto& sm_storage : storage.submeshes)
+        {
+            sm_storage.global_idx = (u32)(start / sizeof(SubmeshMetadata));
+            start += sizeof(SubmeshMetadata);
         }
 
-        // Submit commands
-        CommandList cmdls[]{ m_rd->allocate_command_list(QueueType::Copy) };
-        m_rd->compile_command_list(cmdls[0], list);
-        auto receipt = m_rd->submit_command_lists(cmdls, QueueType::Copy, {}, true);
-
-        // CPU-wait
-        m_rd->wait_for_gpu(*receipt);
-
-        // Reset bump allocator
-        m_staging_buffer.ator.clear();
+        // Staging may have submitted earlier copies of the mesh, the pending batch is the last one
+        storage.batch = m_num_submitted_batches;
+        if (m_pending_bytes >= m_upload_batch_size)
+            flush_uploads();
 
         auto handle = m_handle_ator.allocate<Mesh>();
         try_insert(m_meshes, storage, get_slot(handle.handle));
@@ -190,29 +207,104 @@ namespace mira
         return container;
     }
 
+    MeshContainer MeshManager::load_mesh(const MeshSpecification& spec)
+    {
+        const auto container = load_mesh_async(spec);
+        wait_until_ready(container.mesh);
+        return container;
+    }
+
+    bool MeshManager::is_ready(Mesh handle) const
+    {
+        return try_get(m_meshes, get_slot(handle.handle)).batch < m_num_completed_batches;
+    }
+
+    void MeshManager::wait_until_ready(Mesh handle)
+    {
+        const u64 batch = try_get(m_meshes, get_slot(handle.handle)).batch;
+        if (batch == m_num_submitted_batches)
+            flush_uploads();
+
+        // Batches complete in submission order
+        if (batch >= m_num_completed_batches)
+        {
+            assert(batch - m_num_completed_batches < m_batches_in_flight.size() && "Scheduled uploads have to be submitted before waiting on them");
+            m_rd->wait_for_gpu(m_batches_in_flight[batch - m_num_completed_batches].receipt);
+            retire_batches();
+        }
+        assert(is_ready(handle));
+    }
+
+    void MeshManager::begin_frame()
+    {
+        retire_batches();
+    }
+
+    std::optional<u32> MeshManager::schedule_uploads(QueueScheduler& scheduler)
+    {
+        if (m_pending_copies.empty())
+            return std::nullopt;
+
+        // In flight from submission on, the sync is only known then
+        const u64 staging_head = m_staging_buffer.ator.get_head();
+        return scheduler.add_batch("Mesh uploads", QueueType::Copy, { compile_uploads() }, {},
+            [this, staging_head](SyncReceipt receipt) { m_batches_in_flight.push_back({ receipt, staging_head }); });
+    }
+
+    void MeshManager::flush_uploads()
+    {
+        if (m_pending_copies.empty())
+            return;
+
+        MIRA_PROFILE_FUNCTION();
+
+        const u64 staging_head = m_staging_buffer.ator.get_head();
+        CommandList cmdls[]{ compile_uploads() };
+        const auto receipt = m_rd->submit_command_lists(cmdls, QueueType::Copy, {}, true);
+        m_batches_in_flight.push_back({ *receipt, staging_head });
+    }
+
+    CommandList MeshManager::compile_uploads()
+    {
+        const CommandList cmdl = m_rd->allocate_command_list(QueueType::Copy);
+        m_rd->compile_command_list(cmdl, std::move(m_pending_copies));
+        m_bin->push_deferred_deletion(cmdl);
+
+        ++m_num_submitted_batches;
+        m_pending_copies = RenderCommandList();
+        m_pending_bytes = 0;
+        return cmdl;
+    }
+
     void MeshManager::free_mesh(Mesh handle)
     {        
         auto& res = try_get(m_meshes, get_slot(handle.handle));
 
-        auto deletion_func = [this, &res, handle]()
+        // Recorded copies into the ranges have to be submitted before the ranges can be reused
+        if (res.batch == m_num_submitted_batches)
+            flush_uploads();
+
+        // Device-local vertex data
+        for (auto [attr, alloc_md] : res.allocation_md)
+            m_bin->push_deferred_deletion(&m_device_local_buffers[attr].ator, alloc_md.first, alloc_md.second);
+
+        // Indices
+        m_bin->push_deferred_deletion(&m_index_buffer.ator, res.indices_allocation.first, res.indices_allocation.second);
+
+        // Submeshes metadata
+        m_bin->push_deferred_deletion(&m_submesh_metadata.ator, res.submeshes_md_allocation.first, res.submeshes_md_allocation.second);
+
+        // Meshlets
+        if (!res.meshlets.empty())
         {
-            // Free device-local vertex data
-            for (auto [attr, alloc_md] : res.allocation_md)
-                m_device_local_buffers[attr].ator.free(alloc_md.first, alloc_md.second);
-
-            // Free indices
-            m_index_buffer.ator.free(res.indices_allocation.first, res.indices_allocation.second);
-
-            // Free submeshes metadata
-            m_submesh_metadata.ator.free(res.submeshes_md_allocation.first, res.submeshes_md_allocation.second);
-
-            // Free internal mesh storage
-            m_meshes[get_slot(handle.handle)] = std::nullopt;
-            m_handle_ator.free(handle);
-        };
-          
-        // Push to safe garbage bin
-        m_bin->push_deferred_deletion(deletion_func);
+            m_bin->push_deferred_deletion(&m_meshlets.ator, res.meshlets_allocation.first, res.meshlets_allocation.second);
+            m_bin->push_deferred_deletion(&m_meshlet_vertices.ator, res.meshlet_vertices_allocation.first, res.meshlet_vertices_allocation.second);
+            m_bin->push_deferred_deletion(&m_meshlet_triangles.ator, res.meshlet_triangles_allocation.first, res.meshlet_triangles_allocation.second);
+        }
+
+        // The GPU only sees the ranges, internal mesh storage can go right away
+        m_meshes[get_slot(handle.handle)] = std::nullopt;
+        m_handle_ator.free(handle);
     }
 
     Buffer MeshManager::get_index_buffer() const
@@ -230,6 +322,30 @@ namespace mira
         return m_rd->get_global_descriptor(m_submesh_metadata.full_view);
     }
 
+    u32 MeshManager::get_meshlet_buffer() const
+    {
+        return m_rd->get_global_descriptor(m_meshlets.full_view);
+    }
+
+    u32 MeshManager::get_meshlet_vertex_buffer() const
+    {
+        return m_rd->get_global_descriptor(m_meshlet_vertices.full_view);
+    }
+
+    u32 MeshManager::get_meshlet_triangle_buffer() const
+    {
+        return m_rd->get_global_descriptor(m_meshlet_triangles.full_view);
+    }
+
+    std::span<const Meshlet> MeshManager::get_meshlets(Mesh mesh, u32 submesh) const
+    {
+        const auto& res = try_get(m_meshes, get_slot(mesh.handle));
+        const auto& md = res.submeshes[submesh].md;
+        if (md.meshlet_count == 0)
+            return {};
+        return std::span<const Meshlet>(res.meshlets).subspan(md.meshlet_start - res.first_meshlet, md.meshlet_count);
+    }
+
     u32 MeshManager::get_submesh_metadata_index(Mesh mesh, u32 submesh) const
     {
         const auto& res = try_get(m_meshes, get_slot(mesh.handle));
@@ -240,8 +356,114 @@ namespace mira
         const auto& res = try_get(m_meshes, get_slot(mesh.handle));
         return res.submeshes[submesh].md;
     }
-    u32 MeshManager::get_stride(VertexAttribute attr)
+    std::pair<u8*, u64> MeshManager::stage(u64 size)
+    {
+        u64 offset = m_staging_buffer.ator.allocate(size);
+        while (offset == (u64)-1)
+        {
+            // Submit what is staged so far, then wait for the oldest upload to free its memory
+            if (!m_pending_copies.empty())
+                flush_uploads();
+            else
+            {
+                assert(!m_batches_in_flight.empty() && "Staging memory is held by scheduled uploads which have not been submitted yet");
+                m_rd->wait_for_gpu(m_batches_in_flight.front().receipt);
+                retire_batches();
+            }
+            offset = m_staging_buffer.ator.allocate(size);
+        }
+
+        m_pending_bytes += size;
+        return { m_staging_buffer.memory + offset, offset };
+    }
+
+    void MeshManager::stage_copy(Buffer dst, u64 dst_offset, const void* data, u64 size)
+    {
+        // Half the ring at most, so that the next chunk is staged while the previous one is copied
+        const u64 chunk_size = std::max<u64>(m_staging_buffer.ator.get_size() / 2, 1);
+        for (u64 offset = 0; offset < size; offset += chunk_size)
+        {
+            const u64 chunk = std::min(chunk_size, size - offset);
+            auto [mem, staging_offset] = stage(chunk);
+            std::memcpy(mem, (const u8*)data + offset, chunk);
+
+            m_pending_copies.submit(RenderCommandCopyBuffer(
+                m_staging_buffer.buffer, staging_offset,
+                dst, dst_offset + offset,
+                chunk));
+        }
+    }
+
+    std::pair<u64, u64> MeshManager::upload(DeviceLocal_Buffer& dst, const void* data, u64 size)
+    {
+        const u64 dl_offset = dst.ator.allocate(size);
+        assert(dl_offset != (u32)-1);
+
+        if (size <= m_staging_buffer.ator.get_size())
+        {
+            auto [mem, staging_offset] = stage(size);
+            std::memcpy(mem, data, size);
+
+            m_pending_copies.submit(RenderCommandCopyBuffer(
+                m_staging_buffer.buffer, staging_offset,
+                dst.buffer, dl_offset,
+                size));
+        }
+        else
+            stage_copy(dst.buffer, dl_offset, data, size);
+
+        return { dl_offset, size };
+    }
+
+    void MeshManager::create_structured_buffer(DeviceLocal_Buffer& dst, u32 stride, u32 size)
+    {
+        const u32 count = size / stride;
+        dst.buffer = m_rd->create_buffer(BufferDesc(size, MemoryType::Default));
+        dst.full_view = m_rd->create_view(dst.buffer, BufferViewDesc(ViewType::ShaderResource, 0, stride, count));
+        dst.ator = VirtualBlockAllocator(stride, count);
+    }
+
+    void MeshManager::encode_attribute(VertexAttribute attr, const f32* data, u32 vertex_count, std::span<const SubmeshMetadata> submeshes, u8* out) const
+    {
+        if (m_vertex_format == VertexFormat::Float)
+        {
+            std::memcpy(out, data, (u64)vertex_count * get_stride(attr, VertexFormat::Float));
+            return;
+        }
+
+        switch (attr)
+        {
+        case VertexAttribute::Position:
+            for (const auto& submesh : submeshes)
+                quantize_positions(data + submesh.vert_start * 3, submesh.vert_count, submesh.bounds_min, submesh.bounds_extent, (u16*)out + submesh.vert_start * 4);
+            break;
+        case VertexAttribute::Normal:
+        case VertexAttribute::Tangent:
+            encode_octahedral(data, vertex_count, (u32*)out);
+            break;
+        case VertexAttribute::UV:
+            encode_half2(data, vertex_count, (u32*)out);
+            break;
+        default:
+            assert(false);
+        }
+    }
+
+    void MeshManager::retire_batches()
+    {
+        while (!m_batches_in_flight.empty() && m_rd->is_complete(m_batches_in_flight.front().receipt))
+        {
+            m_staging_buffer.ator.free_until(m_batches_in_flight.front().staging_head);
+            m_batches_in_flight.pop_front();
+            ++m_num_completed_batches;
+        }
+    }
+
+    u32 MeshManager::get_stride(VertexAttribute attr, VertexFormat format)
     {
+        if (format == VertexFormat::Quantized)
+            return attr == VertexAttribute::Position ? 4 * sizeof(u16) : sizeof(u32);
+
         switch (attr)
         {
         case VertexAttribute::Position:
@@ -1,8 +1,10 @@
 #pragma once
 #include "Types/MeshTypes.h"
 #include "../RHI/RHITypes.h"
-#include "../Memory/BumpAllocator.h"			// For staging buffer sub-allocation
+#include "../RHI/RenderCommandList.h"
+#include "../Memory/VirtualLinearRing.h"		// For staging buffer sub-allocation
 #include "../Memory/VirtualBlockAllocator.h"	// For device-local buffer sub-allocation
+#include <deque>
 
 #include "../Handles/HandleAllocator.h"
 
@@ -10,6 +12,7 @@ namespace mira
 {
 	class RenderDevice;
 	class GPUGarbageBin;
+	class QueueScheduler;
 
 	class MeshManager
 	{
@@ -20,6 +23,11 @@ namespace mira
 			std::unordered_map<VertexAttribute, std::span<u8>> data;
 			std::span<u32> indices;
 			std::span<SubmeshMetadata> submeshes;
+
+			// Optional clusters (MeshletBuilder), referenced by the meshlet ranges of the submeshes
+			std::span<Meshlet> meshlets;
+			std::span<u32> meshlet_vertices;
+			std::span<u32> meshlet_triangles;
 		};
 
 		struct SizeSpecification
@@ -27,6 +35,16 @@ namespace mira
 			std::unordered_map<VertexAttribute, u32> buffer_sizes;
 			u32 index_buffer_size{ 0 };
 			u32 staging_size{ 0 };
+
+			// Zero if meshes are loaded without meshlets
+			u32 meshlet_buffer_size{ 0 };
+			u32 meshlet_vertex_buffer_size{ 0 };
+			u32 meshlet_triangle_buffer_size{ 0 };
+
+			VertexFormat vertex_format{ VertexFormat::Float };
+
+			// Staged bytes after which uploads are submitted right away rather than with the next schedule_uploads, 0 for half the staging size
+			u32 upload_batch_size{ 0 };
 		};
 
 	public:
@@ -34,12 +52,40 @@ namespace mira
 		~MeshManager();
 	
 		/*
-			Meshes are loaded on the Graphics queue.
+			Meshes are uploaded on the Copy queue in batches:
+				- The data is staged and the copies recorded, the returned handle is valid right away
+				- Recorded copies are added to the frame's QueueScheduler by schedule_uploads, submitted by flush_uploads,
+				  or submitted right away once 'upload_batch_size' bytes have been staged
+				- Staging memory is reclaimed once the Copy queue has passed the sync of the batch
+				- Data larger than the staging ring is staged in chunks, submitting and waiting for earlier ones as the ring fills up
+
+			A mesh may only be drawn once is_ready reports its copies as completed.
 		*/
+		MeshContainer load_mesh_async(const MeshSpecification& spec);
+
+		// Blocks until the mesh is ready
 		MeshContainer load_mesh(const MeshSpecification& spec);
 
+		bool is_ready(Mesh handle) const;
+		void wait_until_ready(Mesh handle);
+
+		// Reclaims staging memory of completed uploads
+		void begin_frame();
+
+		// Adds the copies recorded since the last submission as a Copy batch, which is returned to depend on (none if nothing was recorded).
+		// The scheduler has to be submitted before meshes of the batch are waited on.
+		std::optional<u32> schedule_uploads(QueueScheduler& scheduler);
+
+		// Submits the copies recorded since the last submission
+		void flush_uploads();
+
 		void free_mesh(Mesh handle);
 
+		VertexFormat get_vertex_format() const { return m_vertex_format; }
+
+		// Bytes per vertex of an attribute on the GPU
+		static u32 get_stride(VertexAttribute attr, VertexFormat format);
+
 		// Used for binding so that vertex cache is utilized on draw
 		Buffer get_index_buffer() const;
 
@@ -55,6 +101,14 @@ namespace mira
 		// Grab metadata on CPU-side (for CPU-side draw call generation)
 		const SubmeshMetadata& get_submesh_metadata(Mesh mesh, u32 submesh) const;
 
+		// Get GPU-indexable identifiers for the meshlet buffers (ShaderInterop_Meshlet, submesh relative u32 vertices, packed u8x3 triangles)
+		u32 get_meshlet_buffer() const;
+		u32 get_meshlet_vertex_buffer() const;
+		u32 get_meshlet_triangle_buffer() const;
+
+		// Meshlets of a submesh on CPU-side (for CPU-side culling), offsets point into the shared meshlet buffers
+		std::span<const Meshlet> get_meshlets(Mesh mesh, u32 submesh) const;
+
 	private:
 		struct Submesh_Storage
 		{
@@ -73,6 +127,14 @@ namespace mira
 			std::pair<u64, u64> submeshes_md_allocation;
 			std::pair<u64, u64> indices_allocation;
 
+			std::vector<Meshlet> meshlets;
+			u32 first_meshlet{ 0 };		// Global index of meshlets[0]
+			std::pair<u64, u64> meshlets_allocation;
+			std::pair<u64, u64> meshlet_vertices_allocation;
+			std::pair<u64, u64> meshlet_triangles_allocation;
+
+			// Last upload batch with copies of this mesh
+			u64 batch{ 0 };
 		};
 
 		// Non-interleaved vertex data
@@ -86,15 +148,41 @@ namespace mira
 		struct Staging_Buffer
 		{
 			mira::Buffer buffer;
-			BumpAllocator ator;
+			u8* memory{ nullptr };
+			VirtualLinearRing ator;
+		};
+
+		struct UploadBatch
+		{
+			SyncReceipt receipt;
+			u64 staging_head{ 0 };		// Staging memory up to this ring position is free once the batch has completed
 		};
 
 	private:
-		u32 get_stride(VertexAttribute attr);
+		// Staging memory and its offset, waits for in-flight uploads if there is no room. 'size' has to fit the staging ring.
+		std::pair<u8*, u64> stage(u64 size);
+
+		// Stages the data and records its copy to 'dst' in chunks, for data which does not fit the staging ring at once
+		void stage_copy(Buffer dst, u64 dst_offset, const void* data, u64 size);
+
+		// Stages the data and records its copy into newly allocated memory of 'dst' (in chunks if it does not fit the staging ring), { offset, size }
+		std::pair<u64, u64> upload(DeviceLocal_Buffer& dst, const void* data, u64 size);
+
+		void create_structured_buffer(DeviceLocal_Buffer& dst, u32 stride, u32 size);
+
+		// Writes float vertex data in the GPU format, positions are quantized per submesh
+		void encode_attribute(VertexAttribute attr, const f32* data, u32 vertex_count, std::span<const SubmeshMetadata> submeshes, u8* out) const;
+
+		// Compiles the copies recorded since the last submission into the next batch
+		CommandList compile_uploads();
+
+		// Pops the completed batches in submission order
+		void retire_batches();
 
 	private:
 		RenderDevice* m_rd{ nullptr };
 		GPUGarbageBin* m_bin{ nullptr };
+		VertexFormat m_vertex_format{ VertexFormat::Float };
 
 		HandleAllocator m_handle_ator;
 
@@ -103,10 +191,20 @@ namespace mira
 		std::unordered_map<VertexAttribute, DeviceLocal_Buffer> m_device_local_buffers;
 		DeviceLocal_Buffer m_index_buffer;
 		DeviceLocal_Buffer m_submesh_metadata;
+		DeviceLocal_Buffer m_meshlets;
+		DeviceLocal_Buffer m_meshlet_vertices;
+		DeviceLocal_Buffer m_meshlet_triangles;
 		Staging_Buffer m_staging_buffer;
 
-		// Upload technique is to submit copy to copy queue and immediately flush after each mesh load for simplicity
-		mira::CommandList m_cmdl;
+		// Copies recorded since the last submission form batch 'm_num_submitted_batches'.
+		// Scheduled batches are in flight once the scheduler has submitted them.
+		RenderCommandList m_pending_copies;
+		u64 m_pending_bytes{ 0 };
+		u64 m_upload_batch_size{ 0 };
+
+		std::deque<UploadBatch> m_batches_in_flight;
+		u64 m_num_submitted_batches{ 0 };
+		u64 m_num_completed_batches{ 0 };
 	};
 }
 
@@ -0,0 +1,176 @@
+#include "QueueScheduler.h"
+#include "../RHI/RenderDevice.h"
+#include <chrono>
+
+namespace mira
+{
+	namespace
+	{
+		const char* get_queue_name(QueueType queue)
+		{
+			switch (queue)
+			{
+			case QueueType::Graphics:
+				return "Graphics";
+			case QueueType::Compute:
+				return "Compute";
+			case QueueType::Copy:
+				return "Copy";
+			default:
+				return "None";
+			}
+		}
+
+		f64 get_time_ms()
+		{
+			return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+	}
+
+	QueueScheduler::QueueScheduler(RenderDevice* rd) :
+		m_rd(rd)
+	{
+	}
+
+	void QueueScheduler::begin_frame()
+	{
+		m_batches.clear();
+	}
+
+	u32 QueueScheduler::add_batch(std::string name, QueueType queue, std::vector<CommandList> lists, std::vector<u32> dependencies,
+		std::function<void(SyncReceipt)> on_submit)
+	{
+		assert((u32)queue < NUM_QUEUES);
+		assert(!lists.empty());
+
+		Batch batch{};
+		batch.name = std::move(name);
+		batch.queue = queue;
+		batch.lists = std::move(lists);
+		batch.dependencies = std::move(dependencies);
+		batch.on_submit = std::move(on_submit);
+		m_batches.push_back(std::move(batch));
+		return (u32)m_batches.size() - 1;
+	}
+
+	void QueueScheduler::submit()
+	{
+		schedule();
+
+		m_trace.clear();
+		std::vector<std::optional<SyncReceipt>> receipts(m_batches.size());
+		for (u32 i = 0; i < m_batches.size(); ++i)
+		{
+			auto& batch = m_batches[i];
+			for (u32 wait : batch.waits)
+			{
+				const f64 start_ms = get_time_ms();
+				m_rd->insert_wait(batch.queue, *receipts[wait]);
+				m_trace.push_back({ TraceEvent::Type::Wait, batch.queue, wait, start_ms, get_time_ms() - start_ms });
+			}
+
+			const f64 start_ms = get_time_ms();
+			receipts[i] = m_rd->submit_command_lists(batch.lists, batch.queue, std::nullopt, batch.signals);
+			m_trace.push_back({ TraceEvent::Type::Execute, batch.queue, i, start_ms, get_time_ms() - start_ms });
+
+			if (batch.on_submit)
+				batch.on_submit(*receipts[i]);
+		}
+	}
+
+	std::string QueueScheduler::format_trace() const
+	{
+		std::string trace;
+		for (u32 q = 0; q < NUM_QUEUES; ++q)
+		{
+			trace += get_queue_name((QueueType)q);
+			trace += ":";
+			for (const auto& event : m_trace)
+			{
+				if ((u32)event.queue != q)
+					continue;
+
+				const auto& name = m_batches[event.batch].name;
+				if (event.type == TraceEvent::Type::Wait)
+					trace += " (wait " + std::string(get_queue_name(m_batches[event.batch].queue)) + "/" + name + ")";
+				else
+					trace += " [" + name + "]";
+			}
+			trace += "\n";
+		}
+		return trace;
+	}
+
+	std::vector<Profiler::Event> QueueScheduler::get_profile_events() const
+	{
+		std::vector<Profiler::Event> events;
+		events.reserve(m_trace.size());
+		for (const auto& event : m_trace)
+		{
+			Profiler::Event profile_event{};
+			profile_event.track = std::string("Queue ") + get_queue_name(event.queue);
+			profile_event.name = event.type == TraceEvent::Type::Wait ?
+				"Wait " + std::string(get_queue_name(m_batches[event.batch].queue)) + "/" + m_batches[event.batch].name :
+				m_batches[event.batch].name;
+			profile_event.start_ms = event.start_ms;
+			profile_event.duration_ms = event.duration_ms;
+			events.push_back(std::move(profile_event));
+		}
+		return events;
+	}
+
+	void QueueScheduler::schedule()
+	{
+		m_num_waits = 0;
+		m_num_elided_waits = 0;
+
+		// Per queue: latest batch of each queue known to be complete before the next batch on it starts
+		std::array<QueueClock, NUM_QUEUES> known{};
+
+		for (u32 i = 0; i < m_batches.size(); ++i)
+		{
+			auto& batch = m_batches[i];
+			const u32 q = (u32)batch.queue;
+			batch.waits.clear();
+			batch.signals = (bool)batch.on_submit;
+
+			// Waiting on the latest dependency of a queue covers the earlier ones on it
+			std::array<u32, NUM_QUEUES> latest;
+			latest.fill(UINT_MAX);
+			u32 cross_queue_dependencies = 0;
+			for (u32 dep : batch.dependencies)
+			{
+				assert(dep < i);
+				const u32 s = (u32)m_batches[dep].queue;
+				if (s == q)
+					continue;
+
+				++cross_queue_dependencies;
+				if (latest[s] == UINT_MAX || m_batches[dep].sequence > m_batches[latest[s]].sequence)
+					latest[s] = dep;
+			}
+
+			for (u32 s = 0; s < NUM_QUEUES; ++s)
+			{
+				if (latest[s] == UINT_MAX)
+					continue;
+
+				// Covered by an earlier wait, possibly through another queue
+				auto& dep = m_batches[latest[s]];
+				if (known[q][s] >= dep.sequence)
+					continue;
+
+				batch.waits.push_back(latest[s]);
+				dep.signals = true;
+				for (u32 t = 0; t < NUM_QUEUES; ++t)
+					known[q][t] = std::max(known[q][t], dep.clock[t]);
+			}
+
+			batch.sequence = ++known[q][q];
+			batch.clock = known[q];
+
+			m_num_waits += (u32)batch.waits.size();
+			m_num_elided_waits += cross_queue_dependencies - (u32)batch.waits.size();
+		}
+	}
+}
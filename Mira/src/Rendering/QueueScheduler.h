@@ -0,0 +1,102 @@
+#pragma once
+#include "../Common.h"
+#include "../RHI/RenderResourceHandle.h"
+#include "../RHI/RHITypes.h"
+#include "../Profiling/Profiler.h"
+#include <string>
+
+namespace mira
+{
+	class RenderDevice;
+
+	/*
+		Submits batches of compiled command lists to the graphics, compute and copy queues with the fewest cross-queue waits.
+
+		Per frame:
+			begin_frame()
+			add_batch with the queue and the batches it depends on (added earlier in the same frame)
+			submit() --> batches are submitted in the order they were added
+
+		- Dependencies on the same queue need no wait, queues execute in order.
+		- A cross-queue dependency is skipped if the queue already waited (directly or transitively) on it or on a later batch of the same queue.
+		  Each batch carries what its queue is known to have waited for (a vector clock), which is inherited through every wait.
+		- Only batches which are waited on, or which want their sync (see add_batch), signal a sync.
+		- The trace of the last submission shows what each queue executed and where it waited, with the interval each wait and
+		  batch took to hand to its queue. The Null device executes on submission, so there they are the execution intervals.
+	*/
+	class QueueScheduler
+	{
+	public:
+		struct TraceEvent
+		{
+			enum class Type
+			{
+				Execute,
+				Wait,
+			};
+
+			Type type{ Type::Execute };
+			QueueType queue{ QueueType::Graphics };
+			u32 batch{ 0 };					// Executed or waited on batch
+
+			// On the std::chrono::steady_clock timeline, as profiler events
+			f64 start_ms{ 0.0 };
+			f64 duration_ms{ 0.0 };
+		};
+
+	public:
+		QueueScheduler(RenderDevice* rd);
+
+		void begin_frame();
+
+		// Lists must be compiled for 'queue'. Returns the batch ID to depend on.
+		// 'on_submit' is called with the sync of the batch once it is submitted (e.g to track its completion), the batch signals for it.
+		u32 add_batch(std::string name, QueueType queue, std::vector<CommandList> lists, std::vector<u32> dependencies = {},
+			std::function<void(SyncReceipt)> on_submit = {});
+
+		void submit();
+
+		const std::vector<TraceEvent>& get_trace() const { return m_trace; }
+
+		// One line per queue, in submission order
+		std::string format_trace() const;
+
+		// Trace as profiler events, one track per queue (e.g "Queue Copy"), for Profiler::add_events
+		std::vector<Profiler::Event> get_profile_events() const;
+
+		// Waits issued and cross-queue dependencies which were already satisfied, for the last submission
+		u32 get_num_waits() const { return m_num_waits; }
+		u32 get_num_elided_waits() const { return m_num_elided_waits; }
+
+	private:
+		static constexpr u32 NUM_QUEUES = 3;
+		using QueueClock = std::array<u32, NUM_QUEUES>;
+
+		struct Batch
+		{
+			std::string name;
+			QueueType queue{ QueueType::Graphics };
+			std::vector<CommandList> lists;
+			std::vector<u32> dependencies;
+			std::function<void(SyncReceipt)> on_submit;
+
+			// Filled in on submission
+			u32 sequence{ 0 };				// Position on its queue, starting at 1
+			QueueClock clock{};				// Batches of each queue known to be complete once this batch is
+			std::vector<u32> waits;
+			bool signals{ false };
+		};
+
+	private:
+		void schedule();
+
+	private:
+		RenderDevice* m_rd{ nullptr };
+
+		std::vector<Batch> m_batches;
+
+		std::vector<TraceEvent> m_trace;
+		u32 m_num_waits{ 0 };
+		u32 m_num_elided_waits{ 0 };
+	};
+}
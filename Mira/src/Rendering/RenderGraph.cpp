@@ -0,0 +1,781 @@
+#include "RenderGraph.h"
+#include "GPUGarbageBin.h"
+#include "../RHI/RenderDevice.h"
+
+namespace mira
+{
+	namespace
+	{
+		// Writes which (may) depend on the previous contents keep earlier writers alive
+		bool preserves_contents(ResourceState state)
+		{
+			return state == ResourceState::UnorderedAccess;
+		}
+
+		u64 hash_range(u64 hash, const TextureViewRange& range)
+		{
+			hash = hash_combine(hash, range.dimension);
+			hash = hash_combine(hash, range.format);
+			hash = hash_combine(hash, range.base_mip_level);
+			hash = hash_combine(hash, range.mip_levels);
+			hash = hash_combine(hash, range.array_base);
+			hash = hash_combine(hash, range.array_count);
+			hash = hash_combine(hash, range.min_lod_clamp);
+			hash = hash_combine(hash, range.depth_read_only);
+			hash = hash_combine(hash, range.stencil_read_only);
+			return hash;
+		}
+
+		void append_range(std::vector<u64>& key, const TextureViewRange& range)
+		{
+			u32 min_lod_clamp{ 0 };
+			std::memcpy(&min_lod_clamp, &range.min_lod_clamp, sizeof(min_lod_clamp));
+
+			key.push_back((u64)range.dimension);
+			key.push_back((u64)range.format);
+			key.push_back(((u64)range.base_mip_level << 32) | range.mip_levels);
+			key.push_back(((u64)range.array_base << 32) | range.array_count);
+			key.push_back(((u64)min_lod_clamp << 2) | ((u64)range.depth_read_only << 1) | (u64)range.stencil_read_only);
+		}
+
+		bool same_range(const TextureViewRange& a, const TextureViewRange& b)
+		{
+			return a.dimension == b.dimension && a.format == b.format &&
+				a.base_mip_level == b.base_mip_level && a.mip_levels == b.mip_levels &&
+				a.array_base == b.array_base && a.array_count == b.array_count &&
+				a.min_lod_clamp == b.min_lod_clamp &&
+				a.depth_read_only == b.depth_read_only && a.stencil_read_only == b.stencil_read_only;
+		}
+	}
+
+	Texture RGExecuteContext::get_texture(RGTexture texture) const
+	{
+		const auto& res = m_graph->m_resources[texture.id];
+		assert(res.kind == RenderGraph::ResourceKind::Texture);
+		return Texture{ res.handle };
+	}
+
+	Buffer RGExecuteContext::get_buffer(RGBuffer buffer) const
+	{
+		const auto& res = m_graph->m_resources[buffer.id];
+		assert(res.kind == RenderGraph::ResourceKind::Buffer);
+		return Buffer{ res.handle };
+	}
+
+	TextureView RGExecuteContext::get_view(RGTexture texture, const TextureViewDesc& desc) const
+	{
+		return m_graph->get_view(get_texture(texture), desc);
+	}
+
+	RGPassBuilder& RGPassBuilder::read(RGTexture texture, ResourceState state)
+	{
+		m_graph->m_passes[m_pass].accesses.push_back({ texture.id, state, false });
+		return *this;
+	}
+
+	RGPassBuilder& RGPassBuilder::read(RGBuffer buffer, ResourceState state)
+	{
+		m_graph->m_passes[m_pass].accesses.push_back({ buffer.id, state, false });
+		return *this;
+	}
+
+	RGPassBuilder& RGPassBuilder::write(RGTexture texture, ResourceState state)
+	{
+		m_graph->m_passes[m_pass].accesses.push_back({ texture.id, state, true });
+		return *this;
+	}
+
+	RGPassBuilder& RGPassBuilder::write(RGBuffer buffer, ResourceState state)
+	{
+		m_graph->m_passes[m_pass].accesses.push_back({ buffer.id, state, true });
+		return *this;
+	}
+
+	RGPassBuilder& RGPassBuilder::add_render_target(RGTexture texture, const TextureViewRange& range, RenderPassBeginAccessType begin, RenderPassEndingAccessType end)
+	{
+		auto& pass = m_graph->m_passes[m_pass];
+		pass.render_targets.push_back({ texture.id, range, begin, end });
+		pass.accesses.push_back({ texture.id, ResourceState::RenderTarget, true });
+		return *this;
+	}
+
+	RGPassBuilder& RGPassBuilder::set_depth_stencil(RGTexture texture, const TextureViewRange& range, RenderPassBeginAccessType begin, RenderPassEndingAccessType end)
+	{
+		auto& pass = m_graph->m_passes[m_pass];
+		assert(!pass.depth_stencil.has_value());
+		pass.depth_stencil = { texture.id, range, begin, end };
+
+		if (range.depth_read_only)
+			pass.accesses.push_back({ texture.id, ResourceState::DepthRead, false });
+		else
+			pass.accesses.push_back({ texture.id, ResourceState::DepthWrite, true });
+		return *this;
+	}
+
+	RGPassBuilder& RGPassBuilder::set_side_effects()
+	{
+		m_graph->m_passes[m_pass].side_effects = true;
+		return *this;
+	}
+
+	RenderGraph::RenderGraph(RenderDevice* rd, GPUGarbageBin* bin) :
+		m_rd(rd),
+		m_bin(bin),
+		m_transients(rd, bin)
+	{
+	}
+
+	RenderGraph::~RenderGraph()
+	{
+		for (const auto& [_, rp] : m_renderpasses)
+			m_rd->free_renderpass(rp.rp);
+
+		for (const auto& [_, view] : m_views)
+			m_rd->free_view(view.view);
+	}
+
+	void RenderGraph::begin_frame()
+	{
+		++m_frame;
+
+		m_resources.clear();
+		m_passes.clear();
+
+		evict_unused();
+	}
+
+	RGTexture RenderGraph::import_texture(Texture texture, ResourceState initial_state, std::optional<ResourceState> final_state)
+	{
+		auto it = m_texture_states.try_emplace(texture.handle, initial_state).first;
+
+		Resource res{};
+		res.kind = ResourceKind::Texture;
+		res.imported = true;
+		res.handle = texture.handle;
+		res.entry_state = it->second;
+		res.final_state = final_state;
+		return RGTexture{ add_resource(res) };
+	}
+
+	RGBuffer RenderGraph::import_buffer(Buffer buffer, ResourceState initial_state, std::optional<ResourceState> final_state)
+	{
+		auto it = m_buffer_states.try_emplace(buffer.handle, initial_state).first;
+
+		Resource res{};
+		res.kind = ResourceKind::Buffer;
+		res.imported = true;
+		res.handle = buffer.handle;
+		res.entry_state = it->second;
+		res.final_state = final_state;
+		return RGBuffer{ add_resource(res) };
+	}
+
+	RGTexture RenderGraph::create_texture(const TextureDesc& desc)
+	{
+		Resource res{};
+		res.kind = ResourceKind::Texture;
+		res.final_state = ResourceState::Common;
+		res.texture_desc = desc;
+		res.desc_hash = hash_desc(desc);
+		return RGTexture{ add_resource(res) };
+	}
+
+	RGBuffer RenderGraph::create_buffer(const BufferDesc& desc)
+	{
+		Resource res{};
+		res.kind = ResourceKind::Buffer;
+		res.final_state = ResourceState::Common;
+		res.buffer_desc = desc;
+		res.desc_hash = hash_desc(desc);
+		return RGBuffer{ add_resource(res) };
+	}
+
+	RGPassBuilder RenderGraph::add_pass(const std::string& name, ExecuteFunc&& func)
+	{
+		Pass pass{};
+		pass.name = name;
+		pass.func = std::move(func);
+		m_passes.push_back(std::move(pass));
+
+		return RGPassBuilder(this, (u32)m_passes.size() - 1);
+	}
+
+	RenderCommandList RenderGraph::execute()
+	{
+		// Re-use compilation if the declared structure has been seen before, a colliding hash replaces the entry
+		build_declaration_key(m_declaration_key);
+		const u64 hash = hash_bytes(m_declaration_key.data(), m_declaration_key.size() * sizeof(u64));
+
+		auto& cached = m_compiled[hash];
+		if (cached.key != m_declaration_key)
+		{
+			cached.key = m_declaration_key;
+			cached.graph = CompiledGraph{};
+			compile(cached.graph);
+		}
+		cached.last_used_frame = m_frame;
+
+		const auto& compiled = cached.graph;
+		allocate_transients(compiled);
+
+		RenderCommandList list;
+		record(compiled, list);
+
+		// Carry states over to the next frame
+		for (u32 i = 0; i < m_resources.size(); ++i)
+		{
+			const auto& res = m_resources[i];
+			if (!res.imported)
+				continue;
+
+			auto& states = res.kind == ResourceKind::Texture ? m_texture_states : m_buffer_states;
+			states[res.handle] = compiled.exit_states[i];
+		}
+
+		return list;
+	}
+
+	u32 RenderGraph::add_resource(const Resource& resource)
+	{
+		m_resources.push_back(resource);
+		return (u32)m_resources.size() - 1;
+	}
+
+	void RenderGraph::build_declaration_key(std::vector<u64>& key) const
+	{
+		key.clear();
+
+		key.push_back(m_resources.size());
+		for (const auto& res : m_resources)
+		{
+			key.push_back(((u64)res.kind << 1) | (u64)res.imported);
+			key.push_back(res.desc_hash);
+			key.push_back((u64)res.entry_state);
+			key.push_back(res.final_state.has_value() ? (u64)*res.final_state : UINT64_MAX);
+		}
+
+		key.push_back(m_passes.size());
+		for (const auto& pass : m_passes)
+		{
+			key.push_back(pass.side_effects);
+
+			key.push_back(pass.accesses.size());
+			for (const auto& access : pass.accesses)
+			{
+				key.push_back(access.resource);
+				key.push_back(((u64)access.state << 1) | (u64)access.write);
+			}
+
+			key.push_back(pass.render_targets.size());
+			for (const auto& rt : pass.render_targets)
+			{
+				key.push_back(rt.resource);
+				key.push_back(((u64)rt.begin << 32) | (u64)rt.end);
+				append_range(key, rt.range);
+			}
+
+			key.push_back(pass.depth_stencil.has_value());
+			if (pass.depth_stencil.has_value())
+			{
+				key.push_back(pass.depth_stencil->resource);
+				key.push_back(((u64)pass.depth_stencil->begin << 32) | (u64)pass.depth_stencil->end);
+				append_range(key, pass.depth_stencil->range);
+			}
+		}
+	}
+
+	void RenderGraph::compile(CompiledGraph& compiled) const
+	{
+		// Cull: walk backwards from the outputs (imported resources) and keep passes which produce something that is consumed
+		std::vector<bool> alive(m_passes.size(), false);
+		std::vector<bool> needed(m_resources.size(), false);
+		for (u32 i = 0; i < m_resources.size(); ++i)
+			needed[i] = m_resources[i].imported;
+
+		for (i32 i = (i32)m_passes.size() - 1; i >= 0; --i)
+		{
+			const auto& pass = m_passes[i];
+
+			bool live = pass.side_effects;
+			for (const auto& access : pass.accesses)
+				live |= access.write && needed[access.resource];
+
+			if (!live)
+				continue;
+
+			alive[i] = true;
+			for (const auto& access : pass.accesses)
+			{
+				if (!access.write || preserves_contents(access.state))
+					needed[access.resource] = true;
+			}
+
+			// Attachments which are loaded depend on earlier writers
+			for (const auto& rt : pass.render_targets)
+			{
+				if (rt.begin == RenderPassBeginAccessType::Preserve)
+					needed[rt.resource] = true;
+			}
+			if (pass.depth_stencil.has_value() && pass.depth_stencil->begin == RenderPassBeginAccessType::Preserve)
+				needed[pass.depth_stencil->resource] = true;
+		}
+
+		// Derive barriers in execution order, grouped per compiled pass (last group is the final one)
+		std::vector<ResourceState> states(m_resources.size());
+		std::vector<bool> uav_written(m_resources.size(), false);
+		for (u32 i = 0; i < m_resources.size(); ++i)
+			states[i] = m_resources[i].entry_state;
+		compiled.lifetimes.assign(m_resources.size(), { UINT_MAX, UINT_MAX });
+
+		// Transitions which may be split: group and index of the barrier, and the compiled pass which last used the resource (UINT_MAX if before the graph)
+		struct SplitCandidate
+		{
+			u32 group{ 0 };
+			u32 barrier{ 0 };
+			u32 prev_use{ UINT_MAX };
+		};
+		std::vector<std::vector<CompiledBarrier>> groups;
+		std::vector<SplitCandidate> split_candidates;
+
+		for (u32 i = 0; i < m_passes.size(); ++i)
+		{
+			if (!alive[i])
+				continue;
+
+			CompiledPass cp{};
+			cp.pass = i;
+
+			const u32 compiled_idx = (u32)compiled.passes.size();
+			auto& group = groups.emplace_back();
+			for (const auto& access : m_passes[i].accesses)
+			{
+				auto& lifetime = compiled.lifetimes[access.resource];
+				const u32 prev_use = lifetime.second;
+				if (lifetime.first == UINT_MAX)
+					lifetime.first = compiled_idx;
+				lifetime.second = compiled_idx;
+
+				if (states[access.resource] != access.state)
+				{
+					// Graph owned resources only exist from their first use onwards
+					if (prev_use != UINT_MAX || m_resources[access.resource].imported)
+						split_candidates.push_back({ compiled_idx, (u32)group.size(), prev_use });
+
+					group.push_back({ access.resource, states[access.resource], access.state, false });
+					states[access.resource] = access.state;
+				}
+				else if (access.state == ResourceState::UnorderedAccess && uav_written[access.resource])
+				{
+					group.push_back({ access.resource, access.state, access.state, true });
+				}
+
+				uav_written[access.resource] = access.write && access.state == ResourceState::UnorderedAccess;
+			}
+
+			compiled.passes.push_back(cp);
+		}
+
+		// Merge render passes: consecutive passes with identical attachments which load the previous contents and need no barriers in between
+		auto same_attachments = [](const Pass& a, const Pass& b)
+		{
+			if (a.render_targets.size() != b.render_targets.size() || a.depth_stencil.has_value() != b.depth_stencil.has_value())
+				return false;
+
+			for (u32 i = 0; i < a.render_targets.size(); ++i)
+			{
+				if (a.render_targets[i].resource != b.render_targets[i].resource || !same_range(a.render_targets[i].range, b.render_targets[i].range))
+					return false;
+				if (b.render_targets[i].begin != RenderPassBeginAccessType::Preserve)
+					return false;
+			}
+
+			if (a.depth_stencil.has_value())
+			{
+				if (a.depth_stencil->resource != b.depth_stencil->resource || !same_range(a.depth_stencil->range, b.depth_stencil->range))
+					return false;
+				if (b.depth_stencil->begin != RenderPassBeginAccessType::Preserve)
+					return false;
+			}
+
+			return true;
+		};
+
+		u32 group_first = UINT_MAX;
+		for (u32 i = 0; i < compiled.passes.size(); ++i)
+		{
+			auto& cp = compiled.passes[i];
+			const auto& pass = m_passes[cp.pass];
+			if (!pass.has_attachments())
+			{
+				group_first = UINT_MAX;
+				continue;
+			}
+
+			// Transient resources may need to be activated (aliasing barrier) before their first use
+			bool activates_transient = false;
+			for (u32 r = 0; r < m_resources.size(); ++r)
+				activates_transient |= !m_resources[r].imported && compiled.lifetimes[r].first == i;
+
+			if (group_first != UINT_MAX && groups[i].empty() && !activates_transient && same_attachments(m_passes[compiled.passes[i - 1].pass], pass))
+			{
+				compiled.passes[i - 1].ends_render_pass = false;
+				compiled.passes[group_first].render_pass_last = cp.pass;
+			}
+			else
+			{
+				group_first = i;
+				cp.begins_render_pass = true;
+				cp.render_pass_last = cp.pass;
+			}
+			cp.ends_render_pass = true;
+		}
+
+		auto can_place_barriers = [&](u32 compiled_idx)
+		{
+			const auto& cp = compiled.passes[compiled_idx];
+			return cp.begins_render_pass || !m_passes[cp.pass].has_attachments();
+		};
+
+		// Leave resources in their requested final states
+		auto& final_group = groups.emplace_back();
+		for (u32 i = 0; i < m_resources.size(); ++i)
+		{
+			const auto& final_state = m_resources[i].final_state;
+			if (!final_state.has_value() || states[i] == *final_state)
+				continue;
+
+			if (m_resources[i].imported)
+			{
+				split_candidates.push_back({ (u32)compiled.passes.size(), (u32)final_group.size(), compiled.lifetimes[i].second });
+				final_group.push_back({ i, states[i], *final_state, false });
+			}
+			else
+			{
+				/*
+					Memory of graph owned resources is handed to another one by its aliasing barrier, after which the resource is inactive.
+					Retire it in the first group after its last use instead of the final one, later activations start a render pass
+					(or have no attachments) so they can not come earlier.
+				*/
+				u32 group = (u32)compiled.passes.size();
+				for (u32 k = compiled.lifetimes[i].second + 1; k < compiled.passes.size(); ++k)
+				{
+					if (can_place_barriers(k))
+					{
+						group = k;
+						break;
+					}
+				}
+
+				CompiledBarrier retire{ i, states[i], *final_state, false };
+				retire.retire = true;
+				groups[group].push_back(retire);
+			}
+			states[i] = *final_state;
+		}
+
+		/*
+			Split transitions: begin right after the last use of the resource and end right before the next one,
+			so that the transition (e.g decompression or cache flushes) overlaps with the passes in between.
+			The begin goes into the first group after the last use which is not in the middle of a merged render pass.
+		*/
+
+		for (const auto& candidate : split_candidates)
+		{
+			const u32 first = candidate.prev_use == UINT_MAX ? 0 : candidate.prev_use + 1;
+			for (u32 k = first; k < candidate.group; ++k)
+			{
+				if (!can_place_barriers(k))
+					continue;
+
+				auto& end = groups[candidate.group][candidate.barrier];
+				end.split = ResourceBarrier::Split::EndOnly;
+
+				auto begin = end;
+				begin.split = ResourceBarrier::Split::BeginOnly;
+				groups[k].push_back(begin);
+				break;
+			}
+		}
+
+		for (u32 i = 0; i < compiled.passes.size(); ++i)
+		{
+			auto& cp = compiled.passes[i];
+			cp.first_barrier = (u32)compiled.barriers.size();
+			cp.num_barriers = (u32)groups[i].size();
+			compiled.barriers.insert(compiled.barriers.end(), groups[i].cbegin(), groups[i].cend());
+		}
+
+		compiled.first_final_barrier = (u32)compiled.barriers.size();
+		compiled.barriers.insert(compiled.barriers.end(), groups.back().cbegin(), groups.back().cend());
+
+		compiled.exit_states = std::move(states);
+	}
+
+	void RenderGraph::allocate_transients(const CompiledGraph& compiled)
+	{
+		m_transients.begin_frame();
+		m_transient_ids.assign(m_resources.size(), UINT_MAX);
+		for (u32 i = 0; i < m_resources.size(); ++i)
+		{
+			const auto& res = m_resources[i];
+			const auto [first, last] = compiled.lifetimes[i];
+			if (res.imported || first == UINT_MAX)
+				continue;
+
+			m_transient_ids[i] = res.kind == ResourceKind::Texture ?
+				m_transients.declare_texture(res.texture_desc, first, last) :
+				m_transients.declare_buffer(res.buffer_desc, first, last);
+		}
+		m_transients.allocate();
+
+		std::vector<u64> transient_textures;
+		for (u32 i = 0; i < m_resources.size(); ++i)
+		{
+			if (m_transient_ids[i] == UINT_MAX)
+				continue;
+
+			auto& res = m_resources[i];
+			if (res.kind == ResourceKind::Texture)
+			{
+				res.handle = m_transients.get_texture(m_transient_ids[i]).handle;
+				transient_textures.push_back(res.handle);
+			}
+			else
+				res.handle = m_transients.get_buffer(m_transient_ids[i]).handle;
+		}
+
+		// Views of transient textures which were released by the pool
+		for (auto handle : m_transient_textures)
+		{
+			if (std::find(transient_textures.cbegin(), transient_textures.cend(), handle) == transient_textures.cend())
+				release_views_of(Texture{ handle });
+		}
+		m_transient_textures = std::move(transient_textures);
+	}
+
+	void RenderGraph::record(const CompiledGraph& compiled, RenderCommandList& list)
+	{
+		auto submit_barriers = [&](u32 first, u32 count, std::optional<u32> activated_pass)
+		{
+			RenderCommandBarrier cmd;
+
+			auto append_barrier = [&](const CompiledBarrier& barr)
+			{
+				const auto& res = m_resources[barr.resource];
+				if (barr.uav)
+				{
+					cmd.append(res.kind == ResourceKind::Texture ?
+						ResourceBarrier::uav_barrier(Texture{ res.handle }) :
+						ResourceBarrier::uav_barrier(Buffer{ res.handle }));
+					return;
+				}
+
+				auto transition = res.kind == ResourceKind::Texture ?
+					ResourceBarrier::transition(Texture{ res.handle }, barr.before, barr.after, 0xffffffff) :
+					ResourceBarrier::transition(Buffer{ res.handle }, barr.before, barr.after);
+
+				if (barr.split == ResourceBarrier::Split::BeginOnly)
+					transition = transition.begin_only();
+				else if (barr.split == ResourceBarrier::Split::EndOnly)
+					transition = transition.end_only();
+				cmd.append(transition);
+			};
+
+			// Retired transients while they still own their memory
+			for (u32 i = first; i < first + count; ++i)
+			{
+				if (compiled.barriers[i].retire)
+					append_barrier(compiled.barriers[i]);
+			}
+
+			// Transient resources which share memory are activated before their first use
+			if (activated_pass.has_value())
+			{
+				for (u32 i = 0; i < m_resources.size(); ++i)
+				{
+					if (m_transient_ids[i] == UINT_MAX || compiled.lifetimes[i].first != *activated_pass || !m_transients.is_aliased(m_transient_ids[i]))
+						continue;
+
+					const auto& res = m_resources[i];
+					if (res.kind == ResourceKind::Texture)
+						cmd.append(ResourceBarrier::aliasing(Texture{}, Texture{ res.handle }));
+					else
+						cmd.append(ResourceBarrier::aliasing(Buffer{}, Buffer{ res.handle }));
+				}
+			}
+
+			for (u32 i = first; i < first + count; ++i)
+			{
+				if (!compiled.barriers[i].retire)
+					append_barrier(compiled.barriers[i]);
+			}
+
+			if (!cmd.barriers.empty())
+				list.submit(cmd);
+		};
+
+		const RGExecuteContext ctx(this);
+		list.submit(RenderCommandBeginProfileScope("RenderGraph"));
+		for (u32 i = 0; i < compiled.passes.size(); ++i)
+		{
+			const auto& cp = compiled.passes[i];
+			submit_barriers(cp.first_barrier, cp.num_barriers, i);
+
+			const auto& pass = m_passes[cp.pass];
+			if (cp.begins_render_pass)
+				list.submit(RenderCommandBeginRenderPass(get_renderpass(pass, m_passes[cp.render_pass_last])));
+
+			// Scoped inside the render pass so that merged passes are timed individually
+			list.submit(RenderCommandBeginProfileScope(pass.name, true));
+			if (pass.func)
+				pass.func(list, ctx);
+			list.submit(RenderCommandEndProfileScope());
+
+			if (cp.ends_render_pass)
+				list.submit(RenderCommandEndRenderPass());
+		}
+
+		submit_barriers(compiled.first_final_barrier, (u32)compiled.barriers.size() - compiled.first_final_barrier, std::nullopt);
+		list.submit(RenderCommandEndProfileScope());
+	}
+
+	RenderPass RenderGraph::get_renderpass(const Pass& first, const Pass& last)
+	{
+		// Begin accesses from the first pass and end accesses from the last pass of a merged group
+		u64 key = hash_bytes(nullptr, 0);
+		for (u32 i = 0; i < first.render_targets.size(); ++i)
+		{
+			const auto& rt = first.render_targets[i];
+			key = hash_combine(key, m_resources[rt.resource].handle);
+			key = hash_combine(key, rt.begin);
+			key = hash_combine(key, last.render_targets[i].end);
+			key = hash_range(key, rt.range);
+		}
+		if (first.depth_stencil.has_value())
+		{
+			key = hash_combine(key, m_resources[first.depth_stencil->resource].handle);
+			key = hash_combine(key, first.depth_stencil->begin);
+			key = hash_combine(key, last.depth_stencil->end);
+			key = hash_range(key, first.depth_stencil->range);
+		}
+
+		auto it = m_renderpasses.find(key);
+		if (it == m_renderpasses.end())
+		{
+			CachedRenderPass cached{};
+			RenderPassBuilder builder;
+
+			for (u32 i = 0; i < first.render_targets.size(); ++i)
+			{
+				const auto& rt = first.render_targets[i];
+				const Texture texture{ m_resources[rt.resource].handle };
+				const TextureViewDesc desc(ViewType::RenderTarget, rt.range);
+
+				builder.append_rt(get_view(texture, desc), rt.begin, last.render_targets[i].end);
+				cached.view_keys.push_back(get_view_key(texture, desc));
+			}
+
+			if (first.depth_stencil.has_value())
+			{
+				const Texture texture{ m_resources[first.depth_stencil->resource].handle };
+				const TextureViewDesc desc(ViewType::DepthStencil, first.depth_stencil->range);
+
+				builder.add_depth(get_view(texture, desc), first.depth_stencil->begin, last.depth_stencil->end);
+				cached.view_keys.push_back(get_view_key(texture, desc));
+			}
+
+			cached.rp = m_rd->create_renderpass(builder.build());
+			it = m_renderpasses.insert({ key, std::move(cached) }).first;
+		}
+
+		// Keep the render pass and its views from being evicted
+		it->second.last_used_frame = m_frame;
+		for (auto view_key : it->second.view_keys)
+			m_views[view_key].last_used_frame = m_frame;
+
+		return it->second.rp;
+	}
+
+	u64 RenderGraph::get_view_key(Texture texture, const TextureViewDesc& desc) const
+	{
+		u64 key = hash_bytes(nullptr, 0);
+		key = hash_combine(key, texture.handle);
+		key = hash_combine(key, desc.view);
+		return hash_range(key, desc.range);
+	}
+
+	TextureView RenderGraph::get_view(Texture texture, const TextureViewDesc& desc)
+	{
+		const u64 key = get_view_key(texture, desc);
+
+		auto it = m_views.find(key);
+		if (it == m_views.end())
+		{
+			CachedView cached{};
+			cached.texture = texture;
+			cached.view = m_rd->create_view(texture, desc);
+			it = m_views.insert({ key, cached }).first;
+		}
+
+		it->second.last_used_frame = m_frame;
+		return it->second.view;
+	}
+
+	void RenderGraph::evict_unused()
+	{
+		// Compilations of graph shapes which are no longer declared
+		std::erase_if(m_compiled, [this](const auto& entry) { return entry.second.last_used_frame + CACHE_EVICTION_FRAMES < m_frame; });
+
+		// Render passes go first as they reference views
+		for (auto it = m_renderpasses.begin(); it != m_renderpasses.end();)
+		{
+			if (it->second.last_used_frame + CACHE_EVICTION_FRAMES < m_frame)
+			{
+				m_bin->push_deferred_deletion(it->second.rp);
+				it = m_renderpasses.erase(it);
+			}
+			else
+				++it;
+		}
+
+		for (auto it = m_views.begin(); it != m_views.end();)
+		{
+			if (it->second.last_used_frame + CACHE_EVICTION_FRAMES < m_frame)
+			{
+				m_bin->push_deferred_deletion(it->second.view);
+				it = m_views.erase(it);
+			}
+			else
+				++it;
+		}
+	}
+
+	void RenderGraph::release_views_of(Texture texture)
+	{
+		std::vector<u64> released_keys;
+		for (auto it = m_views.begin(); it != m_views.end();)
+		{
+			if (it->second.texture.handle == texture.handle)
+			{
+				released_keys.push_back(it->first);
+				m_bin->push_deferred_deletion(it->second.view);
+				it = m_views.erase(it);
+			}
+			else
+				++it;
+		}
+
+		for (auto it = m_renderpasses.begin(); it != m_renderpasses.end();)
+		{
+			const auto& keys = it->second.view_keys;
+			const bool references_released = std::any_of(keys.cbegin(), keys.cend(), [&](u64 key) { return std::find(released_keys.cbegin(), released_keys.cend(), key) != released_keys.cend(); });
+			if (references_released)
+			{
+				m_bin->push_deferred_deletion(it->second.rp);
+				it = m_renderpasses.erase(it);
+			}
+			else
+				++it;
+		}
+	}
+}
@@ -0,0 +1,252 @@
+#pragma once
+#include "../Common.h"
+#include "../RHI/RenderResourceHandle.h"
+#include "../RHI/RenderCommandList.h"
+#include "Types/RenderGraphTypes.h"
+#include "TransientResourcePool.h"
+
+namespace mira
+{
+	class RenderDevice;
+	class GPUGarbageBin;
+	class RenderGraph;
+
+	// Resolves graph resources while recording a pass
+	class RGExecuteContext
+	{
+	public:
+		Texture get_texture(RGTexture texture) const;
+		Buffer get_buffer(RGBuffer buffer) const;
+
+		// Views are cached by the graph, the user should not free them
+		TextureView get_view(RGTexture texture, const TextureViewDesc& desc) const;
+
+	private:
+		friend RenderGraph;
+		RGExecuteContext(RenderGraph* graph) : m_graph(graph) {}
+
+	private:
+		RenderGraph* m_graph{ nullptr };
+	};
+
+	// Declares the resource usage of a pass
+	class RGPassBuilder
+	{
+	public:
+		RGPassBuilder& read(RGTexture texture, ResourceState state);
+		RGPassBuilder& read(RGBuffer buffer, ResourceState state);
+		RGPassBuilder& write(RGTexture texture, ResourceState state);
+		RGPassBuilder& write(RGBuffer buffer, ResourceState state);
+
+		// Attachments, the graph creates (and caches) the views and render pass
+		RGPassBuilder& add_render_target(RGTexture texture, const TextureViewRange& range, RenderPassBeginAccessType begin, RenderPassEndingAccessType end);
+		RGPassBuilder& set_depth_stencil(RGTexture texture, const TextureViewRange& range, RenderPassBeginAccessType begin, RenderPassEndingAccessType end);
+
+		// Pass is never culled
+		RGPassBuilder& set_side_effects();
+
+	private:
+		friend RenderGraph;
+		RGPassBuilder(RenderGraph* graph, u32 pass) : m_graph(graph), m_pass(pass) {}
+
+	private:
+		RenderGraph* m_graph{ nullptr };
+		u32 m_pass{ 0 };
+	};
+
+	/*
+		Frame graph which derives barriers from declared resource usage.
+
+		Per frame:
+			begin_frame()
+			import/create resources, add passes
+			execute() --> RenderCommandList to compile and submit
+
+		- Passes execute in declaration order, passes whose outputs are never consumed are culled.
+		  Writes to imported resources and passes with side effects are always kept.
+		- Consecutive passes with identical attachments and no barriers in between share a single render pass.
+		- Transitions are split when passes run in between the last and next use of a resource, to hide their latency.
+		- States of imported resources are tracked across frames, so a resource only has to state its initial state the first time it is seen by the graph.
+		- Graph-owned resources are transient: they are placed in memory shared with other graph-owned resources whose lifetimes
+		  (first to last live pass) do not overlap, see TransientResourcePool. They start in the common state, return to it after
+		  their last use (before their memory is handed over) and must be fully written (e.g cleared) by their first pass.
+		- The compiled structure (pass order, barriers, render pass merging) is cached on the declarations, compilations unused for
+		  CACHE_EVICTION_FRAMES are dropped. Resource handles are not part of the key, so alternating swapchain buffers reuse the same compilation.
+
+		Barriers are tracked at whole resource granularity.
+	*/
+	class RenderGraph
+	{
+	public:
+		using ExecuteFunc = std::function<void(RenderCommandList&, const RGExecuteContext&)>;
+
+	public:
+		RenderGraph(RenderDevice* rd, GPUGarbageBin* bin);
+		~RenderGraph();
+
+		void begin_frame();
+
+		// External resources. Initial state is only used the first time the resource is seen by the graph.
+		// Final state (optional) is the state the resource is left in at the end of the graph.
+		RGTexture import_texture(Texture texture, ResourceState initial_state, std::optional<ResourceState> final_state = std::nullopt);
+		RGBuffer import_buffer(Buffer buffer, ResourceState initial_state, std::optional<ResourceState> final_state = std::nullopt);
+
+		// Graph-owned resources, whose contents are only valid between their first and last use within the frame
+		RGTexture create_texture(const TextureDesc& desc);
+		RGBuffer create_buffer(const BufferDesc& desc);
+
+		RGPassBuilder add_pass(const std::string& name, ExecuteFunc&& func);
+
+		// Compiles (or reuses compilation) and records all live passes
+		RenderCommandList execute();
+
+	private:
+		friend RGPassBuilder;
+		friend RGExecuteContext;
+
+		// Unused compilation/view/render pass cache entries are released after this many frames
+		static constexpr u64 CACHE_EVICTION_FRAMES = 8;
+
+		enum class ResourceKind : u8
+		{
+			Texture,
+			Buffer
+		};
+
+		struct Resource
+		{
+			ResourceKind kind{ ResourceKind::Texture };
+			bool imported{ false };
+			u64 handle{ 0 };						// Texture or Buffer handle
+
+			ResourceState entry_state{ ResourceState::Common };
+			std::optional<ResourceState> final_state;
+
+			// Graph-owned only
+			TextureDesc texture_desc{};
+			BufferDesc buffer_desc{};
+			u64 desc_hash{ 0 };
+		};
+
+		struct Access
+		{
+			u32 resource{ 0 };
+			ResourceState state{ ResourceState::Common };
+			bool write{ false };
+		};
+
+		struct Attachment
+		{
+			u32 resource{ 0 };
+			TextureViewRange range{};
+			RenderPassBeginAccessType begin{ RenderPassBeginAccessType::Discard };
+			RenderPassEndingAccessType end{ RenderPassEndingAccessType::Discard };
+		};
+
+		struct Pass
+		{
+			std::string name;
+			ExecuteFunc func;
+			std::vector<Access> accesses;
+			std::vector<Attachment> render_targets;
+			std::optional<Attachment> depth_stencil;
+			bool side_effects{ false };
+
+			bool has_attachments() const { return !render_targets.empty() || depth_stencil.has_value(); }
+		};
+
+		struct CompiledBarrier
+		{
+			u32 resource{ 0 };
+			ResourceState before{ ResourceState::Common };
+			ResourceState after{ ResourceState::Common };
+			bool uav{ false };
+			ResourceBarrier::Split split{ ResourceBarrier::Split::None };
+			bool retire{ false };					// Graph owned resource going back to common after its last use
+		};
+
+		struct CompiledPass
+		{
+			u32 pass{ 0 };
+			u32 first_barrier{ 0 };
+			u32 num_barriers{ 0 };
+
+			// Render pass spans [pass, render_pass_last]
+			bool begins_render_pass{ false };
+			bool ends_render_pass{ false };
+			u32 render_pass_last{ 0 };
+		};
+
+		struct CompiledGraph
+		{
+			std::vector<CompiledPass> passes;
+			std::vector<CompiledBarrier> barriers;
+			u32 first_final_barrier{ 0 };
+
+			// State of each declared resource once the graph has executed
+			std::vector<ResourceState> exit_states;
+
+			// First and last compiled pass using each resource (UINT_MAX if unused)
+			std::vector<std::pair<u32, u32>> lifetimes;
+		};
+
+		struct CachedGraph
+		{
+			std::vector<u64> key;					// Declarations the graph was compiled from
+			CompiledGraph graph;
+			u64 last_used_frame{ 0 };
+		};
+
+		struct CachedView
+		{
+			Texture texture;
+			TextureView view;
+			u64 last_used_frame{ 0 };
+		};
+
+		struct CachedRenderPass
+		{
+			RenderPass rp;
+			std::vector<u64> view_keys;
+			u64 last_used_frame{ 0 };
+		};
+
+	private:
+		u32 add_resource(const Resource& resource);
+		void build_declaration_key(std::vector<u64>& key) const;
+		void compile(CompiledGraph& compiled) const;
+		void allocate_transients(const CompiledGraph& compiled);
+		void record(const CompiledGraph& compiled, RenderCommandList& list);
+
+		RenderPass get_renderpass(const Pass& first, const Pass& last);
+		u64 get_view_key(Texture texture, const TextureViewDesc& desc) const;
+		TextureView get_view(Texture texture, const TextureViewDesc& desc);
+		void evict_unused();
+		void release_views_of(Texture texture);
+
+	private:
+		RenderDevice* m_rd{ nullptr };
+		GPUGarbageBin* m_bin{ nullptr };
+		u64 m_frame{ 0 };
+
+		// Declarations (reset every frame, capacity is kept)
+		std::vector<Resource> m_resources;
+		std::vector<Pass> m_passes;
+
+		// Compilation cache, on the hash of the declaration key
+		std::unordered_map<u64, CachedGraph> m_compiled;
+		std::vector<u64> m_declaration_key;
+
+		// States of imported resources across frames
+		std::unordered_map<u64, ResourceState> m_texture_states;
+		std::unordered_map<u64, ResourceState> m_buffer_states;
+
+		// Backs graph-owned resources, pool id per declared resource (UINT_MAX if imported or culled)
+		TransientResourcePool m_transients;
+		std::vector<u32> m_transient_ids;
+		std::vector<u64> m_transient_textures;
+
+		std::unordered_map<u64, CachedView> m_views;
+		std::unordered_map<u64, CachedRenderPass> m_renderpasses;
+	};
+}
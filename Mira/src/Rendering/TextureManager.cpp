@@ -114,11 +114,8 @@ namespace mira
 	void TextureManager::free(LoadedTexture handle)
 	{
 		auto& res = try_get(m_textures, get_slot(handle.handle));
-		m_bin->push_deferred_deletion([this, res_copy = res]()
-			{
-				m_rd->free_view(res_copy.view);
-				m_rd->free_texture(res_copy.texture);
-			});
+		m_bin->push_deferred_deletion(res.view);
+		m_bin->push_deferred_deletion(res.texture);
 
 		m_textures[get_slot(handle.handle)] = std::nullopt;
 		m_handle_ator.free(handle);
@@ -0,0 +1,272 @@
+#include "TransientResourcePool.h"
+#include "GPUGarbageBin.h"
+#include "../RHI/RenderDevice.h"
+
+namespace mira
+{
+	namespace
+	{
+		// Heaps are grown in steps to avoid recreating them for small size changes
+		constexpr u64 HEAP_GROWTH_GRANULARITY = 4ull * 1024 * 1024;
+
+		u64 align_up(u64 value, u64 alignment)
+		{
+			return alignment == 0 ? value : (value + alignment - 1) / alignment * alignment;
+		}
+	}
+
+	TransientResourcePool::TransientResourcePool(RenderDevice* rd, GPUGarbageBin* bin) :
+		m_rd(rd),
+		m_bin(bin)
+	{
+	}
+
+	TransientResourcePool::~TransientResourcePool()
+	{
+		for (const auto& [_, placed] : m_placed)
+		{
+			if (placed.is_texture)
+				m_rd->free_texture(Texture{ placed.handle });
+			else
+				m_rd->free_buffer(Buffer{ placed.handle });
+		}
+
+		for (const auto& heap : m_heaps)
+		{
+			if (heap.heap.handle != 0)
+				m_rd->free_heap(heap.heap);
+		}
+	}
+
+	void TransientResourcePool::begin_frame()
+	{
+		m_declarations.clear();
+	}
+
+	u32 TransientResourcePool::declare_texture(const TextureDesc& desc, u32 first_use, u32 last_use)
+	{
+		assert(desc.memory_type == MemoryType::Default);
+
+		Declaration decl{};
+		decl.is_texture = true;
+		decl.category = (desc.usage & (UsageIntent::RenderTarget | UsageIntent::DepthStencil)) ? HeapCategory::RenderTargets : HeapCategory::Textures;
+		decl.texture_desc = desc;
+		decl.desc_hash = hash_desc(desc);
+		decl.first_use = first_use;
+		decl.last_use = last_use;
+
+		auto it = m_texture_requirements.find(desc);
+		if (it == m_texture_requirements.end())
+			it = m_texture_requirements.insert({ desc, m_rd->get_memory_requirements(desc) }).first;
+		decl.requirements = it->second;
+
+		return declare(std::move(decl));
+	}
+
+	u32 TransientResourcePool::declare_buffer(const BufferDesc& desc, u32 first_use, u32 last_use)
+	{
+		assert(desc.memory_type == MemoryType::Default);
+
+		Declaration decl{};
+		decl.category = HeapCategory::Buffers;
+		decl.buffer_desc = desc;
+		decl.desc_hash = hash_desc(desc);
+		decl.first_use = first_use;
+		decl.last_use = last_use;
+
+		auto it = m_buffer_requirements.find(desc);
+		if (it == m_buffer_requirements.end())
+			it = m_buffer_requirements.insert({ desc, m_rd->get_memory_requirements(desc) }).first;
+		decl.requirements = it->second;
+
+		return declare(std::move(decl));
+	}
+
+	void TransientResourcePool::allocate()
+	{
+		// Same declarations as last time, placement is unchanged
+		const bool unchanged = std::equal(m_declarations.cbegin(), m_declarations.cend(), m_prev_declarations.cbegin(), m_prev_declarations.cend(),
+			[](const Declaration& a, const Declaration& b)
+			{
+				return is_same_resource(a, b) && a.first_use == b.first_use && a.last_use == b.last_use;
+			});
+		if (unchanged)
+		{
+			m_declarations = m_prev_declarations;
+			return;
+		}
+
+		std::array<u64, NUM_HEAP_CATEGORIES> required_sizes{};
+		pack(required_sizes);
+
+		// Grow heaps, resources placed in a replaced heap go with it
+		std::array<Heap, NUM_HEAP_CATEGORIES> replaced_heaps{};
+		for (u32 i = 0; i < NUM_HEAP_CATEGORIES; ++i)
+		{
+			auto& heap = m_heaps[i];
+			if (required_sizes[i] <= heap.size)
+				continue;
+
+			replaced_heaps[i] = heap.heap;
+			heap.size = align_up(required_sizes[i], HEAP_GROWTH_GRANULARITY);
+			heap.heap = m_rd->create_heap(HeapDesc(heap.size, MemoryType::Default, (HeapCategory)i));
+		}
+
+		// Reuse placed resources with an identical placement
+		std::unordered_multimap<u64, PlacedResource> placed;
+		std::vector<u32> created;
+		for (u32 i = 0; i < m_declarations.size(); ++i)
+		{
+			auto& decl = m_declarations[i];
+			const Heap heap = m_heaps[(u32)decl.category].heap;
+
+			u64 key = hash_bytes(nullptr, 0);
+			key = hash_combine(key, heap.handle);
+			key = hash_combine(key, decl.offset);
+			key = hash_combine(key, decl.is_texture);
+			key = hash_combine(key, decl.desc_hash);
+
+			// Each placed resource is taken once, identical resources at the same offset (disjoint lifetimes) still get separate handles
+			auto [first, last] = m_placed.equal_range(key);
+			auto it = std::find_if(first, last, [&](const auto& entry)
+				{
+					const PlacedResource& other = entry.second;
+					return other.heap.handle == heap.handle && other.offset == decl.offset && other.is_texture == decl.is_texture &&
+						(decl.is_texture ? other.texture_desc == decl.texture_desc : other.buffer_desc == decl.buffer_desc);
+				});
+
+			if (it != last)
+			{
+				decl.handle = it->second.handle;
+				m_placed.erase(it);
+			}
+			else
+			{
+				decl.handle = decl.is_texture ?
+					m_rd->create_placed_texture(decl.texture_desc, heap, decl.offset).handle :
+					m_rd->create_placed_buffer(decl.buffer_desc, heap, decl.offset).handle;
+				created.push_back(i);
+			}
+
+			placed.insert({ key, PlacedResource{ decl.is_texture, decl.handle, heap, decl.offset, decl.texture_desc, decl.buffer_desc } });
+		}
+
+		// Placed resources are released before the heaps they live in
+		for (const auto& [_, resource] : m_placed)
+			release_placed(resource);
+		m_placed = std::move(placed);
+
+		for (auto heap : replaced_heaps)
+		{
+			if (heap.handle != 0)
+				m_bin->push_deferred_deletion(heap);
+		}
+
+		m_prev_declarations = m_declarations;
+
+		// New resources may occupy memory last used by a resource which has since been released
+		for (u32 i : created)
+			m_declarations[i].aliased = true;
+	}
+
+	Texture TransientResourcePool::get_texture(u32 id) const
+	{
+		assert(m_declarations[id].is_texture);
+		return Texture{ m_declarations[id].handle };
+	}
+
+	Buffer TransientResourcePool::get_buffer(u32 id) const
+	{
+		assert(!m_declarations[id].is_texture);
+		return Buffer{ m_declarations[id].handle };
+	}
+
+	bool TransientResourcePool::is_aliased(u32 id) const
+	{
+		return m_declarations[id].aliased;
+	}
+
+	u64 TransientResourcePool::get_heap_size() const
+	{
+		u64 size = 0;
+		for (const auto& heap : m_heaps)
+			size += heap.size;
+		return size;
+	}
+
+	u32 TransientResourcePool::declare(Declaration&& decl)
+	{
+		assert(decl.first_use <= decl.last_use);
+		m_declarations.push_back(std::move(decl));
+		return (u32)m_declarations.size() - 1;
+	}
+
+	bool TransientResourcePool::is_same_resource(const Declaration& a, const Declaration& b)
+	{
+		if (a.is_texture != b.is_texture || a.category != b.category)
+			return false;
+		return a.is_texture ? a.texture_desc == b.texture_desc : a.buffer_desc == b.buffer_desc;
+	}
+
+	void TransientResourcePool::pack(std::array<u64, NUM_HEAP_CATEGORIES>& required_sizes)
+	{
+		// Largest first, so that smaller resources fill the gaps
+		std::vector<u32> order(m_declarations.size());
+		for (u32 i = 0; i < order.size(); ++i)
+			order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [this](u32 a, u32 b) { return m_declarations[a].requirements.size > m_declarations[b].requirements.size; });
+
+		m_declared_size = 0;
+		std::vector<u32> placed;
+		std::vector<std::pair<u64, u64>> occupied;
+		for (u32 idx : order)
+		{
+			auto& decl = m_declarations[idx];
+			const u64 size = decl.requirements.size;
+			m_declared_size += size;
+
+			// Memory ranges taken by placed resources which are alive at the same time
+			occupied.clear();
+			for (u32 other_idx : placed)
+			{
+				const auto& other = m_declarations[other_idx];
+				if (other.category != decl.category || other.first_use > decl.last_use || decl.first_use > other.last_use)
+					continue;
+				occupied.push_back({ other.offset, other.offset + other.requirements.size });
+			}
+			std::sort(occupied.begin(), occupied.end());
+
+			// Lowest fitting offset
+			u64 offset = 0;
+			for (const auto& [begin, end] : occupied)
+			{
+				if (align_up(offset, decl.requirements.alignment) + size <= begin)
+					break;
+				offset = std::max(offset, end);
+			}
+			decl.offset = align_up(offset, decl.requirements.alignment);
+
+			auto& required = required_sizes[(u32)decl.category];
+			required = std::max(required, decl.offset + size);
+			placed.push_back(idx);
+		}
+
+		// Anything sharing memory needs an aliasing barrier on activation, including sharing with a resource from a previous frame
+		for (auto& decl : m_declarations)
+		{
+			decl.aliased = std::any_of(m_declarations.cbegin(), m_declarations.cend(), [&decl](const Declaration& other)
+				{
+					return &other != &decl && other.category == decl.category &&
+						other.offset < decl.offset + decl.requirements.size && decl.offset < other.offset + other.requirements.size;
+				});
+		}
+	}
+
+	void TransientResourcePool::release_placed(const PlacedResource& placed)
+	{
+		if (placed.is_texture)
+			m_bin->push_deferred_deletion(Texture{ placed.handle });
+		else
+			m_bin->push_deferred_deletion(Buffer{ placed.handle });
+	}
+}
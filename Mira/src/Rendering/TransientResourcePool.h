@@ -0,0 +1,118 @@
+#pragma once
+#include "../Common.h"
+#include "../RHI/RenderResourceHandle.h"
+#include "../RHI/RHITypes.h"
+
+namespace mira
+{
+	class RenderDevice;
+	class GPUGarbageBin;
+
+	/*
+		Places resources whose lifetimes do not overlap in the same memory.
+
+		Per frame:
+			begin_frame()
+			declare_texture/declare_buffer with the first and last use (any monotonic ordering, e.g pass index)
+			allocate() --> resources are placed and can be grabbed
+
+		- Resources are packed per heap category through greedy interval coloring: largest first, each at the lowest offset
+		  which does not overlap in memory with an already placed resource whose lifetime overlaps its own.
+		- Heaps only grow. Placed resources are kept across frames and only recreated when their placement changes.
+		- A resource sharing memory with another one has undefined contents when it becomes active.
+		  The user must issue an aliasing barrier before its first use (see is_aliased) and fully initialize it (clear, discard or copy).
+	*/
+	class TransientResourcePool
+	{
+	public:
+		TransientResourcePool(RenderDevice* rd, GPUGarbageBin* bin);
+		~TransientResourcePool();
+
+		void begin_frame();
+
+		// Lifetime is inclusive
+		u32 declare_texture(const TextureDesc& desc, u32 first_use, u32 last_use);
+		u32 declare_buffer(const BufferDesc& desc, u32 first_use, u32 last_use);
+
+		void allocate();
+
+		Texture get_texture(u32 id) const;
+		Buffer get_buffer(u32 id) const;
+
+		// Shares memory with another transient resource
+		bool is_aliased(u32 id) const;
+
+		// Total size of the heaps, compared to what the resources take up when not aliased
+		u64 get_heap_size() const;
+		u64 get_declared_size() const { return m_declared_size; }
+
+	private:
+		static constexpr u32 NUM_HEAP_CATEGORIES = 3;
+
+		struct Declaration
+		{
+			bool is_texture{ false };
+			HeapCategory category{ HeapCategory::Buffers };
+			TextureDesc texture_desc{};
+			BufferDesc buffer_desc{};
+			u64 desc_hash{ 0 };
+			MemoryRequirements requirements{};
+
+			u32 first_use{ 0 };
+			u32 last_use{ 0 };
+
+			// Placement
+			u64 offset{ 0 };
+			u64 handle{ 0 };
+			bool aliased{ false };
+		};
+
+		struct HeapEntry
+		{
+			Heap heap;
+			u64 size{ 0 };
+		};
+
+		struct PlacedResource
+		{
+			bool is_texture{ false };
+			u64 handle{ 0 };
+
+			// Compared on lookup, the key is only a hash of them
+			Heap heap;
+			u64 offset{ 0 };
+			TextureDesc texture_desc{};
+			BufferDesc buffer_desc{};
+		};
+
+		struct DescHash
+		{
+			template <typename Desc>
+			size_t operator()(const Desc& desc) const { return (size_t)hash_desc(desc); }
+		};
+
+	private:
+		u32 declare(Declaration&& decl);
+		static bool is_same_resource(const Declaration& a, const Declaration& b);
+		void pack(std::array<u64, NUM_HEAP_CATEGORIES>& required_sizes);
+		void release_placed(const PlacedResource& placed);
+
+	private:
+		RenderDevice* m_rd{ nullptr };
+		GPUGarbageBin* m_bin{ nullptr };
+
+		std::vector<Declaration> m_declarations;
+
+		// Placement of the previous allocation, reused as is if the declarations are identical
+		std::vector<Declaration> m_prev_declarations;
+
+		std::array<HeapEntry, NUM_HEAP_CATEGORIES> m_heaps;
+
+		// Keyed on a hash of heap, offset and description. Identical resources at the same offset (disjoint lifetimes) share a key
+		std::unordered_multimap<u64, PlacedResource> m_placed;
+
+		std::unordered_map<TextureDesc, MemoryRequirements, DescHash> m_texture_requirements;
+		std::unordered_map<BufferDesc, MemoryRequirements, DescHash> m_buffer_requirements;
+		u64 m_declared_size{ 0 };
+	};
+}
@@ -13,12 +13,57 @@ namespace mira
 		Tangent
 	};
 
+	/*
+		Storage of the vertex attributes on the GPU:
+			Float:		float3 Position, Normal and Tangent, float2 UV (44 bytes per vertex)
+			Quantized:	unorm16 xyz Position relative to the submesh bounds (padded to 8 bytes),
+						octahedral snorm16 xy Normal and Tangent, half xy UV (20 bytes per vertex)
+	*/
+	enum class VertexFormat
+	{
+		Float,
+		Quantized
+	};
+
+	// Matches ShaderInterop_SubmeshMD
 	struct SubmeshMetadata
 	{
 		u32 vert_start{ 0 };
 		u32 vert_count{ 0 };
 		u32 index_start{ 0 };
 		u32 index_count{ 0 };
+
+		// Object space, filled in when the mesh is loaded
+		std::array<f32, 3> bounds_min{};
+		std::array<f32, 3> bounds_extent{};
+
+		// Range in the meshlets of the mesh
+		u32 meshlet_start{ 0 };
+		u32 meshlet_count{ 0 };
+	};
+
+	/*
+		Cluster of at most MAX_VERTICES vertices and MAX_TRIANGLES triangles of a submesh, matches ShaderInterop_Meshlet.
+
+		The triangles are a contiguous range of the submesh indices, so a meshlet can also be drawn from the index buffer.
+		Backfacing from 'camera' (object space) if dot(center - camera, cone_axis) >= cone_cutoff * length(center - camera) + radius.
+	*/
+	struct Meshlet
+	{
+		static constexpr u32 MAX_VERTICES = 64;
+		static constexpr u32 MAX_TRIANGLES = 124;
+
+		u32 vert_offset{ 0 };			// Into the meshlet vertices, which hold submesh relative vertices
+		u32 vert_count{ 0 };
+		u32 prim_offset{ 0 };			// Into the meshlet triangles, three meshlet local u8 vertices each
+		u32 prim_count{ 0 };
+		u32 index_offset{ 0 };			// First index, relative to the submesh index_start
+
+		// Object space
+		std::array<f32, 3> center{};
+		f32 radius{ 0.f };
+		std::array<f32, 3> cone_axis{};
+		f32 cone_cutoff{ 1.f };			// 1 when the triangles face too many directions to ever be culled
 	};
 
 	struct MeshContainer
@@ -0,0 +1,18 @@
+#pragma once
+#include "../../Common.h"
+
+namespace mira
+{
+	// Graph-local resource handles, only valid for the frame they were declared in
+	struct RGTexture
+	{
+		u32 id{ UINT_MAX };
+		bool is_valid() const { return id != UINT_MAX; }
+	};
+
+	struct RGBuffer
+	{
+		u32 id{ UINT_MAX };
+		bool is_valid() const { return id != UINT_MAX; }
+	};
+}
@@ -0,0 +1,269 @@
+#include "VertexQuantization.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define MIRA_QUANTIZE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace mira
+{
+	namespace
+	{
+		constexpr f32 UNORM16_MAX = 65535.f;
+		constexpr f32 SNORM16_MAX = 32767.f;
+
+		// Float bits of the smallest normal half (2^-14) and of the largest float which does not round to infinity
+		constexpr u32 HALF_MIN_NORMAL_BITS = 113 << 23;
+		constexpr u32 HALF_OVERFLOW_BITS = 0x477FEFFF;
+
+		f32 get_scale(f32 extent)
+		{
+			return extent > 0.f ? UNORM16_MAX / extent : 0.f;
+		}
+
+		u16 quantize_unorm16(f32 value, f32 min, f32 scale)
+		{
+			return (u16)std::nearbyint(std::clamp((value - min) * scale, 0.f, UNORM16_MAX));
+		}
+
+		u32 encode_octahedral_one(f32 x, f32 y, f32 z)
+		{
+			// Project onto the octahedron, the lower half folds over the diagonals
+			const f32 l1 = std::max(std::abs(x) + std::abs(y) + std::abs(z), std::numeric_limits<f32>::min());
+			f32 ox = x / l1;
+			f32 oy = y / l1;
+			if (z < 0.f)
+			{
+				const f32 fx = (1.f - std::abs(oy)) * std::copysign(1.f, ox);
+				const f32 fy = (1.f - std::abs(ox)) * std::copysign(1.f, oy);
+				ox = fx;
+				oy = fy;
+			}
+
+			const i32 qx = (i32)std::nearbyint(std::clamp(ox, -1.f, 1.f) * SNORM16_MAX);
+			const i32 qy = (i32)std::nearbyint(std::clamp(oy, -1.f, 1.f) * SNORM16_MAX);
+			return (u32)(u16)qx | ((u32)(u16)qy << 16);
+		}
+
+		u16 encode_half_one(f32 value)
+		{
+			u32 bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+
+			const u32 sign = (bits >> 16) & 0x8000;
+			const u32 abs = bits & 0x7FFFFFFF;
+
+			// Rebias the exponent and round the mantissa to nearest
+			u32 half = (abs - (112 << 23) + 0x1000) >> 13;
+			if ((i32)abs < (i32)HALF_MIN_NORMAL_BITS)
+				half = 0;
+			if ((i32)abs > (i32)HALF_OVERFLOW_BITS)
+				half = 0x7C00;
+			return (u16)(half | sign);
+		}
+
+#ifdef MIRA_QUANTIZE_SSE2
+		// Packs the u32 in [0, 65535] of both into u16, a first (SSE2 only has a signed saturating pack)
+		__m128i pack_u16(__m128i a, __m128i b)
+		{
+			const __m128i bias = _mm_set1_epi32(0x8000);
+			const __m128i packed = _mm_packs_epi32(_mm_sub_epi32(a, bias), _mm_sub_epi32(b, bias));
+			return _mm_xor_si128(packed, _mm_set1_epi16((short)0x8000));
+		}
+
+		__m128i encode_half(__m128 values)
+		{
+			const __m128i bits = _mm_castps_si128(values);
+			const __m128i sign = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(0x8000));
+			const __m128i abs = _mm_and_si128(bits, _mm_set1_epi32(0x7FFFFFFF));
+
+			__m128i half = _mm_srli_epi32(_mm_add_epi32(_mm_sub_epi32(abs, _mm_set1_epi32(112 << 23)), _mm_set1_epi32(0x1000)), 13);
+			half = _mm_andnot_si128(_mm_cmplt_epi32(abs, _mm_set1_epi32(HALF_MIN_NORMAL_BITS)), half);
+
+			const __m128i overflow = _mm_cmpgt_epi32(abs, _mm_set1_epi32(HALF_OVERFLOW_BITS));
+			half = _mm_or_si128(_mm_andnot_si128(overflow, half), _mm_and_si128(overflow, _mm_set1_epi32(0x7C00)));
+			return _mm_or_si128(half, sign);
+		}
+#endif
+	}
+
+	void compute_bounds(const f32* positions, u32 count, std::array<f32, 3>& bounds_min, std::array<f32, 3>& bounds_extent)
+	{
+		if (count == 0)
+		{
+			bounds_min = {};
+			bounds_extent = {};
+			return;
+		}
+
+		std::array<f32, 3> min{ positions[0], positions[1], positions[2] };
+		std::array<f32, 3> max = min;
+		u32 i = 0;
+
+#ifdef MIRA_QUANTIZE_SSE2
+		// Four floats are read per position, the last one is left to the scalar loop
+		__m128 min4 = _mm_setr_ps(min[0], min[1], min[2], 0.f);
+		__m128 max4 = min4;
+		for (; i + 1 < count; ++i)
+		{
+			// Operands as in std::min/max, ties (-0 and 0) keep the earlier value
+			const __m128 p = _mm_loadu_ps(positions + i * 3);
+			min4 = _mm_min_ps(p, min4);
+			max4 = _mm_max_ps(p, max4);
+		}
+
+		alignas(16) f32 lanes[4];
+		_mm_store_ps(lanes, min4);
+		min = { lanes[0], lanes[1], lanes[2] };
+		_mm_store_ps(lanes, max4);
+		max = { lanes[0], lanes[1], lanes[2] };
+#endif
+
+		for (; i < count; ++i)
+		{
+			for (u32 c = 0; c < 3; ++c)
+			{
+				min[c] = std::min(min[c], positions[i * 3 + c]);
+				max[c] = std::max(max[c], positions[i * 3 + c]);
+			}
+		}
+
+		bounds_min = min;
+		for (u32 c = 0; c < 3; ++c)
+			bounds_extent[c] = max[c] - min[c];
+	}
+
+	void quantize_positions(const f32* positions, u32 count, const std::array<f32, 3>& bounds_min, const std::array<f32, 3>& bounds_extent, u16* out)
+	{
+		const std::array<f32, 3> scale{ get_scale(bounds_extent[0]), get_scale(bounds_extent[1]), get_scale(bounds_extent[2]) };
+		u32 i = 0;
+
+#ifdef MIRA_QUANTIZE_SSE2
+		// Two positions per iteration, the fourth lane is zeroed as padding
+		const __m128 min4 = _mm_setr_ps(bounds_min[0], bounds_min[1], bounds_min[2], 0.f);
+		const __m128 scale4 = _mm_setr_ps(scale[0], scale[1], scale[2], 0.f);
+		const __m128 max4 = _mm_set1_ps(UNORM16_MAX);
+		for (; i + 2 < count; i += 2)
+		{
+			auto quantize = [&](const f32* p)
+			{
+				const __m128 q = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(p), min4), scale4);
+				return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(q, _mm_setzero_ps()), max4));
+			};
+
+			const __m128i packed = pack_u16(quantize(positions + i * 3), quantize(positions + i * 3 + 3));
+			_mm_storeu_si128((__m128i*)(out + i * 4), packed);
+		}
+#endif
+
+		scalar::quantize_positions(positions + i * 3, count - i, bounds_min, bounds_extent, out + i * 4);
+	}
+
+	void encode_octahedral(const f32* directions, u32 count, u32* out)
+	{
+		u32 i = 0;
+
+#ifdef MIRA_QUANTIZE_SSE2
+		const __m128 sign_mask = _mm_set1_ps(-0.f);
+		const __m128 one = _mm_set1_ps(1.f);
+		for (; i + 4 <= count; i += 4)
+		{
+			const f32* d = directions + i * 3;
+			const __m128 x = _mm_setr_ps(d[0], d[3], d[6], d[9]);
+			const __m128 y = _mm_setr_ps(d[1], d[4], d[7], d[10]);
+			const __m128 z = _mm_setr_ps(d[2], d[5], d[8], d[11]);
+
+			const __m128 l1 = _mm_max_ps(_mm_add_ps(_mm_add_ps(_mm_andnot_ps(sign_mask, x), _mm_andnot_ps(sign_mask, y)), _mm_andnot_ps(sign_mask, z)),
+				_mm_set1_ps(std::numeric_limits<f32>::min()));
+			__m128 ox = _mm_div_ps(x, l1);
+			__m128 oy = _mm_div_ps(y, l1);
+
+			const __m128 fx = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(sign_mask, oy)), _mm_or_ps(_mm_and_ps(ox, sign_mask), one));
+			const __m128 fy = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(sign_mask, ox)), _mm_or_ps(_mm_and_ps(oy, sign_mask), one));
+			const __m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+			ox = _mm_or_ps(_mm_and_ps(lower, fx), _mm_andnot_ps(lower, ox));
+			oy = _mm_or_ps(_mm_and_ps(lower, fy), _mm_andnot_ps(lower, oy));
+
+			auto quantize = [&](__m128 v)
+			{
+				const __m128 clamped = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-1.f)), one);
+				const __m128i q = _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(SNORM16_MAX)));
+				return _mm_packs_epi32(q, q);
+			};
+
+			_mm_storeu_si128((__m128i*)(out + i), _mm_unpacklo_epi16(quantize(ox), quantize(oy)));
+		}
+#endif
+
+		scalar::encode_octahedral(directions + i * 3, count - i, out + i);
+	}
+
+	void encode_half2(const f32* values, u32 count, u32* out)
+	{
+		u32 i = 0;
+
+#ifdef MIRA_QUANTIZE_SSE2
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128i a = encode_half(_mm_loadu_ps(values + i * 2));
+			const __m128i b = encode_half(_mm_loadu_ps(values + i * 2 + 4));
+			_mm_storeu_si128((__m128i*)(out + i), pack_u16(a, b));
+		}
+#endif
+
+		scalar::encode_half2(values + i * 2, count - i, out + i);
+	}
+
+	namespace scalar
+	{
+		void compute_bounds(const f32* positions, u32 count, std::array<f32, 3>& bounds_min, std::array<f32, 3>& bounds_extent)
+		{
+			if (count == 0)
+			{
+				bounds_min = {};
+				bounds_extent = {};
+				return;
+			}
+
+			std::array<f32, 3> min{ positions[0], positions[1], positions[2] };
+			std::array<f32, 3> max = min;
+			for (u32 i = 1; i < count; ++i)
+			{
+				for (u32 c = 0; c < 3; ++c)
+				{
+					min[c] = std::min(min[c], positions[i * 3 + c]);
+					max[c] = std::max(max[c], positions[i * 3 + c]);
+				}
+			}
+
+			bounds_min = min;
+			for (u32 c = 0; c < 3; ++c)
+				bounds_extent[c] = max[c] - min[c];
+		}
+
+		void quantize_positions(const f32* positions, u32 count, const std::array<f32, 3>& bounds_min, const std::array<f32, 3>& bounds_extent, u16* out)
+		{
+			const std::array<f32, 3> scale{ get_scale(bounds_extent[0]), get_scale(bounds_extent[1]), get_scale(bounds_extent[2]) };
+			for (u32 i = 0; i < count; ++i)
+			{
+				for (u32 c = 0; c < 3; ++c)
+					out[i * 4 + c] = quantize_unorm16(positions[i * 3 + c], bounds_min[c], scale[c]);
+				out[i * 4 + 3] = 0;
+			}
+		}
+
+		void encode_octahedral(const f32* directions, u32 count, u32* out)
+		{
+			for (u32 i = 0; i < count; ++i)
+				out[i] = encode_octahedral_one(directions[i * 3], directions[i * 3 + 1], directions[i * 3 + 2]);
+		}
+
+		void encode_half2(const f32* values, u32 count, u32* out)
+		{
+			for (u32 i = 0; i < count; ++i)
+				out[i] = (u32)encode_half_one(values[i * 2]) | ((u32)encode_half_one(values[i * 2 + 1]) << 16);
+		}
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "../Common.h"
+
+namespace mira
+{
+	/*
+		Load-time encoders of the quantized vertex format (VertexFormat::Quantized), decoded in mesh_vs.hlsl.
+
+		SSE2 on x64 with a scalar fallback elsewhere, both produce the same output (see tests/VertexQuantizationTest.cpp).
+		Inputs are tightly packed floats, outputs have room for 'count' elements.
+	*/
+
+	// Axis-aligned bounds of float3 positions
+	void compute_bounds(const f32* positions, u32 count, std::array<f32, 3>& bounds_min, std::array<f32, 3>& bounds_extent);
+
+	// float3 to unorm16 xyz relative to the bounds, padded to four u16 per position
+	void quantize_positions(const f32* positions, u32 count, const std::array<f32, 3>& bounds_min, const std::array<f32, 3>& bounds_extent, u16* out);
+
+	// Unit float3 to octahedral snorm16 xy, x in the low half
+	void encode_octahedral(const f32* directions, u32 count, u32* out);
+
+	// float2 to half xy, x in the low half (denormals flush to zero, no NaN)
+	void encode_half2(const f32* values, u32 count, u32* out);
+
+	// Scalar encoders, used for what the SSE2 loops leave over and as their reference
+	namespace scalar
+	{
+		void compute_bounds(const f32* positions, u32 count, std::array<f32, 3>& bounds_min, std::array<f32, 3>& bounds_extent);
+		void quantize_positions(const f32* positions, u32 count, const std::array<f32, 3>& bounds_min, const std::array<f32, 3>& bounds_extent, u16* out);
+		void encode_octahedral(const f32* directions, u32 count, u32* out);
+		void encode_half2(const f32* values, u32 count, u32* out);
+	}
+}
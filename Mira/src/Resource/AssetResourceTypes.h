@@ -18,6 +18,11 @@ namespace mira
 	{
 		std::unordered_map<VertexAttribute, std::vector<u8>> vertex_data;
 		std::vector<u32> indices;
+
+		// Clusters of all submeshes (MeshletBuilder)
+		std::vector<Meshlet> meshlets;
+		std::vector<u32> meshlet_vertices;
+		std::vector<u32> meshlet_triangles;
 	};
 
 	struct ImportedModel
@@ -1,8 +1,10 @@
 #include "AssimpImporter.h"
+#include "MeshletBuilder.h"
 #include <assimp/scene.h>           // Output data structure
 #include <assimp/Importer.hpp>      // C++ importer interface
 #include <assimp/postprocess.h>     // Post processing flags
 #include <algorithm>
+#include "../Profiling/CPUProfiler.h"
 
 namespace mira
 {
@@ -33,6 +35,8 @@ namespace mira
 
 	AssimpImporter::AssimpImporter(const std::filesystem::path& path)
 	{
+		MIRA_PROFILE_FUNCTION();
+
 		// Load assimp scene
 		Assimp::Importer importer;
 		const aiScene* scene = importer.ReadFile(
@@ -142,6 +146,9 @@ namespace mira
 			std::memcpy(m_loaded_model->mesh.vertex_data[VertexAttribute::UV].data(), uvs.data(), uvs.size() * sizeof(uvs[0]));
 			std::memcpy(m_loaded_model->mesh.vertex_data[VertexAttribute::Normal].data(), normals.data(), normals.size() * sizeof(normals[0]));
 			std::memcpy(m_loaded_model->mesh.vertex_data[VertexAttribute::Tangent].data(), tangents.data(), tangents.size() * sizeof(tangents[0]));
+
+			// Clusters for culling, indices are already in vertex cache order
+			build_meshlets(m_loaded_model->mesh, submeshes);
 		}
 
 		// Sanity check
@@ -0,0 +1,162 @@
+#include "MeshletBuilder.h"
+#include "../Profiling/CPUProfiler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace mira
+{
+	namespace
+	{
+		using float3 = std::array<f32, 3>;
+
+		float3 sub(const float3& a, const float3& b) { return { a[0] - b[0], a[1] - b[1], a[2] - b[2] }; }
+		f32 dot(const float3& a, const float3& b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+		f32 length(const float3& a) { return std::sqrt(dot(a, a)); }
+
+		float3 cross(const float3& a, const float3& b)
+		{
+			return { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+		}
+
+		// Below this the cone is too wide to ever be entirely backfacing
+		constexpr f32 MIN_CONE_DOT = 0.1f;
+
+		void compute_bounds(Meshlet& meshlet, const ImportedMesh& mesh, const SubmeshMetadata& submesh, const f32* positions)
+		{
+			auto get_position = [&](u32 local_vertex)
+			{
+				const f32* p = positions + (submesh.vert_start + mesh.meshlet_vertices[meshlet.vert_offset + local_vertex]) * 3;
+				return float3{ p[0], p[1], p[2] };
+			};
+
+			// Sphere around the center of the bounding box
+			float3 min = get_position(0), max = min;
+			for (u32 i = 1; i < meshlet.vert_count; ++i)
+			{
+				const float3 p = get_position(i);
+				for (u32 c = 0; c < 3; ++c)
+				{
+					min[c] = std::min(min[c], p[c]);
+					max[c] = std::max(max[c], p[c]);
+				}
+			}
+
+			meshlet.center = { (min[0] + max[0]) * 0.5f, (min[1] + max[1]) * 0.5f, (min[2] + max[2]) * 0.5f };
+			meshlet.radius = 0.f;
+			for (u32 i = 0; i < meshlet.vert_count; ++i)
+				meshlet.radius = std::max(meshlet.radius, length(sub(get_position(i), meshlet.center)));
+
+			// Cone around the average triangle normal (clockwise front faces)
+			std::vector<float3> normals;
+			normals.reserve(meshlet.prim_count);
+			float3 axis{};
+			for (u32 i = 0; i < meshlet.prim_count; ++i)
+			{
+				const u32 tri = mesh.meshlet_triangles[meshlet.prim_offset + i];
+				const float3 a = get_position(tri & 0xff), b = get_position((tri >> 8) & 0xff), c = get_position((tri >> 16) & 0xff);
+
+				const float3 n = cross(sub(b, a), sub(c, a));
+				const f32 len = length(n);
+				if (len == 0.f)
+					continue;
+
+				normals.push_back({ n[0] / len, n[1] / len, n[2] / len });
+				for (u32 k = 0; k < 3; ++k)
+					axis[k] += normals.back()[k];
+			}
+
+			meshlet.cone_axis = {};
+			meshlet.cone_cutoff = 1.f;
+
+			const f32 axis_len = length(axis);
+			if (normals.empty() || axis_len == 0.f)
+				return;
+
+			axis = { axis[0] / axis_len, axis[1] / axis_len, axis[2] / axis_len };
+			f32 min_dot = 1.f;
+			for (const auto& n : normals)
+				min_dot = std::min(min_dot, dot(n, axis));
+
+			meshlet.cone_axis = axis;
+			if (min_dot > MIN_CONE_DOT)
+				meshlet.cone_cutoff = std::sqrt(1.f - min_dot * min_dot);
+		}
+	}
+
+	void build_meshlets(ImportedMesh& mesh, std::span<SubmeshMetadata> submeshes)
+	{
+		MIRA_PROFILE_FUNCTION();
+
+		mesh.meshlets.clear();
+		mesh.meshlet_vertices.clear();
+		mesh.meshlet_triangles.clear();
+
+		const f32* positions = (const f32*)mesh.vertex_data.at(VertexAttribute::Position).data();
+
+		// Submesh vertex to meshlet local vertex, reset after every meshlet
+		constexpr u8 UNASSIGNED = 0xff;
+		std::vector<u8> local_vertices;
+
+		for (auto& submesh : submeshes)
+		{
+			submesh.meshlet_start = (u32)mesh.meshlets.size();
+			local_vertices.assign(submesh.vert_count, UNASSIGNED);
+
+			Meshlet meshlet{};
+			auto finish_meshlet = [&]()
+			{
+				compute_bounds(meshlet, mesh, submesh, positions);
+				for (u32 i = 0; i < meshlet.vert_count; ++i)
+					local_vertices[mesh.meshlet_vertices[meshlet.vert_offset + i]] = UNASSIGNED;
+				mesh.meshlets.push_back(meshlet);
+			};
+
+			const u32 num_triangles = submesh.index_count / 3;
+			for (u32 tri = 0; tri < num_triangles; ++tri)
+			{
+				const u32* corners = mesh.indices.data() + submesh.index_start + tri * 3;
+
+				u32 new_vertices = 0;
+				for (u32 k = 0; k < 3; ++k)
+				{
+					const bool repeated = (k > 0 && corners[k] == corners[0]) || (k > 1 && corners[k] == corners[1]);
+					if (local_vertices[corners[k]] == UNASSIGNED && !repeated)
+						++new_vertices;
+				}
+
+				if (meshlet.vert_count + new_vertices > Meshlet::MAX_VERTICES || meshlet.prim_count == Meshlet::MAX_TRIANGLES)
+				{
+					finish_meshlet();
+					meshlet = Meshlet{};
+				}
+
+				if (meshlet.prim_count == 0)
+				{
+					meshlet.vert_offset = (u32)mesh.meshlet_vertices.size();
+					meshlet.prim_offset = (u32)mesh.meshlet_triangles.size();
+					meshlet.index_offset = tri * 3;
+				}
+
+				u32 packed = 0;
+				for (u32 k = 0; k < 3; ++k)
+				{
+					u8& local = local_vertices[corners[k]];
+					if (local == UNASSIGNED)
+					{
+						local = (u8)meshlet.vert_count++;
+						mesh.meshlet_vertices.push_back(corners[k]);
+					}
+					packed |= (u32)local << (k * 8);
+				}
+
+				mesh.meshlet_triangles.push_back(packed);
+				++meshlet.prim_count;
+			}
+
+			if (meshlet.prim_count > 0)
+				finish_meshlet();
+
+			submesh.meshlet_count = (u32)mesh.meshlets.size() - submesh.meshlet_start;
+		}
+	}
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "AssetResourceTypes.h"
+
+namespace mira
+{
+	/*
+		Splits every submesh into meshlets (Meshlet::MAX_VERTICES / MAX_TRIANGLES) and computes their bounding spheres and normal cones.
+
+		Triangles are taken in index order, so the index order decides the locality of the clusters (run after vertex cache optimization).
+		Fills the meshlet arrays of 'mesh' and the meshlet range of each submesh, requires float3 positions.
+	*/
+	void build_meshlets(ImportedMesh& mesh, std::span<SubmeshMetadata> submeshes);
+}
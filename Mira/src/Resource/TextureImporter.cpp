@@ -1,5 +1,6 @@
 #include "TextureImporter.h"
 #include "compressonator.h"
+#include "../Profiling/CPUProfiler.h"
 
 /*
 	Requires installing CompressonatorFramework
@@ -17,6 +18,8 @@ namespace mira
 
 	TextureImporter::TextureImporter(const std::filesystem::path& path, bool generate_mips)
 	{
+		MIRA_PROFILE_FUNCTION();
+
 		CMP_MipSet mip_set_in;
 		memset(&mip_set_in, 0, sizeof(CMP_MipSet));
 		auto cmp_status = CMP_LoadTexture(path.string().c_str(), &mip_set_in);
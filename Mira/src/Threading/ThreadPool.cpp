@@ -0,0 +1,94 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include "../Profiling/CPUProfiler.h"
+
+namespace mira
+{
+	ThreadPool::ThreadPool(u32 num_threads)
+	{
+		if (num_threads == 0)
+			num_threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+		m_workers.reserve(num_threads);
+		for (u32 i = 0; i < num_threads; ++i)
+			m_workers.emplace_back([this]() { work(); });
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_stopping = true;
+		}
+		m_job_available.notify_all();
+
+		for (auto& worker : m_workers)
+			worker.join();
+	}
+
+	void ThreadPool::submit(std::function<void()> job)
+	{
+		push({ std::move(job), nullptr });
+	}
+
+	void ThreadPool::submit(JobGroup& group, std::function<void()> job)
+	{
+		push({ std::move(job), &group });
+	}
+
+	void ThreadPool::wait_idle()
+	{
+		std::unique_lock lock(m_mutex);
+		m_idle.wait(lock, [this]() { return m_jobs.empty() && m_num_running == 0; });
+	}
+
+	void ThreadPool::wait(JobGroup& group)
+	{
+		std::unique_lock lock(m_mutex);
+		m_idle.wait(lock, [&group]() { return group.pending == 0; });
+	}
+
+	void ThreadPool::push(Job job)
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			assert(!m_stopping);
+			if (job.group)
+				++job.group->pending;
+			m_jobs.push(std::move(job));
+		}
+		m_job_available.notify_one();
+	}
+
+	void ThreadPool::work()
+	{
+		MIRA_PROFILE_THREAD("Worker");
+
+		while (true)
+		{
+			Job job;
+			{
+				std::unique_lock lock(m_mutex);
+				m_job_available.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+
+				// Drain the queue before stopping
+				if (m_jobs.empty())
+					return;
+
+				job = std::move(m_jobs.front());
+				m_jobs.pop();
+				++m_num_running;
+			}
+
+			job.function();
+
+			{
+				std::lock_guard lock(m_mutex);
+				--m_num_running;
+				const bool group_done = job.group && --job.group->pending == 0;
+				if (group_done || (m_jobs.empty() && m_num_running == 0))
+					m_idle.notify_all();
+			}
+		}
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "../Common.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+
+namespace mira
+{
+	/*
+		Fixed set of worker threads executing jobs in submission order.
+
+		- Jobs may be submitted from any thread.
+		- wait_idle() blocks until every job submitted so far has finished.
+		- Jobs submitted with a JobGroup can be waited for on their own, so that users sharing a pool do not wait on each other's work.
+		- Pending jobs are finished before the workers are joined on destruction.
+	*/
+	class ThreadPool
+	{
+	public:
+		// Counts the unfinished jobs submitted with it, guarded by the pool
+		struct JobGroup
+		{
+			u32 pending{ 0 };
+		};
+
+	public:
+		// Zero picks one thread per hardware thread, minus the calling one
+		ThreadPool(u32 num_threads = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		void submit(std::function<void()> job);
+		void submit(JobGroup& group, std::function<void()> job);
+		void wait_idle();
+
+		// Blocks until every job submitted with 'group' so far has finished
+		void wait(JobGroup& group);
+
+		u32 get_num_threads() const { return (u32)m_workers.size(); }
+
+	private:
+		struct Job
+		{
+			std::function<void()> function;
+			JobGroup* group{ nullptr };
+		};
+
+	private:
+		void push(Job job);
+		void work();
+
+	private:
+		std::vector<std::thread> m_workers;
+
+		std::mutex m_mutex;
+		std::condition_variable m_job_available;
+		std::condition_variable m_idle;
+		std::queue<Job> m_jobs;
+		u32 m_num_running{ 0 };
+		bool m_stopping{ false };
+	};
+}
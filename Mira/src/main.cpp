@@ -1,13 +1,417 @@
 #include <iostream>
+
+#ifdef _WIN32
 #include "Application.h"
+#include "RHI/DX12/RenderBackend_DX12.h"
+#include "RHI/ShaderCompiler/ShaderCompiler_DXC.h"
+#endif
+
+#include "RHI/Capture/CaptureReplayer.h"
+#include "RHI/Null/RenderBackend_Null.h"
+#include "RHI/Null/RenderDevice_Null.h"
+#include "Rendering/GPUGarbageBin.h"
+#include "Rendering/GPUConstantManager.h"
+#include "Rendering/MeshManager.h"
+#include "Rendering/TextureManager.h"
+#include "Rendering/RenderGraph.h"
+#include "Rendering/QueueScheduler.h"
+#include "Rendering/ClusterCuller.h"
+#include "Resource/MeshletBuilder.h"
+#include "Profiling/Profiler.h"
+#include "Profiling/CPUProfiler.h"
+#include "Threading/ThreadPool.h"
+
+#include <chrono>
+
+/*
+	Usage:
+		Mira								Run the application
+		Mira --capture <file> <frames>		Run the application and capture the first <frames> frames
+		Mira --profile <file>				Run the application and write the profiled scopes of the last frames as a Chrome trace
+		Mira --replay <file> <loops>		Replay a capture <loops> times and report the CPU submission cost
+			[--backend dx12|null]			on the given backend (DX12 by default on Windows), Null also reports its stats
+		Mira --bench-shaders <permutations>	Compile every shader <permutations> times with synthetic defines, serially and as a batch
+		Mira --null <frames>				Run <frames> frames of the managers and render graph on the Null device, report its stats and check them
+
+	Only the Null modes (--null, and --replay on the Null backend) are available outside of Windows.
+*/
 
-int main()
+// Checks the Null device stats against what the frames submitted, false on a mismatch
+static bool run_null_frames(u32 frames)
 {
-	Application app;
-	app.run();
+	mira::ThreadPool workers;
+	mira::RenderBackend_Null be;
+	auto rd = static_cast<mira::RenderDevice_Null*>(be.create_device());
+
+	constexpr u8 MAX_FRAMES_IN_FLIGHT = 2;
+	mira::SwapChain* sc = rd->create_swapchain(nullptr, MAX_FRAMES_IN_FLIGHT + 1);
+
+	mira::TextureDesc depth_desc{};
+	depth_desc.width = 1600;
+	depth_desc.height = 900;
+	depth_desc.usage = mira::UsageIntent::DepthStencil;
+	depth_desc.format = mira::ResourceFormat::D32_FLOAT;
+
+	mira::GPUGarbageBin bin(rd);
+	mira::GPUConstantManager constant_mgr(rd, &bin, 3);
+
+	// Grid of quads in the xz-plane facing +y, spanning [-2, 2] so that only the part within the view is drawn
+	constexpr u32 GRID_QUADS = 256;
+	mira::ImportedMesh grid;
+	std::vector<mira::SubmeshMetadata> submeshes(1);
+	{
+		std::vector<f32> positions;
+		for (u32 z = 0; z <= GRID_QUADS; ++z)
+		{
+			for (u32 x = 0; x <= GRID_QUADS; ++x)
+				positions.insert(positions.end(), { 4.f * x / GRID_QUADS - 2.f, 0.f, 4.f * z / GRID_QUADS - 2.f });
+		}
+		for (u32 z = 0; z < GRID_QUADS; ++z)
+		{
+			for (u32 x = 0; x < GRID_QUADS; ++x)
+			{
+				const u32 v = z * (GRID_QUADS + 1) + x;
+				grid.indices.insert(grid.indices.end(), { v, v + GRID_QUADS + 1, v + 1, v + 1, v + GRID_QUADS + 1, v + GRID_QUADS + 2 });
+			}
+		}
+		grid.vertex_data[mira::VertexAttribute::Position].assign((u8*)positions.data(), (u8*)(positions.data() + positions.size()));
+
+		submeshes[0].vert_count = (GRID_QUADS + 1) * (GRID_QUADS + 1);
+		submeshes[0].index_count = (u32)grid.indices.size();
+		mira::build_meshlets(grid, submeshes);
+	}
+
+	mira::MeshManager::SizeSpecification spec{};
+	spec.index_buffer_size = sizeof(u32) * (u32)grid.indices.size();
+	spec.staging_size = 4'000'000;
+	spec.upload_batch_size = spec.staging_size;
+	spec.buffer_sizes[mira::VertexAttribute::Position] = (u32)grid.vertex_data[mira::VertexAttribute::Position].size();
+	spec.meshlet_buffer_size = sizeof(mira::Meshlet) * (u32)grid.meshlets.size();
+	spec.meshlet_vertex_buffer_size = sizeof(u32) * (u32)grid.meshlet_vertices.size();
+	spec.meshlet_triangle_buffer_size = sizeof(u32) * (u32)grid.meshlet_triangles.size();
+	mira::MeshManager mesh_mgr(rd, &bin, spec);
+
+	mira::MeshManager::MeshSpecification load_spec{};
+	load_spec.indices = grid.indices;
+	load_spec.submeshes = submeshes;
+	load_spec.meshlets = grid.meshlets;
+	load_spec.meshlet_vertices = grid.meshlet_vertices;
+	load_spec.meshlet_triangles = grid.meshlet_triangles;
+	load_spec.data[mira::VertexAttribute::Position] = grid.vertex_data[mira::VertexAttribute::Position];
+	const auto mesh = mesh_mgr.load_mesh_async(load_spec);
+
+	// Checkerboard with its mip chain
+	std::vector<mira::TextureMipData> mips;
+	for (u32 size = 64; size > 0; size /= 2)
+	{
+		mira::TextureMipData mip{};
+		mip.width = mip.height = size;
+		for (u32 i = 0; i < size * size; ++i)
+		{
+			const u8 value = ((i % size) / 8 + (i / size) / 8) % 2 ? 255 : 0;
+			mip.data.insert(mip.data.end(), { value, value, value, 255 });
+		}
+		mips.push_back(std::move(mip));
+	}
+	mira::TextureManager tex_man(rd, &bin);
+	auto [tex_handle, tex_view] = tex_man.allocate("checker", mips);
+
+	mira::RenderGraph graph(rd, &bin);
+	mira::QueueScheduler scheduler(rd);
+	mira::Profiler profiler;
+	mira::ClusterCuller culler(workers);
+	std::vector<mira::ClusterDraw> cluster_draws;
+
+	// Orthographic, looking down -y onto the unit square around the origin (row vectors, depth in [0, 1])
+	mira::ClusterCuller::View cull_view{};
+	cull_view.view_projection =
+	{
+		1.f, 0.f, 0.f, 0.f,
+		0.f, 0.f, -0.1f, 0.f,
+		0.f, 1.f, 0.f, 0.f,
+		0.f, 0.f, 0.5f, 1.f
+	};
+	cull_view.camera_position = { 0.f, 5.f, 0.f };
+	const std::array<f32, 16> world = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f };
+
+	// Stats cover the loads above, the frames add their draws, barriers and transient resources
+	u64 expected_draws = 0;
+	u32 drawn_frames = 0;
+
+	for (u32 frame = 0; frame < frames; ++frame)
+	{
+		MIRA_PROFILE_FRAME(rd->get_current_frame());
+		MIRA_PROFILE_ZONE("Frame");
+
+		rd->begin_frame(MAX_FRAMES_IN_FLIGHT);
+		bin.begin_frame();
+		mesh_mgr.begin_frame();
+
+		profiler.collect_cpu_events();
+		profiler.collect_gpu_timings(rd->get_gpu_timings());
+
+		graph.begin_frame();
+		scheduler.begin_frame();
+
+		// Meshes are only drawn once is_ready, the frame does not depend on the uploads
+		mesh_mgr.schedule_uploads(scheduler);
+
+		auto bb = graph.import_texture(sc->get_buffer(sc->get_next_draw_surface_idx()), mira::ResourceState::Present, mira::ResourceState::Present);
+		auto depth = graph.create_texture(depth_desc);
+
+		cluster_draws.clear();
+		if (mesh_mgr.is_ready(mesh.mesh))
+		{
+			culler.cull(cull_view, mesh_mgr, mesh, world, cluster_draws);
+			expected_draws += cluster_draws.size();
+			++drawn_frames;
+		}
+
+		graph.add_pass("Geometry", [&](mira::RenderCommandList& list, const mira::RGExecuteContext&)
+			{
+				if (!mesh_mgr.is_ready(mesh.mesh))
+					return;
+
+				auto [draw_mem, draw_view] = constant_mgr.allocate_transient(sizeof(world));
+				std::memcpy(draw_mem, world.data(), sizeof(world));
+
+				for (const auto& draw : cluster_draws)
+				{
+					list.submit(mira::RenderCommandUpdateShaderArgs()
+						.append_constant(mesh_mgr.get_submesh_metadata_index(mesh.mesh, draw.submesh))
+						.append_constant(draw_view)
+						.append_constant(tex_view)
+					);
+
+					list.submit(mira::RenderCommandDrawIndexed(mesh_mgr.get_index_buffer(), draw.index_count, 1, draw.index_start, 0, 0));
+				}
+			})
+			.add_render_target(bb, mira::TextureViewRange(mira::TextureViewDimension::Texture2D, mira::ResourceFormat::RGBA_8_UNORM),
+				mira::RenderPassBeginAccessType::Clear, mira::RenderPassEndingAccessType::Preserve)
+			.set_depth_stencil(depth, mira::TextureViewRange(mira::TextureViewDimension::Texture2D, mira::ResourceFormat::D32_FLOAT).set_mips(0, 1),
+				mira::RenderPassBeginAccessType::Clear, mira::RenderPassEndingAccessType::Discard);
+
+		auto list = graph.execute();
+
+		auto list_hdl = rd->allocate_command_list(mira::QueueType::Graphics);
+		rd->compile_command_list(list_hdl, list);
+		scheduler.add_batch("Frame", mira::QueueType::Graphics, { list_hdl });
+		scheduler.submit();
+		profiler.add_events(rd->get_current_frame(), scheduler.get_profile_events());
+		bin.push_deferred_deletion(list_hdl);
+
+		constant_mgr.end_frame();
+
+		sc->present(false);
+		rd->end_frame();
+	}
+
+	rd->flush();
+
+	u32 visible_triangles = 0;
+	for (const auto& draw : cluster_draws)
+		visible_triangles += draw.index_count / 3;
+	std::cout << "Ran " << frames << " frames, " << grid.meshlets.size() << " meshlets, drawing " << visible_triangles << " of "
+		<< grid.indices.size() / 3 << " triangles in " << cluster_draws.size() << " draws\n";
+	rd->print_stats();
 
+	profiler.collect_cpu_events();
+	std::cout << profiler.format_summary();
 
+	bool passed = true;
+	auto check = [&passed](bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::cout << "FAILED: " << what << "\n";
+			passed = false;
+		}
+	};
 
+	// One copy per uploaded mesh buffer (position, indices, meshlets, meshlet vertices and triangles, submesh metadata), one per mip
+	u64 expected_bytes = grid.vertex_data[mira::VertexAttribute::Position].size() + grid.indices.size() * sizeof(u32) +
+		grid.meshlets.size() * sizeof(mira::Meshlet) + (grid.meshlet_vertices.size() + grid.meshlet_triangles.size()) * sizeof(u32) +
+		submeshes.size() * sizeof(mira::SubmeshMetadata);
+	for (const auto& mip : mips)
+		expected_bytes += mip.data.size();
+
+	const auto& stats = rd->get_stats();
+	auto count = [&stats](mira::RenderCommandType type) { return stats.command_counts[(u32)type]; };
+	check(count(mira::RenderCommandType::CopyBuffer) == 6, "mesh upload copies");
+	check(count(mira::RenderCommandType::CopyBufferToImage) == mips.size(), "texture upload copies");
+	check(stats.bytes_copied == expected_bytes, "bytes copied");
+
+	// Mesh upload, texture upload and a graphics list per frame
+	check(stats.submissions == frames + 2 && stats.command_lists == frames + 2, "submissions");
+
+	// Uploaded by the first frame and drawn from the second on, a quarter of the grid is in view and its edge clusters are not culled
+	check(drawn_frames == frames - 1, "mesh ready after its upload");
+	check(count(mira::RenderCommandType::DrawIndexed) == expected_draws && count(mira::RenderCommandType::UpdateShaderArgs) == expected_draws, "draws");
+	if (drawn_frames > 0)
+		check(visible_triangles >= grid.indices.size() / 12 && visible_triangles < grid.indices.size() / 3, "culled triangles");
+	check(count(mira::RenderCommandType::BeginRenderPass) == frames && count(mira::RenderCommandType::EndRenderPass) == frames, "render passes");
+
+	// Back buffer into and out of the render target state
+	check(count(mira::RenderCommandType::Barrier) == 2 * frames, "barriers");
+
+	// The depth target is placed once and reused by every later frame
+	check(stats.heaps == 1 && stats.placed_resources == 1, "transient reuse");
+
+	return passed;
+}
+
+static bool replay_capture(const std::filesystem::path& path, u32 loops, const std::string& backend)
+{
+	mira::ThreadPool workers;
+	std::unique_ptr<mira::RenderBackend> be;
+	if (backend == "null")
+		be = std::make_unique<mira::RenderBackend_Null>();
+#ifdef _WIN32
+	else if (backend == "dx12")
+		be = std::make_unique<mira::RenderBackend_DX12>(workers, false);
+#endif
+	else
+	{
+		std::cout << "Unknown backend " << backend << "\n";
+		return false;
+	}
+
+	mira::RenderDevice* rd = be->create_device();
+	try
+	{
+		mira::CaptureReplayer replayer(rd, path);
+
+		const auto stats = replayer.replay(loops);
+		if (stats.frames == 0)
+		{
+			std::cout << "Capture contains no frames\n";
+			return false;
+		}
+
+		std::cout << "Replayed " << stats.frames << " frames (" << stats.command_lists << " command lists, " << stats.commands << " commands)\n";
+		std::cout << "Per frame: compile " << stats.compile_ms / stats.frames << " ms, submit " << stats.submit_ms / stats.frames
+			<< " ms, total " << stats.frame_ms / stats.frames << " ms\n";
+	}
+	catch (const std::exception& error)
+	{
+		std::cout << "Replay failed: " << error.what() << "\n";
+		return false;
+	}
+
+	if (backend == "null")
+		static_cast<mira::RenderDevice_Null*>(rd)->print_stats();
+	return true;
+}
+
+#ifdef _WIN32
+static void benchmark_shader_compilation(u32 permutations)
+{
+	using Clock = std::chrono::high_resolution_clock;
+	auto elapsed_ms = [](Clock::time_point start) { return std::chrono::duration<f64, std::milli>(Clock::now() - start).count(); };
+
+	// No cache, every request is compiled
+	mira::ThreadPool workers;
+	mira::ShaderCompiler_DXC compiler(workers, mira::ShaderModel::SM_6_6, {});
+
+	// Shader type is taken from the file name suffix (e.g mesh_vs.hlsl)
+	std::vector<mira::ShaderCompileRequest> requests;
+	for (const auto& entry : std::filesystem::directory_iterator("shaders"))
+	{
+		if (entry.path().extension() != ".hlsl")
+			continue;
+
+		const auto stem = entry.path().stem().string();
+		mira::ShaderType type{};
+		if (stem.ends_with("_vs"))
+			type = mira::ShaderType::Vertex;
+		else if (stem.ends_with("_ps"))
+			type = mira::ShaderType::Pixel;
+		else
+			continue;
+
+		for (u32 i = 0; i < permutations; ++i)
+		{
+			mira::ShaderCompileRequest request{};
+			request.rel_path = entry.path().filename();
+			request.type = type;
+			request.defines = { { "PERMUTATION", std::to_string(i) }, { "PERMUTATION_BIT_" + std::to_string(i % 8), "1" } };
+			requests.push_back(request);
+		}
+	}
+
+	if (requests.empty())
+	{
+		std::cout << "No shaders found\n";
+		return;
+	}
+
+	auto start = Clock::now();
+	for (const auto& request : requests)
+		compiler.compile(request);
+	const f64 serial_ms = elapsed_ms(start);
+
+	start = Clock::now();
+	const auto results = compiler.compile_batch(requests);
+	const f64 batch_ms = elapsed_ms(start);
+
+	f64 total_compile_ms = 0.0, slowest_ms = 0.0;
+	u32 failed = 0;
+	for (const auto& result : results)
+	{
+		total_compile_ms += result.compile_ms;
+		slowest_ms = std::max(slowest_ms, result.compile_ms);
+		failed += result.shader ? 0 : 1;
+	}
+
+	std::cout << "Compiled " << requests.size() << " shaders (" << failed << " failed)\n";
+	std::cout << "Serial: " << serial_ms << " ms, batch: " << batch_ms << " ms (" << serial_ms / batch_ms << "x)\n";
+	std::cout << "Batch per shader: average " << total_compile_ms / results.size() << " ms, slowest " << slowest_ms << " ms\n";
+}
+#endif
+
+int main(int argc, char** argv)
+{
+	const std::vector<std::string> args(argv + 1, argv + argc);
+
+	if (args.size() >= 1 && args[0] == "--null")
+	{
+		return run_null_frames(args.size() >= 2 ? std::stoul(args[1]) : 64) ? 0 : 1;
+	}
+
+	if (args.size() >= 2 && args[0] == "--replay")
+	{
+#ifdef _WIN32
+		std::string backend = "dx12";
+#else
+		std::string backend = "null";
+#endif
+		if (args.size() >= 5 && args[3] == "--backend")
+			backend = args[4];
+
+		return replay_capture(args[1], args.size() >= 3 ? std::stoul(args[2]) : 1, backend) ? 0 : 1;
+	}
+
+#ifdef _WIN32
+
+	if (args.size() >= 1 && args[0] == "--bench-shaders")
+	{
+		benchmark_shader_compilation(args.size() >= 2 ? std::stoul(args[1]) : 16);
+		return 0;
+	}
+
+	std::optional<Application::CaptureSettings> capture;
+	if (args.size() >= 2 && args[0] == "--capture")
+		capture = Application::CaptureSettings{ args[1], args.size() >= 3 ? (u32)std::stoul(args[2]) : 1 };
+
+	std::optional<std::filesystem::path> profile_path;
+	if (args.size() >= 2 && args[0] == "--profile")
+		profile_path = args[1];
+
+	Application app(capture, profile_path);
+	app.run();
+#else
+	std::cout << "Only --null <frames> and --replay <file> <loops> [--backend null] are available on this platform\n";
+#endif
 
 	return 0;
-}
\ No newline at end of file
+}
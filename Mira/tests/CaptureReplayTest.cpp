@@ -0,0 +1,165 @@
+#include "RHI/Null/RenderBackend_Null.h"
+#include "RHI/Null/RenderDevice_Null.h"
+#include "RHI/Capture/RenderDevice_Capture.h"
+#include "RHI/Capture/CaptureReplayer.h"
+#include <fstream>
+#include <iostream>
+
+/*
+	Records a prologue and a few frames on the Null device through RenderDevice_Capture and replays them on a fresh device,
+	which has to execute the same work. Missing, foreign, truncated and corrupt captures have to be rejected with an error.
+*/
+
+namespace
+{
+	u32 g_failures = 0;
+
+	void check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::cout << "FAILED: " << what << "\n";
+			++g_failures;
+		}
+	}
+
+	constexpr u32 NUM_FRAMES = 3;
+	constexpr u32 BUFFER_SIZE = 4096;
+
+	// Returns the stats of the recorded frames
+	mira::RenderDevice_Null::Stats record(mira::RenderDevice_Null* device, const std::filesystem::path& path)
+	{
+		mira::RenderDevice_Capture rd(device, path);
+
+		// Prologue: resources and an initial upload
+		const auto upload = rd.create_buffer(mira::BufferDesc(BUFFER_SIZE, mira::MemoryType::Upload));
+		const auto target = rd.create_buffer(mira::BufferDesc(BUFFER_SIZE, mira::MemoryType::Default));
+		const auto view = rd.create_view(target, mira::BufferViewDesc(mira::ViewType::ShaderResource, 0, 16, BUFFER_SIZE / 16));
+
+		u8* mapped = rd.map(upload);
+		for (u32 i = 0; i < BUFFER_SIZE; ++i)
+			mapped[i] = (u8)i;
+
+		auto submit = [&](mira::RenderCommandList list)
+		{
+			auto handle = rd.allocate_command_list(mira::QueueType::Graphics);
+			rd.compile_command_list(handle, std::move(list));
+			rd.submit_command_lists(std::span(&handle, 1), mira::QueueType::Graphics);
+			return handle;
+		};
+
+		mira::RenderCommandList initial;
+		initial.submit(mira::RenderCommandCopyBuffer(upload, 0, target, 0, BUFFER_SIZE));
+		rd.recycle_command_list(submit(std::move(initial)));
+		rd.flush();
+
+		device->reset_stats();
+		for (u32 frame = 0; frame < NUM_FRAMES; ++frame)
+		{
+			rd.mark_frame_boundary();
+			rd.begin_frame(2);
+
+			// Each frame updates and copies a different part of the buffer
+			const u32 offset = frame * 256;
+			for (u32 i = 0; i < 256; ++i)
+				mapped[offset + i] = (u8)(frame + i);
+
+			mira::RenderCommandList list;
+			list.submit(mira::RenderCommandCopyBuffer(upload, offset, target, offset, 256));
+			list.submit(mira::RenderCommandDraw(3, 1, 0, 0));
+			const auto handle = submit(std::move(list));
+
+			rd.end_frame();
+			rd.recycle_command_list(handle);
+		}
+		rd.end_capture();
+
+		const auto stats = device->get_stats();
+		rd.free_view(view);
+		rd.free_buffer(target);
+		rd.free_buffer(upload);
+		return stats;
+	}
+
+	bool rejects(mira::RenderBackend_Null& be, const std::filesystem::path& path)
+	{
+		try
+		{
+			mira::CaptureReplayer replayer(be.create_device(), path);
+			replayer.replay(1);
+		}
+		catch (const std::exception&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	void write_file(const std::filesystem::path& path, const std::vector<u8>& bytes)
+	{
+		std::ofstream(path, std::ios::binary | std::ios::trunc).write((const char*)bytes.data(), bytes.size());
+	}
+}
+
+int main()
+{
+	const auto dir = std::filesystem::temp_directory_path() / "mira_capture_replay_test";
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+	const auto path = dir / "frames.cap";
+
+	mira::RenderBackend_Null be;
+	const auto recorded = record(static_cast<mira::RenderDevice_Null*>(be.create_device()), path);
+	check(recorded.command_lists == NUM_FRAMES, "recorded one list per frame");
+
+	// Replay
+	{
+		constexpr u32 LOOPS = 2;
+		auto device = static_cast<mira::RenderDevice_Null*>(be.create_device());
+		mira::CaptureReplayer replayer(device, path);
+		device->reset_stats();
+
+		const auto stats = replayer.replay(LOOPS);
+		check(stats.frames == NUM_FRAMES * LOOPS, "every frame replayed every loop");
+		check(stats.command_lists == NUM_FRAMES * LOOPS, "every list replayed");
+		check(stats.commands == recorded.command_counts[(u32)mira::RenderCommandType::CopyBuffer] * LOOPS
+			+ recorded.command_counts[(u32)mira::RenderCommandType::Draw] * LOOPS, "every command replayed");
+
+		const auto& replayed = device->get_stats();
+		check(replayed.submissions == recorded.submissions * LOOPS, "same submissions as recorded");
+		check(replayed.bytes_copied == recorded.bytes_copied * LOOPS, "same bytes copied as recorded");
+		check(replayed.command_counts[(u32)mira::RenderCommandType::Draw] == NUM_FRAMES * LOOPS, "same draws as recorded");
+	}
+
+	// Invalid captures
+	check(rejects(be, dir / "does_not_exist.cap"), "missing file is rejected");
+
+	std::vector<u8> random_bytes(4096);
+	for (u32 i = 0; i < random_bytes.size(); ++i)
+		random_bytes[i] = (u8)(i * 2654435761u >> 13);
+	write_file(dir / "random.cap", random_bytes);
+	check(rejects(be, dir / "random.cap"), "random bytes are rejected");
+
+	std::ifstream file(path, std::ios::binary);
+	const std::vector<u8> capture((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	auto wrong_version = capture;
+	wrong_version[4] ^= 0xFF;
+	write_file(dir / "version.cap", wrong_version);
+	check(rejects(be, dir / "version.cap"), "other version is rejected");
+
+	write_file(dir / "truncated.cap", std::vector<u8>(capture.begin(), capture.end() - 3));
+	check(rejects(be, dir / "truncated.cap"), "truncated capture is rejected");
+
+	// Random payload after a valid header
+	auto corrupt = std::vector<u8>(capture.begin(), capture.begin() + sizeof(mira::CaptureHeader));
+	corrupt.insert(corrupt.end(), random_bytes.begin(), random_bytes.end());
+	write_file(dir / "corrupt.cap", corrupt);
+	check(rejects(be, dir / "corrupt.cap"), "corrupt payload is rejected");
+
+	std::filesystem::remove_all(dir);
+
+	if (g_failures == 0)
+		std::cout << "CaptureReplayTest passed\n";
+	return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+#include "Memory/IndexAllocator.h"
+#include <iostream>
+#include <latch>
+#include <random>
+#include <thread>
+
+/*
+	IndexAllocator under contention: threads allocate and free at random while every index is tracked by who holds it,
+	so that an index handed out twice is caught. Then every thread allocates until exhaustion, which has to hand out
+	each index exactly once and return nullopt afterwards.
+*/
+
+namespace
+{
+	std::atomic<u32> g_failures{ 0 };
+
+	void check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::cout << "FAILED: " << what << "\n";
+			++g_failures;
+		}
+	}
+
+	// One flag per index, set while it is allocated
+	class Ownership
+	{
+	public:
+		Ownership(u32 capacity) : m_held(std::make_unique<std::atomic<u8>[]>(capacity)), m_capacity(capacity) {}
+
+		void acquire(u32 index)
+		{
+			check(index < m_capacity, "index within capacity");
+			if (index < m_capacity)
+				check(m_held[index].exchange(1) == 0, "index not handed out twice");
+		}
+
+		void release(u32 index)
+		{
+			check(m_held[index].exchange(0) == 1, "freed index was allocated");
+		}
+
+	private:
+		std::unique_ptr<std::atomic<u8>[]> m_held;
+		u32 m_capacity{ 0 };
+	};
+
+	template <typename Fn>
+	void run_threads(u32 num_threads, Fn&& fn)
+	{
+		std::latch start(num_threads);
+		std::vector<std::thread> threads;
+		for (u32 t = 0; t < num_threads; ++t)
+		{
+			threads.emplace_back([&, t]()
+				{
+					start.arrive_and_wait();
+					fn(t);
+				});
+		}
+		for (auto& thread : threads)
+			thread.join();
+	}
+}
+
+int main()
+{
+	constexpr u32 CAPACITY = 1024;
+	constexpr u32 ITERATIONS = 200'000;
+	const u32 num_threads = std::max(std::thread::hardware_concurrency(), 4u);
+
+	mira::IndexAllocator allocator(CAPACITY);
+	Ownership ownership(CAPACITY);
+
+	// Random allocations and frees, the threads together can hold more than the capacity so that exhaustion is hit under contention
+	const u32 max_held = CAPACITY * 2 / num_threads + 1;
+	run_threads(num_threads, [&](u32 t)
+		{
+			std::mt19937 rng(t);
+			std::vector<u32> held;
+			for (u32 i = 0; i < ITERATIONS; ++i)
+			{
+				if (held.size() < max_held && (held.empty() || rng() % 2))
+				{
+					if (auto index = allocator.allocate(); index.has_value())
+					{
+						ownership.acquire(*index);
+						held.push_back(*index);
+					}
+				}
+				else
+				{
+					const u32 slot = rng() % held.size();
+					ownership.release(held[slot]);
+					allocator.free(held[slot]);
+					held[slot] = held.back();
+					held.pop_back();
+				}
+			}
+
+			for (u32 index : held)
+			{
+				ownership.release(index);
+				allocator.free(index);
+			}
+		});
+	check(allocator.get_num_allocated() == 0, "everything freed after random use");
+
+	// Exhaustion, every index exactly once
+	std::atomic<u32> num_allocated{ 0 };
+	std::vector<std::vector<u32>> held(num_threads);
+	run_threads(num_threads, [&](u32 t)
+		{
+			while (auto index = allocator.allocate())
+			{
+				ownership.acquire(*index);
+				held[t].push_back(*index);
+				++num_allocated;
+			}
+		});
+	check(num_allocated == CAPACITY, "exhaustion hands out the whole capacity");
+	check(allocator.get_num_allocated() == CAPACITY, "allocated count at capacity");
+	check(!allocator.allocate().has_value(), "exhausted allocator returns nullopt");
+
+	run_threads(num_threads, [&](u32 t)
+		{
+			for (u32 index : held[t])
+			{
+				ownership.release(index);
+				allocator.free(index);
+			}
+		});
+	check(allocator.get_num_allocated() == 0, "everything freed after exhaustion");
+
+	if (g_failures == 0)
+		std::cout << "IndexAllocatorTest passed\n";
+	return g_failures == 0 ? 0 : 1;
+}
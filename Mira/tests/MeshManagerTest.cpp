@@ -0,0 +1,130 @@
+#include "RHI/Null/RenderBackend_Null.h"
+#include "RHI/Null/RenderDevice_Null.h"
+#include "Rendering/GPUGarbageBin.h"
+#include "Rendering/MeshManager.h"
+#include <cstring>
+#include <iostream>
+
+/*
+	MeshManager on the Null device with a staging ring smaller than the mesh: vertex and index data which does not fit
+	the ring at once is copied in chunks of half the ring, waiting for earlier chunks as the ring fills up, and lands
+	in the device-local buffers intact. Data which fits the ring is still copied at once.
+*/
+
+namespace
+{
+	u32 g_failures{ 0 };
+
+	void check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::cout << "FAILED: " << what << "\n";
+			++g_failures;
+		}
+	}
+
+	constexpr u32 STAGING_SIZE = 1024;
+	constexpr u32 CHUNK_SIZE = STAGING_SIZE / 2;
+
+	u64 num_chunks(u64 size)
+	{
+		return size <= STAGING_SIZE ? 1 : (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	}
+
+	struct TestMesh
+	{
+		std::vector<f32> positions;
+		std::vector<u32> indices;
+		std::vector<mira::SubmeshMetadata> submeshes;
+
+		TestMesh(u32 num_vertices, u32 num_triangles)
+		{
+			for (u32 i = 0; i < num_vertices * 3; ++i)
+				positions.push_back((f32)i);
+			for (u32 i = 0; i < num_triangles * 3; ++i)
+				indices.push_back(i * 7 % num_vertices);
+
+			mira::SubmeshMetadata submesh{};
+			submesh.vert_count = num_vertices;
+			submesh.index_count = num_triangles * 3;
+			submeshes.push_back(submesh);
+		}
+
+		mira::MeshManager::MeshSpecification get_spec()
+		{
+			mira::MeshManager::MeshSpecification spec{};
+			spec.data[mira::VertexAttribute::Position] = std::span<u8>((u8*)positions.data(), positions.size() * sizeof(f32));
+			spec.indices = indices;
+			spec.submeshes = submeshes;
+			return spec;
+		}
+
+		u64 get_num_bytes() const
+		{
+			return positions.size() * sizeof(f32) + indices.size() * sizeof(u32) + submeshes.size() * sizeof(mira::SubmeshMetadata);
+		}
+
+		u64 get_num_copies() const
+		{
+			return num_chunks(positions.size() * sizeof(f32)) + num_chunks(indices.size() * sizeof(u32)) + num_chunks(submeshes.size() * sizeof(mira::SubmeshMetadata));
+		}
+	};
+}
+
+int main()
+{
+	mira::RenderBackend_Null be;
+	auto rd = static_cast<mira::RenderDevice_Null*>(be.create_device());
+
+	{
+		mira::GPUGarbageBin bin(rd);
+
+		TestMesh large(300, 300);	// 3600 bytes of positions and of indices
+		TestMesh small(20, 10);
+
+		mira::MeshManager::SizeSpecification spec{};
+		spec.staging_size = STAGING_SIZE;
+		spec.index_buffer_size = sizeof(u32) * (u32)(large.indices.size() + small.indices.size());
+		spec.buffer_sizes[mira::VertexAttribute::Position] = sizeof(f32) * (u32)(large.positions.size() + small.positions.size());
+		mira::MeshManager mesh_mgr(rd, &bin, spec);
+
+		rd->begin_frame(2);
+		bin.begin_frame();
+		mesh_mgr.begin_frame();
+
+		const auto& stats = rd->get_stats();
+		auto copies = [&stats]() { return stats.command_counts[(u32)mira::RenderCommandType::CopyBuffer]; };
+
+		// Larger than the ring
+		const auto large_mesh = mesh_mgr.load_mesh(large.get_spec());
+		check(mesh_mgr.is_ready(large_mesh.mesh), "large mesh is ready");
+		check(copies() == large.get_num_copies(), "large data is copied in chunks");
+		check(stats.bytes_copied == large.get_num_bytes(), "every byte of the large mesh is copied");
+		check(stats.submissions > 1, "chunks are submitted as the ring fills up");
+
+		// First allocation of the index buffer
+		const u8* index_memory = rd->map(mesh_mgr.get_index_buffer());
+		check(std::memcmp(index_memory, large.indices.data(), large.indices.size() * sizeof(u32)) == 0, "chunked indices arrive intact");
+
+		// Fits the ring, after the chunks of the large mesh
+		const auto small_mesh = mesh_mgr.load_mesh(small.get_spec());
+		check(mesh_mgr.is_ready(small_mesh.mesh), "small mesh is ready");
+		check(copies() == large.get_num_copies() + 3, "small data is copied at once");
+		check(stats.bytes_copied == large.get_num_bytes() + small.get_num_bytes(), "every byte of the small mesh is copied");
+
+		const auto& md = mesh_mgr.get_submesh_metadata(large_mesh.mesh, 0);
+		check(md.vert_count == 300 && md.bounds_extent[0] == 897.f, "large mesh metadata and bounds");
+		check(mesh_mgr.get_submesh_metadata_index(small_mesh.mesh, 0) == mesh_mgr.get_submesh_metadata_index(large_mesh.mesh, 0) + 1, "submesh metadata is allocated in order");
+
+		mesh_mgr.free_mesh(small_mesh.mesh);
+		mesh_mgr.free_mesh(large_mesh.mesh);
+
+		rd->end_frame();
+		rd->flush();
+	}
+
+	if (g_failures == 0)
+		std::cout << "MeshManagerTest passed\n";
+	return g_failures == 0 ? 0 : 1;
+}
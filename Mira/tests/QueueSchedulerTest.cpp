@@ -0,0 +1,115 @@
+#include "RHI/Null/RenderBackend_Null.h"
+#include "RHI/Null/RenderDevice_Null.h"
+#include "Rendering/QueueScheduler.h"
+#include <iostream>
+
+/*
+	QueueScheduler on the Null device: a frame of batches across the three queues whose dependencies are partly covered by
+	earlier waits, directly, through another queue or by a later batch of the same queue. Only the uncovered ones may become
+	waits, only waited on batches (and those asking for their sync) signal, and the trace has an interval per wait and batch.
+*/
+
+namespace
+{
+	u32 g_failures{ 0 };
+
+	void check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::cout << "FAILED: " << what << "\n";
+			++g_failures;
+		}
+	}
+
+	mira::CommandList compile(mira::RenderDevice* rd, mira::QueueType queue)
+	{
+		const auto cmdl = rd->allocate_command_list(queue);
+		rd->compile_command_list(cmdl, mira::RenderCommandList());
+		return cmdl;
+	}
+
+	using Event = mira::QueueScheduler::TraceEvent;
+	bool is_wait(const Event& event, mira::QueueType queue, u32 batch)
+	{
+		return event.type == Event::Type::Wait && event.queue == queue && event.batch == batch;
+	}
+}
+
+int main()
+{
+	mira::RenderBackend_Null be;
+	auto rd = static_cast<mira::RenderDevice_Null*>(be.create_device());
+
+	using mira::QueueType;
+	mira::QueueScheduler scheduler(rd);
+	std::vector<mira::CommandList> lists;
+
+	for (u32 frame = 0; frame < 2; ++frame)
+	{
+		rd->begin_frame(2);
+		scheduler.begin_frame();
+
+		auto add = [&](const char* name, QueueType queue, std::vector<u32> dependencies, std::function<void(mira::SyncReceipt)> on_submit = {})
+		{
+			lists.push_back(compile(rd, queue));
+			return scheduler.add_batch(name, queue, { lists.back() }, std::move(dependencies), std::move(on_submit));
+		};
+
+		std::optional<mira::SyncReceipt> upload_receipt;
+		const u32 upload = add("Upload", QueueType::Copy, {}, [&](mira::SyncReceipt receipt) { upload_receipt = receipt; });
+		const u32 skin = add("Skin", QueueType::Compute, { upload });
+		const u32 gbuffer = add("GBuffer", QueueType::Graphics, { upload, skin });				// Upload is covered by the wait on Skin
+		const u32 lighting = add("Lighting", QueueType::Graphics, { upload, skin, gbuffer });	// Covered by the GBuffer waits, same queue
+		const u32 readback_a = add("Readback A", QueueType::Copy, { gbuffer });
+		const u32 readback_b = add("Readback B", QueueType::Copy, { lighting });				// Lighting is later than the waited on GBuffer
+		const u32 post = add("Post", QueueType::Compute, { readback_a, readback_b });			// Readback B covers Readback A
+		const u32 present = add("Present", QueueType::Graphics, { post, skin });				// Skin is covered through Post
+
+		const auto submissions = rd->get_stats().submissions;
+		scheduler.submit();
+
+		check(rd->get_stats().submissions == submissions + 8, "every batch is submitted");
+		check(scheduler.get_num_waits() == 6, "uncovered dependencies wait");
+		check(scheduler.get_num_elided_waits() == 5, "covered dependencies are elided");
+
+		// Waits precede the batch they belong to, batches are submitted in the order they were added
+		const auto& trace = scheduler.get_trace();
+		check(trace.size() == 14, "trace has every wait and batch");
+		if (trace.size() == 14)
+		{
+			check(is_wait(trace[1], QueueType::Compute, upload), "Skin waits on Upload");
+			check(is_wait(trace[3], QueueType::Graphics, skin), "GBuffer waits on Skin only");
+			check(trace[5].type == Event::Type::Execute && trace[5].batch == lighting, "Lighting does not wait");
+			check(is_wait(trace[6], QueueType::Copy, gbuffer), "Readback A waits on GBuffer");
+			check(is_wait(trace[8], QueueType::Copy, lighting), "Readback B waits on Lighting");
+			check(is_wait(trace[10], QueueType::Compute, readback_b), "Post waits on Readback B only");
+			check(is_wait(trace[12], QueueType::Graphics, post), "Present waits on Post only");
+			check(trace[13].type == Event::Type::Execute && trace[13].batch == present, "Present is submitted last");
+		}
+
+		// Intervals follow each other on the CPU timeline
+		for (u32 i = 0; i < trace.size(); ++i)
+		{
+			check(trace[i].duration_ms >= 0.0, "interval has a duration");
+			if (i > 0)
+				check(trace[i].start_ms >= trace[i - 1].start_ms + trace[i - 1].duration_ms, "intervals are in submission order");
+		}
+
+		const auto events = scheduler.get_profile_events();
+		check(events.size() == trace.size(), "profile event per trace event");
+		if (!events.empty())
+			check(events.front().track == "Queue Copy" && events.front().name == "Upload", "profile events are on queue tracks");
+
+		check(upload_receipt.has_value() && rd->is_complete(*upload_receipt), "sync of a batch asking for it");
+
+		rd->end_frame();
+	}
+
+	for (auto cmdl : lists)
+		rd->recycle_command_list(cmdl);
+
+	if (g_failures == 0)
+		std::cout << "QueueSchedulerTest passed\n";
+	return g_failures == 0 ? 0 : 1;
+}
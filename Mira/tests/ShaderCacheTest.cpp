@@ -0,0 +1,99 @@
+#include "RHI/ShaderCompiler/ShaderCache.h"
+#include <fstream>
+#include <iostream>
+
+/*
+	ShaderCache round trips through its file: entries survive a reload, a changed include invalidates the entries depending on it,
+	and a corrupt or truncated file is discarded and replaced.
+*/
+
+namespace
+{
+	u32 g_failures = 0;
+
+	void check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::cout << "FAILED: " << what << "\n";
+			++g_failures;
+		}
+	}
+
+	void write_text(const std::filesystem::path& path, const std::string& text)
+	{
+		std::ofstream(path, std::ios::binary | std::ios::trunc) << text;
+	}
+
+	mira::ShaderCache::Dependency dependency(const std::filesystem::path& path, const std::string& text)
+	{
+		return { path.string(), hash_bytes(text.data(), text.size()) };
+	}
+}
+
+int main()
+{
+	const auto dir = std::filesystem::temp_directory_path() / "mira_shader_cache_test";
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+
+	const auto cache_path = dir / "shaders.cache";
+	const auto source = dir / "mesh_vs.hlsl";
+	const auto include = dir / "common.hlsli";
+	const std::string source_text = "#include \"common.hlsli\"";
+	const std::string include_text = "float4 f() { return 0; }";
+	write_text(source, source_text);
+	write_text(include, include_text);
+
+	const std::vector<u8> bytecode = { 1, 2, 3, 4, 5 };
+	const std::vector<u8> other_bytecode = { 9, 8, 7 };
+	constexpr u64 KEY = 42, OTHER_KEY = 43;
+
+	// Reload
+	{
+		mira::ShaderCache cache(cache_path);
+		check(!cache.find(KEY).has_value(), "empty cache misses");
+		cache.store(KEY, { dependency(source, source_text), dependency(include, include_text) }, bytecode);
+		cache.store(OTHER_KEY, { dependency(source, source_text) }, other_bytecode);
+	}
+	{
+		mira::ShaderCache cache(cache_path);
+		const auto found = cache.find(KEY);
+		check(found.has_value() && *found == bytecode, "entry survives reload");
+		check(cache.get_num_hits() == 1 && cache.get_num_misses() == 0, "reload counts a hit");
+	}
+
+	// Include invalidation
+	write_text(include, "float4 f() { return 1; }");
+	{
+		mira::ShaderCache cache(cache_path);
+		check(!cache.find(KEY).has_value(), "changed include invalidates entry");
+		const auto found = cache.find(OTHER_KEY);
+		check(found.has_value() && *found == other_bytecode, "entry without the include stays valid");
+	}
+
+	// Corrupt file
+	write_text(cache_path, "definitely not a shader cache");
+	{
+		mira::ShaderCache cache(cache_path);
+		check(!cache.find(OTHER_KEY).has_value(), "corrupt file is discarded");
+		cache.store(OTHER_KEY, { dependency(source, source_text) }, other_bytecode);
+	}
+	{
+		mira::ShaderCache cache(cache_path);
+		check(cache.find(OTHER_KEY).has_value(), "discarded file is replaced");
+	}
+
+	// Truncated file, the last entry is cut short
+	std::filesystem::resize_file(cache_path, std::filesystem::file_size(cache_path) - 1);
+	{
+		mira::ShaderCache cache(cache_path);
+		check(!cache.find(OTHER_KEY).has_value(), "truncated file is discarded");
+	}
+
+	std::filesystem::remove_all(dir);
+
+	if (g_failures == 0)
+		std::cout << "ShaderCacheTest passed\n";
+	return g_failures == 0 ? 0 : 1;
+}
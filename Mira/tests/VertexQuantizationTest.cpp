@@ -0,0 +1,196 @@
+#include "Rendering/VertexQuantization.h"
+#include <cmath>
+#include <iostream>
+#include <random>
+
+/*
+	The vertex encoders against their scalar reference: both have to agree bit for bit on the same inputs, for lengths
+	which leave a tail to the scalar loop, on axis-aligned, zero and negative zero directions and on the edges of the
+	position bounds and of the half range. Decoding the output has to land within the quantization step of the input.
+*/
+
+namespace
+{
+	u32 g_failures{ 0 };
+
+	void check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::cout << "FAILED: " << what << "\n";
+			++g_failures;
+		}
+	}
+
+	// Lengths around the SIMD widths (two positions, four directions or values per iteration)
+	constexpr u32 COUNTS[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 15, 16, 17, 1000, 1001, 1003 };
+
+	// Decoders as in mesh_vs.hlsl
+	std::array<f32, 3> decode_octahedral(u32 encoded)
+	{
+		f32 x = std::max((int16_t)(encoded & 0xFFFF) / 32767.f, -1.f);
+		f32 y = std::max((int16_t)(encoded >> 16) / 32767.f, -1.f);
+		const f32 z = 1.f - std::abs(x) - std::abs(y);
+		if (z < 0.f)
+		{
+			const f32 fx = (1.f - std::abs(y)) * std::copysign(1.f, x);
+			const f32 fy = (1.f - std::abs(x)) * std::copysign(1.f, y);
+			x = fx;
+			y = fy;
+		}
+
+		const f32 length = std::sqrt(x * x + y * y + z * z);
+		return { x / length, y / length, z / length };
+	}
+
+	f32 decode_half(u16 half)
+	{
+		const f32 sign = (half & 0x8000) ? -1.f : 1.f;
+		const u32 exponent = (half >> 10) & 0x1F;
+		const u32 mantissa = half & 0x3FF;
+		if (exponent == 0x1F)
+			return sign * std::numeric_limits<f32>::infinity();
+		if (exponent == 0)
+			return sign * std::ldexp((f32)mantissa, -24);
+		return sign * std::ldexp((f32)(mantissa | 0x400), (i32)exponent - 25);
+	}
+
+	void test_positions(std::mt19937& rng)
+	{
+		std::uniform_real_distribution<f32> dist(-10.f, 10.f);
+
+		for (u32 count : COUNTS)
+		{
+			std::vector<f32> positions(count * 3);
+			for (f32& p : positions)
+				p = dist(rng);
+
+			// Flat along y (zero extent), and x bounded below by signed zeros which min/max have to pick consistently
+			for (u32 i = 0; i < count; ++i)
+			{
+				positions[i * 3] = i % 3 == 0 ? ((i % 2) ? -0.f : 0.f) : std::abs(positions[i * 3]);
+				positions[i * 3 + 1] = 2.5f;
+			}
+
+			std::array<f32, 3> min{}, extent{}, ref_min{}, ref_extent{};
+			mira::compute_bounds(positions.data(), count, min, extent);
+			mira::scalar::compute_bounds(positions.data(), count, ref_min, ref_extent);
+			check(std::memcmp(&min, &ref_min, sizeof(min)) == 0 && std::memcmp(&extent, &ref_extent, sizeof(extent)) == 0, "bounds match the scalar path");
+
+			std::vector<u16> out(count * 4 + 1, 0xCDCD), ref(count * 4 + 1, 0xCDCD);
+			mira::quantize_positions(positions.data(), count, min, extent, out.data());
+			mira::scalar::quantize_positions(positions.data(), count, min, extent, ref.data());
+			check(out == ref, "positions match the scalar path");
+			check(out.back() == 0xCDCD, "positions are not written past the end");
+
+			for (u32 i = 0; i < count; ++i)
+			{
+				check(out[i * 4 + 3] == 0, "position padding is zero");
+				for (u32 c = 0; c < 3; ++c)
+				{
+					const f32 value = positions[i * 3 + c];
+					const u16 q = out[i * 4 + c];
+					if (value == min[c])
+						check(q == 0, "bounds minimum quantizes to zero");
+					if (value == min[c] + extent[c] && extent[c] > 0.f)
+						check(q == 65535, "bounds maximum quantizes to one");
+
+					const f32 step = extent[c] / 65535.f;
+					const f32 decoded = min[c] + q * step;
+					check(std::abs(decoded - value) <= step * 0.5f + 1e-5f, "position within half a step");
+				}
+			}
+		}
+	}
+
+	void test_directions(std::mt19937& rng)
+	{
+		std::normal_distribution<f32> dist;
+		const std::array<f32, 3> edges[] = {
+			{ 1.f, 0.f, 0.f }, { -1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, -1.f, 0.f }, { 0.f, 0.f, 1.f }, { 0.f, 0.f, -1.f },
+			{ -0.f, -0.f, -1.f }, { 0.f, 0.f, -0.f }, { 0.f, 0.f, 0.f }, { -0.f, -0.f, -0.f } };
+
+		for (u32 count : COUNTS)
+		{
+			std::vector<f32> directions(count * 3);
+			for (u32 i = 0; i < count; ++i)
+			{
+				std::array<f32, 3> d = edges[i % std::size(edges)];
+				if (i >= std::size(edges))
+				{
+					d = { dist(rng), dist(rng), dist(rng) };
+					const f32 length = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+					for (f32& c : d)
+						c /= length;
+				}
+				std::copy(d.begin(), d.end(), directions.begin() + i * 3);
+			}
+
+			std::vector<u32> out(count + 1, 0xCDCDCDCD), ref(count + 1, 0xCDCDCDCD);
+			mira::encode_octahedral(directions.data(), count, out.data());
+			mira::scalar::encode_octahedral(directions.data(), count, ref.data());
+			check(out == ref, "directions match the scalar path");
+			check(out.back() == 0xCDCDCDCD, "directions are not written past the end");
+
+			// The octahedral map stretches a step by at most two along the diagonals
+			const f32 tolerance = 2.f / 32767.f;
+			for (u32 i = 0; i < count; ++i)
+			{
+				const f32* d = directions.data() + i * 3;
+				if (d[0] == 0.f && d[1] == 0.f && d[2] == 0.f)
+				{
+					check(out[i] == 0, "zero direction encodes to the center");
+					continue;
+				}
+
+				const auto decoded = decode_octahedral(out[i]);
+				for (u32 c = 0; c < 3; ++c)
+					check(std::abs(decoded[c] - d[c]) <= tolerance, "direction within the step");
+			}
+		}
+	}
+
+	void test_halfs(std::mt19937& rng)
+	{
+		std::uniform_real_distribution<f32> dist(-4.f, 4.f);
+		const f32 edges[] = { 0.f, -0.f, 1.f, -1.f, 65504.f, -65504.f, 65519.f, 65520.f, 1e9f, -1e9f,
+			std::ldexp(1.f, -14), -std::ldexp(1.f, -14), std::ldexp(1.f, -15), 1e-30f, 0.5f + std::ldexp(1.f, -12) };
+
+		for (u32 count : COUNTS)
+		{
+			std::vector<f32> values(count * 2);
+			for (u32 i = 0; i < values.size(); ++i)
+				values[i] = i < std::size(edges) ? edges[i] : dist(rng);
+
+			std::vector<u32> out(count + 1, 0xCDCDCDCD), ref(count + 1, 0xCDCDCDCD);
+			mira::encode_half2(values.data(), count, out.data());
+			mira::scalar::encode_half2(values.data(), count, ref.data());
+			check(out == ref, "halfs match the scalar path");
+			check(out.back() == 0xCDCDCDCD, "halfs are not written past the end");
+
+			for (u32 i = 0; i < values.size(); ++i)
+			{
+				const f32 value = values[i];
+				const f32 decoded = decode_half((u16)(out[i / 2] >> ((i % 2) * 16)));
+				if (std::abs(value) > 65519.f)
+					check(std::isinf(decoded) && std::signbit(decoded) == std::signbit(value), "out of range half is infinity");
+				else if (std::abs(value) < std::ldexp(1.f, -14))
+					check(decoded == 0.f, "half denormal flushes to zero");
+				else
+					check(std::abs(decoded - value) <= std::abs(value) * std::ldexp(1.f, -11), "half within half an ulp");
+			}
+		}
+	}
+}
+
+int main()
+{
+	std::mt19937 rng(1234);
+	test_positions(rng);
+	test_directions(rng);
+	test_halfs(rng);
+
+	if (g_failures == 0)
+		std::cout << "VertexQuantizationTest passed\n";
+	return g_failures == 0 ? 0 : 1;
+}